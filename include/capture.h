@@ -0,0 +1,53 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * In-process packet capture.
+ *
+ * Workers sample and filter (classic BPF) packets of the capturing
+ * devices, and hand them to per-lcore rings. TX packets are refcount
+ * clones; RX packets are copied (snaplen bounded) since they are
+ * rewritten in-place later. Master drains the rings and writes pcapng
+ * files, or forwards them to KNI for NETIF_PORT_FLAG_FORWARD2KNI.
+ */
+#ifndef __DPVS_CAPTURE_H__
+#define __DPVS_CAPTURE_H__
+#include "dpdk.h"
+#include "netif.h"
+#include "conf/capture.h"
+
+#define RTE_LOGTYPE_CAPTURE     RTE_LOGTYPE_USER1
+
+#define NETIF_PORT_FLAG_CAPTURE_ANY \
+    (NETIF_PORT_FLAG_CAPTURE | NETIF_PORT_FLAG_FORWARD2KNI)
+
+/* called by workers, @mbuf is not consumed. */
+void capture_packet(struct netif_port *dev, struct rte_mbuf *mbuf, uint8_t dir);
+
+static inline void capture_packet_check(struct netif_port *dev,
+                                        struct rte_mbuf *mbuf, uint8_t dir)
+{
+    if (unlikely(dev->flag & NETIF_PORT_FLAG_CAPTURE_ANY))
+        capture_packet(dev, mbuf, dir);
+}
+
+void capture_process_on_master(void);
+
+int capture_init(void);
+int capture_term(void);
+
+#endif /* __DPVS_CAPTURE_H__ */
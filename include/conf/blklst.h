@@ -32,6 +32,12 @@ enum {
     SOCKOPT_GET_BLKLST_GETALL,
 };
 
+enum {
+    /* set, with struct dp_vs_blklst_conf_array */
+    SOCKOPT_SET_BLKLST_ADD_BULK = 710,
+    SOCKOPT_SET_BLKLST_DEL_BULK,
+};
+
 struct dp_vs_blklst_entry {
     union inet_addr addr;
 };
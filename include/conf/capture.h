@@ -0,0 +1,76 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: control plane only
+ * based on dpvs_sockopt.
+ */
+#ifndef __DPVS_CAPTURE_CONF_H__
+#define __DPVS_CAPTURE_CONF_H__
+#include <stdint.h>
+#include <net/if.h>
+#include <linux/filter.h>
+
+enum {
+    /* set */
+    SOCKOPT_SET_CAPTURE_START   = 1200,
+    SOCKOPT_SET_CAPTURE_STOP,
+    /* get */
+    SOCKOPT_GET_CAPTURE_SHOW,
+};
+
+#define CAPTURE_BPF_MAXINSNS        256
+#define CAPTURE_FILE_NAMELEN        256
+#define CAPTURE_SNAPLEN_DEF         262144
+
+enum {
+    CAPTURE_DIR_RX      = 0x1,
+    CAPTURE_DIR_TX      = 0x2,
+    CAPTURE_DIR_BOTH    = CAPTURE_DIR_RX | CAPTURE_DIR_TX,
+};
+
+struct dp_vs_capture_conf {
+    char                ifname[IFNAMSIZ];   /* empty for all devices */
+    uint8_t             direction;          /* CAPTURE_DIR_XXX */
+    uint32_t            snaplen;
+    uint32_t            sample;             /* capture one of @sample packets, 0 for all */
+    uint32_t            count;              /* stop after @count packets, 0 for no limit */
+    char                file[CAPTURE_FILE_NAMELEN]; /* pcapng output file */
+    uint16_t            bpf_len;            /* 0 for no filter */
+    struct sock_filter  bpf[CAPTURE_BPF_MAXINSNS];  /* classic BPF, as `tcpdump -ddd` */
+};
+
+struct dp_vs_capture_lcore_stats {
+    uint8_t             cid;
+    uint64_t            captured;           /* packets enqueued to capture ring */
+    uint64_t            sampled;            /* skipped by sampling */
+    uint64_t            filtered;           /* rejected by BPF filter */
+    uint64_t            ring_full;          /* dropped, capture ring full */
+    uint64_t            nomem;              /* dropped, no clone/copy mbuf */
+};
+
+struct dp_vs_capture_show {
+    uint8_t             running;
+    struct dp_vs_capture_conf conf;
+    uint64_t            written;            /* packets written to file */
+    uint64_t            kni_sent;           /* packets forwarded to KNI */
+    uint64_t            kni_dropped;
+    int                 nlcore;
+    struct dp_vs_capture_lcore_stats lcores[0];
+};
+
+#endif /* __DPVS_CAPTURE_CONF_H__ */
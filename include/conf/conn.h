@@ -26,6 +26,11 @@
  */
 #define MAX_CTRL_CONN_GET_ENTRIES       1024
 
+/* How many hash buckets of one lcore walked at most for one sockopt ctrl msg,
+ * it bounds the time a worker spends on dumping connections.
+ */
+#define MAX_CTRL_CONN_DUMP_BUCKETS      16384
+
 
 enum conn_get_flags {
     GET_IPVS_CONN_FLAG_ALL          = 1,
@@ -41,6 +46,15 @@ enum conn_get_result {
     GET_IPVS_CONN_RESL_NOTEXIST     = 8,
 };
 
+enum conn_filter_flags {
+    CONN_FILTER_F_PROTO             = 0x01,
+    CONN_FILTER_F_VADDR             = 0x02, /* vaddr, and vport if non-zero */
+    CONN_FILTER_F_DADDR             = 0x04, /* real server, and dport if non-zero */
+    CONN_FILTER_F_CADDR             = 0x08, /* client prefix caddr/cplen */
+    CONN_FILTER_F_STATE             = 0x10, /* state name, e.g. "TCP_EST" */
+    CONN_FILTER_F_AGE               = 0x20, /* created at least min_age seconds ago */
+};
+
 enum {
     /* get */
     SOCKOPT_GET_CONN_ALL = 1000,
@@ -76,16 +90,36 @@ struct ip_vs_conn_entry {
 };
 typedef struct ip_vs_conn_entry ipvs_conn_entry_t;
 
+/* server side filter for SOCKOPT_GET_CONN_ALL, all set fields must match */
+struct ip_vs_conn_filter {
+    uint32_t            flags;      /* CONN_FILTER_F_XXX */
+    uint16_t            af;
+    uint16_t            proto;
+    union inet_addr     vaddr;
+    union inet_addr     daddr;
+    union inet_addr     caddr;
+    __be16              vport;
+    __be16              dport;
+    uint8_t             cplen;
+    char                state[16];
+    uint32_t            min_age;
+};
+
 struct ip_vs_conn_req {
     uint32_t flag;
-    uint32_t whence;
+    uint32_t whence;            /* cursor: lcore */
+    uint32_t bucket;            /* cursor: hash bucket of lcore @whence */
+    uint32_t offset;            /* cursor: conns of @bucket already walked */
     ipvs_sockpair_t sockpair;
+    struct ip_vs_conn_filter filter;
 };
 
 struct ip_vs_conn_array {
     uint32_t nconns;
     uint32_t resl;
     uint8_t curcid;
+    uint32_t bucket;            /* cursor to resume with GET_IPVS_CONN_FLAG_MORE */
+    uint32_t offset;
     ipvs_conn_entry_t array[0];
 } __attribute__((__packed__));
 
@@ -0,0 +1,44 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: control plane only
+ * based on dpvs_sockopt.
+ */
+#ifndef __DPVS_ESTATS_CONF_H__
+#define __DPVS_ESTATS_CONF_H__
+#include <stdint.h>
+
+enum {
+    /* get */
+    SOCKOPT_GET_ESTATS_SHOW     = 1800,
+};
+
+#define ESTATS_NAME_LEN             32
+
+/* ipvs extended counters (FULLNAT, SYNPROXY, ...) summed over lcores */
+struct dp_vs_estats_entry {
+    char                name[ESTATS_NAME_LEN];
+    uint64_t            value;
+};
+
+struct dp_vs_estats_show {
+    uint32_t            nstats;
+    struct dp_vs_estats_entry stats[0];
+};
+
+#endif /* __DPVS_ESTATS_CONF_H__ */
@@ -0,0 +1,65 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: control plane only
+ * based on dpvs_sockopt.
+ */
+#ifndef __DPVS_IPFIX_CONF_H__
+#define __DPVS_IPFIX_CONF_H__
+#include <stdint.h>
+#include <netinet/in.h>
+
+enum {
+    /* set */
+    SOCKOPT_SET_IPFIX_START     = 1500,
+    SOCKOPT_SET_IPFIX_STOP,
+    /* get */
+    SOCKOPT_GET_IPFIX_SHOW,
+};
+
+#define IPFIX_PORT_DEF              4739
+#define IPFIX_ACTIVE_TIMEOUT_DEF    60      /* sec */
+#define IPFIX_TEMPLATE_REFRESH_DEF  300     /* sec */
+
+struct dp_vs_ipfix_conf {
+    struct in_addr      collector;          /* UDP collector */
+    uint16_t            port;               /* network order, 0 for IPFIX_PORT_DEF */
+    uint32_t            domain_id;          /* observation domain */
+    uint32_t            active_timeout;     /* sec, 0 for IPFIX_ACTIVE_TIMEOUT_DEF */
+    uint32_t            template_refresh;   /* sec, 0 for IPFIX_TEMPLATE_REFRESH_DEF */
+};
+
+struct dp_vs_ipfix_lcore_stats {
+    uint8_t             cid;
+    uint64_t            records;            /* flow records queued to master */
+    uint64_t            nobuf;              /* dropped, no free batch buffer */
+    uint64_t            ring_full;          /* dropped, ring to master full */
+};
+
+struct dp_vs_ipfix_show {
+    uint8_t             running;
+    struct dp_vs_ipfix_conf conf;
+    uint64_t            sent_records;
+    uint64_t            sent_msgs;
+    uint64_t            sent_templates;
+    uint64_t            send_errors;        /* messages */
+    int                 nlcore;
+    struct dp_vs_ipfix_lcore_stats lcores[0];
+};
+
+#endif /* __DPVS_IPFIX_CONF_H__ */
@@ -29,6 +29,8 @@ enum {
     /* set */
     SOCKOPT_SET_NEIGH_ADD,
     SOCKOPT_SET_NEIGH_DEL,
+    SOCKOPT_SET_NEIGH_ADD_BULK,     /* struct dp_vs_neigh_conf_array */
+    SOCKOPT_SET_NEIGH_DEL_BULK,
 };
 
 enum {
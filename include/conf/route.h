@@ -35,6 +35,13 @@ enum {
     SOCKOPT_GET_ROUTE_SHOW,
 };
 
+enum {
+    /* set, with struct dp_vs_route_conf_array, for controllers
+     * pushing lots of routes at once */
+    SOCKOPT_SET_ROUTE_ADD_BULK  = 310,
+    SOCKOPT_SET_ROUTE_DEL_BULK,
+};
+
 enum {
     ROUTE_CF_SCOPE_NONE     = 0,
     ROUTE_CF_SCOPE_HOST,
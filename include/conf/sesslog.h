@@ -0,0 +1,110 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: control plane only
+ * based on dpvs_sockopt.
+ */
+#ifndef __DPVS_SESSLOG_CONF_H__
+#define __DPVS_SESSLOG_CONF_H__
+#include <stdint.h>
+#include "inet.h"
+
+enum {
+    /* set */
+    SOCKOPT_SET_SESSLOG_START   = 1400,
+    SOCKOPT_SET_SESSLOG_STOP,
+    /* get */
+    SOCKOPT_GET_SESSLOG_SHOW,
+};
+
+#define SESSLOG_PATH_LEN            108     /* sizeof(sun_path) */
+
+enum {
+    SESSLOG_SINK_FILE   = 1,        /* append records to a binary file */
+    SESSLOG_SINK_UNIX   = 2,        /* unix datagram socket, one batch per datagram */
+};
+
+/* record types, also used as event mask of the conf */
+enum {
+    SESSLOG_REC_CREATE  = 0x1,
+    SESSLOG_REC_EXPIRE  = 0x2,
+};
+
+struct dp_vs_sesslog_conf {
+    uint8_t             sink;               /* SESSLOG_SINK_XXX */
+    uint8_t             events;             /* SESSLOG_REC_XXX mask, 0 for all */
+    uint32_t            sample;             /* log one of @sample sessions, 0 for all */
+    char                path[SESSLOG_PATH_LEN];
+};
+
+/*
+ * output format: file starts with a header, followed by records.
+ * datagrams of unix sink carry records only. all fields in host order
+ * except ports, which are in network order as in dp_vs_conn.
+ */
+#define SESSLOG_FILE_MAGIC          0x44505353  /* "DPSS" */
+#define SESSLOG_FILE_VERSION        1
+
+struct dp_vs_sesslog_file_hdr {
+    uint32_t            magic;
+    uint16_t            version;
+    uint16_t            rec_size;
+} __attribute__((__packed__));
+
+struct dp_vs_sesslog_rec {
+    uint8_t             type;               /* SESSLOG_REC_XXX */
+    uint8_t             af;                 /* client side */
+    uint8_t             daf;                /* RS side */
+    uint8_t             proto;
+    uint8_t             fwdmode;
+    uint8_t             cid;
+    uint16_t            state;
+    uint16_t            cport;
+    uint16_t            vport;
+    uint16_t            lport;
+    uint16_t            dport;
+    uint64_t            time;               /* ns since epoch */
+    uint64_t            duration;           /* us, expire only */
+    union inet_addr     caddr;
+    union inet_addr     vaddr;
+    union inet_addr     laddr;
+    union inet_addr     daddr;
+    uint64_t            inpkts;             /* expire only */
+    uint64_t            inbytes;
+    uint64_t            outpkts;
+    uint64_t            outbytes;
+} __attribute__((__packed__));
+
+struct dp_vs_sesslog_lcore_stats {
+    uint8_t             cid;
+    uint64_t            logged;             /* records queued to master */
+    uint64_t            sampled;            /* sessions skipped by sampling */
+    uint64_t            nobuf;              /* dropped, no free batch buffer */
+    uint64_t            ring_full;          /* dropped, ring to master full */
+};
+
+struct dp_vs_sesslog_show {
+    uint8_t             running;
+    struct dp_vs_sesslog_conf conf;
+    uint64_t            written;            /* records written by master */
+    uint64_t            write_errors;       /* records lost by sink errors or backpressure */
+    int                 nlcore;
+    struct dp_vs_sesslog_lcore_stats lcores[0];
+};
+
+#endif /* __DPVS_SESSLOG_CONF_H__ */
@@ -0,0 +1,66 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Note: control plane only
+ * based on dpvs_sockopt.
+ */
+#ifndef __DPVS_SYNC_CONF_H__
+#define __DPVS_SYNC_CONF_H__
+#include <stdint.h>
+#include <net/if.h>
+
+enum {
+    /* set */
+    SOCKOPT_SET_SYNC_START  = 1700,
+    SOCKOPT_SET_SYNC_STOP,
+    /* get */
+    SOCKOPT_GET_SYNC_SHOW,
+};
+
+/* same values as IP_VS_STATE_XXX of the kernel */
+#define DP_VS_SYNC_MASTER           0x1
+#define DP_VS_SYNC_BACKUP           0x2
+
+struct dp_vs_sync_daemon_conf {
+    int                 state;              /* DP_VS_SYNC_MASTER or DP_VS_SYNC_BACKUP */
+    char                mcast_ifn[IFNAMSIZ];/* kernel interface, e.g. KNI of a dpdk port */
+    int                 syncid;             /* 0 for any on backup */
+};
+
+struct dp_vs_sync_stats {
+    /* master */
+    uint64_t            queued;             /* conn events queued by workers */
+    uint64_t            dropped;            /* events dropped, no buffer or ring full */
+    uint64_t            sent_conns;
+    uint64_t            sent_mesgs;
+    uint64_t            send_errors;
+    /* backup */
+    uint64_t            recv_conns;
+    uint64_t            recv_mesgs;
+    uint64_t            recv_errors;        /* malformed or foreign syncid */
+    uint64_t            installed;          /* new connections */
+    uint64_t            updated;            /* existing connections */
+    uint64_t            install_errors;     /* no service/dest, conflicting or no resource */
+};
+
+struct dp_vs_sync_show {
+    struct dp_vs_sync_daemon_conf daemons[2]; /* master, backup; state 0 if stopped */
+    struct dp_vs_sync_stats stats;
+};
+
+#endif /* __DPVS_SYNC_CONF_H__ */
@@ -68,7 +68,10 @@ struct dpvs_msg {
     struct dpvs_msg_reply reply;
     /* response data, created with rte_malloc... and filled by callback */
     uint32_t len;           /* msg data length */
-    char data[0];           /* msg data */
+    char *data;             /* msg data, points to @buf, or to the payload of
+                               the original msg for multicast msg on slaves,
+                               or to @reply.data for slave's reply msg */
+    char buf[0];
 };
 
 static inline uint32_t get_msg_flags(struct dpvs_msg *msg)
@@ -118,6 +121,7 @@ struct dpvs_multicast_queue {
     uint64_t mask;          /* bit-wise core mask */
     struct list_head mq;    /* recieved msg queue */
     struct dpvs_msg *org_msg; /* original msg from 'multicast_msg_send', sender should never visit me */
+    struct dpvs_msg *replies[DPVS_MAX_LCORE]; /* slave's reply msg indexed by lcore, also linked in @mq */
     struct list_head list;
 };
 
@@ -193,6 +197,10 @@ int msg_type_table_print(char *buf, int len); /* debug */
 #define MSG_TYPE_IPV6_STATS                 16
 #define MSG_TYPE_ROUTE6                     17
 #define MSG_TYPE_NEIGH_GET                  18
+#define MSG_TYPE_STATS_GET_BULK             19
+#define MSG_TYPE_SYNC_CONN                  20
+#define MSG_TYPE_TUNNEL6                    21
+#define MSG_TYPE_SESSLOG_RESET              22
 
 #define SOCKOPT_VERSION_MAJOR               1
 #define SOCKOPT_VERSION_MINOR               0
@@ -229,12 +237,42 @@ struct dpvs_sock_msg_reply {
     char data[0];
 };
 
+/*
+ * batch of set messages, applied in order within one request.
+ * msg id is SOCKOPT_SET_BATCH, data is dpvs_sock_batch followed by
+ * @count entries, each padded to DPVS_SOCK_BATCH_ALIGN.
+ *
+ * with DPVS_SOCK_BATCH_F_RESULTS (ignored if atomic), errcode of the reply
+ * only tells if the batch is valid, the reply data is an int32_t result
+ * of each entry, EDPVS_IDLE for entries not applied.
+ */
+#define SOCKOPT_SET_BATCH                   1300
+
+#define DPVS_SOCK_BATCH_F_ATOMIC            0x1 /* roll back all on failure */
+#define DPVS_SOCK_BATCH_F_CONTINUE          0x2 /* apply the rest on failure */
+#define DPVS_SOCK_BATCH_F_RESULTS           0x4 /* reply result of each entry */
+#define DPVS_SOCK_BATCH_ALIGN(len)          (((len) + 7) & ~((size_t)7))
+
+struct dpvs_sock_batch {
+    uint32_t flags;
+    uint32_t count;
+    char data[0];
+};
+
+struct dpvs_sock_batch_entry {
+    sockoptid_t id;
+    uint32_t len;
+    char data[0];
+};
+
 struct dpvs_sockopts {
     uint32_t version;
     struct list_head list;
     sockoptid_t set_opt_min;
     sockoptid_t set_opt_max;
     int (*set)(sockoptid_t opt, const void *in, size_t inlen);
+    /* optional, revert a successful set of a failed atomic batch */
+    int (*rollback)(sockoptid_t opt, const void *in, size_t inlen);
     sockoptid_t get_opt_min;
     sockoptid_t get_opt_max;
     int (*get)(sockoptid_t opt, const void *in, size_t inlen, void **out, size_t *outlen);
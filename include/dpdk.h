@@ -40,6 +40,7 @@
 #include <rte_debug.h>
 #include <rte_ether.h>
 #include <rte_ethdev.h>
+#include <rte_flow.h>
 #include <rte_ring.h>
 #include <rte_mempool.h>
 #include <rte_mbuf.h>
@@ -55,6 +56,8 @@
 #include <rte_kni.h>
 #include <rte_ip_frag.h>
 #include <rte_eth_bond.h>
+#include <rte_gro.h>
+#include <rte_gso.h>
 #include "mbuf.h"
 
 typedef uint8_t lcoreid_t;
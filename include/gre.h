@@ -0,0 +1,109 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * GRE header helpers shared by GRE/IP and GRE/IPv6 tunnels.
+ * refer linux:include/net/gre.h
+ */
+#ifndef __DPVS_GRE_H__
+#define __DPVS_GRE_H__
+#include <endian.h>
+#include "ip_tunnel.h"
+
+#define GRE_F_CSUM          htobe16(0x8000)
+#define GRE_F_ROUTING       htobe16(0x4000)
+#define GRE_F_KEY           htobe16(0x2000)
+#define GRE_F_SEQ           htobe16(0x1000)
+#define GRE_F_STRICT        htobe16(0x0800)
+#define GRE_F_REC           htobe16(0x0700)
+#define GRE_F_FLAGS         htobe16(0x00F8)
+#define GRE_F_VERSION       htobe16(0x0007)
+
+/* linux: net/gre.h */
+struct gre_base_hdr {
+    __be16  flags;
+    __be16  protocol;
+} __attribute__((__packed__));
+
+/* linux: gre_flags_to_tnl_flags */
+static inline __be16 flags_gre2tnl(__be16 flags)
+{
+    __be16 tflags = 0;
+
+    if (flags & GRE_F_CSUM)
+        tflags |= TUNNEL_F_CSUM;
+    if (flags & GRE_F_ROUTING)
+        tflags |= TUNNEL_F_ROUTING;
+    if (flags & GRE_F_KEY)
+        tflags |= TUNNEL_F_KEY;
+    if (flags & GRE_F_SEQ)
+        tflags |= TUNNEL_F_SEQ;
+    if (flags & GRE_F_STRICT)
+        tflags |= TUNNEL_F_STRICT;
+    if (flags & GRE_F_REC)
+        tflags |= TUNNEL_F_REC;
+    if (flags & GRE_F_VERSION)
+        tflags |= TUNNEL_F_VERSION;
+
+    return tflags;
+}
+
+/* linux: gre_tnl_flags_to_gre_flags */
+static inline __be16 flags_tnl2gre(__be16 tflags)
+{
+    __be16 flags = 0;
+
+    if (tflags & TUNNEL_F_CSUM)
+        flags |= GRE_F_CSUM;
+    if (tflags & TUNNEL_F_ROUTING)
+        flags |= GRE_F_ROUTING;
+    if (tflags & TUNNEL_F_KEY)
+        flags |= GRE_F_KEY;
+    if (tflags & TUNNEL_F_SEQ)
+        flags |= GRE_F_SEQ;
+    if (tflags & TUNNEL_F_STRICT)
+        flags |= GRE_F_STRICT;
+    if (tflags & TUNNEL_F_REC)
+        flags |= GRE_F_REC;
+    if (tflags & TUNNEL_F_VERSION)
+        flags |= GRE_F_VERSION;
+
+    return flags;
+}
+
+/* linux: gre_calc_hlen */
+static inline int gre_calc_hlen(__be16 o_flags)
+{
+    int addend = 4;
+
+    if (o_flags & TUNNEL_F_CSUM)
+        addend += 4;
+    if (o_flags & TUNNEL_F_KEY)
+        addend += 4;
+    if (o_flags & TUNNEL_F_SEQ)
+        addend += 4;
+
+    return addend;
+}
+
+int gre_build_header(struct rte_mbuf *mbuf, int hlen, __be16 flags,
+                     __be16 proto, __be32 key, __be32 seq);
+
+int gre_parse_header(struct rte_mbuf *mbuf, struct ip_tunnel_pktinfo *tpi,
+                     bool *csum_err, __be16 proto);
+
+#endif /* __DPVS_GRE_H__ */
@@ -261,6 +261,54 @@ static inline void inet_stats_dump(const char *title, const char *prefix,
 #ifdef __DPVS__
 #include "dpdk.h"
 #include "netif.h"
+
+/*
+ * Incremental checksum update (RFC 1624).
+ *
+ * @old and @new are raw (unfolded) one's complement sums of the words
+ * being replaced and of their replacement, e.g., rewritten addresses
+ * and ports, so the checksum of a translated packet can be updated
+ * without summing its payload again.
+ */
+static inline uint16_t inet_csum_fold(uint32_t sum)
+{
+    sum = (sum & 0xffff) + (sum >> 16);
+    sum = (sum & 0xffff) + (sum >> 16);
+    return (uint16_t)sum;
+}
+
+static inline uint16_t inet_csum_update(uint16_t check,
+                                        uint32_t old, uint32_t new)
+{
+    /* HC' = ~(~HC + ~m + m') */
+    uint32_t sum = (uint16_t)~check;
+
+    sum += (uint16_t)~inet_csum_fold(old);
+    sum += inet_csum_fold(new);
+
+    return (uint16_t)~inet_csum_fold(sum);
+}
+
+static inline void inet_csum_replace2(uint16_t *check,
+                                      uint16_t old, uint16_t new)
+{
+    *check = inet_csum_update(*check, old, new);
+}
+
+static inline void inet_csum_replace4(uint16_t *check,
+                                      uint32_t old, uint32_t new)
+{
+    *check = inet_csum_update(*check, (old >> 16) + (old & 0xffff),
+                              (new >> 16) + (new & 0xffff));
+}
+
+/* raw sum of an address as it appears in the pseudo-header */
+static inline uint32_t inet_addr_csum(int af, const union inet_addr *addr)
+{
+    return __rte_raw_cksum(addr, af == AF_INET6 ?
+                           sizeof(struct in6_addr) : sizeof(struct in_addr), 0);
+}
+
 /*
  * Inet Hooks
  */
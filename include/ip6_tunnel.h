@@ -0,0 +1,158 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * dpvs IPv6 tunnel common codes.
+ * refer linux:include/net/ip6_tunnel.h
+ *       linux:include/uapi/linux/ip6_tunnel.h
+ *
+ * unlike IPv4 tunnels, the tunnel table and the underlay route cache
+ * are per-lcore, so data plane lookups need no lock. the master changes
+ * the tables by multicast msgs, see ip6_tunnel.c.
+ */
+#ifndef __DPVS_IP6_TUNNEL_H__
+#define __DPVS_IP6_TUNNEL_H__
+#include <net/if.h>
+#include <netinet/in.h>
+#include "ip_tunnel.h"
+#if defined(__DPVS__)
+#include "list.h"
+#include "netif.h"
+#include "route6.h"
+#endif
+
+/* ip6_tunnel_param.flags */
+#define IP6_TNL_F_USE_ORIG_TCLASS   0x2 /* inherit tclass of inner packet */
+
+enum {
+    /* set */
+    SOCKOPT_TUNNEL6_ADD         = 1600,
+    SOCKOPT_TUNNEL6_DEL,
+    SOCKOPT_TUNNEL6_CHANGE,
+    SOCKOPT_TUNNEL6_REPLACE,
+
+    /* get */
+    SOCKOPT_TUNNEL6_SHOW        = 1600,
+};
+
+struct ip6_tunnel_param {
+    char            ifname[IFNAMSIZ];
+    char            kind[TNLKINDSIZ];
+    char            link[IFNAMSIZ];
+    __be16          i_flags;
+    __be16          o_flags;
+    __be32          i_key;
+    __be32          o_key;
+    struct in6_addr laddr;
+    struct in6_addr raddr;
+    uint8_t         hop_limit;  /* 0 for inherit */
+    uint8_t         tclass;
+    uint32_t        flags;      /* IP6_TNL_F_XXX */
+} __attribute__((__packed__));
+
+#if defined(__DPVS__)
+
+struct ip6_tunnel_tab;
+
+struct ip6_tunnel_ops {
+    const char              *kind;
+    uint32_t                priv_size;
+    struct list_head        list;
+    struct ip6_tunnel_tab   *tab;
+    void                    (*setup)(struct netif_port *dev);
+    int                     (*change)(struct netif_port *dev,
+                                      const struct ip6_tunnel_param *params);
+};
+
+#define IP6_TNL_HASH_BITS   7
+#define IP6_TNL_HASH_SIZE   (1 << IP6_TNL_HASH_BITS)
+
+/* table of tunnels for each kind, one hash table per lcore. */
+struct ip6_tunnel_tab {
+    struct hlist_head       tunnels[DPVS_MAX_LCORE][IP6_TNL_HASH_SIZE];
+    int                     nb_tnl; /* total number of tunnel */
+    struct ip6_tunnel_ops   *ops;
+};
+
+/*
+ * underlay route cached by each lcore, valid in generation @gen of
+ * neigh_generation(), so route changes need not walk the tunnels.
+ *
+ * xmit reads the lcore's own copy of link/params/hlen, taken when the
+ * tunnel is linked on the lcore, since slaves keep sending through the
+ * device by routes while the master changes the tunnel.
+ */
+struct ip6_tunnel_dst {
+    struct route6           *rt;
+    struct in6_addr         saddr;
+    uint32_t                gen;
+    uint32_t                mtu;    /* path MTU of inner packets */
+
+    struct netif_port       *link;
+    struct ip6_tunnel_param params;
+    int                     hlen;
+} __rte_cache_aligned;
+
+struct ip6_tunnel {
+    struct hlist_node       hlist[DPVS_MAX_LCORE];
+    struct netif_port       *dev;
+    struct netif_port       *link;
+    struct ip6_tunnel_tab   *tab;
+    struct ip6_tunnel_param params;
+    int                     hlen;   /* tunnel header length, not IPv6 */
+
+    /* DPVS_MAX_LCORE entries */
+    struct ip6_tunnel_dst   *dst_cache;
+};
+
+/* tunnel state of current lcore, for xmit */
+static inline struct ip6_tunnel_dst *ip6_tunnel_this_dst(struct ip6_tunnel *tnl)
+{
+    return &tnl->dst_cache[rte_lcore_id()];
+}
+
+int ip6_tunnel_init(void);
+int ip6_tunnel_term(void);
+
+int ip6_tunnel_init_tab(struct ip6_tunnel_tab *tab,
+                        struct ip6_tunnel_ops *ops);
+int ip6_tunnel_term_tab(struct ip6_tunnel_tab *tab);
+
+struct ip6_tunnel *ip6_tunnel_lookup(struct ip6_tunnel_tab *tab,
+                                     portid_t link, __be16 flags,
+                                     const struct in6_addr *remote,
+                                     const struct in6_addr *local,
+                                     __be32 key);
+
+int ip6_tunnel_rcv(struct ip6_tunnel *tnl, struct ip_tunnel_pktinfo *tpi,
+                   struct rte_mbuf *mbuf);
+
+int ip6_tunnel_xmit(struct rte_mbuf *mbuf, struct netif_port *dev,
+                    uint8_t proto);
+
+int ip6_tunnel_get_link(struct netif_port *dev, struct rte_eth_link *link);
+int ip6_tunnel_get_stats(struct netif_port *dev, struct rte_eth_stats *stats);
+int ip6_tunnel_get_promisc(struct netif_port *dev, bool *promisc);
+
+int ip6ip6_init(void);
+int ip6ip6_term(void);
+
+int ip6gre_init(void);
+int ip6gre_term(void);
+
+#endif /* __DPVS__ */
+#endif /* __DPVS_IP6_TUNNEL_H__ */
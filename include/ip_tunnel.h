@@ -82,6 +82,7 @@ struct ip_tunnel_ops {
     uint32_t                priv_size;
     struct list_head        list;
     struct ip_tunnel_tab    *tab;
+    bool                    kni;    /* attach KNI, for ethernet tunnels */
     void                    (*setup)(struct netif_port *dev);
     int                     (*change)(struct netif_port *dev,
                                       const struct ip_tunnel_param *params);
@@ -151,5 +152,8 @@ int ipip_term(void);
 int gre_init(void);
 int gre_term(void);
 
+int vxlan_init(void);
+int vxlan_term(void);
+
 #endif /* __DPVS__ */
 #endif /* __DPVS_TUNNEL_H__ */
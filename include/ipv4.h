@@ -138,6 +138,38 @@ static inline void ip4_send_csum(struct ipv4_hdr *iph)
     iph->hdr_checksum = rte_ipv4_cksum(iph);
 }
 
+/*
+ * header rewrites keeping @iph->hdr_checksum valid (RFC 1624),
+ * so translated packets need no full header re-checksum.
+ */
+static inline void ip4_set_saddr(struct ipv4_hdr *iph, uint32_t addr)
+{
+    inet_csum_replace4(&iph->hdr_checksum, iph->src_addr, addr);
+    iph->src_addr = addr;
+}
+
+static inline void ip4_set_daddr(struct ipv4_hdr *iph, uint32_t addr)
+{
+    inet_csum_replace4(&iph->hdr_checksum, iph->dst_addr, addr);
+    iph->dst_addr = addr;
+}
+
+/* @len in network order */
+static inline void ip4_set_tot_len(struct ipv4_hdr *iph, uint16_t len)
+{
+    inet_csum_replace2(&iph->hdr_checksum, iph->total_length, len);
+    iph->total_length = len;
+}
+
+static inline void ip4_decrease_ttl(struct ipv4_hdr *iph)
+{
+    uint32_t csum = (uint32_t)iph->hdr_checksum;
+
+    csum += (uint32_t)htons(0x0100);
+    iph->hdr_checksum = (uint16_t)(csum + (csum >= 0xffff));
+    iph->time_to_live--;
+}
+
 static inline bool ip4_is_frag(struct ipv4_hdr *iph)
 {
     return (iph->fragment_offset
@@ -39,6 +39,8 @@ enum {
     DPVS_CONN_F_HASHED          = 0x0040,
     DPVS_CONN_F_REDIRECT_HASHED = 0x0080,
     DPVS_CONN_F_INACTIVE        = 0x0100,
+    DPVS_CONN_F_SYNCED          = 0x0200,   /* synchronized to backup directors */
+    DPVS_CONN_F_LOGGED          = 0x0400,   /* creation logged, log expiry too */
     DPVS_CONN_F_SYNPROXY        = 0x8000,
     DPVS_CONN_F_TEMPLATE        = 0x1000,
     DPVS_CONN_F_NOFASTXMIT      = 0x2000,
@@ -67,11 +69,12 @@ struct conn_tuple_hash {
     uint16_t            dport;
 } __rte_cache_aligned;
 
+/* conn is lcore-local, counters need no atomic ops */
 struct dp_vs_conn_stats {
-    rte_atomic64_t      inpkts;
-    rte_atomic64_t      inbytes;
-    rte_atomic64_t      outpkts;
-    rte_atomic64_t      outbytes;
+    uint64_t            inpkts;
+    uint64_t            inbytes;
+    uint64_t            outpkts;
+    uint64_t            outbytes;
 } __rte_cache_aligned;
 
 struct dp_vs_fdir_filt;
@@ -113,9 +116,7 @@ struct dp_vs_conn {
                         struct dp_vs_conn *conn,
                         struct rte_mbuf *mbuf);
 
-    /* L2 fast xmit */
-    struct ether_addr       in_smac;
-    struct ether_addr       in_dmac;
+    /* L2 fast xmit, inbound is cached in dest (see dp_vs_dest_nh) */
     struct ether_addr       out_smac;
     struct ether_addr       out_dmac;
 
@@ -148,10 +149,16 @@ struct dp_vs_conn {
     /* controll members */
     struct dp_vs_conn *control;         /* master who controlls me */
     rte_atomic32_t n_control;           /* number of connections controlled by me*/
-    uint64_t ctime;                     /* create time */
+    uint64_t ctime;                     /* create time, always set */
 
     /* connection redirect in fnat/snat/nat modes */
     struct dp_vs_redirect  *redirect;
+
+    /* last synchronized to backup directors, in timer cycles */
+    uint64_t sync_tsc;
+
+    /* last exported to IPFIX collector, in TSC */
+    uint64_t ipfix_tsc;
 } __rte_cache_aligned;
 
 /* for syn-proxy to save all ack packet in conn before rs's syn-ack arrives */
@@ -175,6 +182,13 @@ dp_vs_conn_new(struct rte_mbuf *mbuf,
                uint32_t flags);
 int dp_vs_conn_del(struct dp_vs_conn *conn);
 
+struct dp_vs_conn *
+dp_vs_conn_sync_new(const struct dp_vs_conn_param *param,
+                    struct dp_vs_dest *dest,
+                    const union inet_addr *laddr, uint16_t lport,
+                    const union inet_addr *daddr, uint16_t dport,
+                    uint32_t flags);
+
 struct dp_vs_conn *
 dp_vs_conn_get(int af, uint16_t proto,
                 const union inet_addr *saddr,
@@ -30,6 +30,7 @@ enum dpvs_fwd_mode {
     DPVS_FWD_MODE_FNAT      = 5,
     DPVS_FWD_MODE_NAT       = DPVS_FWD_MASQ,
     DPVS_FWD_MODE_SNAT      = 6,
+    DPVS_FWD_MODE_VXLAN     = 7,
 };
 
 enum {
@@ -41,6 +42,24 @@ enum {
 #include "common.h"
 #include "list.h"
 #include "dpdk.h"
+#include "vxlan.h"
+
+/*
+ * next hop to the real server, cached per lcore and shared by all conns
+ * of the lcore to the dest for fast xmit. it's valid only in generation
+ * @gen of neigh_generation(), so neighbour and route changes need not
+ * to walk conns.
+ */
+struct dp_vs_dest_nh {
+    struct netif_port   *dev;
+    struct ether_addr   smac;
+    struct ether_addr   dmac;
+    uint32_t            gen;
+    uint16_t            mtu;        /* 0 if not known (learned from RS) */
+    struct in_addr      tun_src;    /* outer source of IPIP tunnel */
+    bool                vxlan;      /* dest->encap[@encap_idx] is used */
+    uint8_t             encap_idx;
+} __rte_cache_aligned;
 
 struct dp_vs_dest {
     struct list_head    n_list;     /* for the dests in the service */
@@ -79,7 +98,27 @@ struct dp_vs_dest {
     union inet_addr     vaddr;      /* virtual IP address */
     unsigned            conn_timeout; /* conn timeout copied from svc*/
     unsigned            limit_proportion; /* limit copied from svc*/
+
+    /*
+     * prebuilt VXLAN headers, the same for all lcores. lcores rebuild
+     * them on cache miss (e.g., VXLAN device changed) into the unused
+     * copy, so readers of the current copy are never disturbed.
+     */
+    rte_spinlock_t      encap_lock;
+    uint8_t             encap_cur;
+    struct vxlan_encap  encap[2];
+
+    /* next hop cache of each forwarding lcore, see dp_vs_dest_lcore_nh() */
+    struct dp_vs_dest_nh nh[0];
 } __rte_cache_aligned;
+
+/* slot of each lcore in dest->nh[], set by dp_vs_dest_init() */
+extern uint8_t dp_vs_dest_nh_index[DPVS_MAX_LCORE];
+
+static inline struct dp_vs_dest_nh *dp_vs_dest_lcore_nh(struct dp_vs_dest *dest)
+{
+    return &dest->nh[dp_vs_dest_nh_index[rte_lcore_id()]];
+}
 #endif
 
 struct dp_vs_dest_conf {
@@ -198,6 +237,9 @@ void __dp_vs_del_dest(struct dp_vs_dest *dest);
 
 int dp_vs_del_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest);
 
+void dp_vs_fill_dest_entry(struct dp_vs_dest_entry *entry,
+                           const struct dp_vs_dest *dest);
+
 int dp_vs_get_dest_entries(const struct dp_vs_service *svc,
                            const struct dp_vs_get_dests *get,
                            struct dp_vs_get_dests *uptr);
@@ -0,0 +1,67 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * IPFIX (RFC 7011) flow export.
+ *
+ * Workers emit a flow record when a conn expires, and every active
+ * timeout for a conn still passing traffic. Records are batched to
+ * master by per-lcore rings, master encodes them with cached templates
+ * (per client/RS address family) and sends them to a UDP collector.
+ */
+#ifndef __DPVS_IPFIX_H__
+#define __DPVS_IPFIX_H__
+#include "common.h"
+#include "ipvs/conn.h"
+#include "conf/ipfix.h"
+
+/* flowEndReason */
+#define IPFIX_END_IDLE_TIMEOUT      1
+#define IPFIX_END_ACTIVE_TIMEOUT    2
+#define IPFIX_END_OF_FLOW           3
+
+extern volatile bool dp_vs_ipfix_on;
+extern uint64_t dp_vs_ipfix_active_cycles;
+
+void __dp_vs_ipfix_conn_export(struct dp_vs_conn *conn, uint8_t reason);
+
+/* called by workers for each packet of @conn */
+static inline void dp_vs_ipfix_conn_active(struct dp_vs_conn *conn)
+{
+    uint64_t last;
+
+    if (likely(!dp_vs_ipfix_on))
+        return;
+
+    last = conn->ipfix_tsc ? conn->ipfix_tsc : conn->ctime;
+    if (unlikely(rte_rdtsc() - last >= dp_vs_ipfix_active_cycles))
+        __dp_vs_ipfix_conn_export(conn, IPFIX_END_ACTIVE_TIMEOUT);
+}
+
+/* called by workers from conn timer when @conn is released */
+static inline void dp_vs_ipfix_conn_expire(struct dp_vs_conn *conn)
+{
+    if (unlikely(dp_vs_ipfix_on))
+        __dp_vs_ipfix_conn_export(conn, IPFIX_END_IDLE_TIMEOUT);
+}
+
+void dp_vs_ipfix_process_on_master(void);
+
+int dp_vs_ipfix_init(void);
+int dp_vs_ipfix_term(void);
+
+#endif /* __DPVS_IPFIX_H__ */
@@ -23,6 +23,9 @@
 
 int dp_vs_laddr_bind(struct dp_vs_conn *conn, struct dp_vs_service *svc);
 int dp_vs_laddr_unbind(struct dp_vs_conn *conn);
+/* bind the given <laddr, lport>, for connections synchronized from peers */
+int dp_vs_laddr_bind_port(struct dp_vs_conn *conn, struct dp_vs_service *svc,
+                          const union inet_addr *addr, uint16_t lport);
 
 int dp_vs_laddr_add(struct dp_vs_service *svc, int af, const union inet_addr *addr,
                     const char *ifname);
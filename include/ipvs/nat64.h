@@ -28,16 +28,21 @@ static inline int mbuf_nat6to4_len(struct rte_mbuf *mbuf)
     int len;
 
     offset = ip6_skip_exthdr(mbuf, offset, &nexthdr);
-    len = mbuf->pkt_len - offset + sizeof(struct ipv4_hdr);
+    len = mbuf_l3_seg_len(mbuf) - offset + sizeof(struct ipv4_hdr);
 
     return len;
 }
 
 static inline int mbuf_nat4to6_len(struct rte_mbuf *mbuf)
 {
-    return (mbuf->pkt_len - ip4_hdrlen(mbuf) + sizeof(struct ip6_hdr));
+    return (mbuf_l3_seg_len(mbuf) - ip4_hdrlen(mbuf) + sizeof(struct ip6_hdr));
 }
 
+/*
+ * L3 translation in place: the old header is trimmed and the new one is
+ * written into the headroom just before L4, payload is never moved.
+ * the IPv4 header from mbuf_6to4() has a valid checksum.
+ */
 int mbuf_6to4(struct rte_mbuf *mbuf,
               const struct in_addr *saddr,
               const struct in_addr *daddr);
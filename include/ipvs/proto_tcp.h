@@ -36,6 +36,8 @@ enum {
 #define TCP_OLEN_IP4_ADDR           8
 #define TCP_OLEN_IP6_ADDR           20
 
+#define MAX_TCP_OPT_LEN             40
+
 #define TCP_OLEN_TSTAMP_ALIGNED     12
 #define TCP_OLEN_SACK_BASE          2
 #define TCP_OLEN_SACK_PERBLOCK      8
@@ -105,5 +107,6 @@ void tcp6_send_csum(struct ipv6_hdr *iph, struct tcphdr *th);
 struct rte_mempool *get_mbuf_pool(const struct dp_vs_conn *conn, int dir);
 void install_proto_tcp_keywords(void);
 void tcp_keyword_value_init(void);
+int tcp_toa_benchmark(int rounds);
 
 #endif
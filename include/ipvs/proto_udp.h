@@ -30,6 +30,9 @@ extern int g_defence_udp_drop;
 void install_proto_udp_keywords(void);
 void udp_keyword_value_init(void);
 
+void udp_uoa_batch_flush(lcoreid_t cid);
+void udp_uoa_batch_kick(struct dp_vs_conn *conn);
+
 void udp4_send_csum(struct ipv4_hdr *iph, struct udp_hdr *uh);
 void udp6_send_csum(struct ipv6_hdr *iph, struct udp_hdr *uh);
 
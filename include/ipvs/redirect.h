@@ -48,13 +48,15 @@ struct dp_vs_redirect *dp_vs_redirect_alloc(enum dpvs_fwd_mode fwdmode);
 void dp_vs_redirect_free(struct dp_vs_conn *conn);
 void dp_vs_redirect_hash(struct dp_vs_conn *conn);
 void dp_vs_redirect_unhash(struct dp_vs_conn *conn);
-struct dp_vs_redirect *dp_vs_redirect_get(int af, uint16_t proto,
+int dp_vs_redirect_get(int af, uint16_t proto,
     const union inet_addr *saddr, const union inet_addr *daddr,
-    uint16_t sport, uint16_t dport);
+    uint16_t sport, uint16_t dport, lcoreid_t *cid);
 void dp_vs_redirect_init(struct dp_vs_conn *conn);
 int dp_vs_redirect_table_init(void);
 int dp_vs_redirect_pkt(struct rte_mbuf *mbuf, lcoreid_t peer_cid);
 void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid);
+void dp_vs_redirect_ring_flush(lcoreid_t cid);
+lcoreid_t dp_vs_redirect_frag_lcore(const struct ipv4_hdr *iph);
 int dp_vs_redirects_init(void);
 int dp_vs_redirects_term(void);
 
@@ -142,6 +142,14 @@ struct dp_vs_get_services {
     struct dp_vs_service_entry entrytable[0];
 };
 
+/* reply of DPVS_SO_GET_SNAPSHOT: each dp_vs_service_entry is followed by
+ * its @num_dests dp_vs_dest_entry, stats are summed over all lcores. */
+struct dp_vs_get_snapshot {
+    unsigned int        num_services;
+    unsigned int        num_dests;      /* of all services */
+    char                entries[0];
+};
+
 struct dp_vs_service_user{
     int               af;
     uint16_t          proto;
@@ -239,12 +247,13 @@ enum{
     DPVS_SO_GET_SERVICES,
     DPVS_SO_GET_SERVICE,
     DPVS_SO_GET_DESTS,
+    DPVS_SO_GET_SNAPSHOT,
 };
 
 
 #define SOCKOPT_SVC_BASE         DPVS_SO_SET_FLUSH
 #define SOCKOPT_SVC_SET_CMD_MAX  DPVS_SO_SET_GRATARP
-#define SOCKOPT_SVC_GET_CMD_MAX  DPVS_SO_GET_DESTS
+#define SOCKOPT_SVC_GET_CMD_MAX  DPVS_SO_GET_SNAPSHOT
 
 #define MAX_ARG_LEN    (sizeof(struct dp_vs_service_user) +    \
                          sizeof(struct dp_vs_dest_user))
@@ -0,0 +1,56 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Session logging.
+ *
+ * Workers write fixed-size binary records of conn creation and expiry
+ * into per-lcore batch buffers and pass them to master by SP/SC rings.
+ * Master stamps wall-clock time and writes the batches to a file or a
+ * unix datagram socket.
+ */
+#ifndef __DPVS_SESSLOG_H__
+#define __DPVS_SESSLOG_H__
+#include "common.h"
+#include "ipvs/conn.h"
+#include "conf/sesslog.h"
+
+extern volatile bool dp_vs_sesslog_on;
+
+void __dp_vs_sesslog_conn_new(struct dp_vs_conn *conn);
+void __dp_vs_sesslog_conn_expire(struct dp_vs_conn *conn);
+
+/* called by workers when @conn is created */
+static inline void dp_vs_sesslog_conn_new(struct dp_vs_conn *conn)
+{
+    if (unlikely(dp_vs_sesslog_on))
+        __dp_vs_sesslog_conn_new(conn);
+}
+
+/* called by workers when @conn is released */
+static inline void dp_vs_sesslog_conn_expire(struct dp_vs_conn *conn)
+{
+    if (unlikely(conn->flags & DPVS_CONN_F_LOGGED))
+        __dp_vs_sesslog_conn_expire(conn);
+}
+
+void dp_vs_sesslog_process_on_master(void);
+
+int dp_vs_sesslog_init(void);
+int dp_vs_sesslog_term(void);
+
+#endif /* __DPVS_SESSLOG_H__ */
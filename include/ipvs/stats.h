@@ -88,6 +88,10 @@ enum  dp_vs_estats_type {
     CONN_SCHED_UNREACH,
     SYNPROXY_NO_DEST,
     CONN_EXCEEDED,
+    FULLNAT_ADD_TOA_HEADROOM,
+    FULLNAT_ADD_TOA_SPLIT,
+    FULLNAT_ADD_TOA_SHIFT,
+    FULLNAT_ADD_TOA_COMPACT,
     DP_VS_EXT_STAT_LAST
 };
 
@@ -113,6 +117,7 @@ int dp_vs_new_stats(struct dp_vs_stats **p);
 void dp_vs_del_stats(struct dp_vs_stats *p);
 void dp_vs_zero_stats(struct dp_vs_stats* stats);
 int dp_vs_copy_stats(struct dp_vs_stats* dst, struct dp_vs_stats* src);
+int dp_vs_copy_stats_bulk(struct dp_vs_stats **dst, struct dp_vs_stats **src, int n);
 #endif
 
 #endif /* __DPVS_STATS_H__ */
@@ -0,0 +1,58 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Connection synchronization between directors.
+ *
+ * Workers queue conn events to per-lcore rings, master encodes them into
+ * multicast datagrams. The backup installs received conns on the lcore
+ * owning them, so established flows survive a fail-over.
+ */
+#ifndef __DPVS_SYNC_H__
+#define __DPVS_SYNC_H__
+#include "common.h"
+#include "ipvs/conn.h"
+#include "conf/sync.h"
+
+extern volatile bool dp_vs_sync_master_on;
+
+/* called by workers, after state transition of @conn */
+void __dp_vs_sync_conn(struct dp_vs_conn *conn, uint16_t old_state);
+/* called by workers, @conn synchronized before is released */
+void __dp_vs_sync_conn_expire(struct dp_vs_conn *conn);
+
+static inline void dp_vs_sync_conn(struct dp_vs_conn *conn, uint16_t old_state)
+{
+    if (unlikely(dp_vs_sync_master_on))
+        __dp_vs_sync_conn(conn, old_state);
+}
+
+static inline void dp_vs_sync_conn_expire(struct dp_vs_conn *conn)
+{
+    if (unlikely(conn->flags & DPVS_CONN_F_SYNCED) && dp_vs_sync_master_on)
+        __dp_vs_sync_conn_expire(conn);
+}
+
+void dp_vs_sync_process_on_master(void);
+
+int dp_vs_sync_init(void);
+int dp_vs_sync_term(void);
+
+void ipvs_sync_keyword_value_init(void);
+void install_ipvs_sync_keywords(void);
+
+#endif /* __DPVS_SYNC_H__ */
@@ -58,6 +58,15 @@ int dp_vs_xmit_tunnel(struct dp_vs_proto *proto,
                         struct dp_vs_conn *conn,
                         struct rte_mbuf *mbuf);
 
+int dp_vs_xmit_vxlan(struct dp_vs_proto *proto,
+                        struct dp_vs_conn *conn,
+                        struct rte_mbuf *mbuf);
+
+/* send packets staged by fast-xmit of this rx burst */
+void dp_vs_xmit_burst_flush(lcoreid_t cid);
+
+int dp_vs_xmit_nat64_benchmark(int rounds);
+
 void install_xmit_keywords(void);
 
 #endif /* __DPVS_XMIT_H__ */
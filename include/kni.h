@@ -38,6 +38,8 @@ int kni_add_dev(struct netif_port *dev, const char *kniname);
 int kni_del_dev(struct netif_port *dev);
 int kni_init(void);
 
+extern rte_spinlock_t kni_lock;
+
 static inline bool kni_dev_exist(const struct netif_port *dev)
 {
     return dev->kni.kni ? true : false;
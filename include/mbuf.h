@@ -84,6 +84,18 @@ static inline void *mbuf_tail_point(const struct rte_mbuf *mbuf)
     return rte_pktmbuf_mtod_offset(mbuf, void *, mbuf->data_len);
 }
 
+/*
+ * length of the largest L3 packet to be sent for @mbuf, that is
+ * the size of each segment for TCP aggregates (see PKT_TX_TCP_SEG).
+ */
+static inline uint32_t mbuf_l3_seg_len(const struct rte_mbuf *mbuf)
+{
+    if (mbuf->ol_flags & PKT_TX_TCP_SEG)
+        return mbuf->l3_len + mbuf->l4_len + mbuf->tso_segsz;
+
+    return mbuf->pkt_len;
+}
+
 static inline void *mbuf_header_pointer(const struct rte_mbuf *mbuf,
                     int offset, int len, void *buffer)
 {
@@ -80,6 +80,44 @@ static inline unsigned int neigh_hashkey(int af,
                              & NEIGH_TAB_MASK;
 }
 
+/*
+ * per-lcore generation of next hop resolution, it's bumped whenever a
+ * neighbour entry changes state or MAC, is removed, or a route of the
+ * lcore is added/deleted. L2 headers cached out of neighbour table
+ * (e.g., DR/TUNNEL fast xmit) are valid only in their generation.
+ */
+extern uint32_t neigh_gen[DPVS_MAX_LCORE];
+
+static inline uint32_t neigh_generation(void)
+{
+    return neigh_gen[rte_lcore_id()];
+}
+
+static inline void neigh_generation_bump(void)
+{
+    lcoreid_t cid = rte_lcore_id();
+
+    /* zero is never a valid generation */
+    if (unlikely(++neigh_gen[cid] == 0))
+        neigh_gen[cid] = 1;
+}
+
+/*
+ * invalidate cached L2 headers of all lcores, for changes made by
+ * control plane out of neighbour and route tables (e.g., tunnel params).
+ * racing with the lcore's own bump is harmless, the generation changes
+ * anyway.
+ */
+static inline void neigh_generation_bump_all(void)
+{
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (unlikely(++neigh_gen[cid] == 0))
+            neigh_gen[cid] = 1;
+    }
+}
+
 void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx);
 
 struct neighbour_entry *neigh_lookup_entry(int af, const union inet_addr *key,
@@ -40,6 +40,10 @@ enum {
     NETIF_PORT_FLAG_TC_EGRESS               = (0x1<<10),
     NETIF_PORT_FLAG_TC_INGRESS              = (0x1<<11),
     NETIF_PORT_FLAG_NO_ARP                  = (0x1<<12),
+    NETIF_PORT_FLAG_CAPTURE                 = (0x1<<13),
+    NETIF_PORT_FLAG_TX_TCP_TSO_OFFLOAD      = (0x1<<14),
+    NETIF_PORT_FLAG_RX_TCP_LRO              = (0x1<<15),
+    NETIF_PORT_FLAG_RX_GRO                  = (0x1<<16),
 };
 
 /* max tx/rx queue number for each nic */
@@ -73,6 +77,7 @@ struct netif_queue_conf
     queueid_t id;
     uint16_t len;
     uint16_t kni_len;
+    uint16_t dirty;         /* tx only, on lcore's dirty txq list */
     struct rx_partner *isol_rxq;
     struct rte_mbuf *mbufs[NETIF_MAX_PKT_BURST];
     struct rte_mbuf *kni_mbufs[NETIF_MAX_PKT_BURST];
@@ -116,6 +121,13 @@ struct rx_partner {
     struct list_head lnode;
 };
 
+/* TX queue selection among the txqs of the port owned by a lcore */
+typedef enum {
+    NETIF_TXQ_POLICY_LCORE      = 0,    /* single txq per lcore, default */
+    NETIF_TXQ_POLICY_FLOWHASH,          /* by flow hash, keep per-flow order */
+    NETIF_TXQ_POLICY_PRIORITY,          /* by TOS/traffic class as TC does */
+} netif_txq_policy_t;
+
 /**************************** lcore statistics ***************************/
 struct netif_lcore_stats
 {
@@ -175,6 +187,7 @@ typedef enum {
     PORT_TYPE_BOND_SLAVE,
     PORT_TYPE_VLAN,
     PORT_TYPE_TUNNEL,
+    PORT_TYPE_TUNNEL6,
     PORT_TYPE_INVAL,
 } port_type_t;
 
@@ -198,6 +211,28 @@ union netif_bond {
     } slave;
 } __rte_cache_aligned;
 
+#define NETIF_RSS_KEY_LEN_MAX       52
+#define NETIF_RSS_RETA_SIZE_MAX     512
+
+/* RSS config of a port, for software calculation of the rx lcore */
+struct netif_rss {
+    portid_t                port;       /* device hashing, e.g. vlan's real dev */
+    uint64_t                rss_hf;
+    uint8_t                 key[NETIF_RSS_KEY_LEN_MAX];
+    uint8_t                 key_len;
+    uint16_t                reta_size;  /* power of 2 */
+    lcoreid_t               reta[NETIF_RSS_RETA_SIZE_MAX]; /* hash index to rx lcore */
+};
+
+/* rte_flow rule of a port, installed on each slave for bonding */
+struct netif_flow {
+    int                     nflows;
+    struct {
+        portid_t            pid;
+        struct rte_flow     *flow;
+    } flows[NETIF_MAX_BOND_SLAVES];
+};
+
 struct netif_ops {
     int (*op_init)(struct netif_port *dev);
     int (*op_uninit)(struct netif_port *dev);
@@ -212,6 +247,11 @@ struct netif_ops {
     int (*op_get_link)(struct netif_port *dev, struct rte_eth_link *link);
     int (*op_get_promisc)(struct netif_port *dev, bool *promisc);
     int (*op_get_stats)(struct netif_port *dev, struct rte_eth_stats *stats);
+    int (*op_get_rss)(struct netif_port *dev, struct netif_rss *rss);
+    int (*op_flow_create)(struct netif_port *dev, const struct rte_flow_attr *attr,
+                          const struct rte_flow_item pattern[],
+                          const struct rte_flow_action actions[],
+                          struct netif_flow *flow);
 };
 
 struct netif_hw_addr {
@@ -248,6 +288,7 @@ struct netif_port {
     int                     ntxq;                       /* tx queue numbe */
     uint16_t                rxq_desc_nb;                /* rx queue descriptor number */
     uint16_t                txq_desc_nb;                /* tx queue descriptor number */
+    netif_txq_policy_t      txq_policy;                 /* tx queue selection */
     struct ether_addr       addr;                       /* MAC address */
     struct netif_hw_addr_list mc;                       /* HW multicast list */
     int                     socket;                     /* socket id */
@@ -271,7 +312,9 @@ struct netif_port {
 /**************************** lcore API *******************************/
 int netif_xmit(struct rte_mbuf *mbuf, struct netif_port *dev);
 int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev);
+int netif_xmit_burst(struct rte_mbuf **mbufs, int n, struct netif_port *dev);
 int netif_rcv(struct netif_port *dev, __be16 eth_type, struct rte_mbuf *mbuf);
+int netif_rcv_l2(struct netif_port *dev, struct rte_mbuf *mbuf);
 int netif_print_lcore_conf(char *buf, int *len, bool is_all, portid_t pid);
 int netif_print_lcore_queue_conf(lcoreid_t cid, char *buf, int *len, bool title);
 void netif_get_slave_lcores(uint8_t *nb, uint64_t *mask);
@@ -283,6 +326,7 @@ int netif_lcore_loop_job_register(struct netif_lcore_loop_job *lcore_job);
 int netif_lcore_loop_job_unregister(struct netif_lcore_loop_job *lcore_job);
 int netif_lcore_start(void);
 bool is_lcore_id_valid(lcoreid_t cid);
+bool netif_lcore_is_kni(lcoreid_t cid);
 bool netif_lcore_is_idle(lcoreid_t cid);
 
 /************************** protocol API *****************************/
@@ -311,6 +355,12 @@ int netif_get_queue(struct netif_port *port, lcoreid_t id, queueid_t *qid);
 int netif_get_link(struct netif_port *dev, struct rte_eth_link *link);
 int netif_get_promisc(struct netif_port *dev, bool *promisc);
 int netif_get_stats(struct netif_port *dev, struct rte_eth_stats *stats);
+int netif_get_rss(struct netif_port *dev, struct netif_rss *rss);
+int netif_flow_create(struct netif_port *dev, const struct rte_flow_attr *attr,
+                      const struct rte_flow_item pattern[],
+                      const struct rte_flow_action actions[],
+                      struct netif_flow *flow);
+int netif_flow_destroy(struct netif_flow *flow);
 
 /************************** module API *****************************/
 int netif_virtual_devices_add(void);
@@ -325,6 +375,8 @@ void install_netif_keywords(void);
 
 /*************************** kni api *******************************/
 void kni_process_on_master(void);
+unsigned kni_send2kern_burst(struct netif_port *dev,
+                             struct rte_mbuf **mbufs, unsigned npkts);
 
 static inline void *netif_priv(struct netif_port *dev)
 {
@@ -37,6 +37,9 @@
  * when needed, release it after used. no trial needed, it's
  * efficient and all resource available can be used.
  *
+ * for NIC without legacy fdir, rte_flow rules are used, or lports are
+ * selected by software RSS per <laddr, rs>, see sa_pool.c.
+ *
  * Lei Chen <raychen@qiyi.com>, June 2017, initial.
  */
 #ifndef __DPVS_SA_POOL__
@@ -67,6 +70,21 @@ int sa_release(const struct netif_port *dev,
                const struct sockaddr_storage *daddr,
                const struct sockaddr_storage *saddr);
 
+/**
+ * take the given <saddr, sport> out of current lcore's pool, for
+ * connections synchronized from peers which keep their local address.
+ */
+int sa_bind(const struct netif_port *dev,
+            const struct sockaddr_storage *daddr,
+            const struct sockaddr_storage *saddr);
+
+/**
+ * lcore whose pool owns <@saddr, sport> towards @daddr (the rs), where
+ * fdir or RSS steers the back traffic. @daddr is needed with RSS only.
+ */
+lcoreid_t sa_lcore_of(const struct sockaddr_storage *daddr,
+                      const struct sockaddr_storage *saddr);
+
 int sa_pool_stats(const struct inet_ifaddr *ifa, struct sa_pool_stats *stats);
 
 /* config file */
@@ -167,4 +167,39 @@ struct opphdr {
     __u8    options[0];
 } __attribute__((__packed__));
 
+/**
+ *  Batched UOA "mapping datagram": IPPROTO_OPT with protocol IPPROTO_NONE
+ *
+ *   +--------+--------------------+------------------+-------+-------+
+ *  | IP hdr | opphdr (no option) | uoa_batch_hdr    | ent 0 | ...   |
+ *   +--------+--------------------+------------------+-------+-------+
+ *
+ *  sent from LB's local IP to RS, carrying UOA of many UDP connections,
+ *  the flows' packets need no UOA of their own. for each entry RS saves
+ *  the mapping (LIP:lport -> RIP:rport) => (real addr:real port), LIP and
+ *  RIP are the IP header's addresses. RS echoes the uoa_batch_hdr back
+ *  from RIP to LIP, with UOA_BATCH_F_ACK and no entries, as "ACK".
+ *  LB resends a batch with the same @seq until it's acked or max-trail
+ *  reached. @cookie is opaque to RS.
+ *
+ *  opphdr.version is the family of the IP header.
+ */
+#define UOA_BATCH_F_ACK     0x01
+
+struct uoa_batch_hdr {
+    __u8    flags;      /* UOA_BATCH_F_XXX */
+    __u8    count;      /* number of entries */
+    __be16  rport;      /* port of RS for all entries */
+    __be32  seq;
+    __be32  cookie;
+} __attribute__((__packed__));
+
+struct uoa_batch_ent {
+    __be16  lport;
+    __be16  real_port;
+    __u8    real_af;    /* OPPHDR_IPV4 or OPPHDR_IPV6 */
+    __u8    rsvd[3];
+    __u8    real_addr[16];
+} __attribute__((__packed__));
+
 #endif
@@ -0,0 +1,117 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * dpvs VXLAN device (RFC 7348).
+ * refer linux:drivers/net/vxlan.c
+ */
+#ifndef __DPVS_VXLAN_H__
+#define __DPVS_VXLAN_H__
+#include <stdbool.h>
+#include "dpdk.h"
+#include "inet.h"
+#include "netif.h"
+#include "ipv4.h"
+
+#define VXLAN_PORT              4789    /* IANA assigned */
+#define VXLAN_VNI_MAX           0xffffff
+#define VXLAN_HF_VNI            htonl(0x08000000)
+
+/* outer UDP source port range, see RFC 7348 section 5 */
+#define VXLAN_SRC_PORT_MIN      49152
+#define VXLAN_SRC_PORT_MAX      65535
+
+/* headers prepended to the inner L3 packet by VXLAN encapsulation. */
+struct vxlan_encap {
+    struct ipv4_hdr     iph;
+    struct udp_hdr      udph;
+    struct vxlan_hdr    vxh;
+    struct ether_hdr    eth;
+} __attribute__((__packed__));
+
+/* VNI is the value of @i_key/@o_key of tunnel params */
+static inline __be32 vxlan_vni_field(__be32 key)
+{
+    return htonl(ntohl(key) << 8);
+}
+
+static inline __be16 vxlan_src_port(uint32_t hash)
+{
+    return htons((((uint64_t)hash * (VXLAN_SRC_PORT_MAX - VXLAN_SRC_PORT_MIN + 1))
+                  >> 32) + VXLAN_SRC_PORT_MIN);
+}
+
+bool is_vxlan_dev(const struct netif_port *dev);
+
+/* hash of inner flow of @mbuf whose L3 header is at @l3_off. */
+uint32_t vxlan_flow_hash(const struct rte_mbuf *mbuf, uint16_t eth_type,
+                         uint32_t l3_off);
+
+/*
+ * build outer headers of VXLAN device @dev into @encap by tunnel params
+ * and route of the remote VTEP, the underlay device and next hop are
+ * returned. @encap->eth.d_addr is left to the caller, the per-packet
+ * fields are filled by vxlan_encap_fill().
+ */
+int vxlan_encap_build(struct netif_port *dev, struct vxlan_encap *encap,
+                      struct netif_port **odev, union inet_addr *onexthop);
+
+/*
+ * fill per-packet fields of the prebuilt @hdr prepended to @mbuf,
+ * @hdr->eth.ether_type must be set. TOS, TTL and DF are inherited
+ * from IPv4 inner header as ip_tunnel_xmit() does. outer UDP checksum
+ * is zero, outer IP checksum is offloaded to @odev if supported.
+ */
+static inline void vxlan_encap_fill(struct rte_mbuf *mbuf,
+                                    struct vxlan_encap *hdr,
+                                    uint32_t hash,
+                                    const struct netif_port *odev)
+{
+    struct ipv4_hdr *oiph = &hdr->iph;
+
+    if (hdr->eth.ether_type == htons(ETHER_TYPE_IPv4)) {
+        const struct ipv4_hdr *iiph = (const struct ipv4_hdr *)(hdr + 1);
+
+        if (oiph->type_of_service & 0x1)
+            oiph->type_of_service = iiph->type_of_service;
+        if (!oiph->time_to_live)
+            oiph->time_to_live = iiph->time_to_live;
+        oiph->fragment_offset |= iiph->fragment_offset
+                                 & htons(IPV4_HDR_DF_FLAG);
+    } else {
+        oiph->type_of_service &= ~0x1;
+        if (!oiph->time_to_live)
+            oiph->time_to_live = INET_DEF_TTL;
+    }
+
+    oiph->total_length = htons(mbuf->pkt_len);
+    oiph->packet_id = ip4_select_id(oiph);
+
+    hdr->udph.src_port = vxlan_src_port(hash);
+    hdr->udph.dgram_len = htons(mbuf->pkt_len - sizeof(struct ipv4_hdr));
+    hdr->udph.dgram_cksum = 0;
+
+    mbuf->l3_len = sizeof(struct ipv4_hdr);
+    if (odev->flag & NETIF_PORT_FLAG_TX_IP_CSUM_OFFLOAD) {
+        oiph->hdr_checksum = 0;
+        mbuf->ol_flags |= PKT_TX_IP_CKSUM | PKT_TX_IPV4;
+    } else {
+        ip4_send_csum(oiph);
+    }
+}
+
+#endif /* __DPVS_VXLAN_H__ */
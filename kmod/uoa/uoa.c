@@ -52,9 +52,10 @@
 #include <linux/vmalloc.h>
 #include <asm/pgtable_types.h>
 
-#if LINUX_VERSION_CODE < KERNEL_VERSION(3,3,0)
-#include <net/ipv6.h> /* ipv6_skip_exthdr */
-#endif
+#include <net/ip.h>
+#include <net/ipv6.h> /* ipv6_skip_exthdr, ip6_local_out */
+#include <net/route.h>
+#include <net/ip6_route.h>
 
 #define UOA_NEED_EXTRA
 #include "uoa_extra.h"
@@ -844,6 +845,208 @@ static struct uoa_map *uoa_opp_rcv(__be16 af, void *iph, struct sk_buff *skb)
     return um;
 }
 
+/*
+ * "ACK" of batched mapping datagram, echo @obh from RS to LB.
+ * it's sent in softirq, so skb is built and routed by hand.
+ */
+static int uoa_batch_send_ack(struct sk_buff *oskb, __be16 af,
+                              const struct uoa_batch_hdr *obh)
+{
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(3,0,0)
+    struct sk_buff *skb;
+    struct opphdr *opph;
+    struct uoa_batch_hdr *bh;
+    int hlen = (AF_INET6 == af) ? sizeof(struct ipv6hdr) : sizeof(struct iphdr);
+    int len = hlen + sizeof(*opph) + sizeof(*bh);
+    int err;
+
+    skb = alloc_skb(LL_MAX_HEADER + len, GFP_ATOMIC);
+    if (!skb)
+        return -ENOMEM;
+
+    skb_reserve(skb, LL_MAX_HEADER);
+    skb_put(skb, len);
+    skb_reset_network_header(skb);
+
+    opph = (void *)skb->data + hlen;
+    memset(opph, 0, sizeof(*opph));
+    opph->version  = (AF_INET6 == af) ? OPPHDR_IPV6 : OPPHDR_IPV4;
+    opph->protocol = IPPROTO_NONE;
+    opph->length   = htons(sizeof(*opph));
+
+    bh = (void *)(opph + 1);
+    memcpy(bh, obh, sizeof(*bh));
+    bh->flags = UOA_BATCH_F_ACK;
+    bh->count = 0;
+
+    if (AF_INET6 == af) {
+        const struct ipv6hdr *oip6h = ipv6_hdr(oskb);
+        struct ipv6hdr *ip6h = ipv6_hdr(skb);
+        struct dst_entry *dst;
+        struct flowi6 fl6;
+
+        memset(ip6h, 0, sizeof(*ip6h));
+        ip6h->version     = 6;
+        ip6h->payload_len = htons(len - hlen);
+        ip6h->nexthdr     = IPPROTO_OPT;
+        ip6h->hop_limit   = 64;
+        ip6h->saddr       = oip6h->daddr;
+        ip6h->daddr       = oip6h->saddr;
+
+        memset(&fl6, 0, sizeof(fl6));
+        fl6.saddr = ip6h->saddr;
+        fl6.daddr = ip6h->daddr;
+        fl6.flowi6_proto = IPPROTO_OPT;
+
+        dst = ip6_route_output(&init_net, NULL, &fl6);
+        if (dst->error) {
+            err = dst->error;
+            dst_release(dst);
+            kfree_skb(skb);
+            return err;
+        }
+        skb_dst_set(skb, dst);
+        skb->protocol = htons(ETH_P_IPV6);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+        err = ip6_local_out(&init_net, NULL, skb);
+#else
+        err = ip6_local_out(skb);
+#endif
+    } else {
+        const struct iphdr *oiph = ip_hdr(oskb);
+        struct iphdr *iph = ip_hdr(skb);
+        struct rtable *rt;
+
+        rt = ip_route_output(&init_net, oiph->saddr, oiph->daddr, 0, 0);
+        if (IS_ERR(rt)) {
+            kfree_skb(skb);
+            return PTR_ERR(rt);
+        }
+        skb_dst_set(skb, &rt->dst);
+
+        memset(iph, 0, sizeof(*iph));
+        iph->version  = 4;
+        iph->ihl      = sizeof(*iph) >> 2;
+        iph->tot_len  = htons(len);
+        iph->frag_off = htons(IP_DF);
+        iph->ttl      = 64;
+        iph->protocol = IPPROTO_OPT;
+        iph->saddr    = oiph->daddr;
+        iph->daddr    = oiph->saddr;
+        ip_send_check(iph);
+        skb->protocol = htons(ETH_P_IP);
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(4,4,0)
+        err = ip_local_out(&init_net, NULL, skb);
+#else
+        err = ip_local_out(skb);
+#endif
+    }
+
+    return net_xmit_eval(err);
+#else
+    /* no ACK, LB stops resending by max-trail */
+    return -EOPNOTSUPP;
+#endif
+}
+
+/*
+ * save mappings from batched mapping datagram (see uoa.h).
+ * return true if @skb is such datagram or its ACK, it's not for
+ * upper layer and should be dropped then.
+ */
+static bool uoa_batch_rcv(struct sk_buff *skb)
+{
+    __be16 af = ((6 == ip_hdr(skb)->version) ? AF_INET6 : AF_INET);
+    struct uoa_batch_hdr *bh;
+    struct uoa_batch_ent *ent;
+    struct opphdr *opph;
+    struct uoa_map *um;
+    int iphdrlen, offset, i;
+    void *iph;
+
+    if (AF_INET6 == af) {
+        if (ipv6_hdr(skb)->nexthdr != IPPROTO_OPT)
+            return false;
+        iphdrlen = ipv6_hdrlen(skb);
+    } else {
+        if (ip_hdr(skb)->protocol != IPPROTO_OPT)
+            return false;
+        iphdrlen = ip_hdrlen(skb);
+    }
+
+    if (!pskb_may_pull(skb, iphdrlen + sizeof(*opph)))
+        return false;
+
+    opph = (void *)skb_network_header(skb) + iphdrlen;
+    if (opph->protocol != IPPROTO_NONE)
+        return false;
+
+    /* offset of uoa_batch_hdr, pull may reallocate the header */
+    offset = iphdrlen + ntohs(opph->length);
+    if (!pskb_may_pull(skb, offset + sizeof(*bh)))
+        return true;
+
+    bh = (void *)skb_network_header(skb) + offset;
+    if (bh->flags & UOA_BATCH_F_ACK)
+        return true;
+
+    if (!pskb_may_pull(skb, offset + sizeof(*bh) + bh->count * sizeof(*ent)))
+        return true;
+
+    iph = skb_network_header(skb);
+    bh = iph + offset;
+    ent = (void *)(bh + 1);
+
+    for (i = 0; i < bh->count; i++, ent++) {
+        UOA_STATS_INC(uoa_got);
+
+        um = kmem_cache_alloc(uoa_map_cache, GFP_ATOMIC);
+        if (!um) {
+            UOA_STATS_INC(uoa_miss);
+            continue;
+        }
+
+        memset(um, 0, sizeof(*um));
+        um->af = af;
+        if (AF_INET == af) {
+            um->saddr.in.s_addr = ((struct iphdr *)iph)->saddr;
+            um->daddr.in.s_addr = ((struct iphdr *)iph)->daddr;
+        } else {
+            memmove(&um->saddr.in6, &((struct ipv6hdr *)iph)->saddr,
+                        sizeof(struct in6_addr));
+            memmove(&um->daddr.in6, &((struct ipv6hdr *)iph)->daddr,
+                        sizeof(struct in6_addr));
+        }
+        um->sport = ent->lport;
+        um->dport = bh->rport;
+
+        um->optuoa.op_code = IPOPT_UOA;
+        um->optuoa.op_port = ent->real_port;
+        if (ent->real_af == OPPHDR_IPV6) {
+            um->optuoa.op_len = IPOLEN_UOA_IPV6;
+            memcpy(&um->optuoa.op_addr.in6, ent->real_addr,
+                   sizeof(struct in6_addr));
+        } else {
+            um->optuoa.op_len = IPOLEN_UOA_IPV4;
+            memcpy(&um->optuoa.op_addr.in, ent->real_addr,
+                   sizeof(struct in_addr));
+        }
+
+        UOA_STATS_INC(uoa_saved);
+        uoa_map_hash(um);
+    }
+
+    if (uoa_batch_send_ack(skb, af, bh) != 0) {
+        UOA_STATS_INC(uoa_ack_fail);
+        if (uoa_debug)
+            pr_warn("fail to send UOA batch ACK\n");
+    }
+
+    return true;
+}
+
 static struct uoa_map *uoa_skb_rcv_opt(struct sk_buff *skb)
 {
     struct iphdr *iph = ip_hdr(skb);
@@ -895,6 +1098,10 @@ static unsigned int uoa_ip_local_in(unsigned int hooknum,
 {
     struct uoa_map *um;
 
+    /* mapping datagram is eaten here */
+    if (unlikely(uoa_batch_rcv(skb)))
+        return NF_DROP;
+
     um = uoa_skb_rcv_opt(skb);
     if (um)
         uoa_map_hash(um);
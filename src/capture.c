@@ -0,0 +1,932 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * In-process packet capture (pcapng) and forward2kni.
+ *
+ * the BPF program is compiled by the tool (`tcpdump -ddd` format), checked
+ * once on start and interpreted on workers. captured mbufs are passed to
+ * master through per-lcore SP/SC rings, each mbuf carries its meta data
+ * (port, direction, sinks, original length) in udata64 and TSC timestamp.
+ */
+#include <stdio.h>
+#include <errno.h>
+#include <assert.h>
+#include <sys/time.h>
+#include "common.h"
+#include "dpdk.h"
+#include "netif.h"
+#include "kni.h"
+#include "ctrl.h"
+#include "capture.h"
+
+#define CAPTURE_RING_SIZE           2048
+#define CAPTURE_POOL_SIZE           8191
+#define CAPTURE_POOL_CACHE          256
+#define CAPTURE_MBUF_SIZE           RTE_MBUF_DEFAULT_BUF_SIZE
+#define CAPTURE_DEQ_BURST           NETIF_MAX_PKT_BURST
+#define CAPTURE_BPF_MEMWORDS        BPF_MEMWORDS
+#define CAPTURE_FLUSH_INTERVAL      1024
+
+/* capture sinks, a packet may be sent to more than one sink */
+#define CAPTURE_SINK_FILE           0x1
+#define CAPTURE_SINK_KNI            0x2
+
+/* meta data layout in mbuf->udata64 */
+#define CAPTURE_META(port, dir, sinks, len) \
+    (((uint64_t)(len) << 32) | ((uint64_t)(sinks) << 24) | \
+     ((uint64_t)(dir) << 16) | (uint64_t)(port))
+#define CAPTURE_META_PORT(m)        ((portid_t)((m)->udata64 & 0xffff))
+#define CAPTURE_META_DIR(m)         ((uint8_t)(((m)->udata64 >> 16) & 0xff))
+#define CAPTURE_META_SINKS(m)       ((uint8_t)(((m)->udata64 >> 24) & 0xff))
+#define CAPTURE_META_LEN(m)         ((uint32_t)((m)->udata64 >> 32))
+
+/* pcapng blocks */
+#define PCAPNG_BT_SHB               0x0A0D0D0A
+#define PCAPNG_BT_IDB               0x00000001
+#define PCAPNG_BT_EPB               0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC     0x1A2B3C4D
+#define PCAPNG_LINKTYPE_ETHERNET    1
+#define PCAPNG_OPT_ENDOFOPT         0
+#define PCAPNG_OPT_IF_NAME          2
+#define PCAPNG_OPT_IF_TSRESOL       9
+#define PCAPNG_OPT_EPB_FLAGS        2
+#define PCAPNG_EPB_FLAG_INBOUND     0x1
+#define PCAPNG_EPB_FLAG_OUTBOUND    0x2
+#define PCAPNG_PAD(len)             (((len) + 3) & ~3)
+
+struct pcapng_block_head {
+    uint32_t    type;
+    uint32_t    total_len;
+} __attribute__((__packed__));
+
+struct pcapng_shb {
+    struct pcapng_block_head head;
+    uint32_t    magic;
+    uint16_t    major;
+    uint16_t    minor;
+    int64_t     section_len;
+} __attribute__((__packed__));
+
+struct pcapng_idb {
+    struct pcapng_block_head head;
+    uint16_t    linktype;
+    uint16_t    reserved;
+    uint32_t    snaplen;
+} __attribute__((__packed__));
+
+struct pcapng_epb {
+    struct pcapng_block_head head;
+    uint32_t    ifid;
+    uint32_t    ts_high;
+    uint32_t    ts_low;
+    uint32_t    caplen;
+    uint32_t    origlen;
+} __attribute__((__packed__));
+
+struct pcapng_opt {
+    uint16_t    code;
+    uint16_t    len;
+} __attribute__((__packed__));
+
+/* per-lcore capture ring and statistics, written by owner lcore only */
+struct capture_lcore {
+    struct rte_ring                     *ring;
+    uint32_t                            sample_cnt;
+    struct dp_vs_capture_lcore_stats    stats;
+} __rte_cache_aligned;
+
+/* fields read by workers are set before NETIF_PORT_FLAG_CAPTURE. */
+struct capture_session {
+    bool                running;
+    portid_t            port;       /* NETIF_PORT_ID_ALL for all devices */
+    struct dp_vs_capture_conf conf;
+
+    /* master only */
+    FILE                *fp;
+    uint64_t            written;
+    uint64_t            tsc_base;
+    uint64_t            ns_base;
+    uint32_t            nifs;
+    int32_t             ifids[NETIF_MAX_PORTS];
+} __rte_cache_aligned;
+
+static struct capture_lcore capture_lcores[DPVS_MAX_LCORE];
+static struct rte_mempool *capture_pool[DPVS_MAX_SOCKET];
+static struct capture_session capture_sess;
+
+static uint64_t capture_kni_sent;
+static uint64_t capture_kni_dropped;
+
+/*
+ * classic BPF filter, see bpf_filter() and sk_chk_filter() of Linux.
+ * packet data beyond the first segment is treated as out of range.
+ */
+static int capture_bpf_check(const struct sock_filter *prog, uint16_t len)
+{
+    const struct sock_filter *ins;
+    uint16_t pc;
+
+    if (len == 0 || len > CAPTURE_BPF_MAXINSNS)
+        return EDPVS_INVAL;
+
+    for (pc = 0; pc < len; pc++) {
+        ins = &prog[pc];
+
+        switch (BPF_CLASS(ins->code)) {
+        case BPF_LD:
+        case BPF_LDX:
+            if (BPF_MODE(ins->code) == BPF_MEM &&
+                    ins->k >= CAPTURE_BPF_MEMWORDS)
+                return EDPVS_INVAL;
+            break;
+        case BPF_ST:
+        case BPF_STX:
+            if (ins->k >= CAPTURE_BPF_MEMWORDS)
+                return EDPVS_INVAL;
+            break;
+        case BPF_ALU:
+            if ((BPF_OP(ins->code) == BPF_DIV || BPF_OP(ins->code) == BPF_MOD)
+                    && BPF_SRC(ins->code) == BPF_K && ins->k == 0)
+                return EDPVS_INVAL;
+            break;
+        case BPF_JMP:
+            if (BPF_OP(ins->code) == BPF_JA) {
+                if (ins->k >= (uint32_t)(len - pc - 1))
+                    return EDPVS_INVAL;
+            } else if (pc + ins->jt + 1 >= len || pc + ins->jf + 1 >= len) {
+                return EDPVS_INVAL;
+            }
+            break;
+        case BPF_RET:
+        case BPF_MISC:
+            break;
+        default:
+            return EDPVS_INVAL;
+        }
+    }
+
+    return BPF_CLASS(prog[len - 1].code) == BPF_RET ? EDPVS_OK : EDPVS_INVAL;
+}
+
+static inline int capture_bpf_load(const uint8_t *p, uint32_t buflen,
+                                   uint32_t k, int size, uint32_t *val)
+{
+    if (unlikely(k >= buflen || size > buflen - k))
+        return -1;
+
+    switch (size) {
+    case 4:
+        *val = ((uint32_t)p[k] << 24) | ((uint32_t)p[k + 1] << 16) |
+               ((uint32_t)p[k + 2] << 8) | p[k + 3];
+        break;
+    case 2:
+        *val = ((uint32_t)p[k] << 8) | p[k + 1];
+        break;
+    default:
+        *val = p[k];
+        break;
+    }
+
+    return 0;
+}
+
+static inline int bpf_size(uint16_t code)
+{
+    switch (BPF_SIZE(code)) {
+    case BPF_W:
+        return 4;
+    case BPF_H:
+        return 2;
+    default:
+        return 1;
+    }
+}
+
+static uint32_t capture_bpf_run(const struct sock_filter *pc,
+                                const struct rte_mbuf *mbuf)
+{
+    const uint8_t *p = rte_pktmbuf_mtod(mbuf, const uint8_t *);
+    uint32_t buflen = mbuf->data_len;
+    uint32_t wirelen = mbuf->pkt_len;
+    uint32_t A = 0, X = 0, k;
+    uint32_t mem[CAPTURE_BPF_MEMWORDS];
+
+    for (;; pc++) {
+        switch (pc->code) {
+        case BPF_RET | BPF_K:
+            return pc->k;
+        case BPF_RET | BPF_A:
+            return A;
+
+        case BPF_LD | BPF_W | BPF_ABS:
+        case BPF_LD | BPF_H | BPF_ABS:
+        case BPF_LD | BPF_B | BPF_ABS:
+            if (capture_bpf_load(p, buflen, pc->k, bpf_size(pc->code), &A))
+                return 0;
+            continue;
+        case BPF_LD | BPF_W | BPF_IND:
+        case BPF_LD | BPF_H | BPF_IND:
+        case BPF_LD | BPF_B | BPF_IND:
+            k = X + pc->k;
+            if (k < X || capture_bpf_load(p, buflen, k, bpf_size(pc->code), &A))
+                return 0;
+            continue;
+        case BPF_LD | BPF_W | BPF_LEN:
+            A = wirelen;
+            continue;
+        case BPF_LDX | BPF_W | BPF_LEN:
+            X = wirelen;
+            continue;
+        case BPF_LDX | BPF_MSH | BPF_B:
+            if (capture_bpf_load(p, buflen, pc->k, 1, &X))
+                return 0;
+            X = (X & 0xf) << 2;
+            continue;
+        case BPF_LD | BPF_IMM:
+            A = pc->k;
+            continue;
+        case BPF_LDX | BPF_IMM:
+            X = pc->k;
+            continue;
+        case BPF_LD | BPF_MEM:
+            A = mem[pc->k];
+            continue;
+        case BPF_LDX | BPF_MEM:
+            X = mem[pc->k];
+            continue;
+        case BPF_ST:
+            mem[pc->k] = A;
+            continue;
+        case BPF_STX:
+            mem[pc->k] = X;
+            continue;
+
+        case BPF_JMP | BPF_JA:
+            pc += pc->k;
+            continue;
+        case BPF_JMP | BPF_JGT | BPF_K:
+            pc += (A > pc->k) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JGE | BPF_K:
+            pc += (A >= pc->k) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JEQ | BPF_K:
+            pc += (A == pc->k) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JSET | BPF_K:
+            pc += (A & pc->k) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JGT | BPF_X:
+            pc += (A > X) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JGE | BPF_X:
+            pc += (A >= X) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JEQ | BPF_X:
+            pc += (A == X) ? pc->jt : pc->jf;
+            continue;
+        case BPF_JMP | BPF_JSET | BPF_X:
+            pc += (A & X) ? pc->jt : pc->jf;
+            continue;
+
+        case BPF_ALU | BPF_ADD | BPF_X:
+            A += X;
+            continue;
+        case BPF_ALU | BPF_SUB | BPF_X:
+            A -= X;
+            continue;
+        case BPF_ALU | BPF_MUL | BPF_X:
+            A *= X;
+            continue;
+        case BPF_ALU | BPF_DIV | BPF_X:
+            if (X == 0)
+                return 0;
+            A /= X;
+            continue;
+        case BPF_ALU | BPF_MOD | BPF_X:
+            if (X == 0)
+                return 0;
+            A %= X;
+            continue;
+        case BPF_ALU | BPF_AND | BPF_X:
+            A &= X;
+            continue;
+        case BPF_ALU | BPF_OR | BPF_X:
+            A |= X;
+            continue;
+        case BPF_ALU | BPF_XOR | BPF_X:
+            A ^= X;
+            continue;
+        case BPF_ALU | BPF_LSH | BPF_X:
+            A <<= X;
+            continue;
+        case BPF_ALU | BPF_RSH | BPF_X:
+            A >>= X;
+            continue;
+        case BPF_ALU | BPF_ADD | BPF_K:
+            A += pc->k;
+            continue;
+        case BPF_ALU | BPF_SUB | BPF_K:
+            A -= pc->k;
+            continue;
+        case BPF_ALU | BPF_MUL | BPF_K:
+            A *= pc->k;
+            continue;
+        case BPF_ALU | BPF_DIV | BPF_K:
+            A /= pc->k;
+            continue;
+        case BPF_ALU | BPF_MOD | BPF_K:
+            A %= pc->k;
+            continue;
+        case BPF_ALU | BPF_AND | BPF_K:
+            A &= pc->k;
+            continue;
+        case BPF_ALU | BPF_OR | BPF_K:
+            A |= pc->k;
+            continue;
+        case BPF_ALU | BPF_XOR | BPF_K:
+            A ^= pc->k;
+            continue;
+        case BPF_ALU | BPF_LSH | BPF_K:
+            A <<= pc->k;
+            continue;
+        case BPF_ALU | BPF_RSH | BPF_K:
+            A >>= pc->k;
+            continue;
+        case BPF_ALU | BPF_NEG:
+            A = -A;
+            continue;
+
+        case BPF_MISC | BPF_TAX:
+            X = A;
+            continue;
+        case BPF_MISC | BPF_TXA:
+            A = X;
+            continue;
+
+        default: /* rejected by capture_bpf_check() */
+            return 0;
+        }
+    }
+}
+
+/* return number of sinks the packet should go to, zero for none. */
+static inline uint8_t capture_match(struct capture_lcore *cl,
+                                    struct netif_port *dev,
+                                    struct rte_mbuf *mbuf, uint8_t dir)
+{
+    struct capture_session *sess = &capture_sess;
+    uint8_t sinks = 0;
+
+    if (dev->flag & NETIF_PORT_FLAG_FORWARD2KNI)
+        sinks |= CAPTURE_SINK_KNI;
+
+    if (!(dev->flag & NETIF_PORT_FLAG_CAPTURE) || !(sess->conf.direction & dir))
+        return sinks;
+
+    if (sess->conf.sample > 1 && ++cl->sample_cnt < sess->conf.sample) {
+        cl->stats.sampled++;
+        return sinks;
+    }
+    cl->sample_cnt = 0;
+
+    if (sess->conf.bpf_len && !capture_bpf_run(sess->conf.bpf, mbuf)) {
+        cl->stats.filtered++;
+        return sinks;
+    }
+
+    return sinks | CAPTURE_SINK_FILE;
+}
+
+void capture_packet(struct netif_port *dev, struct rte_mbuf *mbuf, uint8_t dir)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct capture_lcore *cl = &capture_lcores[cid];
+    struct rte_mempool *pool = capture_pool[rte_socket_id()];
+    struct rte_mbuf *cap;
+    uint32_t len;
+    uint8_t sinks;
+
+    if (unlikely(!cl->ring))
+        return;
+
+    sinks = capture_match(cl, dev, mbuf, dir);
+    if (!sinks)
+        return;
+
+    if (dir == CAPTURE_DIR_TX) {
+        /* TX packets are not modified anymore, refcount clone is enough. */
+        cap = rte_pktmbuf_clone(mbuf, pool);
+    } else if (sinks & CAPTURE_SINK_KNI) {
+        /* KNI needs whole packet. */
+        cap = mbuf_copy(mbuf, pool);
+    } else {
+        /* RX packets will be rewritten in-place, copy snaplen only. */
+        cap = rte_pktmbuf_alloc(pool);
+        if (likely(cap != NULL)) {
+            len = RTE_MIN(mbuf->pkt_len, capture_sess.conf.snaplen);
+            len = RTE_MIN(len, (uint32_t)rte_pktmbuf_tailroom(cap));
+            if (unlikely(mbuf_copy_bits(mbuf, 0,
+                            rte_pktmbuf_append(cap, len), len) != 0)) {
+                rte_pktmbuf_free(cap);
+                cap = NULL;
+            }
+        }
+    }
+
+    if (unlikely(!cap)) {
+        cl->stats.nomem++;
+        return;
+    }
+
+    cap->udata64 = CAPTURE_META(dev->id, dir, sinks, mbuf->pkt_len);
+    cap->timestamp = rte_rdtsc();
+
+    if (unlikely(rte_ring_sp_enqueue(cl->ring, cap) != 0)) {
+        cl->stats.ring_full++;
+        rte_pktmbuf_free(cap);
+        return;
+    }
+
+    cl->stats.captured++;
+}
+
+/*
+ * pcapng writer, called on master.
+ */
+static int pcapng_write_opt(FILE *fp, uint16_t code, const void *val, uint16_t len)
+{
+    struct pcapng_opt opt = { .code = code, .len = len };
+    static const uint8_t pad[4] = { 0 };
+
+    if (fwrite(&opt, sizeof(opt), 1, fp) != 1)
+        return EDPVS_IO;
+    if (len && fwrite(val, len, 1, fp) != 1)
+        return EDPVS_IO;
+    if (PCAPNG_PAD(len) != len &&
+            fwrite(pad, PCAPNG_PAD(len) - len, 1, fp) != 1)
+        return EDPVS_IO;
+
+    return EDPVS_OK;
+}
+
+static int pcapng_write_shb(FILE *fp)
+{
+    struct pcapng_shb shb;
+    uint32_t total = sizeof(shb) + sizeof(uint32_t);
+
+    shb.head.type = PCAPNG_BT_SHB;
+    shb.head.total_len = total;
+    shb.magic = PCAPNG_BYTE_ORDER_MAGIC;
+    shb.major = 1;
+    shb.minor = 0;
+    shb.section_len = -1;
+
+    if (fwrite(&shb, sizeof(shb), 1, fp) != 1 ||
+            fwrite(&total, sizeof(total), 1, fp) != 1)
+        return EDPVS_IO;
+
+    return EDPVS_OK;
+}
+
+static int pcapng_write_idb(FILE *fp, const char *ifname, uint32_t snaplen)
+{
+    struct pcapng_idb idb;
+    uint8_t tsresol = 9; /* nanosecond */
+    uint16_t namelen = strlen(ifname);
+    uint32_t total;
+
+    total = sizeof(idb)
+          + sizeof(struct pcapng_opt) + PCAPNG_PAD(namelen)
+          + sizeof(struct pcapng_opt) + PCAPNG_PAD(sizeof(tsresol))
+          + sizeof(struct pcapng_opt) + sizeof(uint32_t);
+
+    idb.head.type = PCAPNG_BT_IDB;
+    idb.head.total_len = total;
+    idb.linktype = PCAPNG_LINKTYPE_ETHERNET;
+    idb.reserved = 0;
+    idb.snaplen = snaplen;
+
+    if (fwrite(&idb, sizeof(idb), 1, fp) != 1 ||
+            pcapng_write_opt(fp, PCAPNG_OPT_IF_NAME, ifname, namelen) != EDPVS_OK ||
+            pcapng_write_opt(fp, PCAPNG_OPT_IF_TSRESOL, &tsresol,
+                             sizeof(tsresol)) != EDPVS_OK ||
+            pcapng_write_opt(fp, PCAPNG_OPT_ENDOFOPT, NULL, 0) != EDPVS_OK ||
+            fwrite(&total, sizeof(total), 1, fp) != 1)
+        return EDPVS_IO;
+
+    return EDPVS_OK;
+}
+
+static int pcapng_write_epb(FILE *fp, uint32_t ifid, uint64_t ts,
+                            const struct rte_mbuf *mbuf, uint32_t caplen,
+                            uint32_t origlen, uint32_t flags)
+{
+    struct pcapng_epb epb;
+    const struct rte_mbuf *seg;
+    static const uint8_t pad[4] = { 0 };
+    uint32_t total, left, len;
+
+    total = sizeof(epb) + PCAPNG_PAD(caplen)
+          + sizeof(struct pcapng_opt) + sizeof(flags)
+          + sizeof(struct pcapng_opt) + sizeof(uint32_t);
+
+    epb.head.type = PCAPNG_BT_EPB;
+    epb.head.total_len = total;
+    epb.ifid = ifid;
+    epb.ts_high = (uint32_t)(ts >> 32);
+    epb.ts_low = (uint32_t)ts;
+    epb.caplen = caplen;
+    epb.origlen = origlen;
+
+    if (fwrite(&epb, sizeof(epb), 1, fp) != 1)
+        return EDPVS_IO;
+
+    left = caplen;
+    for (seg = mbuf; seg && left; seg = seg->next) {
+        len = RTE_MIN(left, (uint32_t)seg->data_len);
+        if (fwrite(rte_pktmbuf_mtod(seg, void *), len, 1, fp) != 1)
+            return EDPVS_IO;
+        left -= len;
+    }
+
+    if (PCAPNG_PAD(caplen) != caplen &&
+            fwrite(pad, PCAPNG_PAD(caplen) - caplen, 1, fp) != 1)
+        return EDPVS_IO;
+
+    if (pcapng_write_opt(fp, PCAPNG_OPT_EPB_FLAGS, &flags, sizeof(flags)) != EDPVS_OK ||
+            pcapng_write_opt(fp, PCAPNG_OPT_ENDOFOPT, NULL, 0) != EDPVS_OK ||
+            fwrite(&total, sizeof(total), 1, fp) != 1)
+        return EDPVS_IO;
+
+    return EDPVS_OK;
+}
+
+static void capture_stop(void)
+{
+    struct capture_session *sess = &capture_sess;
+    struct netif_port *dev;
+    portid_t pid, nports;
+
+    if (!sess->running)
+        return;
+
+    nports = netif_port_count();
+    for (pid = 0; pid < nports; pid++) {
+        dev = netif_port_get(pid);
+        if (dev)
+            dev->flag &= ~NETIF_PORT_FLAG_CAPTURE;
+    }
+    rte_wmb();
+
+    sess->running = false;
+    if (sess->fp) {
+        fclose(sess->fp);
+        sess->fp = NULL;
+    }
+
+    RTE_LOG(INFO, CAPTURE, "capture stopped, %lu packets written to %s\n",
+            sess->written, sess->conf.file);
+}
+
+static int capture_start(const struct dp_vs_capture_conf *conf)
+{
+    struct capture_session *sess = &capture_sess;
+    struct netif_port *dev = NULL;
+    struct timeval tv;
+    portid_t pid, nports;
+    lcoreid_t cid;
+    int err;
+
+    if (sess->running)
+        return EDPVS_BUSY;
+
+    if (!(conf->direction & CAPTURE_DIR_BOTH) || !strlen(conf->file))
+        return EDPVS_INVAL;
+
+    if (conf->bpf_len &&
+            capture_bpf_check(conf->bpf, conf->bpf_len) != EDPVS_OK) {
+        RTE_LOG(WARNING, CAPTURE, "%s: invalid BPF program\n", __func__);
+        return EDPVS_INVAL;
+    }
+
+    if (strlen(conf->ifname)) {
+        dev = netif_port_get_by_name(conf->ifname);
+        if (!dev)
+            return EDPVS_NODEV;
+    }
+
+    memset(sess, 0, sizeof(*sess));
+    memcpy(&sess->conf, conf, sizeof(sess->conf));
+    sess->conf.ifname[IFNAMSIZ - 1] = '\0';
+    sess->conf.file[CAPTURE_FILE_NAMELEN - 1] = '\0';
+    if (!sess->conf.snaplen || sess->conf.snaplen > CAPTURE_SNAPLEN_DEF)
+        sess->conf.snaplen = CAPTURE_SNAPLEN_DEF;
+    sess->port = dev ? dev->id : NETIF_PORT_ID_ALL;
+    for (pid = 0; pid < NETIF_MAX_PORTS; pid++)
+        sess->ifids[pid] = -1;
+
+    sess->fp = fopen(sess->conf.file, "w");
+    if (!sess->fp) {
+        RTE_LOG(ERR, CAPTURE, "%s: fail to open %s: %s\n", __func__,
+                sess->conf.file, strerror(errno));
+        return EDPVS_IO;
+    }
+
+    err = pcapng_write_shb(sess->fp);
+    if (err != EDPVS_OK) {
+        fclose(sess->fp);
+        sess->fp = NULL;
+        return err;
+    }
+
+    gettimeofday(&tv, NULL);
+    sess->tsc_base = rte_rdtsc();
+    sess->ns_base = tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        memset(&capture_lcores[cid].stats, 0, sizeof(capture_lcores[cid].stats));
+        capture_lcores[cid].stats.cid = cid;
+    }
+
+    sess->running = true;
+    rte_wmb();
+
+    /* session is ready, let workers see it */
+    if (dev) {
+        dev->flag |= NETIF_PORT_FLAG_CAPTURE;
+    } else {
+        nports = netif_port_count();
+        for (pid = 0; pid < nports; pid++) {
+            dev = netif_port_get(pid);
+            if (dev)
+                dev->flag |= NETIF_PORT_FLAG_CAPTURE;
+        }
+    }
+
+    RTE_LOG(INFO, CAPTURE, "capture started on %s, writing to %s\n",
+            strlen(sess->conf.ifname) ? sess->conf.ifname : "all devices",
+            sess->conf.file);
+    return EDPVS_OK;
+}
+
+static void capture_write(struct rte_mbuf *mbuf)
+{
+    struct capture_session *sess = &capture_sess;
+    struct netif_port *dev;
+    portid_t pid = CAPTURE_META_PORT(mbuf);
+    uint32_t caplen;
+    uint64_t ts, hz = rte_get_tsc_hz();
+
+    if (!sess->running || !sess->fp)
+        return;
+
+    if (sess->ifids[pid] < 0) {
+        dev = netif_port_get(pid);
+        if (pcapng_write_idb(sess->fp, dev ? dev->name : "unknown",
+                             sess->conf.snaplen) != EDPVS_OK)
+            goto io_err;
+        sess->ifids[pid] = sess->nifs++;
+    }
+
+    ts = mbuf->timestamp - sess->tsc_base;
+    ts = sess->ns_base + ts / hz * 1000000000ULL + ts % hz * 1000000000ULL / hz;
+    caplen = RTE_MIN(mbuf->pkt_len, sess->conf.snaplen);
+
+    if (pcapng_write_epb(sess->fp, sess->ifids[pid], ts, mbuf, caplen,
+                         CAPTURE_META_LEN(mbuf),
+                         CAPTURE_META_DIR(mbuf) == CAPTURE_DIR_RX ?
+                         PCAPNG_EPB_FLAG_INBOUND : PCAPNG_EPB_FLAG_OUTBOUND)
+            != EDPVS_OK)
+        goto io_err;
+
+    if (++sess->written % CAPTURE_FLUSH_INTERVAL == 0)
+        fflush(sess->fp);
+
+    if (sess->conf.count && sess->written >= sess->conf.count)
+        capture_stop();
+    return;
+
+io_err:
+    RTE_LOG(ERR, CAPTURE, "%s: fail to write %s, stop capturing\n",
+            __func__, sess->conf.file);
+    capture_stop();
+}
+
+static void capture_kni_flush(struct netif_port *dev,
+                              struct rte_mbuf **mbufs, unsigned num)
+{
+    unsigned i, sent = 0;
+
+    if (dev)
+        sent = kni_send2kern_burst(dev, mbufs, num);
+
+    for (i = sent; i < num; i++)
+        rte_pktmbuf_free(mbufs[i]);
+
+    capture_kni_sent += sent;
+    capture_kni_dropped += num - sent;
+}
+
+void capture_process_on_master(void)
+{
+    struct rte_mbuf *mbufs[CAPTURE_DEQ_BURST];
+    struct rte_mbuf *kni_mbufs[CAPTURE_DEQ_BURST];
+    struct rte_mbuf *mbuf, *copy;
+    struct netif_port *dev, *kni_dev;
+    unsigned i, n, nkni;
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!capture_lcores[cid].ring)
+            continue;
+
+        n = rte_ring_sc_dequeue_burst(capture_lcores[cid].ring,
+                                      (void **)mbufs, CAPTURE_DEQ_BURST, NULL);
+        if (!n)
+            continue;
+
+        kni_dev = NULL;
+        nkni = 0;
+
+        for (i = 0; i < n; i++) {
+            mbuf = mbufs[i];
+
+            if (CAPTURE_META_SINKS(mbuf) & CAPTURE_SINK_FILE)
+                capture_write(mbuf);
+
+            if (!(CAPTURE_META_SINKS(mbuf) & CAPTURE_SINK_KNI)) {
+                rte_pktmbuf_free(mbuf);
+                continue;
+            }
+
+            /* KNI cannot handle indirect mbufs, copy TX clones here
+             * on master rather than on workers. */
+            if (RTE_MBUF_INDIRECT(mbuf)) {
+                copy = mbuf_copy(mbuf, mbuf->pool);
+                rte_pktmbuf_free(mbuf);
+                if (!copy) {
+                    capture_kni_dropped++;
+                    continue;
+                }
+                mbuf = copy;
+            }
+
+            dev = netif_port_get(CAPTURE_META_PORT(mbuf));
+            if (nkni && dev != kni_dev) {
+                capture_kni_flush(kni_dev, kni_mbufs, nkni);
+                nkni = 0;
+            }
+            kni_dev = dev;
+            kni_mbufs[nkni++] = mbuf;
+        }
+
+        if (nkni)
+            capture_kni_flush(kni_dev, kni_mbufs, nkni);
+    }
+}
+
+/*
+ * control plane
+ */
+static int capture_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    switch (opt) {
+    case SOCKOPT_SET_CAPTURE_START:
+        if (!conf || size < sizeof(struct dp_vs_capture_conf))
+            return EDPVS_INVAL;
+        return capture_start(conf);
+    case SOCKOPT_SET_CAPTURE_STOP:
+        if (!capture_sess.running)
+            return EDPVS_NOTEXIST;
+        capture_stop();
+        return EDPVS_OK;
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static int capture_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                               void **out, size_t *outsize)
+{
+    struct dp_vs_capture_show *show;
+    lcoreid_t cid;
+    size_t len;
+    int nlcore = 0;
+
+    if (opt != SOCKOPT_GET_CAPTURE_SHOW)
+        return EDPVS_NOTSUPP;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (capture_lcores[cid].ring)
+            nlcore++;
+    }
+
+    len = sizeof(*show) + nlcore * sizeof(struct dp_vs_capture_lcore_stats);
+    show = rte_zmalloc(NULL, len, 0);
+    if (!show)
+        return EDPVS_NOMEM;
+
+    show->running = capture_sess.running;
+    memcpy(&show->conf, &capture_sess.conf, sizeof(show->conf));
+    show->written = capture_sess.written;
+    show->kni_sent = capture_kni_sent;
+    show->kni_dropped = capture_kni_dropped;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!capture_lcores[cid].ring)
+            continue;
+        show->lcores[show->nlcore] = capture_lcores[cid].stats;
+        show->lcores[show->nlcore].cid = cid;
+        show->nlcore++;
+    }
+
+    *out = show;
+    *outsize = len;
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts capture_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_SET_CAPTURE_START,
+    .set_opt_max    = SOCKOPT_SET_CAPTURE_STOP,
+    .set            = capture_sockopt_set,
+    .get_opt_min    = SOCKOPT_GET_CAPTURE_SHOW,
+    .get_opt_max    = SOCKOPT_GET_CAPTURE_SHOW,
+    .get            = capture_sockopt_get,
+};
+
+int capture_init(void)
+{
+    char name[RTE_RING_NAMESIZE];
+    lcoreid_t cid;
+    int socket_id, err;
+
+    for (socket_id = 0; socket_id < get_numa_nodes(); socket_id++) {
+        snprintf(name, sizeof(name), "capture_pool_%d", socket_id);
+        capture_pool[socket_id] = rte_pktmbuf_pool_create(name,
+                CAPTURE_POOL_SIZE, CAPTURE_POOL_CACHE, 0,
+                CAPTURE_MBUF_SIZE, socket_id);
+        if (!capture_pool[socket_id]) {
+            RTE_LOG(ERR, CAPTURE, "%s: fail to create %s\n", __func__, name);
+            return EDPVS_NOMEM;
+        }
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!rte_lcore_is_enabled(cid) || cid == rte_get_master_lcore())
+            continue;
+
+        snprintf(name, sizeof(name), "capture_ring_c%d", cid);
+        capture_lcores[cid].ring = rte_ring_create(name, CAPTURE_RING_SIZE,
+                rte_lcore_to_socket_id(cid), RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!capture_lcores[cid].ring) {
+            RTE_LOG(ERR, CAPTURE, "%s: fail to create %s\n", __func__, name);
+            return EDPVS_NOMEM;
+        }
+        capture_lcores[cid].stats.cid = cid;
+    }
+
+    if ((err = sockopt_register(&capture_sockopts)) != EDPVS_OK)
+        return err;
+
+    return EDPVS_OK;
+}
+
+int capture_term(void)
+{
+    struct rte_mbuf *mbuf;
+    lcoreid_t cid;
+    int err;
+
+    capture_stop();
+
+    if ((err = sockopt_unregister(&capture_sockopts)) != EDPVS_OK)
+        return err;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!capture_lcores[cid].ring)
+            continue;
+        while (rte_ring_sc_dequeue(capture_lcores[cid].ring, (void **)&mbuf) == 0)
+            rte_pktmbuf_free(mbuf);
+        rte_ring_free(capture_lcores[cid].ring);
+        capture_lcores[cid].ring = NULL;
+    }
+
+    return EDPVS_OK;
+}
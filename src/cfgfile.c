@@ -33,6 +33,7 @@
 #include "ipvs/proto_tcp.h"
 #include "ipvs/proto_udp.h"
 #include "ipvs/synproxy.h"
+#include "ipvs/sync.h"
 
 typedef void (*sighandler_t)(int);
 
@@ -52,6 +53,7 @@ static void keyword_value_init(void)
     udp_keyword_value_init();
     tcp_keyword_value_init();
     synproxy_keyword_value_init();
+    ipvs_sync_keyword_value_init();
 
     ipv6_keyword_value_init();
 }
@@ -87,6 +89,9 @@ static vector_t install_keywords(void)
     install_proto_udp_keywords();
     install_sublevel_end();
 
+    install_keyword("sync", NULL, KW_TYPE_NORMAL);
+    install_ipvs_sync_keywords();
+
     install_ipv6_keywords();
 
     return g_keywords;
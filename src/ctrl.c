@@ -18,6 +18,7 @@
 #include <sys/socket.h>
 #include <fcntl.h>
 #include <sys/un.h>
+#include <poll.h>
 #include <unistd.h>
 #include <libgen.h>
 #include <string.h>
@@ -286,6 +287,7 @@ struct dpvs_msg* msg_make(msgid_t type, uint32_t seq,
     msg->mode = mode;
     msg->cid = cid;
     msg->len = len;
+    msg->data = msg->buf;
     if (len)
         memcpy(msg->data, data, len);
     assert(0 == flags);
@@ -415,6 +417,33 @@ int msg_send(struct dpvs_msg *msg, lcoreid_t cid, uint32_t flags, struct dpvs_ms
         return EDPVS_MSG_DROP;
 }
 
+/*
+ * make a header-only msg sharing payload of multicast msg @org.
+ * @org is held until all slaves replied (see msg_master_process),
+ * and slaves never write msg data, so the payload needn't be copied.
+ */
+static struct dpvs_msg *msg_make_shared(const struct dpvs_msg *org)
+{
+    struct dpvs_msg *msg;
+
+    msg = rte_zmalloc("msg", sizeof(struct dpvs_msg), RTE_CACHE_LINE_SIZE);
+    if (unlikely(NULL == msg))
+        return NULL;
+
+    rte_spinlock_init(&msg->lock);
+    msg->type = org->type;
+    msg->seq = org->seq;
+    msg->mode = DPVS_MSG_UNICAST;
+    msg->cid = org->cid;
+    msg->len = org->len;
+    msg->data = org->data;
+
+    rte_atomic16_init(&msg->refcnt);
+    rte_atomic16_inc(&msg->refcnt);
+
+    return msg;
+}
+
 /* "msg" must be produced by "msg_make" */
 int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multicast_queue **reply)
 {
@@ -446,7 +475,7 @@ int multicast_msg_send(struct dpvs_msg *msg, uint32_t flags, struct dpvs_multica
     rte_atomic16_inc(&msg->refcnt); /* refcnt increase by 1 for itself */
     for (ii = 0; ii < DPVS_MAX_LCORE; ii++) {
         if (slave_lcore_mask & (1L << ii)) {
-            new_msg = msg_make(msg->type, msg->seq, DPVS_MSG_UNICAST, msg->cid, msg->len, msg->data);
+            new_msg = msg_make_shared(msg);
             if (unlikely(!new_msg)) {
                 RTE_LOG(ERR, MSGMGR, "%s: msg make fail\n", __func__);
                 add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
@@ -574,6 +603,7 @@ int msg_master_process(void)
             }
             if (mcq->mask & (1L << msg->cid)) { /* you are the msg i'm waiting */
                 list_add_tail(&msg->mq_node, &mcq->mq);
+                mcq->replies[msg->cid] = msg;
                 add_msg_flags(msg, DPVS_MSG_F_STATE_QUEUE);/* set QUEUE flag for slave's reply msg */
                 mcq->mask &= ~(1L << msg->cid);
                 if (test_msg_flags(msg, DPVS_MSG_F_CALLBACK_FAIL)) /* callback on slave failed */
@@ -607,7 +637,7 @@ int msg_master_process(void)
 /* only unicast msg can be recieved on slave lcore */
 int msg_slave_process(void)
 {
-    struct dpvs_msg *msg, *xmsg;
+    struct dpvs_msg *msg;
     struct dpvs_msg_type *msg_type;
     lcoreid_t cid;
     int ret = EDPVS_OK;
@@ -644,22 +674,17 @@ int msg_slave_process(void)
                      __func__, msg->type, cid);
             }
         }
-        /* send response msg to Master for multicast msg */
+        /* send response msg to Master for multicast msg, the recieved msg is
+         * reused as the reply with its data replaced by reply data, which
+         * is freed along with the msg by msg_destroy. */
         if (DPVS_MSG_MULTICAST == msg_type->mode) {
-            xmsg = msg_make(msg->type, msg->seq, DPVS_MSG_UNICAST, cid, msg->reply.len,
-                    msg->reply.data);
-            if (unlikely(!xmsg)) {
-                ret = EDPVS_NOMEM;
-                add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
-                goto cont;
-            }
-            add_msg_flags(xmsg, DPVS_MSG_F_CALLBACK_FAIL & get_msg_flags(msg));
-            if (msg_send(xmsg, master_lcore, DPVS_MSG_F_ASYNC, NULL)) {
+            msg->cid = cid;
+            msg->len = msg->reply.len;
+            msg->data = msg->reply.data;
+            set_msg_flags(msg, DPVS_MSG_F_CALLBACK_FAIL & get_msg_flags(msg));
+            if (msg_send(msg, master_lcore, DPVS_MSG_F_ASYNC, NULL))
                 add_msg_flags(msg, DPVS_MSG_F_STATE_DROP);
-                msg_destroy(&xmsg);
-                goto cont;
-            }
-            msg_destroy(&xmsg);
+            goto cont;
         }
 
         add_msg_flags(msg, DPVS_MSG_F_STATE_FIN);
@@ -930,22 +955,35 @@ static struct list_head sockopt_list;
 
 static int srv_fd;
 
+/*
+ * clients may keep the connection and send messages (pipelined) one after
+ * another, they're served in order on each master loop. idle clients are
+ * closed, clients reconnect on the next request (see libipvs).
+ */
+#define SOCKOPT_CLIENT_MAX      32
+#define SOCKOPT_CLIENT_BUDGET   64  /* msgs served per client per loop */
+#define SOCKOPT_CLIENT_IDLE     30  /* seconds */
+#define SOCKOPT_CLIENT_EVICT    1   /* seconds idle to give way when full */
+
+static int clt_fds[SOCKOPT_CLIENT_MAX];
+static uint64_t clt_active[SOCKOPT_CLIENT_MAX]; /* cycles */
+static int clt_num;
+
 static inline int judge_id_betw(sockoptid_t num, sockoptid_t min, sockoptid_t max)
 {
     return ((num <= max) && (num >= min));
 }
 
-static struct dpvs_sockopts* sockopts_get(struct dpvs_sock_msg *msg)
+static struct dpvs_sockopts* sockopts_lookup(enum sockopt_type type,
+                                             sockoptid_t id, uint32_t version)
 {
     struct dpvs_sockopts *skopt;
-    if (unlikely(NULL == msg))
-        return NULL;
 
-    switch (msg->type) {
+    switch (type) {
         case SOCKOPT_GET:
             list_for_each_entry(skopt, &sockopt_list, list) {
-                if (judge_id_betw(msg->id, skopt->get_opt_min, skopt->get_opt_max)) {
-                    if (unlikely(skopt->version != msg->version)) {
+                if (skopt->get && judge_id_betw(id, skopt->get_opt_min, skopt->get_opt_max)) {
+                    if (unlikely(skopt->version != version)) {
                         RTE_LOG(WARNING, MSGMGR, "%s: socket msg version not match\n", __func__);
                         return NULL;
                     }
@@ -956,8 +994,8 @@ static struct dpvs_sockopts* sockopts_get(struct dpvs_sock_msg *msg)
             break;
         case SOCKOPT_SET:
             list_for_each_entry(skopt, &sockopt_list, list) {
-                if (judge_id_betw(msg->id, skopt->set_opt_min, skopt->set_opt_max)) {
-                    if (unlikely(skopt->version != msg->version)) {
+                if (skopt->set && judge_id_betw(id, skopt->set_opt_min, skopt->set_opt_max)) {
+                    if (unlikely(skopt->version != version)) {
                         RTE_LOG(WARNING, MSGMGR, "%s: socket msg version not match\n", __func__);
                         return NULL;
                     }
@@ -967,24 +1005,45 @@ static struct dpvs_sockopts* sockopts_get(struct dpvs_sock_msg *msg)
             return NULL;
             break;
         default:
-            RTE_LOG(WARNING, MSGMGR, "%s: unkown sock msg type: %d\n", __func__, msg->type);
+            RTE_LOG(WARNING, MSGMGR, "%s: unkown sock msg type: %d\n", __func__, type);
     }
     return NULL;
 }
 
+static inline struct dpvs_sockopts* sockopts_get(struct dpvs_sock_msg *msg)
+{
+    if (unlikely(NULL == msg))
+        return NULL;
+
+    return sockopts_lookup(msg->type, msg->id, msg->version);
+}
+
+static inline int judge_range_overlap(sockoptid_t min1, sockoptid_t max1,
+                                      sockoptid_t min2, sockoptid_t max2)
+{
+    return ((min1 <= max2) && (min2 <= max1));
+}
+
 static inline int sockopts_exist(struct dpvs_sockopts *sockopts)
 {
     struct dpvs_sockopts *skopt;
     if (unlikely(NULL == sockopts))
         return 0;
 
+    /* SOCKOPT_SET_BATCH is served by ctrl itself, see sockopt_msg_process */
+    if (judge_id_betw(SOCKOPT_SET_BATCH, sockopts->set_opt_min, sockopts->set_opt_max))
+        return 1;
+
+    /* a range without handler (e.g. get-only modules) is not served */
     list_for_each_entry(skopt, &sockopt_list, list) {
-        if (judge_id_betw(sockopts->set_opt_min, skopt->set_opt_min, skopt->set_opt_max) ||
-                judge_id_betw(sockopts->set_opt_max, skopt->set_opt_min, skopt->set_opt_max)) {
+        if (sockopts->set && skopt->set &&
+                judge_range_overlap(sockopts->set_opt_min, sockopts->set_opt_max,
+                                    skopt->set_opt_min, skopt->set_opt_max)) {
             return 1;
         }
-        if (judge_id_betw(sockopts->get_opt_min, skopt->get_opt_min, skopt->get_opt_max) ||
-                judge_id_betw(sockopts->get_opt_max, skopt->get_opt_min, skopt->get_opt_max)) {
+        if (sockopts->get && skopt->get &&
+                judge_range_overlap(sockopts->get_opt_min, sockopts->get_opt_max,
+                                    skopt->get_opt_min, skopt->get_opt_max)) {
             return 1;
         }
     }
@@ -1043,6 +1102,8 @@ static inline int sockopt_msg_recv(int clt_fd, struct dpvs_sock_msg **pmsg)
     len = sizeof(msg_hdr);
     memset(&msg_hdr, 0, len);
     res = readn(clt_fd, &msg_hdr, len);
+    if (0 == res) /* client closed */
+        return EDPVS_IO;
     if (sizeof(msg_hdr) != res) {
         RTE_LOG(WARNING, MSGMGR, "%s: sockopt msg header recv fail -- %d/%d recieved\n",
                 __func__, res, len);
@@ -1117,74 +1178,289 @@ static int sockopt_msg_send(int clt_fd,
     return EDPVS_OK;
 }
 
-int sockopt_ctl(__rte_unused void *arg)
+/*
+ * apply all set entries of a batch in order. on failure, entries applied
+ * already are rolled back in reverse order if DPVS_SOCK_BATCH_F_ATOMIC,
+ * by the rollback callback of their sockopts. with DPVS_SOCK_BATCH_F_CONTINUE
+ * the rest entries are still applied. @failed is the index of the (first)
+ * failed entry. @results is set to the result of each entry if asked by
+ * DPVS_SOCK_BATCH_F_RESULTS and the batch is valid, freed by caller.
+ */
+static int sockopt_batch_apply(const struct dpvs_sock_msg *msg, uint32_t *failed,
+                               int32_t **results)
+{
+    const struct dpvs_sock_batch *batch = (const void *)msg->data;
+    const struct dpvs_sock_batch_entry *ent;
+    struct dpvs_sockopts **skopts = NULL;
+    uint32_t *offs = NULL;
+    int32_t *res = NULL;
+    size_t off;
+    uint32_t i;
+    int j, ret, err = EDPVS_OK;
+
+    *failed = 0;
+    *results = NULL;
+    if (msg->len < sizeof(*batch))
+        return EDPVS_INVAL;
+    if (!batch->count)
+        return EDPVS_OK;
+    if (batch->count > (msg->len - sizeof(*batch)) / sizeof(*ent))
+        return EDPVS_INVAL;
+
+    offs = rte_malloc(NULL, batch->count * sizeof(uint32_t), 0);
+    skopts = rte_malloc(NULL, batch->count * sizeof(*skopts), 0);
+    if (unlikely(!offs || !skopts)) {
+        err = EDPVS_NOMEM;
+        goto out;
+    }
+
+    if ((batch->flags & DPVS_SOCK_BATCH_F_RESULTS) &&
+            !(batch->flags & DPVS_SOCK_BATCH_F_ATOMIC)) {
+        res = rte_malloc(NULL, batch->count * sizeof(int32_t), 0);
+        if (unlikely(!res)) {
+            err = EDPVS_NOMEM;
+            goto out;
+        }
+        for (i = 0; i < batch->count; i++)
+            res[i] = EDPVS_IDLE;
+    }
+
+    /* validate the whole batch before applying anything */
+    off = sizeof(*batch);
+    for (i = 0; i < batch->count; i++) {
+        *failed = i;
+        if (off + sizeof(*ent) > msg->len) {
+            err = EDPVS_INVAL;
+            goto out;
+        }
+        ent = (const void *)(msg->data + off);
+        if (ent->len > msg->len - off - sizeof(*ent)) {
+            err = EDPVS_INVAL;
+            goto out;
+        }
+        skopts[i] = sockopts_lookup(SOCKOPT_SET, ent->id, msg->version);
+        if (!skopts[i]) {
+            err = EDPVS_NOTSUPP;
+            goto out;
+        }
+        offs[i] = off;
+        off += DPVS_SOCK_BATCH_ALIGN(sizeof(*ent) + ent->len);
+    }
+
+    for (i = 0; i < batch->count; i++) {
+        ent = (const void *)(msg->data + offs[i]);
+        ret = skopts[i]->set(ent->id, ent->data, ent->len);
+        if (res)
+            res[i] = ret;
+        if (ret == EDPVS_OK)
+            continue;
+        if (err == EDPVS_OK) {
+            *failed = i;
+            err = ret;
+        }
+        if (!(batch->flags & DPVS_SOCK_BATCH_F_CONTINUE) ||
+                (batch->flags & DPVS_SOCK_BATCH_F_ATOMIC))
+            break;
+    }
+
+    if (err != EDPVS_OK && (batch->flags & DPVS_SOCK_BATCH_F_ATOMIC)) {
+        for (j = (int)i - 1; j >= 0; j--) {
+            ent = (const void *)(msg->data + offs[j]);
+            if (!skopts[j]->rollback ||
+                    skopts[j]->rollback(ent->id, ent->data, ent->len) != EDPVS_OK)
+                RTE_LOG(WARNING, MSGMGR, "%s: fail to roll back batch entry %d "
+                        "<id=%d>\n", __func__, j, ent->id);
+        }
+    }
+
+    /* the batch is valid and applied */
+    *results = res;
+    res = NULL;
+
+out:
+    if (res)
+        rte_free(res);
+    if (offs)
+        rte_free(offs);
+    if (skopts)
+        rte_free(skopts);
+    return err;
+}
+
+/* serve one message of the client, return error if the client is gone. */
+static int sockopt_msg_process(int clt_fd)
 {
-    int clt_fd;
     int ret;
-    socklen_t clt_len;
-    struct sockaddr_un clt_addr;
     struct dpvs_sockopts *skopt;
     struct dpvs_sock_msg *msg;
     struct dpvs_sock_msg_reply reply_hdr;
     void *reply_data = NULL;
     size_t reply_data_len = 0;
+    uint32_t failed = 0;
+    int32_t *results = NULL;
 
-    memset(&clt_addr, 0, sizeof(struct sockaddr_un));
-    clt_len = sizeof(clt_addr);
+    /* Note: clt_fd is block */
+    ret = sockopt_msg_recv(clt_fd, &msg);
+    if (unlikely(EDPVS_OK != ret))
+        return ret;
 
-    /* Note: srv_fd is nonblock */
-    clt_fd = accept(srv_fd, (struct sockaddr*)&clt_addr, &clt_len);
-    if (clt_fd < 0) {
-        if (EWOULDBLOCK != errno) {
-            RTE_LOG(WARNING, MSGMGR, "%s: Fail to accept client request\n", __func__);
+    memset(&reply_hdr, 0, sizeof(reply_hdr));
+    reply_hdr.version = SOCKOPT_VERSION;
+    reply_hdr.id = msg->id;
+    reply_hdr.type = msg->type;
+
+    if (msg->type == SOCKOPT_SET && msg->id == SOCKOPT_SET_BATCH) {
+        ret = sockopt_batch_apply(msg, &failed, &results);
+        if (ret != EDPVS_OK) {
+            RTE_LOG(INFO, MSGMGR, "%s: socket msg batch failed at entry %u: %s\n",
+                    __func__, failed, dpvs_strerror(ret));
+            snprintf(reply_hdr.errstr, SOCKOPT_ERRSTR_LEN, "batch entry %u: %s",
+                     failed, dpvs_strerror(ret));
         }
-        return EDPVS_IO;
+        if (results) {
+            /* entry failures are told by results */
+            reply_data = results;
+            reply_data_len = ((const struct dpvs_sock_batch *)msg->data)->count
+                             * sizeof(int32_t);
+            ret = EDPVS_OK;
+        }
+    } else {
+        skopt = sockopts_get(msg);
+        if (skopt) {
+            if (msg->type == SOCKOPT_GET)
+                ret = skopt->get(msg->id, msg->data, msg->len, &reply_data, &reply_data_len);
+            else
+                ret = skopt->set(msg->id, msg->data, msg->len);
+            if (ret < 0) {
+                /* assume that reply_data is freed by user when callback fails */
+                reply_data = NULL;
+                reply_data_len = 0;
+                RTE_LOG(INFO, MSGMGR, "%s: socket msg<type=%s, id=%d> callback failed\n",
+                        __func__, msg->type == SOCKOPT_GET ? "GET" : "SET", msg->id);
+            }
+        } else {
+            /* reply rather than close, the client may keep the connection */
+            ret = EDPVS_NOTSUPP;
+        }
+        strncpy(reply_hdr.errstr, dpvs_strerror(ret), SOCKOPT_ERRSTR_LEN - 1);
     }
 
-    /* Note: clt_fd is block */
-    ret = sockopt_msg_recv(clt_fd, &msg);
-    if (unlikely(EDPVS_OK != ret)) {
-        close(clt_fd);
-        return ret;
+    reply_hdr.errcode = ret;
+    reply_hdr.len = reply_data_len;
+
+    /* send response */
+    ret = sockopt_msg_send(clt_fd, &reply_hdr, reply_data, reply_data_len);
+
+    if (reply_data)
+        rte_free(reply_data);
+    sockopt_msg_free(msg);
+
+    /* errcode of callback is replied, only IO error closes the client */
+    return ret == EDPVS_IO ? EDPVS_IO : EDPVS_OK;
+}
+
+static inline bool sockopt_readable(int fd)
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLIN };
+
+    return poll(&pfd, 1, 0) > 0;
+}
+
+static void sockopt_client_close(int i)
+{
+    close(clt_fds[i]);
+    clt_num--;
+    clt_fds[i] = clt_fds[clt_num];
+    clt_active[i] = clt_active[clt_num];
+}
+
+/* close the longest idle client, if idle for @min_idle cycles */
+static bool sockopt_client_evict(uint64_t now, uint64_t min_idle)
+{
+    int i, idlest = -1;
+
+    for (i = 0; i < clt_num; i++) {
+        if (now - clt_active[i] < min_idle)
+            continue;
+        if (idlest < 0 || clt_active[i] < clt_active[idlest])
+            idlest = i;
     }
+    if (idlest < 0)
+        return false;
 
-    skopt = sockopts_get(msg);
-    if (skopt) {
-        if (msg->type == SOCKOPT_GET)
-            ret = skopt->get(msg->id, msg->data, msg->len, &reply_data, &reply_data_len);
-        else if (msg->type == SOCKOPT_SET)
-            ret = skopt->set(msg->id, msg->data, msg->len);
-        if (ret < 0) {
-            /* assume that reply_data is freed by user when callback fails */
-            reply_data = NULL;
-            reply_data_len = 0;
-            RTE_LOG(INFO, MSGMGR, "%s: socket msg<type=%s, id=%d> callback failed\n",
-                    __func__, msg->type == SOCKOPT_GET ? "GET" : "SET", msg->id);
+    sockopt_client_close(idlest);
+    return true;
+}
+
+static void sockopt_accept(void)
+{
+    int clt_fd;
+    socklen_t clt_len;
+    struct sockaddr_un clt_addr;
+    uint64_t now = rte_get_timer_cycles();
+
+    for (;;) {
+        /* pending clients wait in backlog if all are busy */
+        if (clt_num >= SOCKOPT_CLIENT_MAX && (!sockopt_readable(srv_fd) ||
+                !sockopt_client_evict(now, SOCKOPT_CLIENT_EVICT * rte_get_timer_hz())))
+            return;
+
+        memset(&clt_addr, 0, sizeof(struct sockaddr_un));
+        clt_len = sizeof(clt_addr);
+
+        /* Note: srv_fd is nonblock */
+        clt_fd = accept(srv_fd, (struct sockaddr*)&clt_addr, &clt_len);
+        if (clt_fd < 0) {
+            if (EWOULDBLOCK != errno) {
+                RTE_LOG(WARNING, MSGMGR, "%s: Fail to accept client request\n", __func__);
+            }
+            return;
         }
 
-        memset(&reply_hdr, 0, sizeof(reply_hdr));
-        reply_hdr.version = SOCKOPT_VERSION;
-        reply_hdr.id = msg->id;
-        reply_hdr.type = msg->type;
-        reply_hdr.errcode = ret;
-        strncpy(reply_hdr.errstr, dpvs_strerror(ret), SOCKOPT_ERRSTR_LEN - 1);
-        reply_hdr.len = reply_data_len;
+        clt_active[clt_num] = now;
+        clt_fds[clt_num++] = clt_fd;
+    }
+}
+
+int sockopt_ctl(__rte_unused void *arg)
+{
+    struct pollfd pfds[SOCKOPT_CLIENT_MAX];
+    int i, n, budget, ret;
+    uint64_t now;
 
-        /* send response */
-        ret = sockopt_msg_send(clt_fd, &reply_hdr, reply_data, reply_data_len);
+    sockopt_accept();
+    if (!clt_num)
+        return EDPVS_OK;
 
-        if (reply_data)
-            rte_free(reply_data);
+    now = rte_get_timer_cycles();
+    while (sockopt_client_evict(now, SOCKOPT_CLIENT_IDLE * rte_get_timer_hz()))
+        ;
 
-        if (EDPVS_OK != ret) {
-            sockopt_msg_free(msg);
-            close(clt_fd);
-            return ret;
-        }
+    for (i = 0; i < clt_num; i++) {
+        pfds[i].fd = clt_fds[i];
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
     }
 
-    sockopt_msg_free(msg);
-    close(clt_fd);
+    n = poll(pfds, clt_num, 0);
+    if (n <= 0)
+        return n < 0 ? EDPVS_IO : EDPVS_OK;
+
+    /* backward, so that removing client by swapping with the last is safe */
+    for (i = clt_num - 1; i >= 0; i--) {
+        if (!pfds[i].revents)
+            continue;
+
+        clt_active[i] = now;
+        budget = SOCKOPT_CLIENT_BUDGET;
+        do {
+            ret = sockopt_msg_process(clt_fds[i]);
+            if (ret != EDPVS_OK) {
+                sockopt_client_close(i);
+                break;
+            }
+        } while (--budget > 0 && sockopt_readable(clt_fds[i]));
+    }
 
     return EDPVS_OK;
 }
@@ -1224,7 +1500,7 @@ static inline int sockopt_init(void)
         return EDPVS_IO;
     }
 
-    if (-1 == listen(srv_fd, 1)) {
+    if (-1 == listen(srv_fd, SOCKOPT_CLIENT_MAX)) {
         RTE_LOG(ERR, MSGMGR, "%s: Server socket listen failed\n", __func__);
         close(srv_fd);
         unlink(ipc_unix_domain);
@@ -1236,6 +1512,9 @@ static inline int sockopt_init(void)
 
 static inline int sockopt_term(void)
 {
+    while (clt_num > 0)
+        close(clt_fds[--clt_num]);
+
     close(srv_fd);
     unlink(ipc_unix_domain);
     return EDPVS_OK;
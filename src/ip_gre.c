@@ -28,73 +28,13 @@
 #include "ipv4.h"
 #include "icmp.h"
 #include "ip_tunnel.h"
+#include "gre.h"
 
 #define GRE
 #define RTE_LOGTYPE_GRE     RTE_LOGTYPE_USER1
 
-#define GRE_F_CSUM          htobe16(0x8000)
-#define GRE_F_ROUTING       htobe16(0x4000)
-#define GRE_F_KEY           htobe16(0x2000)
-#define GRE_F_SEQ           htobe16(0x1000)
-#define GRE_F_STRICT        htobe16(0x0800)
-#define GRE_F_REC           htobe16(0x0700)
-#define GRE_F_FLAGS         htobe16(0x00F8)
-#define GRE_F_VERSION       htobe16(0x0007)
-
-/* linux: net/gre.h */
-struct gre_base_hdr {
-    __be16  flags;
-    __be16  protocol;
-} __attribute__((__packed__));
-
 static struct ip_tunnel_tab gre_tunnel_tab;
 
-/* linux: gre_flags_to_tnl_flags */
-static inline __be16 flags_gre2tnl(__be16 flags)
-{
-    __be16 tflags = 0;
-
-    if (flags & GRE_F_CSUM)
-        tflags |= TUNNEL_F_CSUM;
-    if (flags & GRE_F_ROUTING)
-        tflags |= TUNNEL_F_ROUTING;
-    if (flags & GRE_F_KEY)
-        tflags |= TUNNEL_F_KEY;
-    if (flags & GRE_F_SEQ)
-        tflags |= TUNNEL_F_SEQ;
-    if (flags & GRE_F_STRICT)
-        tflags |= TUNNEL_F_STRICT;
-    if (flags & GRE_F_REC)
-        tflags |= TUNNEL_F_REC;
-    if (flags & GRE_F_VERSION)
-        tflags |= TUNNEL_F_VERSION;
-
-    return tflags;
-}
-
-/* linux: gre_tnl_flags_to_gre_flags */
-static inline __be16 flags_tnl2gre(__be16 tflags)
-{
-    __be16 flags = 0;
-
-    if (tflags & TUNNEL_F_CSUM)
-        flags |= GRE_F_CSUM;
-    if (tflags & TUNNEL_F_ROUTING)
-        flags |= GRE_F_ROUTING;
-    if (tflags & TUNNEL_F_KEY)
-        flags |= GRE_F_KEY;
-    if (tflags & TUNNEL_F_SEQ)
-        flags |= GRE_F_SEQ;
-    if (tflags & TUNNEL_F_STRICT)
-        flags |= GRE_F_STRICT;
-    if (tflags & TUNNEL_F_REC)
-        flags |= GRE_F_REC;
-    if (tflags & TUNNEL_F_VERSION)
-        flags |= GRE_F_VERSION;
-
-    return flags;
-}
-
 static inline __be16 gre_checksum(struct rte_mbuf *mbuf)
 {
     __be16 csum;
@@ -103,24 +43,9 @@ static inline __be16 gre_checksum(struct rte_mbuf *mbuf)
     return csum == 0xffff ? csum : ~csum;
 }
 
-/* linux: gre_calc_hlen */
-static inline int gre_calc_hlen(__be16 o_flags)
-{
-    int addend = 4;
-
-    if (o_flags & TUNNEL_F_CSUM)
-        addend += 4;
-    if (o_flags & TUNNEL_F_KEY)
-        addend += 4;
-    if (o_flags & TUNNEL_F_SEQ)
-        addend += 4;
-
-    return addend;
-}
-
 /* linux: gre_build_header */
-static int gre_build_header(struct rte_mbuf *mbuf, int hlen, __be16 flags,
-                            __be16 proto, __be32 key, __be32 seq)
+int gre_build_header(struct rte_mbuf *mbuf, int hlen, __be16 flags,
+                     __be16 proto, __be32 key, __be32 seq)
 {
     struct gre_base_hdr *greh;
 
@@ -153,9 +78,8 @@ static int gre_build_header(struct rte_mbuf *mbuf, int hlen, __be16 flags,
 
 /* linux: gre_parse_header.
  * return header length to be pulled and fill tpi if success. */
-static int gre_parse_header(struct rte_mbuf *mbuf,
-                            struct ip_tunnel_pktinfo *tpi,
-                            bool *csum_err, __be16 proto)
+int gre_parse_header(struct rte_mbuf *mbuf, struct ip_tunnel_pktinfo *tpi,
+                     bool *csum_err, __be16 proto)
 {
     const struct gre_base_hdr *greh;
     __be32 *options;
@@ -29,6 +29,7 @@
 #include "ipv4.h"
 #include "icmp.h"
 #include "ctrl.h"
+#include "kni.h"
 #include "ip_tunnel.h"
 
 #define TUNNEL
@@ -211,6 +212,17 @@ static struct netif_port *tunnel_create(struct ip_tunnel_tab *tab,
         return NULL;
     }
 
+    /* kernel may route over ethernet tunnels through KNI,
+     * e.g., health checks of RSs in VXLAN overlay. */
+    if (ops->kni) {
+        err = kni_add_dev(dev, NULL);
+        if (err != EDPVS_OK) {
+            netif_port_unregister(dev);
+            netif_free(dev);
+            return NULL;
+        }
+    }
+
     /* set MTU after op_init, need calc tnl->hlen first */
     dev->mtu = tunnel_bind_dev(dev);
 
@@ -263,6 +275,9 @@ static int tunnel_destroy(struct ip_tunnel_tab *tab, struct netif_port *dev)
     if (tab->fb_tunnel_dev == dev)
         tab->fb_tunnel_dev = NULL;
 
+    if (kni_dev_exist(dev))
+        kni_del_dev(dev);
+
     netif_port_unregister(dev);
     return netif_free(dev);
 }
@@ -642,8 +657,13 @@ int ip_tunnel_init(void)
     if ((err = gre_init()) != EDPVS_OK)
         goto gre_fail;
 
+    if ((err = vxlan_init()) != EDPVS_OK)
+        goto vxlan_fail;
+
     return EDPVS_OK;
 
+vxlan_fail:
+    gre_term();
 gre_fail:
     ipip_term();
 ipip_fail:
@@ -664,6 +684,10 @@ int ip_tunnel_term(void)
     if (err != EDPVS_OK)
         return err;
 
+    err = vxlan_term();
+    if (err != EDPVS_OK)
+        return err;
+
     err = sockopt_unregister(&ip_tunnel_sockopts);
     if (err != EDPVS_OK)
         return err;
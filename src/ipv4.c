@@ -247,7 +247,7 @@ static int ipv4_output_fin(struct rte_mbuf *mbuf)
 {
     struct route_entry *rt = mbuf->userdata;
 
-    if (mbuf->pkt_len > rt->mtu)
+    if (mbuf_l3_seg_len(mbuf) > rt->mtu)
         return ipv4_fragment(mbuf, rt->mtu, ipv4_output_fin2);
 
     return ipv4_output_fin2(mbuf);
@@ -276,7 +276,7 @@ static int ipv4_forward(struct rte_mbuf *mbuf)
 {
     struct ipv4_hdr *iph = ip4_hdr(mbuf);
     struct route_entry *rt = mbuf->userdata;
-    uint32_t mtu, csum;
+    uint32_t mtu;
 
     assert(rt && rt->port);
 
@@ -287,7 +287,7 @@ static int ipv4_forward(struct rte_mbuf *mbuf)
     }
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         IP4_INC_STATS(fragfails);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG, htonl(mtu));
@@ -300,10 +300,7 @@ static int ipv4_forward(struct rte_mbuf *mbuf)
     }
 
     /* decrease TTL and re-cal the checksum */
-    csum = (uint32_t)iph->hdr_checksum;
-    csum += (uint32_t)htons(0x0100);
-    iph->hdr_checksum = (uint16_t)(csum + (csum >= 0xffff));
-    iph->time_to_live--;
+    ip4_decrease_ttl(iph);
 
     return INET_HOOK(AF_INET, INET_HOOK_FORWARD, mbuf,
             netif_port_get(mbuf->port), rt->port, ipv4_forward_fin);
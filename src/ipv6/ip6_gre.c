@@ -0,0 +1,160 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * dpvs GRE/IPv6 tunnel.
+ * refer linux:net/ipv6/ip6_gre.c
+ *
+ * sequence number is not supported, it needs a counter shared by
+ * all lcores on TX and an order check on RX, neither is lockless.
+ */
+#include <assert.h>
+#include <linux/if_ether.h>
+#include "ipv6.h"
+#include "ip6_tunnel.h"
+#include "gre.h"
+
+#define IP6GRE
+#define RTE_LOGTYPE_IP6GRE  RTE_LOGTYPE_USER1
+
+static struct ip6_tunnel_tab ip6gre_tunnel_tab;
+
+static int ip6gre_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    struct ip6_tunnel_dst *dst = ip6_tunnel_this_dst(netif_priv(dev));
+    int err;
+
+    err = gre_build_header(mbuf, dst->hlen, dst->params.o_flags,
+                           htons(mbuf->packet_type), dst->params.o_key, 0);
+    if (err != EDPVS_OK) {
+        rte_pktmbuf_free(mbuf);
+        return err;
+    }
+
+    return ip6_tunnel_xmit(mbuf, dev, IPPROTO_GRE);
+}
+
+static int ip6gre_dev_init(struct netif_port *dev)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    if ((tnl->params.i_flags | tnl->params.o_flags) & TUNNEL_F_SEQ) {
+        RTE_LOG(ERR, IP6GRE, "%s: sequence number not supported\n",
+                __func__);
+        return EDPVS_NOTSUPP;
+    }
+
+    tnl->hlen = gre_calc_hlen(tnl->params.o_flags);
+
+    return EDPVS_OK;
+}
+
+static struct netif_ops ip6gre_dev_ops = {
+    .op_init        = ip6gre_dev_init,
+    .op_xmit        = ip6gre_xmit,
+    .op_get_link    = ip6_tunnel_get_link,
+    .op_get_stats   = ip6_tunnel_get_stats,
+    .op_get_promisc = ip6_tunnel_get_promisc,
+};
+
+static void ip6gre_setup(struct netif_port *dev)
+{
+    dev->netif_ops = &ip6gre_dev_ops;
+}
+
+static int ip6gre_change(struct netif_port *dev,
+                         const struct ip6_tunnel_param *param)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    if ((param->i_flags | param->o_flags) & TUNNEL_F_SEQ)
+        return EDPVS_NOTSUPP;
+
+    tnl->hlen = gre_calc_hlen(param->o_flags);
+
+    return EDPVS_OK;
+}
+
+static int ip6gre_rcv(struct rte_mbuf *mbuf)
+{
+    int hlen;
+    struct ip6_hdr *ip6h;
+    struct ip6_tunnel *tnl;
+    struct ip_tunnel_pktinfo tpi;
+    bool csum_err = false;
+
+    hlen = gre_parse_header(mbuf, &tpi, &csum_err, htons(ETH_P_IPV6));
+    if (hlen < 0)
+        goto drop;
+
+    ip6h = mbuf->userdata; /* see ip6_local_in_fin */
+
+    tnl = ip6_tunnel_lookup(&ip6gre_tunnel_tab, mbuf->port, tpi.flags,
+                            &ip6h->ip6_src, &ip6h->ip6_dst, tpi.key);
+    if (!tnl)
+        goto drop;
+
+    if (rte_pktmbuf_adj(mbuf, hlen) == NULL)
+        goto drop;
+
+    ip6_tunnel_rcv(tnl, &tpi, mbuf);
+    return 0; /* consumed */
+
+drop:
+    rte_pktmbuf_free(mbuf);
+    return 0;
+}
+
+static struct ip6_tunnel_ops ip6gre_tnl_ops = {
+    .kind       = "ip6gre",
+    .priv_size  = sizeof(struct ip6_tunnel),
+    .setup      = ip6gre_setup,
+    .change     = ip6gre_change,
+};
+
+static struct inet6_protocol ip6gre_proto = {
+    .handler    = ip6gre_rcv,
+    .flags      = INET6_PROTO_F_FINAL,
+};
+
+int ip6gre_init(void)
+{
+    int err;
+
+    err = ip6_tunnel_init_tab(&ip6gre_tunnel_tab, &ip6gre_tnl_ops);
+    if (err != EDPVS_OK)
+        return err;
+
+    err = ipv6_register_protocol(&ip6gre_proto, IPPROTO_GRE);
+    if (err != EDPVS_OK) {
+        ip6_tunnel_term_tab(&ip6gre_tunnel_tab);
+        return err;
+    }
+
+    return err;
+}
+
+int ip6gre_term(void)
+{
+    int err;
+
+    err = ipv6_unregister_protocol(&ip6gre_proto, IPPROTO_GRE);
+    if (err != EDPVS_OK)
+        return err;
+
+    return ip6_tunnel_term_tab(&ip6gre_tunnel_tab);
+}
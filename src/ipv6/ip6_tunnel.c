@@ -0,0 +1,1082 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * IPv6 tunnel commom routines and control plane codes.
+ * refer linux:net/ipv6/ip6_tunnel.c
+ *
+ * each lcore has its own tunnel table and underlay route cache, the
+ * data plane never locks. tables are changed on master and synced to
+ * slaves by MSG_TYPE_TUNNEL6 msgs, which carry the tunnel pointer only.
+ */
+#include <assert.h>
+#include <netinet/ip.h>
+#include <netinet/icmp6.h>
+#include <linux/if_ether.h>
+#include "list.h"
+#include "common.h"
+#include "netif.h"
+#include "neigh.h"
+#include "ipv4.h"
+#include "ipv6.h"
+#include "icmp.h"
+#include "icmp6.h"
+#include "inetaddr.h"
+#include "ctrl.h"
+#include "ip6_tunnel.h"
+
+#define TUNNEL6
+#define RTE_LOGTYPE_TUNNEL6 RTE_LOGTYPE_USER1
+
+enum {
+    TUNNEL6_MSG_ADD     = 1,
+    TUNNEL6_MSG_DEL,
+};
+
+struct ip6_tunnel_msg {
+    int                 op;
+    struct ip6_tunnel   *tnl;
+};
+
+static rte_rwlock_t         ip6_tunnel_lock;
+
+static struct list_head     ip6_tunnel_ops_list;
+
+static int tunnel6_register_ops(struct ip6_tunnel_ops *new)
+{
+    struct ip6_tunnel_ops *ops;
+
+    assert(new);
+
+    rte_rwlock_write_lock(&ip6_tunnel_lock);
+
+    list_for_each_entry(ops, &ip6_tunnel_ops_list, list) {
+        if (strcmp(ops->kind, new->kind) == 0) {
+            rte_rwlock_write_unlock(&ip6_tunnel_lock);
+            return EDPVS_EXIST;
+        }
+    }
+
+    list_add_tail(&new->list, &ip6_tunnel_ops_list);
+
+    rte_rwlock_write_unlock(&ip6_tunnel_lock);
+    return EDPVS_OK;
+}
+
+static int tunnel6_unregister_ops(struct ip6_tunnel_ops *ops)
+{
+    assert(ops);
+
+    rte_rwlock_write_lock(&ip6_tunnel_lock);
+    list_del(&ops->list);
+    rte_rwlock_write_unlock(&ip6_tunnel_lock);
+    return EDPVS_OK;
+}
+
+static struct ip6_tunnel_ops *tunnel6_find_ops(const char *kind)
+{
+    struct ip6_tunnel_ops *ops;
+
+    rte_rwlock_read_lock(&ip6_tunnel_lock);
+
+    list_for_each_entry(ops, &ip6_tunnel_ops_list, list) {
+        if (strcmp(ops->kind, kind) == 0) {
+            rte_rwlock_read_unlock(&ip6_tunnel_lock);
+            return ops;
+        }
+    }
+
+    rte_rwlock_read_unlock(&ip6_tunnel_lock);
+    return NULL;
+}
+
+static inline struct hlist_head *
+tunnel6_hash_head(struct ip6_tunnel_tab *tab, lcoreid_t cid, __be32 key,
+                  const struct in6_addr *remote)
+{
+    uint32_t h = rte_jhash_32b((const uint32_t *)remote, 4, key);
+    return &tab->tunnels[cid][h % IP6_TNL_HASH_SIZE];
+}
+
+/* @n is the tunnel's node of lcore @cid */
+static inline struct ip6_tunnel *tunnel6_entry(struct hlist_node *n,
+                                               lcoreid_t cid)
+{
+    return container_of(n - cid, struct ip6_tunnel, hlist[0]);
+}
+
+#define tunnel6_for_each(tnl, pos, head, cid) \
+    for (pos = (head)->first; \
+         pos && ({ tnl = tunnel6_entry(pos, cid); 1; }); \
+         pos = pos->next)
+
+static inline void tunnel6_dst_reset(struct ip6_tunnel_dst *dst)
+{
+    if (dst->rt) {
+        route6_put(dst->rt);
+        dst->rt = NULL;
+    }
+    dst->gen = 0;
+}
+
+/* link or unlink the tunnel on current lcore. */
+static int tunnel6_lcore_op(int op, struct ip6_tunnel *tnl)
+{
+    lcoreid_t cid = rte_lcore_id();
+
+    switch (op) {
+    case TUNNEL6_MSG_ADD:
+        if (!hlist_unhashed(&tnl->hlist[cid]))
+            return EDPVS_EXIST;
+        /* master does not touch them till the tunnel is unlinked again */
+        tnl->dst_cache[cid].link = tnl->link;
+        tnl->dst_cache[cid].params = tnl->params;
+        tnl->dst_cache[cid].hlen = tnl->hlen;
+        hlist_add_head(&tnl->hlist[cid],
+                       tunnel6_hash_head(tnl->tab, cid, tnl->params.i_key,
+                                         &tnl->params.raddr));
+        return EDPVS_OK;
+
+    case TUNNEL6_MSG_DEL:
+        hlist_del_init(&tnl->hlist[cid]);
+        tunnel6_dst_reset(&tnl->dst_cache[cid]);
+        return EDPVS_OK;
+
+    default:
+        return EDPVS_INVAL;
+    }
+}
+
+static int tunnel6_msg_cb(struct dpvs_msg *msg)
+{
+    const struct ip6_tunnel_msg *tm;
+
+    assert(msg && msg->data);
+    if (msg->len != sizeof(*tm))
+        return EDPVS_INVAL;
+
+    tm = (const struct ip6_tunnel_msg *)msg->data;
+    return tunnel6_lcore_op(tm->op, tm->tnl);
+}
+
+/* called on master, apply @op to all lcores. */
+static int tunnel6_sync(int op, struct ip6_tunnel *tnl)
+{
+    struct ip6_tunnel_msg tm = { .op = op, .tnl = tnl };
+    struct dpvs_msg *msg;
+    lcoreid_t cid;
+    int err;
+
+    cid = rte_lcore_id();
+    assert(cid == rte_get_master_lcore());
+
+    /* for master */
+    err = tunnel6_lcore_op(op, tnl);
+    if (err != EDPVS_OK)
+        return err;
+
+    /* for slaves */
+    msg = msg_make(MSG_TYPE_TUNNEL6, 0, DPVS_MSG_MULTICAST, cid,
+                   sizeof(tm), &tm);
+    if (unlikely(!msg))
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(msg, 0, NULL);
+    msg_destroy(&msg);
+
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, TUNNEL6, "%s: fail to sync %s on slaves -- %s\n",
+                __func__, tnl->dev->name, dpvs_strerror(err));
+    return err;
+}
+
+/* linux:ip6_tnl_link_config
+ * return MTU of tunnel device. */
+static int tunnel6_bind_dev(struct netif_port *dev)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+    struct netif_port *linkdev = NULL;
+    struct route6 *rt;
+    struct flow6 fl6;
+    int mtu = ETH_DATA_LEN; /* 1500 */
+
+    /* guess output device to choose mtu */
+    if (!ipv6_addr_any(&tnl->params.raddr)) {
+        memset(&fl6, 0, sizeof(fl6));
+        fl6.fl6_daddr = tnl->params.raddr;
+        fl6.fl6_saddr = tnl->params.laddr;
+        fl6.fl6_oif = tnl->link;
+
+        rt = route6_output(NULL, &fl6);
+        if (rt) {
+            linkdev = rt->rt6_dev;
+            route6_put(rt);
+        }
+    }
+
+    if (!linkdev && tnl->link)
+        linkdev = tnl->link;
+
+    if (linkdev)
+        mtu = linkdev->mtu;
+
+    mtu -= sizeof(struct ip6_hdr) + tnl->hlen;
+
+    if (mtu < IPV6_MIN_MTU)
+        mtu = IPV6_MIN_MTU;
+
+    return mtu;
+}
+
+static struct netif_port *tunnel6_create(struct ip6_tunnel_tab *tab,
+                                         const struct ip6_tunnel_ops *ops,
+                                         const struct ip6_tunnel_param *par)
+{
+    struct netif_port *dev;
+    struct ip6_tunnel *tnl;
+    struct ip6_tunnel_param params;
+    int i, err;
+
+    assert(tab && ops && par);
+    params = *par; /* may modified */
+
+    if (netif_port_count() >= NETIF_MAX_PORTS) {
+        RTE_LOG(ERR, TUNNEL6, "%s: exceeding specification limits(%d)",
+            __func__, NETIF_MAX_PORTS);
+        return NULL;
+    }
+
+    /* set ifname template if not assigned. */
+    if (!strlen(params.ifname))
+        snprintf(params.ifname, IFNAMSIZ, "%s%%d", ops->kind);
+
+    dev = netif_alloc(ops->priv_size, params.ifname, 1, 1, ops->setup);
+    if (!dev)
+        return NULL;
+
+    /* syn back ifname, it may generated. */
+    snprintf(params.ifname, IFNAMSIZ, "%.15s", dev->name);
+
+    tnl = netif_priv(dev);
+
+    tnl->dst_cache = rte_zmalloc("tunnel6_dst",
+                                 sizeof(*tnl->dst_cache) * DPVS_MAX_LCORE,
+                                 RTE_CACHE_LINE_SIZE);
+    if (!tnl->dst_cache) {
+        netif_free(dev);
+        return NULL;
+    }
+
+    for (i = 0; i < DPVS_MAX_LCORE; i++)
+        INIT_HLIST_NODE(&tnl->hlist[i]);
+    tnl->dev = dev;
+    tnl->tab = tab;
+    tnl->params = params;
+    if (strlen(params.link)) {
+        tnl->link = netif_port_get_by_name(params.link);
+        if (!tnl->link) {
+            RTE_LOG(WARNING, TUNNEL6, "%s: invalid link device\n", __func__);
+            tnl->params.link[0] = '\0';
+        }
+    }
+
+    dev->type = PORT_TYPE_TUNNEL6;
+    dev->hw_header_len = 0; /* no l2 header for tunnel */
+    if (tnl->link) {
+        dev->flag |= tnl->link->flag;
+        ether_addr_copy(&tnl->link->addr, &dev->addr);
+    }
+    dev->flag |= NETIF_PORT_FLAG_RUNNING; /* XXX */
+    dev->flag |= NETIF_PORT_FLAG_NO_ARP;
+    dev->flag &= ~NETIF_PORT_FLAG_TX_IP_CSUM_OFFLOAD;
+    dev->flag &= ~NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD;
+    dev->flag &= ~NETIF_PORT_FLAG_TX_UDP_CSUM_OFFLOAD;
+
+    err = netif_port_register(dev);
+    if (err != EDPVS_OK)
+        goto errout;
+
+    /* set MTU after op_init, need calc tnl->hlen first */
+    dev->mtu = tunnel6_bind_dev(dev);
+
+    /* insert to tables of all lcores */
+    err = tunnel6_sync(TUNNEL6_MSG_ADD, tnl);
+    if (err != EDPVS_OK) {
+        /* unlink from whom had it */
+        tunnel6_sync(TUNNEL6_MSG_DEL, tnl);
+        netif_port_unregister(dev);
+        goto errout;
+    }
+    tab->nb_tnl++;
+
+    return dev;
+
+errout:
+    rte_free(tnl->dst_cache);
+    netif_free(dev);
+    return NULL;
+}
+
+static int tunnel6_change(struct netif_port *dev,
+                          const struct ip6_tunnel_param *params)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+    struct netif_port *link = tnl->link;
+    int err;
+    assert(dev && dev->type == PORT_TYPE_TUNNEL6 && params && tnl->tab);
+
+    if (strlen(params->link)) {
+        link = netif_port_get_by_name(params->link);
+        if (!link)
+            return EDPVS_NODEV;
+    }
+
+    /*
+     * validate before anything is changed. ops->change may only set
+     * what lcores do not read till re-linked (e.g. tnl->hlen).
+     */
+    if (tnl->tab->ops->change) {
+        err = tnl->tab->ops->change(dev, params);
+        if (err != EDPVS_OK) {
+            RTE_LOG(WARNING, TUNNEL6, "%s: fail to change %s -- %s\n",
+                    __func__, dev->name, dpvs_strerror(err));
+            return err;
+        }
+    }
+
+    /* no lcore sees the tunnel (nor caches route for it) in-between,
+     * and lcores xmit with their own copy of params till re-linked. */
+    err = tunnel6_sync(TUNNEL6_MSG_DEL, tnl);
+    if (err != EDPVS_OK)
+        return err;
+
+    tnl->link = link;
+    tnl->params = *params; /* FIXME: all params changes ! */
+
+    dev->mtu = tunnel6_bind_dev(dev);
+
+    return tunnel6_sync(TUNNEL6_MSG_ADD, tnl);
+}
+
+static void tunnel6_free(struct ip6_tunnel_tab *tab, struct netif_port *dev)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    tab->nb_tnl--;
+    netif_port_unregister(dev);
+    rte_free(tnl->dst_cache);
+    netif_free(dev);
+}
+
+static int tunnel6_destroy(struct ip6_tunnel_tab *tab, struct netif_port *dev)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+    int err;
+    assert(dev && dev->type == PORT_TYPE_TUNNEL6);
+
+    /* leak it rather than free it under a slave's feet */
+    err = tunnel6_sync(TUNNEL6_MSG_DEL, tnl);
+    if (err != EDPVS_OK)
+        return err;
+
+    tunnel6_free(tab, dev);
+    return EDPVS_OK;
+}
+
+/* linux:ip_tunnel_key_match */
+static bool tunnel6_key_match(const struct ip6_tunnel_param *p,
+                              __be16 flags, __be32 key)
+{
+    if (p->i_flags & TUNNEL_F_KEY) {
+        if (flags & TUNNEL_F_KEY)
+            return key == p->i_key;
+        else
+            return false;
+    } else {
+        return !(flags & TUNNEL_F_KEY);
+    }
+}
+
+static inline bool tunnel6_link_match(struct ip6_tunnel *tnl, portid_t port)
+{
+    if (port == NETIF_PORT_ID_INVALID && !tnl->link)
+        return true;
+    else if (tnl->link && tnl->link->id == port)
+        return true;
+
+    return false;
+}
+
+/* dump from master's table, which has all the tunnels. */
+static int tunnel6_dump_table(struct ip6_tunnel_tab *tab,
+                              struct ip6_tunnel_param *pars,
+                              size_t npar, portid_t link)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct ip6_tunnel *tnl;
+    struct hlist_node *pos;
+    int h, cnt = 0;
+
+    assert(tab && pars);
+
+    for (h = 0; h < IP6_TNL_HASH_SIZE; h++) {
+        tunnel6_for_each(tnl, pos, &tab->tunnels[cid][h], cid) {
+            if (cnt >= npar)
+                break;
+
+            assert(tnl->dev && tnl->dev->type == PORT_TYPE_TUNNEL6);
+
+            if (link != NETIF_PORT_ID_INVALID &&
+                !tunnel6_link_match(tnl, link))
+                continue;
+
+            memcpy(pars + cnt, &tnl->params, sizeof(*pars));
+            cnt++;
+        }
+    }
+
+    return cnt;
+}
+
+static int tunnel6_so_set(sockoptid_t opt, const void *arg, size_t inlen)
+{
+    const struct ip6_tunnel_param *params = arg;
+    struct netif_port *dev;
+    struct ip6_tunnel *tnl;
+    struct ip6_tunnel_ops *ops = NULL;
+    int err = EDPVS_INVAL;
+
+    if (!params || inlen < sizeof(*params))
+        return EDPVS_INVAL;
+
+    /* find the tunnel mode first */
+    dev = netif_port_get_by_name(params->ifname);
+    if (dev) {
+        if (dev->type != PORT_TYPE_TUNNEL6) {
+            RTE_LOG(ERR, TUNNEL6, "%s: not ipv6 tunnel device\n", __func__);
+            return EDPVS_INVAL;
+        }
+
+        tnl = netif_priv(dev);
+        ops = tnl->tab->ops;
+    } else if (strlen(params->kind)) {
+        ops = tunnel6_find_ops(params->kind);
+        if (!ops) {
+            RTE_LOG(ERR, TUNNEL6, "%s: invalid tunnel mode\n", __func__);
+            return EDPVS_INVAL;
+        }
+    }
+
+    if (!ops && (opt == SOCKOPT_TUNNEL6_ADD || opt == SOCKOPT_TUNNEL6_REPLACE)) {
+        RTE_LOG(ERR, TUNNEL6, "%s: cannot determine tunnel mode\n", __func__);
+        return EDPVS_INVAL;
+    }
+
+    if (!dev && (opt == SOCKOPT_TUNNEL6_DEL || opt == SOCKOPT_TUNNEL6_CHANGE ||
+                 opt == SOCKOPT_TUNNEL6_REPLACE)) {
+        return EDPVS_NOTEXIST;
+    }
+
+    rte_rwlock_write_lock(&ip6_tunnel_lock);
+    switch (opt) {
+    case SOCKOPT_TUNNEL6_ADD:
+        if (dev) {
+            err = EDPVS_EXIST;
+            break;
+        }
+
+        dev = tunnel6_create(ops->tab, ops, params);
+        err = dev ? EDPVS_OK : EDPVS_RESOURCE;
+        break;
+
+    case SOCKOPT_TUNNEL6_DEL:
+        err = tunnel6_destroy(ops->tab, dev);
+        break;
+
+    case SOCKOPT_TUNNEL6_CHANGE:
+        err = tunnel6_change(dev, params);
+        break;
+
+    case SOCKOPT_TUNNEL6_REPLACE:
+        err = tunnel6_destroy(ops->tab, dev);
+        if (err != EDPVS_OK)
+            break;
+
+        dev = tunnel6_create(ops->tab, ops, params);
+        err = dev ? EDPVS_OK : EDPVS_RESOURCE;
+        break;
+
+    default:
+        err = EDPVS_NOTSUPP;
+        break;
+    }
+    rte_rwlock_write_unlock(&ip6_tunnel_lock);
+
+    return err;
+}
+
+static int tunnel6_so_get(sockoptid_t opt, const void *arg, size_t inlen,
+                          void **out, size_t *outlen)
+{
+    const struct ip6_tunnel_param *params = arg;
+    struct netif_port *dev, *link = NULL;
+    const struct ip6_tunnel *tnl;
+    struct ip6_tunnel_ops *ops;
+    struct ip6_tunnel_tab *tab;
+    struct ip6_tunnel_param *tp_arr = NULL;
+    size_t tp_cnt = 0; /* number of tunnel param */
+    int err = EDPVS_OK;
+
+    if (!params || inlen < sizeof(*params) || !out || !outlen)
+        return EDPVS_INVAL;
+
+    rte_rwlock_read_lock(&ip6_tunnel_lock);
+
+    /* device name is indicated */
+    if (strlen(params->ifname)) {
+        dev = netif_port_get_by_name(params->ifname);
+        if (!dev) {
+            err = EDPVS_NOTEXIST;
+            goto out;
+        }
+
+        if (dev->type != PORT_TYPE_TUNNEL6) {
+            RTE_LOG(ERR, TUNNEL6, "%s: not ipv6 tunnel device\n", __func__);
+            err = EDPVS_INVAL;
+            goto out;
+        }
+
+        tnl = netif_priv(dev);
+
+        tp_cnt = 1;
+        tp_arr = rte_malloc(NULL, sizeof(*tp_arr) * tp_cnt, 0);
+        if (!tp_arr) {
+            err = EDPVS_NOMEM;
+            goto out;
+        }
+
+        memcpy(tp_arr, &tnl->params, sizeof(*tp_arr));
+        goto done;
+    }
+
+    if (strlen(params->link))
+        link = netif_port_get_by_name(params->link);
+
+    /* for each table, or the specific one */
+    list_for_each_entry(ops, &ip6_tunnel_ops_list, list) {
+        void *new_ptr;
+        size_t size;
+
+        if (strlen(params->kind) && strcmp(params->kind, ops->kind) != 0)
+            continue;
+
+        tab = ops->tab;
+
+        /* rte_realloc() do not support 0 size,
+         * we cannot return EDPVS_NOMEM. */
+        size = sizeof(*tp_arr) * (tab->nb_tnl + tp_cnt);
+        if (!size)
+            continue;
+
+        new_ptr = rte_realloc(tp_arr, size, 0);
+        if (!new_ptr) {
+            rte_free(tp_arr);
+            err = EDPVS_NOMEM;
+            goto out;
+        }
+        tp_arr = new_ptr;
+
+        tp_cnt += tunnel6_dump_table(tab, tp_arr + tp_cnt, tab->nb_tnl,
+                                     link ? link->id : NETIF_PORT_ID_INVALID);
+    }
+
+done:
+    *out = tp_arr;
+    *outlen = tp_cnt * sizeof(*tp_arr);
+
+out:
+    rte_rwlock_read_unlock(&ip6_tunnel_lock);
+
+    return err;
+}
+
+int ip6_tunnel_init_tab(struct ip6_tunnel_tab *tab,
+                        struct ip6_tunnel_ops *ops)
+{
+    int cid, h;
+    assert(tab && ops);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++)
+        for (h = 0; h < IP6_TNL_HASH_SIZE; h++)
+            INIT_HLIST_HEAD(&tab->tunnels[cid][h]);
+
+    tab->ops = ops;
+    ops->tab = tab;
+
+    return tunnel6_register_ops(ops);
+}
+
+/* data plane is stopped, unlink tunnels without msg. */
+int ip6_tunnel_term_tab(struct ip6_tunnel_tab *tab)
+{
+    lcoreid_t cid, master = rte_get_master_lcore();
+    struct ip6_tunnel *tnl;
+    struct hlist_node *pos, *n;
+    int h;
+    assert(tab && tab->ops);
+
+    tunnel6_unregister_ops(tab->ops);
+
+    rte_rwlock_write_lock(&ip6_tunnel_lock);
+
+    for (h = 0; h < IP6_TNL_HASH_SIZE; h++) {
+        for (pos = tab->tunnels[master][h].first; pos; pos = n) {
+            n = pos->next;
+            tnl = tunnel6_entry(pos, master);
+
+            for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+                hlist_del_init(&tnl->hlist[cid]);
+                tunnel6_dst_reset(&tnl->dst_cache[cid]);
+            }
+            tunnel6_free(tab, tnl->dev);
+        }
+    }
+
+    rte_rwlock_write_unlock(&ip6_tunnel_lock);
+
+    return EDPVS_OK;
+}
+
+/* linux:ip6_tnl_lookup */
+struct ip6_tunnel *ip6_tunnel_lookup(struct ip6_tunnel_tab *tab,
+                                     portid_t link, __be16 flags,
+                                     const struct in6_addr *remote,
+                                     const struct in6_addr *local,
+                                     __be32 key)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct hlist_head *head;
+    struct hlist_node *pos;
+    struct ip6_tunnel *tnl, *cand = NULL;
+
+    head = tunnel6_hash_head(tab, cid, key, remote);
+
+    tunnel6_for_each(tnl, pos, head, cid) {
+        if (!ipv6_addr_equal(local, &tnl->params.laddr) ||
+            !ipv6_addr_equal(remote, &tnl->params.raddr) ||
+            !(tnl->dev->flag & NETIF_PORT_FLAG_RUNNING))
+            continue;
+
+        if (!tunnel6_key_match(&tnl->params, flags, key))
+            continue;
+
+        if (tunnel6_link_match(tnl, link))
+            return tnl;
+        else
+            cand = tnl;
+    }
+
+    tunnel6_for_each(tnl, pos, head, cid) {
+        if (!ipv6_addr_equal(remote, &tnl->params.raddr) ||
+            !ipv6_addr_any(&tnl->params.laddr) ||
+            !(tnl->dev->flag & NETIF_PORT_FLAG_RUNNING))
+            continue;
+
+        if (!tunnel6_key_match(&tnl->params, flags, key))
+            continue;
+
+        if (tunnel6_link_match(tnl, link))
+            return tnl;
+        else if (!cand)
+            cand = tnl;
+    }
+
+    head = tunnel6_hash_head(tab, cid, key, &in6addr_any);
+
+    tunnel6_for_each(tnl, pos, head, cid) {
+        if (!ipv6_addr_equal(local, &tnl->params.laddr) ||
+            !ipv6_addr_any(&tnl->params.raddr) ||
+            !(tnl->dev->flag & NETIF_PORT_FLAG_RUNNING))
+            continue;
+
+        if (!tunnel6_key_match(&tnl->params, flags, key))
+            continue;
+
+        if (tunnel6_link_match(tnl, link))
+            return tnl;
+        else if (!cand)
+            cand = tnl;
+    }
+
+    if (flags & TUNNEL_F_NO_KEY)
+        goto skip_key_lookup;
+
+    tunnel6_for_each(tnl, pos, head, cid) {
+        if (tnl->params.i_key != key ||
+            !ipv6_addr_any(&tnl->params.laddr) ||
+            !ipv6_addr_any(&tnl->params.raddr) ||
+            !(tnl->dev->flag & NETIF_PORT_FLAG_RUNNING))
+            continue;
+
+        if (tunnel6_link_match(tnl, link))
+            return tnl;
+        else if (!cand)
+            cand = tnl;
+    }
+
+skip_key_lookup:
+    return cand;
+}
+
+/* linux:__ip6_tnl_rcv */
+int ip6_tunnel_rcv(struct ip6_tunnel *tnl, struct ip_tunnel_pktinfo *tpi,
+                   struct rte_mbuf *mbuf)
+{
+    const struct ip6_tunnel_param *params = &tnl->params;
+    int err;
+    assert(tnl && mbuf);
+
+    if ((!(tpi->flags & TUNNEL_F_CSUM) &&  (params->i_flags & TUNNEL_F_CSUM)) ||
+         ((tpi->flags & TUNNEL_F_CSUM) && !(params->i_flags & TUNNEL_F_CSUM))) {
+        goto drop;
+    }
+
+    /* clean up vlan info of the underlay */
+    if (unlikely(mbuf->ol_flags & PKT_RX_VLAN_STRIPPED)) {
+        mbuf->vlan_tci = 0;
+        mbuf->ol_flags &= (~PKT_RX_VLAN_STRIPPED);
+    }
+
+    mbuf->port = tnl->dev->id;
+
+    err = netif_rcv(tnl->dev, tpi->proto, mbuf);
+    if (unlikely(err == EDPVS_KNICONTINUE)) /* not consumed */
+        goto drop;
+    return err;
+
+drop:
+    rte_pktmbuf_free(mbuf);
+    return EDPVS_DROP;
+}
+
+/*
+ * underlay route of current lcore, looked up only if the cache is out
+ * of neigh_generation(), i.e., route or neighbour changed.
+ */
+static struct ip6_tunnel_dst *tunnel6_dst_get(struct ip6_tunnel *tnl)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct ip6_tunnel_dst *dst = &tnl->dst_cache[cid];
+    uint32_t gen = neigh_generation();
+    struct route6 *rt;
+    struct flow6 fl6;
+    int mtu;
+
+    if (likely(dst->rt && dst->gen == gen))
+        return dst;
+
+    /* being removed from this lcore, do not hold route for it */
+    if (unlikely(hlist_unhashed(&tnl->hlist[cid])))
+        return NULL;
+
+    tunnel6_dst_reset(dst);
+
+    memset(&fl6, 0, sizeof(fl6));
+    fl6.fl6_daddr = dst->params.raddr;
+    fl6.fl6_saddr = dst->params.laddr;
+    fl6.fl6_oif = dst->link;
+
+    rt = route6_output(NULL, &fl6);
+    if (!rt)
+        return NULL;
+
+    if (!ipv6_addr_any(&dst->params.laddr)) {
+        dst->saddr = dst->params.laddr;
+    } else if (!ipv6_addr_any(&rt->rt6_prefsrc.addr)) {
+        dst->saddr = rt->rt6_prefsrc.addr;
+    } else {
+        union inet_addr saddr;
+
+        inet_addr_select(AF_INET6, rt->rt6_dev,
+                         (union inet_addr *)&dst->params.raddr,
+                         0, &saddr);
+        dst->saddr = saddr.in6;
+    }
+
+    mtu = rt->rt6_mtu - sizeof(struct ip6_hdr) - dst->hlen;
+    dst->mtu = mtu > 0 ? mtu : 0;
+
+    /* refer route in cache and it's put on reset. */
+    dst->rt = rt;
+    dst->gen = gen;
+    return dst;
+}
+
+/*
+ * tell the sender of an oversized inner packet the tunnel's MTU.
+ * mbuf is at inner IP header and routed back to where it came from.
+ */
+static void tunnel6_send_pmtu(struct rte_mbuf *mbuf, uint32_t mtu)
+{
+    if (mbuf->packet_type == ETHER_TYPE_IPv6) {
+        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+        struct route6 *rt;
+        struct flow6 fl6;
+
+        memset(&fl6, 0, sizeof(fl6));
+        fl6.fl6_daddr = ip6h->ip6_src;
+        rt = route6_output(NULL, &fl6);
+        if (!rt)
+            return;
+
+        mbuf->port = rt->rt6_dev->id;
+        route6_put(rt);
+
+        mbuf->packet_type = ETH_PKT_HOST;
+        icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0,
+                   mtu < IPV6_MIN_MTU ? IPV6_MIN_MTU : mtu);
+    } else if (mbuf->packet_type == ETHER_TYPE_IPv4) {
+        struct ipv4_hdr *iph = ip4_hdr(mbuf);
+        struct route_entry *rt;
+        struct flow4 fl4;
+
+        if (!(iph->fragment_offset & htons(IPV4_HDR_DF_FLAG)))
+            return;
+
+        memset(&fl4, 0, sizeof(fl4));
+        fl4.fl4_daddr.s_addr = iph->src_addr;
+        rt = route4_output(&fl4);
+        if (!rt)
+            return;
+
+        mbuf->port = rt->port->id;
+        mbuf->userdata = rt;
+
+        mbuf->packet_type = ETH_PKT_HOST;
+        icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_FRAG_NEEDED, htonl(mtu));
+
+        mbuf->userdata = NULL;
+        route4_put(rt);
+    }
+}
+
+/* linux:ip6_tnl_xmit
+ * mbuf is at tunnel header (tnl->hlen) followed by inner IP header,
+ * whose type is mbuf->packet_type. */
+int ip6_tunnel_xmit(struct rte_mbuf *mbuf, struct netif_port *dev,
+                    uint8_t proto)
+{
+    struct ip6_tunnel       *tnl = netif_priv(dev);
+    struct ip6_tunnel_dst   *dst = ip6_tunnel_this_dst(tnl);
+    const struct ip6_tunnel_param *params = &dst->params;
+    int                     hlen = dst->hlen;
+    struct ip6_hdr          *oip6h; /* outter IPv6 header */
+    const void              *iph;   /* inner IP header */
+    uint8_t                 tclass, hlim;
+    int                     err = EDPVS_DROP;
+
+    assert(mbuf && dev);
+
+    if (unlikely(ipv6_addr_any(&params->raddr))) {
+        /* TODO: NBMA tunnel */
+        RTE_LOG(DEBUG, TUNNEL6, "%s: NBMA dev not support\n", __func__);
+        err = EDPVS_NOTSUPP;
+        goto errout;
+    }
+
+    dst = tunnel6_dst_get(tnl);
+    if (unlikely(!dst)) {
+        err = EDPVS_NOROUTE;
+        goto errout;
+    }
+
+    if (unlikely(dst->rt->rt6_dev == dev))
+        goto errout;
+
+    /* IPv6 never fragments on the way, enforce path MTU here */
+    if (unlikely(mbuf_l3_seg_len(mbuf) - hlen > dst->mtu)) {
+        if (rte_pktmbuf_adj(mbuf, hlen) != NULL)
+            tunnel6_send_pmtu(mbuf, dst->mtu);
+        err = EDPVS_FRAG;
+        goto errout;
+    }
+
+    iph = rte_pktmbuf_mtod_offset(mbuf, void *, hlen);
+
+    tclass = params->tclass;
+    hlim = params->hop_limit;
+    if (mbuf->packet_type == ETHER_TYPE_IPv6) {
+        const struct ip6_hdr *ip6h = iph;
+
+        if (params->flags & IP6_TNL_F_USE_ORIG_TCLASS)
+            tclass = (ntohl(ip6h->ip6_flow) >> 20) & 0xff;
+        if (!hlim)
+            hlim = ip6h->ip6_hlim;
+    } else if (mbuf->packet_type == ETHER_TYPE_IPv4) {
+        const struct ipv4_hdr *ip4h = iph;
+
+        if (params->flags & IP6_TNL_F_USE_ORIG_TCLASS)
+            tclass = ip4h->type_of_service;
+        if (!hlim)
+            hlim = ip4h->time_to_live;
+    }
+
+    oip6h = (struct ip6_hdr *)rte_pktmbuf_prepend(mbuf, sizeof(*oip6h));
+    if (unlikely(!oip6h)) {
+        err = EDPVS_NOROOM;
+        goto errout;
+    }
+
+    oip6h->ip6_flow = htonl((6 << 28) | ((uint32_t)tclass << 20));
+    oip6h->ip6_plen = htons(mbuf->pkt_len - sizeof(*oip6h));
+    oip6h->ip6_nxt  = proto;
+    oip6h->ip6_hlim = hlim ? : INET_DEF_TTL;
+    oip6h->ip6_src  = dst->saddr;
+    oip6h->ip6_dst  = params->raddr;
+
+    /* refer route in mbuf and this reference will be put later. */
+    route6_get(dst->rt);
+    mbuf->userdata = (void *)dst->rt;
+
+    return ip6_local_out(mbuf);
+
+errout:
+    rte_pktmbuf_free(mbuf);
+    return err;
+}
+
+int ip6_tunnel_get_link(struct netif_port *dev, struct rte_eth_link *link)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    if (tnl->link) {
+        return netif_get_link(tnl->link, link);
+    } else {
+        memset(link, 0, sizeof(*link));
+        return EDPVS_OK;
+    }
+}
+
+int ip6_tunnel_get_stats(struct netif_port *dev, struct rte_eth_stats *stats)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    if (tnl->link) {
+        return netif_get_stats(tnl->link, stats);
+    } else {
+        memset(stats, 0, sizeof(*stats));
+        return EDPVS_OK;
+    }
+}
+
+int ip6_tunnel_get_promisc(struct netif_port *dev, bool *promisc)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    if (tnl->link) {
+        return netif_get_promisc(tnl->link, promisc);
+    } else {
+        *promisc = false;
+        return EDPVS_OK;
+    }
+}
+
+static struct dpvs_sockopts ip6_tunnel_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_TUNNEL6_ADD,
+    .set_opt_max    = SOCKOPT_TUNNEL6_REPLACE,
+    .set            = tunnel6_so_set,
+    .get_opt_min    = SOCKOPT_TUNNEL6_SHOW,
+    .get_opt_max    = SOCKOPT_TUNNEL6_SHOW,
+    .get            = tunnel6_so_get,
+};
+
+static inline void tunnel6_msg_type_init(struct dpvs_msg_type *msg_type)
+{
+    memset(msg_type, 0, sizeof(*msg_type));
+    msg_type->type           = MSG_TYPE_TUNNEL6;
+    msg_type->mode           = DPVS_MSG_MULTICAST;
+    msg_type->cid            = rte_lcore_id();
+    msg_type->unicast_msg_cb = tunnel6_msg_cb;
+}
+
+int ip6_tunnel_init(void)
+{
+    struct dpvs_msg_type msg_type;
+    int err;
+
+    rte_rwlock_init(&ip6_tunnel_lock);
+    INIT_LIST_HEAD(&ip6_tunnel_ops_list);
+
+    tunnel6_msg_type_init(&msg_type);
+    err = msg_type_mc_register(&msg_type);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, TUNNEL6, "%s: fail to register msg\n", __func__);
+        goto msg_fail;
+    }
+
+    /* control plane */
+    err = sockopt_register(&ip6_tunnel_sockopts);
+    if (err != EDPVS_OK)
+        goto so_fail;
+
+    /*
+     * init all ipv6 tunnels.
+     */
+
+    if ((err = ip6ip6_init()) != EDPVS_OK)
+        goto ip6ip6_fail;
+
+    if ((err = ip6gre_init()) != EDPVS_OK)
+        goto ip6gre_fail;
+
+    return EDPVS_OK;
+
+ip6gre_fail:
+    ip6ip6_term();
+ip6ip6_fail:
+    sockopt_unregister(&ip6_tunnel_sockopts);
+so_fail:
+    msg_type_mc_unregister(&msg_type);
+msg_fail:
+    return err;
+}
+
+int ip6_tunnel_term(void)
+{
+    struct dpvs_msg_type msg_type;
+    int err;
+
+    err = ip6ip6_term();
+    if (err != EDPVS_OK)
+        return err;
+
+    err = ip6gre_term();
+    if (err != EDPVS_OK)
+        return err;
+
+    err = sockopt_unregister(&ip6_tunnel_sockopts);
+    if (err != EDPVS_OK)
+        return err;
+
+    tunnel6_msg_type_init(&msg_type);
+    err = msg_type_mc_unregister(&msg_type);
+    if (err != EDPVS_OK)
+        return err;
+
+    return EDPVS_OK;
+}
@@ -0,0 +1,202 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * dpvs IPv6-in-IPv6 and IPv4-in-IPv6 tunnels.
+ * refer linux:net/ipv6/ip6_tunnel.c
+ */
+#include <assert.h>
+#include <linux/if_ether.h>
+#include "ipv6.h"
+#include "ip6_tunnel.h"
+
+#define IP6IP6
+#define RTE_LOGTYPE_IP6IP6  RTE_LOGTYPE_USER1
+
+static struct ip6_tunnel_tab ip6ip6_tunnel_tab;
+static struct ip6_tunnel_tab ipip6_tunnel_tab;
+
+/* dummy packet info for ip6ip6/ipip6 tunnel. */
+static struct ip_tunnel_pktinfo ip6ip6_tpi = {
+    /* .proto      = htons(ETH_P_IPV6), */
+};
+
+static struct ip_tunnel_pktinfo ipip6_tpi = {
+    /* .proto      = htons(ETH_P_IP), */
+};
+
+static int ip6ip6_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    if (mbuf->packet_type != ETHER_TYPE_IPv6) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_DROP;
+    }
+
+    return ip6_tunnel_xmit(mbuf, dev, IPPROTO_IPV6);
+}
+
+static int ipip6_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    if (mbuf->packet_type != ETHER_TYPE_IPv4) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_DROP;
+    }
+
+    return ip6_tunnel_xmit(mbuf, dev, IPPROTO_IPIP);
+}
+
+static struct netif_ops ip6ip6_dev_ops = {
+    .op_xmit        = ip6ip6_xmit,
+    .op_get_link    = ip6_tunnel_get_link,
+    .op_get_stats   = ip6_tunnel_get_stats,
+    .op_get_promisc = ip6_tunnel_get_promisc,
+};
+
+static struct netif_ops ipip6_dev_ops = {
+    .op_xmit        = ipip6_xmit,
+    .op_get_link    = ip6_tunnel_get_link,
+    .op_get_stats   = ip6_tunnel_get_stats,
+    .op_get_promisc = ip6_tunnel_get_promisc,
+};
+
+static void ip6ip6_setup(struct netif_port *dev)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    dev->netif_ops = &ip6ip6_dev_ops;
+    tnl->hlen = 0; /* no overhead other than IPv6 header */
+}
+
+static void ipip6_setup(struct netif_port *dev)
+{
+    struct ip6_tunnel *tnl = netif_priv(dev);
+
+    dev->netif_ops = &ipip6_dev_ops;
+    tnl->hlen = 0;
+}
+
+static int __ip6ip6_rcv(struct rte_mbuf *mbuf, struct ip6_tunnel_tab *tab,
+                        struct ip_tunnel_pktinfo *tpi)
+{
+    struct ip6_hdr *ip6h;
+    struct ip6_tunnel *tnl;
+
+    /* IPv6's upper layer can use @userdata for IPv6 header,
+     * and mbuf is at inner header. see ip6_local_in_fin() */
+    ip6h = mbuf->userdata;
+
+    tnl = ip6_tunnel_lookup(tab, mbuf->port, TUNNEL_F_NO_KEY,
+                            &ip6h->ip6_src, &ip6h->ip6_dst, 0);
+    if (!tnl)
+        return EDPVS_KNICONTINUE;
+
+    ip6_tunnel_rcv(tnl, tpi, mbuf);
+    return 0; /* consumed */
+}
+
+static int ip6ip6_rcv(struct rte_mbuf *mbuf)
+{
+    return __ip6ip6_rcv(mbuf, &ip6ip6_tunnel_tab, &ip6ip6_tpi);
+}
+
+static int ipip6_rcv(struct rte_mbuf *mbuf)
+{
+    return __ip6ip6_rcv(mbuf, &ipip6_tunnel_tab, &ipip6_tpi);
+}
+
+static struct ip6_tunnel_ops ip6ip6_tunnel_ops = {
+    .kind       = "ip6ip6",
+    .priv_size  = sizeof(struct ip6_tunnel),
+    .setup      = ip6ip6_setup,
+};
+
+static struct ip6_tunnel_ops ipip6_tunnel_ops = {
+    .kind       = "ipip6",
+    .priv_size  = sizeof(struct ip6_tunnel),
+    .setup      = ipip6_setup,
+};
+
+static struct inet6_protocol ip6ip6_proto = {
+    .handler    = ip6ip6_rcv,
+    .flags      = INET6_PROTO_F_FINAL,
+};
+
+static struct inet6_protocol ipip6_proto = {
+    .handler    = ipip6_rcv,
+    .flags      = INET6_PROTO_F_FINAL,
+};
+
+int ip6ip6_init(void)
+{
+    int err;
+
+    ip6ip6_tpi.proto = htons(ETH_P_IPV6);
+    ipip6_tpi.proto = htons(ETH_P_IP);
+
+    err = ip6_tunnel_init_tab(&ip6ip6_tunnel_tab, &ip6ip6_tunnel_ops);
+    if (err != EDPVS_OK)
+        return err;
+
+    err = ip6_tunnel_init_tab(&ipip6_tunnel_tab, &ipip6_tunnel_ops);
+    if (err != EDPVS_OK)
+        goto ipip6_tab_fail;
+
+    err = ipv6_register_protocol(&ip6ip6_proto, IPPROTO_IPV6);
+    if (err != EDPVS_OK)
+        goto ip6ip6_proto_fail;
+
+    err = ipv6_register_protocol(&ipip6_proto, IPPROTO_IPIP);
+    if (err != EDPVS_OK)
+        goto ipip6_proto_fail;
+
+    return EDPVS_OK;
+
+ipip6_proto_fail:
+    ipv6_unregister_protocol(&ip6ip6_proto, IPPROTO_IPV6);
+ip6ip6_proto_fail:
+    ip6_tunnel_term_tab(&ipip6_tunnel_tab);
+ipip6_tab_fail:
+    ip6_tunnel_term_tab(&ip6ip6_tunnel_tab);
+    return err;
+}
+
+int ip6ip6_term(void)
+{
+    int err;
+
+    err = ipv6_unregister_protocol(&ipip6_proto, IPPROTO_IPIP);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IP6IP6, "%s: fail to unregister ipip6 proto\n", __func__);
+        return err;
+    }
+
+    err = ipv6_unregister_protocol(&ip6ip6_proto, IPPROTO_IPV6);
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IP6IP6, "%s: fail to unregister ip6ip6 proto\n", __func__);
+        return err;
+    }
+
+    err = ip6_tunnel_term_tab(&ipip6_tunnel_tab);
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IP6IP6, "%s: fail to term ipip6 tab\n", __func__);
+
+    err = ip6_tunnel_term_tab(&ip6ip6_tunnel_tab);
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IP6IP6, "%s: fail to term ip6ip6 tab\n", __func__);
+
+    return err;
+}
@@ -331,7 +331,7 @@ static int ip6_output_fin(struct rte_mbuf *mbuf)
     else
         mtu = ((struct route6 *)mbuf->userdata)->rt6_mtu;
 
-    if (mbuf->pkt_len > mtu)
+    if (mbuf_l3_seg_len(mbuf) > mtu)
         return ip6_fragment(mbuf, mtu, ip6_output_fin2);
     else
         return ip6_output_fin2(mbuf);
@@ -429,7 +429,7 @@ static int ip6_forward(struct rte_mbuf *mbuf)
     if (mtu < IPV6_MIN_MTU)
         mtu = IPV6_MIN_MTU;
 
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         mbuf->port = rt->rt6_dev->id;
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, mtu);
 
@@ -17,6 +17,7 @@
  */
 #include<assert.h>
 #include "route6.h"
+#include "neigh.h"
 #include "linux_ipv6.h"
 #include "ctrl.h"
 #include "route6_lpm.h"
@@ -187,11 +188,16 @@ static struct route6 *rt6_get(const struct dp_vs_route6_conf *rt6_cfg)
 
 static int rt6_add_lcore(const struct dp_vs_route6_conf *rt6_cfg)
 {
+    /* next hops cached out of routes may change */
+    neigh_generation_bump();
+
     return g_rt6_method->rt6_add_lcore(rt6_cfg);
 }
 
 static int rt6_del_lcore(const struct dp_vs_route6_conf *rt6_cfg)
 {
+    neigh_generation_bump();
+
     return g_rt6_method->rt6_del_lcore(rt6_cfg);
 }
 
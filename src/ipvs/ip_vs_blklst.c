@@ -197,33 +197,110 @@ static int dp_vs_blklst_del(uint8_t proto, const union inet_addr *vaddr,
     return EDPVS_OK;
 }
 
-void  dp_vs_blklst_flush(struct dp_vs_service *svc)
+/*
+ * add/del @n blklst ips on master, then on all slave lcores with
+ * a single multicast msg. entries failed on master are skipped and
+ * the first error is returned.
+ */
+static int dp_vs_blklst_add_del_bulk(bool add, const struct dp_vs_blklst_conf *cfs,
+                                     int n)
 {
-    struct blklst_entry *entry, *next;
-    int hash;
+    struct dp_vs_blklst_conf *done;
+    struct dpvs_msg *msg;
+    int i, ndone = 0, err, ret = EDPVS_OK;
 
-    for (hash = 0; hash < DPVS_BLKLST_TAB_SIZE; hash++) {
-        list_for_each_entry_safe(entry, next, &this_blklst_tab[hash], list) {
-            if (entry->vaddr.in.s_addr == svc->addr.in.s_addr)
-                dp_vs_blklst_del(entry->proto, &entry->vaddr,
-                                 entry->vport, &entry->blklst);
+    if (rte_lcore_id() != rte_get_master_lcore()) {
+        RTE_LOG(INFO, SERVICE, "[%s] must set from master lcore\n", __func__);
+        return EDPVS_NOTSUPP;
+    }
+
+    if (n <= 0)
+        return EDPVS_OK;
+
+    done = rte_malloc(NULL, sizeof(*done) * n, 0);
+    if (!done)
+        return EDPVS_NOMEM;
+
+    for (i = 0; i < n; i++) {
+        if (add)
+            err = dp_vs_blklst_add_lcore(cfs[i].proto, &cfs[i].vaddr,
+                                         cfs[i].vport, &cfs[i].blklst);
+        else
+            err = dp_vs_blklst_del_lcore(cfs[i].proto, &cfs[i].vaddr,
+                                         cfs[i].vport, &cfs[i].blklst);
+        if (err) {
+            RTE_LOG(INFO, SERVICE, "[%s] fail to %s blklst ip #%d\n",
+                    __func__, add ? "set" : "del", i);
+            if (ret == EDPVS_OK)
+                ret = err;
+            continue;
         }
+        done[ndone++] = cfs[i];
     }
-    return;
+
+    if (!ndone)
+        goto out;
+
+    msg = msg_make(add ? MSG_TYPE_BLKLST_ADD : MSG_TYPE_BLKLST_DEL, 0,
+                   DPVS_MSG_MULTICAST, rte_lcore_id(),
+                   sizeof(*done) * ndone, done);
+    if (!msg) {
+        ret = EDPVS_NOMEM;
+        goto out;
+    }
+    err = multicast_msg_send(msg, 0, NULL);
+    if (err != EDPVS_OK) {
+        RTE_LOG(INFO, SERVICE, "[%s] fail to send multicast message\n", __func__);
+        ret = err;
+    }
+    msg_destroy(&msg);
+
+out:
+    rte_free(done);
+    return ret;
 }
 
-static void dp_vs_blklst_flush_all(void)
+/* del all blklst ips of @svc, or all of them if @svc is NULL */
+static void dp_vs_blklst_flush_svc(const struct dp_vs_service *svc)
 {
-    struct blklst_entry *entry, *next;
-    int hash;
+    struct dp_vs_blklst_conf *cfs;
+    struct blklst_entry *entry;
+    int hash, n = 0, max;
+
+    max = rte_atomic32_read(&this_num_blklsts);
+    if (max <= 0)
+        return;
+
+    cfs = rte_zmalloc(NULL, sizeof(*cfs) * max, 0);
+    if (!cfs)
+        return;
 
     for (hash = 0; hash < DPVS_BLKLST_TAB_SIZE; hash++) {
-        list_for_each_entry_safe(entry, next, &this_blklst_tab[hash], list) {
-            dp_vs_blklst_del(entry->proto, &entry->vaddr,
-                             entry->vport, &entry->blklst);
+        list_for_each_entry(entry, &this_blklst_tab[hash], list) {
+            if (n >= max)
+                break;
+            if (svc && entry->vaddr.in.s_addr != svc->addr.in.s_addr)
+                continue;
+            cfs[n].proto = entry->proto;
+            cfs[n].vaddr = entry->vaddr;
+            cfs[n].vport = entry->vport;
+            cfs[n].blklst = entry->blklst;
+            n++;
         }
     }
-    return;
+
+    dp_vs_blklst_add_del_bulk(false, cfs, n);
+    rte_free(cfs);
+}
+
+void  dp_vs_blklst_flush(struct dp_vs_service *svc)
+{
+    dp_vs_blklst_flush_svc(svc);
+}
+
+static void dp_vs_blklst_flush_all(void)
+{
+    dp_vs_blklst_flush_svc(NULL);
 }
 
 /*
@@ -232,8 +309,18 @@ static void dp_vs_blklst_flush_all(void)
 static int blklst_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
 {
     const struct dp_vs_blklst_conf *blklst_conf = conf;
+    const struct dp_vs_blklst_conf_array *array = conf;
     int err;
 
+    if (opt == SOCKOPT_SET_BLKLST_ADD_BULK || opt == SOCKOPT_SET_BLKLST_DEL_BULK) {
+        if (!conf || size < sizeof(*array) || array->naddr <= 0 ||
+            size != sizeof(*array) + array->naddr * sizeof(*blklst_conf))
+            return EDPVS_INVAL;
+
+        return dp_vs_blklst_add_del_bulk(opt == SOCKOPT_SET_BLKLST_ADD_BULK,
+                                         array->blklsts, array->naddr);
+    }
+
     if (!conf && size < sizeof(*blklst_conf))
         return EDPVS_INVAL;
 
@@ -254,6 +341,16 @@ static int blklst_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
     return err;
 }
 
+static int blklst_sockopt_rollback(sockoptid_t opt, const void *conf, size_t size)
+{
+    if (opt == SOCKOPT_SET_BLKLST_ADD_BULK)
+        return blklst_sockopt_set(SOCKOPT_SET_BLKLST_DEL_BULK, conf, size);
+    if (opt != SOCKOPT_SET_BLKLST_ADD)
+        return EDPVS_NOTSUPP;
+
+    return blklst_sockopt_set(SOCKOPT_SET_BLKLST_DEL, conf, size);
+}
+
 static void blklst_fill_conf(int af, struct dp_vs_blklst_conf *cf,
                             const struct blklst_entry *entry)
 {
@@ -297,24 +394,30 @@ static int blklst_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
 static int blklst_msg_process(bool add, struct dpvs_msg *msg)
 {
     struct dp_vs_blklst_conf *cf;
-    int err;
+    int i, n, err, ret = EDPVS_OK;
     assert(msg);
 
-    if (msg->len != sizeof(struct dp_vs_blklst_conf)){
+    if (!msg->len || msg->len % sizeof(struct dp_vs_blklst_conf)){
         RTE_LOG(ERR, SERVICE, "%s: bad message.\n", __func__);
         return EDPVS_INVAL;
     }
 
-    cf = (struct dp_vs_blklst_conf *)msg->data;
-    if (add)
-        err = dp_vs_blklst_add_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
-    else
-        err = dp_vs_blklst_del_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
-    if (err != EDPVS_OK)
-        RTE_LOG(ERR, SERVICE, "%s: fail to %s blklst: %s.\n",
-                __func__, add ? "add" : "del", dpvs_strerror(err));
+    /* bulk msg carries more than one config */
+    n = msg->len / sizeof(struct dp_vs_blklst_conf);
+    for (i = 0; i < n; i++) {
+        cf = &((struct dp_vs_blklst_conf *)msg->data)[i];
+        if (add)
+            err = dp_vs_blklst_add_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
+        else
+            err = dp_vs_blklst_del_lcore(cf->proto, &cf->vaddr, cf->vport, &cf->blklst);
+        if (err != EDPVS_OK) {
+            RTE_LOG(ERR, SERVICE, "%s: fail to %s blklst: %s.\n",
+                    __func__, add ? "add" : "del", dpvs_strerror(err));
+            ret = err;
+        }
+    }
 
-    return err;
+    return ret;
 }
 
 inline static int blklst_add_msg_cb(struct dpvs_msg *msg)
@@ -330,8 +433,9 @@ inline static int blklst_del_msg_cb(struct dpvs_msg *msg)
 static struct dpvs_sockopts blklst_sockopts = {
     .version            = SOCKOPT_VERSION,
     .set_opt_min        = SOCKOPT_SET_BLKLST_ADD,
-    .set_opt_max        = SOCKOPT_SET_BLKLST_FLUSH,
+    .set_opt_max        = SOCKOPT_SET_BLKLST_DEL_BULK,
     .set                = blklst_sockopt_set,
+    .rollback           = blklst_sockopt_rollback,
     .get_opt_min        = SOCKOPT_GET_BLKLST_GETALL,
     .get_opt_max        = SOCKOPT_GET_BLKLST_GETALL,
     .get                = blklst_sockopt_get,
@@ -31,6 +31,9 @@
 #include "ipvs/proto_tcp.h"
 #include "ipvs/proto_udp.h"
 #include "ipvs/proto_icmp.h"
+#include "ipvs/sync.h"
+#include "ipvs/sesslog.h"
+#include "ipvs/ipfix.h"
 #include "parser/parser.h"
 #include "ctrl.h"
 #include "conf/conn.h"
@@ -96,6 +99,8 @@ static struct dp_vs_conn *dp_vs_conn_alloc(void)
 
     memset(conn, 0, sizeof(struct dp_vs_conn));
     conn->connpool = this_conn_cache;
+    /* set for every conn, the dump age filter and sesslog rely on it */
+    conn->ctime = rte_rdtsc();
     this_conn_count++;
 
     return conn;
@@ -279,6 +284,9 @@ static int conn_bind_dest(struct dp_vs_conn *conn, struct dp_vs_dest *dest)
     case DPVS_FWD_MODE_DR:
         conn->packet_xmit = dp_vs_xmit_dr;
         break;
+    case DPVS_FWD_MODE_VXLAN:
+        conn->packet_xmit = dp_vs_xmit_vxlan;
+        break;
     case DPVS_FWD_MODE_FNAT:
         conn->packet_xmit = dp_vs_xmit_fnat;
         conn->packet_out_xmit = dp_vs_out_xmit_fnat;
@@ -400,8 +408,8 @@ static inline void conn_stats_dump(const char *msg, struct dp_vs_conn *conn)
                 msg ? msg : "", rte_lcore_id(), inet_proto_name(conn->proto),
                 caddr, ntohs(conn->cport), vaddr, ntohs(conn->vport),
                 laddr, ntohs(conn->lport), daddr, ntohs(conn->dport),
-                rte_atomic64_read(&conn->stats.inpkts), rte_atomic64_read(&conn->stats.inbytes),
-                rte_atomic64_read(&conn->stats.outpkts), rte_atomic64_read(&conn->stats.outbytes));
+                conn->stats.inpkts, conn->stats.inbytes,
+                conn->stats.outpkts, conn->stats.outbytes);
     }
 }
 #endif
@@ -526,6 +534,11 @@ static int conn_expire(void *priv)
                     (struct sockaddr_storage *)&saddr);
         }
 
+        /* tell backups before the lport may be reused */
+        dp_vs_sync_conn_expire(conn);
+        dp_vs_sesslog_conn_expire(conn);
+        dp_vs_ipfix_conn_expire(conn);
+
         conn_unbind_dest(conn);
         dp_vs_laddr_unbind(conn);
 
@@ -759,9 +772,6 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
     rte_atomic32_set(&new->refcnt, 1);
     new->flags  = flags;
     new->state  = 0;
-#ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
-    new->ctime = rte_rdtsc();
-#endif
 
     /* bind destination and corresponding trasmitter */
     err = conn_bind_dest(new, dest);
@@ -832,6 +842,8 @@ struct dp_vs_conn *dp_vs_conn_new(struct rte_mbuf *mbuf,
     else
         dpvs_timer_sched(&new->timer, &new->timeout, conn_expire, new, false);
 
+    dp_vs_sesslog_conn_new(new);
+
 #ifdef CONFIG_DPVS_IPVS_DEBUG
     conn_dump("new conn: ", new);
 #endif
@@ -848,6 +860,129 @@ errout_redirect:
     return NULL;
 }
 
+/*
+ * create a connection synchronized from a peer director, there's no packet.
+ * tuples and <laddr, lport> are kept as they are on the peer, so that the
+ * flow goes on here after fail-over. state and timeout are left to caller,
+ * which holds the conn like dp_vs_conn_new().
+ */
+struct dp_vs_conn *dp_vs_conn_sync_new(const struct dp_vs_conn_param *param,
+                                       struct dp_vs_dest *dest,
+                                       const union inet_addr *laddr, uint16_t lport,
+                                       const union inet_addr *daddr, uint16_t dport,
+                                       uint32_t flags)
+{
+    struct dp_vs_conn *new;
+    struct dp_vs_redirect *new_r;
+    struct conn_tuple_hash *t;
+    int err;
+
+    assert(param && dest && laddr && daddr);
+
+    if (unlikely(flags & DPVS_CONN_F_TEMPLATE))
+        return NULL;
+
+    new_r = dp_vs_redirect_alloc(dest->fwdmode);
+
+    new = dp_vs_conn_alloc();
+    if (unlikely(!new))
+        goto errout_redirect;
+
+    new->redirect = new_r;
+
+    /* inbound tuple */
+    t = &tuplehash_in(new);
+    t->direct   = DPVS_CONN_DIR_INBOUND;
+    t->af       = param->af;
+    t->proto    = param->proto;
+    t->saddr    = *param->caddr;
+    t->sport    = param->cport;
+    t->daddr    = *param->vaddr;
+    t->dport    = param->vport;
+    INIT_LIST_HEAD(&t->list);
+
+    /* outbound tuple, daddr/dport is overwritten by laddr bind for FNAT */
+    t = &tuplehash_out(new);
+    t->direct   = DPVS_CONN_DIR_OUTBOUND;
+    t->af       = dest->af;
+    t->proto    = param->proto;
+    t->saddr    = *daddr;
+    t->sport    = dport;
+    t->daddr    = *param->caddr;
+    t->dport    = param->cport;
+    INIT_LIST_HEAD(&t->list);
+
+    new->af     = param->af;
+    new->proto  = param->proto;
+    new->caddr  = *param->caddr;
+    new->cport  = param->cport;
+    new->vaddr  = *param->vaddr;
+    new->vport  = param->vport;
+    new->laddr  = *param->caddr;
+    new->lport  = param->cport;
+    new->daddr  = *daddr;
+    new->dport  = dport;
+
+    if (AF_INET == tuplehash_in(new).af)
+        new->in_nexthop.in.s_addr = htonl(INADDR_ANY);
+    else
+        new->in_nexthop.in6 = in6addr_any;
+
+    if (AF_INET == tuplehash_out(new).af)
+        new->out_nexthop.in.s_addr = htonl(INADDR_ANY);
+    else
+        new->out_nexthop.in6 = in6addr_any;
+
+    rte_atomic32_clear(&new->n_control);
+    rte_atomic32_set(&new->refcnt, 1);
+    new->flags  = flags;
+    new->state  = 0;
+    INIT_LIST_HEAD(&new->ack_mbuf);
+    rte_atomic32_set(&new->syn_retry_max, 0);
+    rte_atomic32_set(&new->dup_ack_cnt, 0);
+
+    err = conn_bind_dest(new, dest);
+    if (err != EDPVS_OK) {
+        RTE_LOG(WARNING, IPVS, "%s: fail to bind dest: %s\n",
+                __func__, dpvs_strerror(err));
+        goto errout;
+    }
+
+    if (dest->fwdmode == DPVS_FWD_MODE_FNAT) {
+        if ((err = dp_vs_laddr_bind_port(new, dest->svc, laddr, lport)) != EDPVS_OK)
+            goto unbind_dest;
+    }
+
+    dp_vs_redirect_init(new);
+
+    if ((err = dp_vs_conn_hash(new)) != EDPVS_OK)
+        goto unbind_laddr;
+
+    new->timeout.tv_sec = conn_init_timeout;
+    new->timeout.tv_usec = 0;
+    dpvs_time_rand_delay(&new->timeout, 1000000);
+    dpvs_timer_sched(&new->timer, &new->timeout, conn_expire, new, false);
+
+    dp_vs_sesslog_conn_new(new);
+
+#ifdef CONFIG_DPVS_IPVS_DEBUG
+    conn_dump("sync conn: ", new);
+#endif
+    return new;
+
+unbind_laddr:
+    dp_vs_laddr_unbind(new);
+unbind_dest:
+    conn_unbind_dest(new);
+errout:
+    dp_vs_conn_free(new);
+    return NULL;
+errout_redirect:
+    if (new_r)
+        rte_mempool_put(new_r->redirect_pool, new_r);
+    return NULL;
+}
+
 /**
  * try lookup and hold dp_vs_conn{} by packet tuple
  *
@@ -1073,20 +1208,29 @@ static int conn_term_lcore(void *arg)
 
 /*
  * ctrl plane support for commands:
- *     ipvsadm -ln -c
+ *     ipvsadm -ln -c [filters]
  *     ipvsadm -ln -c --sockpair af:proto:sip:sport:tip:tport
  *     ipvsadm -ln -c --persistent-conn
+ *
+ * the full table dump is cursor based: each request walks at most
+ * MAX_CTRL_CONN_DUMP_BUCKETS buckets per lcore, filters conns on the
+ * lcore owning them, and returns where to resume in the reply.
  */
-struct ip_vs_conn_array_list {
-    int head;
-    int tail;
-    struct list_head ca_list;
-    ipvs_conn_entry_t array[0];
+
+/* walks of lcore tables at most for one request, bounds the time
+ * master blocks on a sparse (or heavily filtered) table */
+#define CONN_DUMP_WALKS_MAX     64
+
+/* payload of MSG_TYPE_CONN_GET_ALL */
+struct conn_dump_req {
+    struct ip_vs_conn_filter filter;
+    uint32_t bucket;
+    uint32_t offset;
+    uint32_t max;           /* entries returned at most */
 };
 
 static uint8_t g_slave_lcore_nb;
 static uint64_t g_slave_lcore_mask;
-static struct list_head conn_to_dump;
 
 static inline char* get_conn_state_name(uint16_t proto, uint16_t state)
 {
@@ -1234,146 +1378,195 @@ static int sockopt_conn_get_specified(const struct ip_vs_conn_req *conn_req,
     return EDPVS_NOTEXIST;
 }
 
-/* call me on the same lcore as the conn table,
+static bool conn_dump_match(const struct dp_vs_conn *conn,
+                            const struct ip_vs_conn_filter *f, uint64_t now)
+{
+    int af = tuplehash_in(conn).af;
+
+    if (!f->flags)
+        return true;
+
+    if ((f->flags & CONN_FILTER_F_PROTO) && conn->proto != f->proto)
+        return false;
+
+    if (f->flags & CONN_FILTER_F_VADDR) {
+        if (af != f->af || !inet_addr_equal(af, &conn->vaddr, &f->vaddr))
+            return false;
+        if (f->vport && conn->vport != f->vport)
+            return false;
+    }
+
+    if (f->flags & CONN_FILTER_F_DADDR) {
+        if (tuplehash_out(conn).af != f->af ||
+            !inet_addr_equal(f->af, &conn->daddr, &f->daddr))
+            return false;
+        if (f->dport && conn->dport != f->dport)
+            return false;
+    }
+
+    if ((f->flags & CONN_FILTER_F_CADDR) && f->cplen) {
+        if (af != f->af || !inet_addr_same_net(af, f->cplen, &conn->caddr, &f->caddr))
+            return false;
+    }
+
+    if ((f->flags & CONN_FILTER_F_STATE) &&
+        strncmp(get_conn_state_name(conn->proto, conn->state),
+                f->state, sizeof(f->state)) != 0)
+        return false;
+
+    if ((f->flags & CONN_FILTER_F_AGE) &&
+        (now - conn->ctime) / rte_get_tsc_hz() < f->min_age)
+        return false;
+
+    return true;
+}
+
+/* walk @tbl from cursor <@bucket, @offset> and append matched conns to
+ * @arr, until MAX_CTRL_CONN_DUMP_BUCKETS buckets walked or @arr holds
+ * @max entries. the cursor is updated to where to resume, @bucket is
+ * DPVS_CONN_TBL_SIZE if the whole table is walked.
+ *
+ * call me on the same lcore as the conn table,
  * lock me if the conn table is global
  * */
-static int __lcore_conn_table_dump(const struct list_head *cplist)
+static void __lcore_conn_table_dump(const struct list_head *tbl,
+                                    const struct ip_vs_conn_filter *filter,
+                                    uint32_t *bucket, uint32_t *offset,
+                                    struct ip_vs_conn_array *arr, uint32_t max)
 {
-    int i;
     struct conn_tuple_hash *tuphash;
     struct dp_vs_conn *conn;
-    struct ip_vs_conn_array_list *cparr = NULL;
+    uint32_t bkt, end, idx, skip = *offset;
+    uint64_t now = rte_rdtsc();
 
-    for (i = 0; i < DPVS_CONN_TBL_SIZE; i++) {
-        list_for_each_entry(tuphash, &cplist[i], list) {
+    end = RTE_MIN((uint32_t)DPVS_CONN_TBL_SIZE, *bucket + MAX_CTRL_CONN_DUMP_BUCKETS);
+
+    for (bkt = *bucket; bkt < end; bkt++, skip = 0) {
+        idx = 0;
+        list_for_each_entry(tuphash, &tbl[bkt], list) {
             if (tuphash->direct != DPVS_CONN_DIR_INBOUND)
                 continue;
-            conn = tuplehash_to_conn(tuphash);
-            if (unlikely(cparr == NULL || cparr->tail >= MAX_CTRL_CONN_GET_ENTRIES)) {
-                cparr = rte_zmalloc("conn_ctrl", sizeof(struct ip_vs_conn_array_list)
-                        + MAX_CTRL_CONN_GET_ENTRIES * sizeof(ipvs_conn_entry_t), 0);
-                if (unlikely(cparr == NULL))
-                    return EDPVS_NOMEM;
-                cparr->head = cparr->tail = 0;
-            }
-            sockopt_fill_conn_entry(conn, &cparr->array[cparr->tail++]);
-            if (cparr->tail >= MAX_CTRL_CONN_GET_ENTRIES) {
-                RTE_LOG(DEBUG, IPVS, "%s: adding %d elems to conn_to_dump list -- "
-                        "%p:%d-%d\n", __func__, cparr->tail - cparr->head, cparr,
-                        cparr->head, cparr->tail);
-                list_add_tail(&cparr->ca_list, &conn_to_dump);
+            if (idx++ < skip)
+                continue;
+            if (arr->nconns >= max) {
+                *bucket = bkt;
+                *offset = idx - 1;
+                return;
             }
+            conn = tuplehash_to_conn(tuphash);
+            if (conn_dump_match(conn, filter, now))
+                sockopt_fill_conn_entry(conn, &arr->array[arr->nconns++]);
         }
     }
-    if (cparr && cparr->tail < MAX_CTRL_CONN_GET_ENTRIES) {
-        RTE_LOG(DEBUG, IPVS, "%s: adding %d elems to conn_to_dump list -- "
-                "%p:%d-%d\n", __func__, cparr->tail - cparr->head, cparr,
-                cparr->head, cparr->tail);
-        list_add_tail(&cparr->ca_list, &conn_to_dump);
+
+    *bucket = bkt;
+    *offset = 0;
+}
+
+/* dump lcore @cid's conns from cursor in @dreq, append them to @conn_arr */
+static int conn_dump_lcore(lcoreid_t cid, struct conn_dump_req *dreq,
+                           struct ip_vs_conn_array *conn_arr)
+{
+    struct dpvs_msg *msg;
+    struct dpvs_msg_reply *reply;
+    struct ip_vs_conn_array *resp;
+    int res;
+
+    dreq->max = MAX_CTRL_CONN_GET_ENTRIES - conn_arr->nconns;
+
+    msg = msg_make(MSG_TYPE_CONN_GET_ALL, 0, DPVS_MSG_UNICAST, rte_lcore_id(),
+                   sizeof(*dreq), dreq);
+    if (unlikely(!msg))
+        return EDPVS_NOMEM;
+
+    /* the walk on slave is bounded, blockable msg is fine */
+    res = msg_send(msg, cid, 0, &reply);
+    if (res != EDPVS_OK)
+        goto out;
+
+    resp = reply->data;
+    if (unlikely(!resp || reply->len < sizeof(*resp) ||
+                 resp->nconns > dreq->max || reply->len != sizeof(*resp) +
+                 resp->nconns * sizeof(ipvs_conn_entry_t))) {
+        res = EDPVS_INVAL;
+        goto out;
     }
-    return EDPVS_OK;
+
+    memcpy(&conn_arr->array[conn_arr->nconns], resp->array,
+           resp->nconns * sizeof(ipvs_conn_entry_t));
+    conn_arr->nconns += resp->nconns;
+    dreq->bucket = resp->bucket;
+    dreq->offset = resp->offset;
+
+out:
+    msg_destroy(&msg);
+    return res;
 }
 
 static int sockopt_conn_get_all(const struct ip_vs_conn_req *conn_req,
         struct ip_vs_conn_array *conn_arr)
 {
-    int n, res, got = 0;
-    struct ip_vs_conn_array_list *larr, *next_larr;
-    struct dpvs_msg *msg;
-    lcoreid_t cid = conn_req->whence;
-
-again:
-    list_for_each_entry_safe(larr, next_larr, &conn_to_dump, ca_list) {
-        RTE_LOG(DEBUG, IPVS, "%s: printing conn_to_dump list(len=%d) --"
-                "%p:%d-%d\n", __func__, list_elems(&conn_to_dump), larr,
-                larr->head, larr->tail);
-        n = larr->tail - larr->head;
-        assert(n > 0);
-        if (n > MAX_CTRL_CONN_GET_ENTRIES - got) {
-            memcpy(&conn_arr->array[got], &larr->array[larr->head],
-                    (MAX_CTRL_CONN_GET_ENTRIES - got) * sizeof(ipvs_conn_entry_t));
-            larr->head += MAX_CTRL_CONN_GET_ENTRIES - got;
-            got += MAX_CTRL_CONN_GET_ENTRIES - got;
-
-            assert(got == MAX_CTRL_CONN_GET_ENTRIES);
-            conn_arr->nconns = got;
-            /* small chance that all done here, we assign GET_IPVS_CONN_RESL_MORE
-             * flag for simplicity here anyway */
-            conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
-            conn_arr->curcid = cid;
-            return EDPVS_OK;
-        } else {
-            memcpy(&conn_arr->array[got], &larr->array[larr->head],
-                    n * sizeof(ipvs_conn_entry_t));
-            larr->head += n;
-            assert(larr->head == larr->tail);
-            list_del_init(&larr->ca_list);
-            rte_free(larr);
-            got += n;
-            if (got == MAX_CTRL_CONN_GET_ENTRIES) {
-                conn_arr->nconns = got;
-                /* low chance that all done here, we assign GET_IPVS_CONN_RESL_MORE
-                 * flag for simplicity here anyway */
-                conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
-                conn_arr->curcid = cid;
-                return EDPVS_OK;
-            }
-        }
+    bool is_tmpl = !!(conn_req->flag & GET_IPVS_CONN_FLAG_TEMPLATE);
+    struct conn_dump_req dreq;
+    lcoreid_t cid = 0;
+    int walks, res;
+
+    memset(&dreq, 0, sizeof(dreq));
+    dreq.filter = conn_req->filter;
+    if (conn_req->flag & GET_IPVS_CONN_FLAG_MORE) {
+        cid = conn_req->whence;
+        dreq.bucket = conn_req->bucket;
+        dreq.offset = conn_req->offset;
     }
+    conn_arr->nconns = 0;
 
-    if ((conn_req->flag & GET_IPVS_CONN_FLAG_TEMPLATE)
-            && (cid == rte_get_master_lcore())) { /* persist conns */
-        rte_spinlock_lock(&dp_vs_ct_lock);
-        res = __lcore_conn_table_dump(dp_vs_ct_tbl);
-        rte_spinlock_unlock(&dp_vs_ct_lock);
+    for (walks = 0; walks < CONN_DUMP_WALKS_MAX &&
+            conn_arr->nconns < MAX_CTRL_CONN_GET_ENTRIES; walks++) {
+        if (is_tmpl) { /* persist conns, global table on master */
+            cid = rte_get_master_lcore();
+            rte_spinlock_lock(&dp_vs_ct_lock);
+            __lcore_conn_table_dump(dp_vs_ct_tbl, &dreq.filter, &dreq.bucket,
+                                    &dreq.offset, conn_arr,
+                                    MAX_CTRL_CONN_GET_ENTRIES);
+            rte_spinlock_unlock(&dp_vs_ct_lock);
+            if (dreq.bucket >= DPVS_CONN_TBL_SIZE)
+                goto done;
+            continue;
+        }
+
+        for ( ; cid < DPVS_MAX_LCORE; cid++)
+            if (g_slave_lcore_mask & (1UL << cid))
+                break;
+        if (cid >= DPVS_MAX_LCORE)
+            goto done;
+
+        res = conn_dump_lcore(cid, &dreq, conn_arr);
         if (res != EDPVS_OK) {
-            conn_arr->nconns = got;
+            RTE_LOG(WARNING, IPVS, "%s: fail to get lcore%d's connection table -- %s\n",
+                    __func__, (int)cid, dpvs_strerror(res));
             conn_arr->resl = GET_IPVS_CONN_RESL_FAIL;
             conn_arr->curcid = cid;
             return res;
         }
-        cid++;
-        goto again;
-    }
 
-    if (conn_req->flag & GET_IPVS_CONN_FLAG_TEMPLATE) {
-        conn_arr->nconns = got;
-        conn_arr->resl = GET_IPVS_CONN_RESL_OK;
-        conn_arr->curcid = 0;
-        return EDPVS_OK;
+        if (dreq.bucket >= DPVS_CONN_TBL_SIZE) { /* lcore done, go on with next */
+            cid++;
+            dreq.bucket = 0;
+            dreq.offset = 0;
+        }
     }
 
-    for ( ; cid < DPVS_MAX_LCORE; cid++)
-        if (g_slave_lcore_mask & (1UL << cid))
-            break;
-    if (cid >= DPVS_MAX_LCORE) {
-        conn_arr->nconns = got;
-        conn_arr->resl = GET_IPVS_CONN_RESL_OK;
-        conn_arr->curcid = 0;
-        return EDPVS_OK;
-    }
+    /* there may be nothing left, the client finds it with the next call */
+    conn_arr->resl = GET_IPVS_CONN_RESL_OK | GET_IPVS_CONN_RESL_MORE;
+    conn_arr->curcid = cid;
+    conn_arr->bucket = dreq.bucket;
+    conn_arr->offset = dreq.offset;
+    return EDPVS_OK;
 
-    /* get conns table from cid and saved into dump list */
-    msg = msg_make(MSG_TYPE_CONN_GET_ALL, 0, DPVS_MSG_UNICAST, rte_lcore_id(), 0, NULL);
-    /* FIXME: When conns in session table are not many enough, blockable msg would get
-     * timeout probably due to the traverse of the whole huge session table.  So non-
-     * blockable msg is used. A more elegant solution is to use an upper time limit for
-     * the session table access in this case, which is much more complicated. */
-    res = msg_send(msg, cid, DPVS_MSG_F_ASYNC, NULL);
-    while (!test_msg_flags(msg, DPVS_MSG_F_STATE_FIN|DPVS_MSG_F_STATE_DROP))
-        ; /* wait until msg processed */
-
-    if (res != EDPVS_OK || test_msg_flags(msg, DPVS_MSG_F_STATE_DROP|
-                DPVS_MSG_F_CALLBACK_FAIL)) {
-        RTE_LOG(WARNING, IPVS, "%s: fail to get lcore%d's connection table -- %s\n",
-                __func__, (int)cid, dpvs_strerror(res));
-        conn_arr->nconns = got;
-        conn_arr->resl = GET_IPVS_CONN_RESL_FAIL;
-        conn_arr->curcid = cid;
-        return res;
-    }
-    cid++;
-    goto again;
+done:
+    conn_arr->resl = GET_IPVS_CONN_RESL_OK;
+    conn_arr->curcid = 0;
+    return EDPVS_OK;
 }
 
 static int sockopt_conn_get(sockoptid_t opt, const void *in, size_t inlen,
@@ -1408,13 +1601,6 @@ static int sockopt_conn_get(sockoptid_t opt, const void *in, size_t inlen,
         {
             if (!(conn_req->flag & (GET_IPVS_CONN_FLAG_ALL|GET_IPVS_CONN_FLAG_MORE)))
                 return EDPVS_INVAL;
-            if (!(conn_req->flag & GET_IPVS_CONN_FLAG_MORE)) {
-                struct ip_vs_conn_array_list *calst, *tcalst;
-                list_for_each_entry_safe(calst, tcalst, &conn_to_dump, ca_list) {
-                    list_del_init(&calst->ca_list);
-                    rte_free(calst);
-                }
-            }
 
             arr_size = sizeof(struct ip_vs_conn_array) + MAX_CTRL_CONN_GET_ENTRIES *
                 sizeof(ipvs_conn_entry_t);
@@ -1496,7 +1682,33 @@ static int conn_get_msgcb_slave(struct dpvs_msg *msg)
 
 static int conn_get_all_msgcb_slave(struct dpvs_msg *msg)
 {
-    return  __lcore_conn_table_dump(this_conn_tbl);
+    const struct conn_dump_req *dreq;
+    struct ip_vs_conn_array *arr;
+    uint32_t bucket, offset;
+
+    if (msg->len != sizeof(struct conn_dump_req))
+        return EDPVS_INVAL;
+    dreq = (struct conn_dump_req *)msg->data;
+    if (dreq->max > MAX_CTRL_CONN_GET_ENTRIES)
+        return EDPVS_INVAL;
+
+    arr = rte_zmalloc("get_conns", sizeof(struct ip_vs_conn_array) +
+                      dreq->max * sizeof(ipvs_conn_entry_t), 0);
+    if (unlikely(!arr))
+        return EDPVS_NOMEM;
+
+    bucket = dreq->bucket;
+    offset = dreq->offset;
+    __lcore_conn_table_dump(this_conn_tbl, &dreq->filter, &bucket, &offset,
+                            arr, dreq->max);
+    arr->bucket = bucket;
+    arr->offset = offset;
+
+    msg->reply.len = sizeof(struct ip_vs_conn_array) +
+                     arr->nconns * sizeof(ipvs_conn_entry_t);
+    msg->reply.data = arr;
+
+    return EDPVS_OK;
 }
 
 static int register_conn_get_msg(void)
@@ -1574,7 +1786,6 @@ static int conn_ctrl_init(void)
 {
     int err;
 
-    INIT_LIST_HEAD(&conn_to_dump);
     netif_get_slave_lcores(&g_slave_lcore_nb, &g_slave_lcore_mask);
 
     if ((err = register_conn_get_msg()) != EDPVS_OK)
@@ -1591,13 +1802,6 @@ static int conn_ctrl_init(void)
 
 static void conn_ctrl_term(void)
 {
-    struct ip_vs_conn_array_list *calst, *tcalst;
-
-    list_for_each_entry_safe(calst, tcalst, &conn_to_dump, ca_list) {
-        list_del_init(&calst->ca_list);
-        rte_free(calst);
-    }
-
     sockopt_unregister(&conn_sockopts);
     unregister_conn_get_msg();
 }
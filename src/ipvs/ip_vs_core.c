@@ -37,6 +37,9 @@
 #include "ipvs/proto_udp.h"
 #include "route6.h"
 #include "ipvs/redirect.h"
+#include "ipvs/sync.h"
+#include "ipvs/sesslog.h"
+#include "ipvs/ipfix.h"
 
 static inline int dp_vs_fill_iphdr(int af, struct rte_mbuf *mbuf,
                                    struct dp_vs_iphdr *iph)
@@ -928,6 +931,7 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
     struct dp_vs_proto *prot;
     struct dp_vs_conn *conn;
     int dir, verdict, err, related;
+    uint16_t old_state;
     bool drop = false;
     lcoreid_t cid, peer_cid;
     eth_type_t etype = mbuf->packet_type; /* FIXME: use other field ? */
@@ -956,20 +960,56 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
         return INET_ACCEPT;
 
     /*
-     * Defrag ipvs-forwarding TCP/UDP is not supported for some reasons,
+     * Defrag ipvs-forwarding TCP is not supported, UDP fragments are
+     * reassembled before conn lookup.
      *
      * - RSS/flow-director do not support TCP/UDP fragments, means it's
-     *   not able to direct frags to same lcore as original TCP/UDP packets.
-     * - per-lcore conn table will miss if frags reachs wrong lcore.
-     *
-     * If we redirect frags to "correct" lcore, it may cause performance
-     * issue. Also it need to understand RSS algorithm. Moreover, for the
-     * case frags in same flow are not occur in same lcore, a global lock is
-     * needed, which is not a good idea.
+     *   not able to direct frags to same lcore as original packets.
+     *   So all frags of one datagram are redirected to the lcore owning
+     *   its reassembly, hashed by (saddr, daddr, ip_id, proto), without
+     *   any global lock. That requires conn redirect enabled, otherwise
+     *   frags are reassembled on the receiving lcore.
+     * - the reassembled datagram goes through conn lookup, which may
+     *   redirect it again to the conn's lcore, and is re-fragmented at
+     *   output if it exceeds the MTU.
      */
     if (af == AF_INET && ip4_is_frag(ip4_hdr(mbuf))) {
-        RTE_LOG(DEBUG, IPVS, "%s: frag not support.\n", __func__);
-        return INET_DROP;
+        struct ether_hdr eth, *ehdr;
+
+        if (iph.proto != IPPROTO_UDP) {
+            RTE_LOG(DEBUG, IPVS, "%s: frag not support.\n", __func__);
+            return INET_DROP;
+        }
+
+        peer_cid = dp_vs_redirect_frag_lcore(ip4_hdr(mbuf));
+        if (cid != peer_cid) {
+            /* recover mbuf.data_off to outer Ether header */
+            rte_pktmbuf_prepend(mbuf, (uint16_t)sizeof(struct ether_hdr));
+
+            return dp_vs_redirect_pkt(mbuf, peer_cid);
+        }
+
+        /*
+         * reassembly moves the datagram to where the Ether header of its
+         * heading frag was, restore the header in front of it for a
+         * possible redirect to the conn's lcore.
+         */
+        eth = *rte_pktmbuf_mtod_offset(mbuf, struct ether_hdr *,
+                                       -(int)sizeof(struct ether_hdr));
+
+        if (ip4_defrag(mbuf, IP_DEFRAG_VS_FWD) != EDPVS_OK)
+            return INET_STOLEN;
+        ip4_send_csum(ip4_hdr(mbuf));
+
+        ehdr = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
+                                        (uint16_t)sizeof(struct ether_hdr));
+        if (unlikely(!ehdr))
+            return INET_DROP;
+        *ehdr = eth;
+        rte_pktmbuf_adj(mbuf, (uint16_t)sizeof(struct ether_hdr));
+
+        if (dp_vs_fill_iphdr(af, mbuf, &iph) != EDPVS_OK)
+            return INET_DROP;
     }
 
     /* packet belongs to existing connection ? */
@@ -1038,6 +1078,7 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
         }
     }
 
+    old_state = conn->state;
     if (prot->state_trans) {
         err = prot->state_trans(prot, conn, mbuf, dir);
         if (err != EDPVS_OK)
@@ -1045,6 +1086,12 @@ static int __dp_vs_in(void *priv, struct rte_mbuf *mbuf,
     }
     conn->old_state = conn->state;
 
+    /* state transition triggered synchronization */
+    dp_vs_sync_conn(conn, old_state);
+
+    /* long-lived flow reports its counters every active timeout */
+    dp_vs_ipfix_conn_active(conn);
+
     /* holding the conn, need a "put" later. */
     if (dir == DPVS_CONN_DIR_INBOUND)
         return xmit_inbound(mbuf, prot, conn);
@@ -1073,9 +1120,9 @@ static int __dp_vs_pre_routing(void *priv, struct rte_mbuf *mbuf,
     if (EDPVS_OK != dp_vs_fill_iphdr(af, mbuf, &iph))
         return INET_ACCEPT;
 
-    /* Drop all ip fragment except ospf */
+    /* Drop all ip fragment except ospf and udp (reassembled by dp_vs_in) */
     if ((af == AF_INET) && ip4_is_frag(ip4_hdr(mbuf))
-            && (iph.proto != IPPROTO_OSPF)) {
+            && (iph.proto != IPPROTO_OSPF) && (iph.proto != IPPROTO_UDP)) {
         dp_vs_estats_inc(DEFENCE_IP_FRAG_DROP);
         return INET_DROP;
     }
@@ -1197,6 +1244,24 @@ int dp_vs_init(void)
         goto err_stats;
     }
 
+    err = dp_vs_sync_init();
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init sync: %s\n", dpvs_strerror(err));
+        goto err_sync;
+    }
+
+    err = dp_vs_sesslog_init();
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init sesslog: %s\n", dpvs_strerror(err));
+        goto err_sesslog;
+    }
+
+    err = dp_vs_ipfix_init();
+    if (err != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "fail to init ipfix: %s\n", dpvs_strerror(err));
+        goto err_ipfix;
+    }
+
     err = inet_register_hooks(dp_vs_ops, NELEMS(dp_vs_ops));
     if (err != EDPVS_OK) {
         RTE_LOG(ERR, IPVS, "fail to register hooks: %s\n", dpvs_strerror(err));
@@ -1207,6 +1272,12 @@ int dp_vs_init(void)
     return EDPVS_OK;
 
 err_hooks:
+    dp_vs_ipfix_term();
+err_ipfix:
+    dp_vs_sesslog_term();
+err_sesslog:
+    dp_vs_sync_term();
+err_sync:
     dp_vs_stats_term();
 err_stats:
     dp_vs_blklst_term();
@@ -1236,6 +1307,18 @@ int dp_vs_term(void)
     if (err != EDPVS_OK)
         RTE_LOG(ERR, IPVS, "fail to unregister hooks: %s\n", dpvs_strerror(err));
 
+    err = dp_vs_ipfix_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate ipfix: %s\n", dpvs_strerror(err));
+
+    err = dp_vs_sesslog_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate sesslog: %s\n", dpvs_strerror(err));
+
+    err = dp_vs_sync_term();
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "fail to terminate sync: %s\n", dpvs_strerror(err));
+
     err = dp_vs_stats_term();
     if (err != EDPVS_OK)
         RTE_LOG(ERR, IPVS, "fail to terminate term: %s\n", dpvs_strerror(err));
@@ -47,6 +47,10 @@ static struct list_head dp_vs_rtable[DP_VS_RTAB_SIZE];
 
 struct list_head dp_vs_dest_trash = LIST_HEAD_INIT(dp_vs_dest_trash);
 
+/* master and slaves forward, other lcores never use their slot 0 */
+uint8_t dp_vs_dest_nh_index[DPVS_MAX_LCORE];
+static int dp_vs_dest_nh_count = 1;
+
 static inline unsigned dp_vs_rs_hashkey(int af,
                     const union inet_addr *addr,
                     uint32_t port)
@@ -202,7 +206,8 @@ int dp_vs_new_dest(struct dp_vs_service *svc,
 {
     int size;
     struct dp_vs_dest *dest;
-    size = RTE_CACHE_LINE_ROUNDUP(sizeof(struct dp_vs_dest));
+    size = RTE_CACHE_LINE_ROUNDUP(sizeof(struct dp_vs_dest)) +
+           dp_vs_dest_nh_count * sizeof(struct dp_vs_dest_nh);
     dest = rte_zmalloc("dpvs_new_dest", size, 0);
     if(dest == NULL){
         RTE_LOG(DEBUG, SERVICE, "%s: no memory.\n", __func__);
@@ -226,6 +231,7 @@ int dp_vs_new_dest(struct dp_vs_service *svc,
     rte_atomic32_set(&dest->refcnt, 0);
 
     INIT_LIST_HEAD(&dest->d_list);
+    rte_spinlock_init(&dest->encap_lock);
 
     if (dp_vs_new_stats(&(dest->stats)) != EDPVS_OK) {
         rte_free(dest);
@@ -501,6 +507,23 @@ dp_vs_del_dest(struct dp_vs_service *svc, struct dp_vs_dest_conf *udest)
     return EDPVS_OK;
 }
 
+/* fill @entry but stats, which need a message round to all lcores */
+void dp_vs_fill_dest_entry(struct dp_vs_dest_entry *entry,
+                           const struct dp_vs_dest *dest)
+{
+    memset(entry, 0, sizeof(*entry));
+    entry->af   = dest->af;
+    entry->addr = dest->addr;
+    entry->port = dest->port;
+    entry->conn_flags = dest->fwdmode;
+    entry->weight = rte_atomic16_read(&dest->weight);
+    entry->max_conn = dest->max_conn;
+    entry->min_conn = dest->min_conn;
+    entry->actconns = rte_atomic32_read(&dest->actconns);
+    entry->inactconns = rte_atomic32_read(&dest->inactconns);
+    entry->persistconns = rte_atomic32_read(&dest->persistconns);
+}
+
 int dp_vs_get_dest_entries(const struct dp_vs_service *svc,
                            const struct dp_vs_get_dests *get,
                            struct dp_vs_get_dests *uptr)
@@ -513,17 +536,7 @@ int dp_vs_get_dest_entries(const struct dp_vs_service *svc,
     list_for_each_entry(dest, &svc->dests, n_list){
         if(count >= get->num_dests)
             break;
-        memset(&entry, 0, sizeof(entry));
-        entry.af   = dest->af;
-        entry.addr = dest->addr;
-        entry.port = dest->port;
-        entry.conn_flags = dest->fwdmode;
-        entry.weight = rte_atomic16_read(&dest->weight);
-        entry.max_conn = dest->max_conn;
-        entry.min_conn = dest->min_conn;
-        entry.actconns = rte_atomic32_read(&dest->actconns);
-        entry.inactconns = rte_atomic32_read(&dest->inactconns);
-        entry.persistconns = rte_atomic32_read(&dest->persistconns);
+        dp_vs_fill_dest_entry(&entry, dest);
         ret = dp_vs_copy_stats(&(entry.stats), dest->stats);
         if (ret != EDPVS_OK)
             break;
@@ -538,10 +551,25 @@ int dp_vs_get_dest_entries(const struct dp_vs_service *svc,
 int dp_vs_dest_init(void)
 {
     int idx;
+    uint8_t nb_slaves;
+    uint64_t slave_mask;
+    lcoreid_t cid;
+
     for (idx = 0; idx < DP_VS_RTAB_SIZE; idx++) {
         INIT_LIST_HEAD(&dp_vs_rtable[idx]);
     }
     rte_rwlock_init(&__dp_vs_rs_lock);
+
+    /* slot 0 is master's */
+    netif_get_slave_lcores(&nb_slaves, &slave_mask);
+    dp_vs_dest_nh_count = 1;
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (slave_mask & (1UL << cid))
+            dp_vs_dest_nh_index[cid] = dp_vs_dest_nh_count++;
+        else
+            dp_vs_dest_nh_index[cid] = 0;
+    }
+
     return EDPVS_OK;
 }
 
@@ -0,0 +1,707 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * IPFIX (RFC 7011) flow export.
+ *
+ * one record per conn carries the client-side tuple, the RS-side tuple
+ * as post-NAT(P) fields, and both directions' total counts (the reverse
+ * direction as RFC 5103 reverse elements). there are four templates,
+ * one for each combination of client and RS address families; the
+ * template set is built once on start and resent every template refresh
+ * interval, as required for UDP transport.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "common.h"
+#include "dpdk.h"
+#include "netif.h"
+#include "ctrl.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/conn.h"
+#include "ipvs/proto_tcp.h"
+#include "ipvs/ipfix.h"
+
+#define IPFIX_BUFF_RECS             64      /* records per batch */
+#define IPFIX_POOL_SIZE             4095
+#define IPFIX_POOL_CACHE            64
+#define IPFIX_RING_SIZE             512
+#define IPFIX_DEQ_BURST             32
+#define IPFIX_FLUSH_LOOPS           1024
+#define IPFIX_MSG_MAX               1400    /* fits common path MTUs */
+
+#define IPFIX_VERSION               10
+#define IPFIX_SET_TEMPLATE          2
+#define IPFIX_TEMPLATE_ID_BASE      256
+#define IPFIX_NR_TEMPLATES          4
+#define IPFIX_PEN_REVERSE           29305   /* RFC 5103 */
+#define IPFIX_ENTERPRISE_BIT        0x8000
+
+/* information elements */
+#define IPFIX_IE_PROTOCOL           4
+#define IPFIX_IE_SRC_PORT           7
+#define IPFIX_IE_SRC_IPV4           8
+#define IPFIX_IE_DST_PORT           11
+#define IPFIX_IE_DST_IPV4           12
+#define IPFIX_IE_SRC_IPV6           27
+#define IPFIX_IE_DST_IPV6           28
+#define IPFIX_IE_OCTET_TOTAL        85
+#define IPFIX_IE_PACKET_TOTAL       86
+#define IPFIX_IE_END_REASON         136
+#define IPFIX_IE_START_MS           152
+#define IPFIX_IE_END_MS             153
+#define IPFIX_IE_POST_NAT_SRC_IPV4  225
+#define IPFIX_IE_POST_NAT_DST_IPV4  226
+#define IPFIX_IE_POST_NAPT_SRC_PORT 227
+#define IPFIX_IE_POST_NAPT_DST_PORT 228
+#define IPFIX_IE_POST_NAT_SRC_IPV6  281
+#define IPFIX_IE_POST_NAT_DST_IPV6  282
+
+struct ipfix_msg_hdr {
+    uint16_t            version;
+    uint16_t            length;
+    uint32_t            export_time;
+    uint32_t            seq;
+    uint32_t            domain_id;
+} __attribute__((__packed__));
+
+struct ipfix_set_hdr {
+    uint16_t            id;
+    uint16_t            length;
+} __attribute__((__packed__));
+
+/* flow record from workers, TSC timestamps */
+struct ipfix_rec {
+    uint8_t             af;
+    uint8_t             daf;
+    uint8_t             proto;
+    uint8_t             reason;
+    uint16_t            cport;
+    uint16_t            vport;
+    uint16_t            lport;
+    uint16_t            dport;
+    uint64_t            start;
+    uint64_t            end;
+    union inet_addr     caddr;
+    union inet_addr     vaddr;
+    union inet_addr     laddr;
+    union inet_addr     daddr;
+    uint64_t            inpkts;
+    uint64_t            inbytes;
+    uint64_t            outpkts;
+    uint64_t            outbytes;
+};
+
+struct ipfix_buff {
+    uint16_t            nr;
+    struct ipfix_rec    recs[IPFIX_BUFF_RECS];
+};
+
+/* per-lcore ring and statistics, written by owner lcore only */
+struct ipfix_lcore {
+    struct rte_ring                 *ring;
+    struct ipfix_buff               *curr;
+    struct dp_vs_ipfix_lcore_stats  stats;
+} __rte_cache_aligned;
+
+/* master only */
+struct ipfix_exporter {
+    bool                running;
+    struct dp_vs_ipfix_conf conf;
+    int                 sockfd;
+    struct sockaddr_in  collector;
+    uint32_t            seq;            /* data records sent */
+    uint64_t            tsc_base;
+    uint64_t            ms_base;
+    uint64_t            template_cycles;
+    uint64_t            template_tsc;   /* last template sent */
+
+    /* template cache */
+    char                tmpl_msg[IPFIX_MSG_MAX];
+    uint16_t            tmpl_len;
+
+    /* message being built */
+    char                msg[IPFIX_MSG_MAX];
+    uint16_t            len;
+    uint16_t            set_off;        /* 0 if no open set */
+    uint16_t            set_id;
+    uint32_t            nr_recs;
+
+    uint64_t            sent_records;
+    uint64_t            sent_msgs;
+    uint64_t            sent_templates;
+    uint64_t            send_errors;
+};
+
+volatile bool dp_vs_ipfix_on = false;
+uint64_t dp_vs_ipfix_active_cycles;
+
+static struct ipfix_lcore ipfix_lcores[DPVS_MAX_LCORE];
+static struct rte_mempool *ipfix_pool;
+static struct ipfix_exporter ipfix_exp = { .sockfd = -1 };
+static struct netif_lcore_loop_job ipfix_job;
+
+static inline int ipfix_addr_len(int af)
+{
+    return af == AF_INET6 ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+}
+
+static inline uint16_t ipfix_template_id(int af, int daf)
+{
+    return IPFIX_TEMPLATE_ID_BASE + (af == AF_INET6 ? 2 : 0) + (daf == AF_INET6 ? 1 : 0);
+}
+
+static inline int ipfix_rec_len(int af, int daf)
+{
+    return 2 * ipfix_addr_len(af) + 2 * ipfix_addr_len(daf)
+         + 4 * sizeof(uint16_t)         /* ports */
+         + 1                            /* protocol */
+         + 2 * sizeof(uint64_t)         /* start, end */
+         + 4 * sizeof(uint64_t)         /* counters */
+         + 1;                           /* end reason */
+}
+
+/*
+ * workers
+ */
+static void ipfix_lcore_flush(struct ipfix_lcore *il)
+{
+    struct ipfix_buff *buff = il->curr;
+
+    if (!buff)
+        return;
+    il->curr = NULL;
+
+    if (unlikely(rte_ring_sp_enqueue(il->ring, buff) != 0)) {
+        il->stats.ring_full += buff->nr;
+        rte_mempool_put(ipfix_pool, buff);
+        return;
+    }
+
+    il->stats.records += buff->nr;
+}
+
+void __dp_vs_ipfix_conn_export(struct dp_vs_conn *conn, uint8_t reason)
+{
+    struct ipfix_lcore *il = &ipfix_lcores[rte_lcore_id()];
+    struct ipfix_buff *buff = il->curr;
+    struct ipfix_rec *rec;
+    uint64_t now = rte_rdtsc();
+
+    if (unlikely(!il->ring) || (conn->flags & DPVS_CONN_F_TEMPLATE))
+        return;
+
+    /* do not retry on every packet when out of buffers */
+    conn->ipfix_tsc = now;
+
+    if (!buff) {
+        if (unlikely(rte_mempool_get(ipfix_pool, (void **)&buff) != 0)) {
+            il->stats.nobuf++;
+            return;
+        }
+        buff->nr = 0;
+        il->curr = buff;
+    }
+
+    rec = &buff->recs[buff->nr++];
+    rec->af         = conn->af;
+    rec->daf        = tuplehash_out(conn).af;
+    rec->proto      = conn->proto;
+    rec->reason     = reason;
+    if (reason == IPFIX_END_IDLE_TIMEOUT && conn->proto == IPPROTO_TCP &&
+            conn->state != DPVS_TCP_S_ESTABLISHED)
+        rec->reason = IPFIX_END_OF_FLOW;
+    rec->cport      = conn->cport;
+    rec->vport      = conn->vport;
+    rec->lport      = conn->lport;
+    rec->dport      = conn->dport;
+    rec->start      = conn->ctime;
+    rec->end        = now;
+    rec->caddr      = conn->caddr;
+    rec->vaddr      = conn->vaddr;
+    rec->laddr      = conn->laddr;
+    rec->daddr      = conn->daddr;
+    rec->inpkts     = conn->stats.inpkts;
+    rec->inbytes    = conn->stats.inbytes;
+    rec->outpkts    = conn->stats.outpkts;
+    rec->outbytes   = conn->stats.outbytes;
+
+    if (buff->nr >= IPFIX_BUFF_RECS)
+        ipfix_lcore_flush(il);
+}
+
+static void ipfix_lcore_job(void *arg)
+{
+    struct ipfix_lcore *il = &ipfix_lcores[rte_lcore_id()];
+
+    if (il->curr)
+        ipfix_lcore_flush(il);
+}
+
+/*
+ * master, message encoding
+ */
+static inline char *ipfix_put16(char *p, uint16_t v)
+{
+    v = htons(v);
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static inline char *ipfix_put64(char *p, uint64_t v)
+{
+    v = rte_cpu_to_be_64(v);
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static char *ipfix_put_field(char *p, uint16_t ie, uint16_t len, bool reverse)
+{
+    uint32_t pen = htonl(IPFIX_PEN_REVERSE);
+
+    p = ipfix_put16(p, reverse ? (ie | IPFIX_ENTERPRISE_BIT) : ie);
+    p = ipfix_put16(p, len);
+    if (reverse) {
+        memcpy(p, &pen, sizeof(pen));
+        p += sizeof(pen);
+    }
+    return p;
+}
+
+/* field order must match ipfix_encode_rec() */
+static char *ipfix_put_template(char *p, int af, int daf)
+{
+    bool v6 = af == AF_INET6, dv6 = daf == AF_INET6;
+    int alen = ipfix_addr_len(af), dlen = ipfix_addr_len(daf);
+
+    p = ipfix_put16(p, ipfix_template_id(af, daf));
+    p = ipfix_put16(p, 16);     /* field count */
+    p = ipfix_put_field(p, v6 ? IPFIX_IE_SRC_IPV6 : IPFIX_IE_SRC_IPV4, alen, false);
+    p = ipfix_put_field(p, v6 ? IPFIX_IE_DST_IPV6 : IPFIX_IE_DST_IPV4, alen, false);
+    p = ipfix_put_field(p, dv6 ? IPFIX_IE_POST_NAT_SRC_IPV6 : IPFIX_IE_POST_NAT_SRC_IPV4,
+                        dlen, false);
+    p = ipfix_put_field(p, dv6 ? IPFIX_IE_POST_NAT_DST_IPV6 : IPFIX_IE_POST_NAT_DST_IPV4,
+                        dlen, false);
+    p = ipfix_put_field(p, IPFIX_IE_SRC_PORT, 2, false);
+    p = ipfix_put_field(p, IPFIX_IE_DST_PORT, 2, false);
+    p = ipfix_put_field(p, IPFIX_IE_POST_NAPT_SRC_PORT, 2, false);
+    p = ipfix_put_field(p, IPFIX_IE_POST_NAPT_DST_PORT, 2, false);
+    p = ipfix_put_field(p, IPFIX_IE_PROTOCOL, 1, false);
+    p = ipfix_put_field(p, IPFIX_IE_START_MS, 8, false);
+    p = ipfix_put_field(p, IPFIX_IE_END_MS, 8, false);
+    p = ipfix_put_field(p, IPFIX_IE_OCTET_TOTAL, 8, false);
+    p = ipfix_put_field(p, IPFIX_IE_PACKET_TOTAL, 8, false);
+    p = ipfix_put_field(p, IPFIX_IE_OCTET_TOTAL, 8, true);
+    p = ipfix_put_field(p, IPFIX_IE_PACKET_TOTAL, 8, true);
+    p = ipfix_put_field(p, IPFIX_IE_END_REASON, 1, false);
+    return p;
+}
+
+static void ipfix_build_templates(struct ipfix_exporter *exp)
+{
+    static const int afs[IPFIX_NR_TEMPLATES][2] = {
+        { AF_INET, AF_INET }, { AF_INET, AF_INET6 },
+        { AF_INET6, AF_INET }, { AF_INET6, AF_INET6 },
+    };
+    struct ipfix_set_hdr *set;
+    char *p;
+    int i;
+
+    p = exp->tmpl_msg + sizeof(struct ipfix_msg_hdr);
+    set = (struct ipfix_set_hdr *)p;
+    p += sizeof(*set);
+    for (i = 0; i < IPFIX_NR_TEMPLATES; i++)
+        p = ipfix_put_template(p, afs[i][0], afs[i][1]);
+
+    set->id = htons(IPFIX_SET_TEMPLATE);
+    set->length = htons(p - (char *)set);
+    exp->tmpl_len = p - exp->tmpl_msg;
+}
+
+static inline uint64_t ipfix_tsc_to_ms(const struct ipfix_exporter *exp, uint64_t tsc)
+{
+    uint64_t hz = rte_get_tsc_hz();
+    uint64_t ts = tsc - exp->tsc_base;
+
+    return exp->ms_base + ts / hz * 1000ULL + ts % hz * 1000ULL / hz;
+}
+
+static int ipfix_send(struct ipfix_exporter *exp, char *msg, uint16_t len,
+                      uint32_t seq)
+{
+    struct ipfix_msg_hdr *hdr = (struct ipfix_msg_hdr *)msg;
+
+    hdr->version = htons(IPFIX_VERSION);
+    hdr->length = htons(len);
+    hdr->export_time = htonl((uint32_t)time(NULL));
+    hdr->seq = htonl(seq);
+    hdr->domain_id = htonl(exp->conf.domain_id);
+
+    if (sendto(exp->sockfd, msg, len, MSG_DONTWAIT,
+               (struct sockaddr *)&exp->collector, sizeof(exp->collector)) < 0) {
+        exp->send_errors++;
+        return EDPVS_IO;
+    }
+
+    exp->sent_msgs++;
+    return EDPVS_OK;
+}
+
+static void ipfix_send_templates(struct ipfix_exporter *exp)
+{
+    if (ipfix_send(exp, exp->tmpl_msg, exp->tmpl_len, exp->seq) == EDPVS_OK)
+        exp->sent_templates++;
+    exp->template_tsc = rte_rdtsc();
+}
+
+static void ipfix_close_set(struct ipfix_exporter *exp)
+{
+    struct ipfix_set_hdr *set;
+
+    if (!exp->set_off)
+        return;
+
+    set = (struct ipfix_set_hdr *)(exp->msg + exp->set_off);
+    set->id = htons(exp->set_id);
+    set->length = htons(exp->len - exp->set_off);
+    exp->set_off = 0;
+}
+
+static void ipfix_flush(struct ipfix_exporter *exp)
+{
+    ipfix_close_set(exp);
+
+    if (exp->nr_recs) {
+        /* sequence number is the count of data records sent before */
+        if (ipfix_send(exp, exp->msg, exp->len, exp->seq) == EDPVS_OK)
+            exp->sent_records += exp->nr_recs;
+        exp->seq += exp->nr_recs;
+    }
+
+    exp->len = sizeof(struct ipfix_msg_hdr);
+    exp->nr_recs = 0;
+}
+
+static void ipfix_encode_rec(struct ipfix_exporter *exp, const struct ipfix_rec *rec)
+{
+    uint16_t tid = ipfix_template_id(rec->af, rec->daf);
+    int alen = ipfix_addr_len(rec->af), dlen = ipfix_addr_len(rec->daf);
+    int need = ipfix_rec_len(rec->af, rec->daf);
+    char *p;
+
+    if (exp->set_off && exp->set_id != tid)
+        ipfix_close_set(exp);
+    if (!exp->set_off)
+        need += sizeof(struct ipfix_set_hdr);
+
+    if (exp->len + need > IPFIX_MSG_MAX) {
+        ipfix_flush(exp);
+        need = ipfix_rec_len(rec->af, rec->daf) + sizeof(struct ipfix_set_hdr);
+    }
+
+    if (!exp->set_off) {
+        exp->set_off = exp->len;
+        exp->set_id = tid;
+        exp->len += sizeof(struct ipfix_set_hdr);
+    }
+
+    p = exp->msg + exp->len;
+    rte_memcpy(p, &rec->caddr, alen);
+    p += alen;
+    rte_memcpy(p, &rec->vaddr, alen);
+    p += alen;
+    rte_memcpy(p, &rec->laddr, dlen);
+    p += dlen;
+    rte_memcpy(p, &rec->daddr, dlen);
+    p += dlen;
+    /* ports are in network order already */
+    memcpy(p, &rec->cport, 2);
+    memcpy(p + 2, &rec->vport, 2);
+    memcpy(p + 4, &rec->lport, 2);
+    memcpy(p + 6, &rec->dport, 2);
+    p += 8;
+    *p++ = rec->proto;
+    p = ipfix_put64(p, ipfix_tsc_to_ms(exp, rec->start));
+    p = ipfix_put64(p, ipfix_tsc_to_ms(exp, rec->end));
+    p = ipfix_put64(p, rec->inbytes);
+    p = ipfix_put64(p, rec->inpkts);
+    p = ipfix_put64(p, rec->outbytes);
+    p = ipfix_put64(p, rec->outpkts);
+    *p++ = rec->reason;
+
+    exp->len = p - exp->msg;
+    exp->nr_recs++;
+}
+
+void dp_vs_ipfix_process_on_master(void)
+{
+    struct ipfix_exporter *exp = &ipfix_exp;
+    struct ipfix_buff *buffs[IPFIX_DEQ_BURST];
+    unsigned i, j, n;
+    lcoreid_t cid;
+
+    if (exp->running &&
+            rte_rdtsc() - exp->template_tsc >= exp->template_cycles)
+        ipfix_send_templates(exp);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!ipfix_lcores[cid].ring)
+            continue;
+
+        n = rte_ring_sc_dequeue_burst(ipfix_lcores[cid].ring, (void **)buffs,
+                                      IPFIX_DEQ_BURST, NULL);
+        for (i = 0; i < n; i++) {
+            /* batches still in flight after stop are dropped */
+            if (exp->running) {
+                for (j = 0; j < buffs[i]->nr; j++)
+                    ipfix_encode_rec(exp, &buffs[i]->recs[j]);
+            }
+            rte_mempool_put(ipfix_pool, buffs[i]);
+        }
+    }
+
+    if (exp->running && exp->nr_recs)
+        ipfix_flush(exp);
+}
+
+static void ipfix_stop(void)
+{
+    struct ipfix_exporter *exp = &ipfix_exp;
+
+    if (!exp->running)
+        return;
+
+    dp_vs_ipfix_on = false;
+    rte_wmb();
+
+    ipfix_flush(exp);
+    exp->running = false;
+    close(exp->sockfd);
+    exp->sockfd = -1;
+
+    RTE_LOG(INFO, IPVS, "ipfix export stopped, %lu records sent\n",
+            exp->sent_records);
+}
+
+static int ipfix_start(const struct dp_vs_ipfix_conf *conf)
+{
+    struct ipfix_exporter *exp = &ipfix_exp;
+    struct timeval tv;
+    lcoreid_t cid;
+
+    if (exp->running)
+        return EDPVS_BUSY;
+
+    if (conf->collector.s_addr == htonl(INADDR_ANY))
+        return EDPVS_INVAL;
+
+    memset(exp, 0, sizeof(*exp));
+    exp->conf = *conf;
+    if (!exp->conf.port)
+        exp->conf.port = htons(IPFIX_PORT_DEF);
+    if (!exp->conf.active_timeout)
+        exp->conf.active_timeout = IPFIX_ACTIVE_TIMEOUT_DEF;
+    if (!exp->conf.template_refresh)
+        exp->conf.template_refresh = IPFIX_TEMPLATE_REFRESH_DEF;
+
+    exp->sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (exp->sockfd < 0)
+        return EDPVS_SYSCALL;
+
+    exp->collector.sin_family = AF_INET;
+    exp->collector.sin_addr = exp->conf.collector;
+    exp->collector.sin_port = exp->conf.port;
+
+    gettimeofday(&tv, NULL);
+    exp->tsc_base = rte_rdtsc();
+    exp->ms_base = tv.tv_sec * 1000ULL + tv.tv_usec / 1000ULL;
+    exp->template_cycles = (uint64_t)exp->conf.template_refresh * rte_get_tsc_hz();
+    exp->len = sizeof(struct ipfix_msg_hdr);
+
+    ipfix_build_templates(exp);
+    ipfix_send_templates(exp);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        memset(&ipfix_lcores[cid].stats, 0, sizeof(ipfix_lcores[cid].stats));
+        ipfix_lcores[cid].stats.cid = cid;
+    }
+
+    dp_vs_ipfix_active_cycles = (uint64_t)exp->conf.active_timeout * rte_get_tsc_hz();
+    exp->running = true;
+    rte_wmb();
+    dp_vs_ipfix_on = true;
+
+    RTE_LOG(INFO, IPVS, "ipfix export started to %s:%u, domain %u\n",
+            inet_ntoa(exp->conf.collector), ntohs(exp->conf.port),
+            exp->conf.domain_id);
+    return EDPVS_OK;
+}
+
+/*
+ * control plane
+ */
+static int ipfix_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    switch (opt) {
+    case SOCKOPT_SET_IPFIX_START:
+        if (!conf || size < sizeof(struct dp_vs_ipfix_conf))
+            return EDPVS_INVAL;
+        return ipfix_start(conf);
+    case SOCKOPT_SET_IPFIX_STOP:
+        if (!ipfix_exp.running)
+            return EDPVS_NOTEXIST;
+        ipfix_stop();
+        return EDPVS_OK;
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static int ipfix_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                             void **out, size_t *outsize)
+{
+    struct dp_vs_ipfix_show *show;
+    lcoreid_t cid;
+    size_t len;
+    int nlcore = 0;
+
+    if (opt != SOCKOPT_GET_IPFIX_SHOW)
+        return EDPVS_NOTSUPP;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (ipfix_lcores[cid].ring)
+            nlcore++;
+    }
+
+    len = sizeof(*show) + nlcore * sizeof(struct dp_vs_ipfix_lcore_stats);
+    show = rte_zmalloc(NULL, len, 0);
+    if (!show)
+        return EDPVS_NOMEM;
+
+    show->running = ipfix_exp.running;
+    show->conf = ipfix_exp.conf;
+    show->sent_records = ipfix_exp.sent_records;
+    show->sent_msgs = ipfix_exp.sent_msgs;
+    show->sent_templates = ipfix_exp.sent_templates;
+    show->send_errors = ipfix_exp.send_errors;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!ipfix_lcores[cid].ring)
+            continue;
+        show->lcores[show->nlcore] = ipfix_lcores[cid].stats;
+        show->lcores[show->nlcore].cid = cid;
+        show->nlcore++;
+    }
+
+    *out = show;
+    *outsize = len;
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts ipfix_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_SET_IPFIX_START,
+    .set_opt_max    = SOCKOPT_SET_IPFIX_STOP,
+    .set            = ipfix_sockopt_set,
+    .get_opt_min    = SOCKOPT_GET_IPFIX_SHOW,
+    .get_opt_max    = SOCKOPT_GET_IPFIX_SHOW,
+    .get            = ipfix_sockopt_get,
+};
+
+int dp_vs_ipfix_init(void)
+{
+    char name[RTE_RING_NAMESIZE];
+    lcoreid_t cid;
+    int err;
+
+    ipfix_pool = rte_mempool_create("dp_vs_ipfix", IPFIX_POOL_SIZE,
+                                    sizeof(struct ipfix_buff),
+                                    IPFIX_POOL_CACHE, 0, NULL, NULL,
+                                    NULL, NULL, SOCKET_ID_ANY, 0);
+    if (!ipfix_pool) {
+        RTE_LOG(ERR, IPVS, "%s: fail to create ipfix pool\n", __func__);
+        return EDPVS_NOMEM;
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!rte_lcore_is_enabled(cid) || cid == rte_get_master_lcore())
+            continue;
+
+        snprintf(name, sizeof(name), "dp_vs_ipfix_c%d", cid);
+        ipfix_lcores[cid].ring = rte_ring_create(name, IPFIX_RING_SIZE,
+                rte_lcore_to_socket_id(cid), RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!ipfix_lcores[cid].ring) {
+            RTE_LOG(ERR, IPVS, "%s: fail to create %s\n", __func__, name);
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
+        ipfix_lcores[cid].stats.cid = cid;
+    }
+
+    snprintf(ipfix_job.name, sizeof(ipfix_job.name) - 1, "%s", "ipvs_ipfix");
+    ipfix_job.func = ipfix_lcore_job;
+    ipfix_job.data = NULL;
+    ipfix_job.type = NETIF_LCORE_JOB_SLOW;
+    ipfix_job.skip_loops = IPFIX_FLUSH_LOOPS;
+    if ((err = netif_lcore_loop_job_register(&ipfix_job)) != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register loop job\n", __func__);
+        goto errout;
+    }
+
+    if ((err = sockopt_register(&ipfix_sockopts)) != EDPVS_OK) {
+        netif_lcore_loop_job_unregister(&ipfix_job);
+        goto errout;
+    }
+
+    return EDPVS_OK;
+
+errout:
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(ipfix_lcores[cid].ring);
+        ipfix_lcores[cid].ring = NULL;
+    }
+    rte_mempool_free(ipfix_pool);
+    ipfix_pool = NULL;
+    return err;
+}
+
+int dp_vs_ipfix_term(void)
+{
+    lcoreid_t cid;
+    int err;
+
+    ipfix_stop();
+
+    if ((err = sockopt_unregister(&ipfix_sockopts)) != EDPVS_OK)
+        return err;
+
+    netif_lcore_loop_job_unregister(&ipfix_job);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(ipfix_lcores[cid].ring);
+        ipfix_lcores[cid].ring = NULL;
+    }
+    rte_mempool_free(ipfix_pool);
+    ipfix_pool = NULL;
+
+    return EDPVS_OK;
+}
@@ -255,6 +255,80 @@ int dp_vs_laddr_bind(struct dp_vs_conn *conn, struct dp_vs_service *svc)
     return EDPVS_OK;
 }
 
+/*
+ * unlike dp_vs_laddr_bind(), <laddr, lport> is not selected but taken
+ * from a synchronized connection. the lport must belong to current lcore
+ * and be free in its sa_pool.
+ */
+int dp_vs_laddr_bind_port(struct dp_vs_conn *conn, struct dp_vs_service *svc,
+                          const union inet_addr *addr, uint16_t lport)
+{
+    struct dp_vs_laddr *laddr = NULL, *curr;
+    struct sockaddr_storage dsin, ssin;
+    int err;
+
+    if (!conn || !conn->dest || !svc || !addr)
+        return EDPVS_INVAL;
+    if (svc->proto != IPPROTO_TCP && svc->proto != IPPROTO_UDP)
+        return EDPVS_NOTSUPP;
+    if (conn->flags & DPVS_CONN_F_TEMPLATE)
+        return EDPVS_OK;
+
+    rte_rwlock_read_lock(&svc->laddr_lock);
+    list_for_each_entry(curr, &svc->laddr_list, list) {
+        if (inet_addr_equal(curr->af, &curr->addr, addr)) {
+            laddr = curr;
+            rte_atomic32_inc(&laddr->refcnt);
+            break;
+        }
+    }
+    rte_rwlock_read_unlock(&svc->laddr_lock);
+
+    if (!laddr)
+        return EDPVS_NOTEXIST;
+
+    memset(&dsin, 0, sizeof(struct sockaddr_storage));
+    memset(&ssin, 0, sizeof(struct sockaddr_storage));
+
+    if (laddr->af == AF_INET) {
+        struct sockaddr_in *daddr, *saddr;
+        daddr = (struct sockaddr_in *)&dsin;
+        daddr->sin_family = laddr->af;
+        daddr->sin_addr = conn->daddr.in;
+        daddr->sin_port = conn->dport;
+        saddr = (struct sockaddr_in *)&ssin;
+        saddr->sin_family = laddr->af;
+        saddr->sin_addr = laddr->addr.in;
+        saddr->sin_port = lport;
+    } else {
+        struct sockaddr_in6 *daddr, *saddr;
+        daddr = (struct sockaddr_in6 *)&dsin;
+        daddr->sin6_family = laddr->af;
+        daddr->sin6_addr = conn->daddr.in6;
+        daddr->sin6_port = conn->dport;
+        saddr = (struct sockaddr_in6 *)&ssin;
+        saddr->sin6_family = laddr->af;
+        saddr->sin6_addr = laddr->addr.in6;
+        saddr->sin6_port = lport;
+    }
+
+    err = sa_bind(laddr->iface, &dsin, &ssin);
+    if (err != EDPVS_OK) {
+        put_laddr(laddr);
+        return err;
+    }
+
+    rte_atomic32_inc(&laddr->conn_counts);
+
+    conn->laddr = laddr->addr;
+    conn->lport = lport;
+    tuplehash_out(conn).daddr = laddr->addr;
+    tuplehash_out(conn).dport = lport;
+
+    conn->local = laddr;
+    return EDPVS_OK;
+}
+
 int dp_vs_laddr_unbind(struct dp_vs_conn *conn)
 {
     struct sockaddr_storage dsin, ssin;
@@ -489,6 +563,14 @@ static int laddr_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
     return err;
 }
 
+static int laddr_sockopt_rollback(sockoptid_t opt, const void *conf, size_t size)
+{
+    if (opt != SOCKOPT_SET_LADDR_ADD)
+        return EDPVS_NOTSUPP;
+
+    return laddr_sockopt_set(SOCKOPT_SET_LADDR_DEL, conf, size);
+}
+
 static int laddr_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
                              void **out, size_t *outsize)
 {
@@ -559,6 +641,7 @@ static struct dpvs_sockopts laddr_sockopts = {
     .set_opt_min        = SOCKOPT_SET_LADDR_ADD,
     .set_opt_max        = SOCKOPT_SET_LADDR_FLUSH,
     .set                = laddr_sockopt_set,
+    .rollback           = laddr_sockopt_rollback,
     .get_opt_min        = SOCKOPT_GET_LADDR_GETALL,
     .get_opt_max        = SOCKOPT_GET_LADDR_GETALL,
     .get                = laddr_sockopt_get,
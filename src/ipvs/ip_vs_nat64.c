@@ -47,7 +47,7 @@ int mbuf_6to4(struct rte_mbuf *mbuf,
     if (!ip4h)
         return EDPVS_NOROOM;
 
-    memset(ip4h, 0, sizeof(struct ipv4_hdr));
+    /* every field is written, no memset needed */
     ip4h->version_ihl     = ((4 << 4) | 5);
     ip4h->type_of_service = 0;
     ip4h->total_length    = htons(mbuf->pkt_len);
@@ -58,6 +58,9 @@ int mbuf_6to4(struct rte_mbuf *mbuf,
     ip4h->dst_addr        = daddr->s_addr;
     ip4h->packet_id       = 0; // NO FRAG, so 0 is OK?
 
+    /* checksum once here, later rewrites (TOA) keep it by ip4_set_xxx */
+    ip4_send_csum(ip4h);
+
     mbuf->l3_len = sizeof(struct ipv4_hdr);
 
     return EDPVS_OK;
@@ -86,8 +89,7 @@ int mbuf_4to6(struct rte_mbuf *mbuf,
     if (!ip6h)
         return EDPVS_NOROOM;
 
-    memset(ip6h, 0, sizeof(struct ip6_hdr));
-    ip6h->ip6_vfc   = 0x60;
+    ip6h->ip6_flow  = htonl(0x60000000); /* version 6, no tclass/flow */
     ip6h->ip6_plen  = htons(plen);
     ip6h->ip6_nxt   = next_prot;
     ip6h->ip6_hlim  = hops;
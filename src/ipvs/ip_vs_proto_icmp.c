@@ -240,14 +240,9 @@ static struct dp_vs_conn *icmp_conn_lookup(struct dp_vs_proto *proto,
     if (conn) {
         return conn;
     } else {
-        struct dp_vs_redirect *r;
-
-        r = dp_vs_redirect_get(iph->af, iph->proto,
-                               &iph->saddr, &iph->daddr,
-                               sport, dport);
-        if (r) {
-            *peer_cid = r->cid;
-        }
+        dp_vs_redirect_get(iph->af, iph->proto,
+                           &iph->saddr, &iph->daddr,
+                           sport, dport, peer_cid);
     }
 
     return conn;
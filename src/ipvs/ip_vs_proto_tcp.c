@@ -156,13 +156,94 @@ inline void tcp6_send_csum(struct ipv6_hdr *iph, struct tcphdr *th) {
             (void *)th - (void *)iph, IPPROTO_TCP);
 }
 
+/*
+ * raw sum of the TCP header (checksum field excluded) and of the
+ * pseudo-header words NAT may change, i.e., addresses and L4 length.
+ * taken before and after translation, it gives the RFC 1624 update
+ * of th->check without summing the payload again.
+ */
+static inline uint32_t tcp_csum_partial(int af, const union inet_addr *saddr,
+        const union inet_addr *daddr, uint16_t l4_len, const struct tcphdr *th)
+{
+    uint32_t sum;
+
+    sum = __rte_raw_cksum(th, th->doff << 2, 0);
+    sum += (uint16_t)~th->check;
+    sum += inet_addr_csum(af, saddr);
+    sum += inet_addr_csum(af, daddr);
+    sum += htons(l4_len);
+
+    return sum;
+}
+
+static inline uint16_t tcp_l4_len(int af, int iphdrlen, struct rte_mbuf *mbuf)
+{
+    if (AF_INET6 == af)
+        return ntohs(ip6_hdr(mbuf)->ip6_plen) + sizeof(struct ip6_hdr) - iphdrlen;
+    else
+        return ntohs(ip4_hdr(mbuf)->total_length) - iphdrlen;
+}
+
+/*
+ * partial sum of the packet before translation.
+ * @tuple is what the packet matched, its addresses are the original ones
+ * even if L3 is translated (or converted by nat64) already.
+ */
+static inline uint32_t tcp_csum_orig(int af, int iphdrlen,
+        const struct conn_tuple_hash *tuple,
+        const struct tcphdr *th, struct rte_mbuf *mbuf)
+{
+    return tcp_csum_partial(tuple->af, &tuple->saddr, &tuple->daddr,
+                            tcp_l4_len(af, iphdrlen, mbuf), th);
+}
+
+static inline uint32_t tcp_csum_curr(int af, int iphdrlen,
+        const struct tcphdr *th, struct rte_mbuf *mbuf)
+{
+    if (AF_INET6 == af) {
+        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+
+        return tcp_csum_partial(af, (union inet_addr *)&ip6h->ip6_src,
+                                (union inet_addr *)&ip6h->ip6_dst,
+                                tcp_l4_len(af, iphdrlen, mbuf), th);
+    } else {
+        struct ipv4_hdr *iph = ip4_hdr(mbuf);
+
+        return tcp_csum_partial(af, (union inet_addr *)&iph->src_addr,
+                                (union inet_addr *)&iph->dst_addr,
+                                tcp_l4_len(af, iphdrlen, mbuf), th);
+    }
+}
+
+/*
+ * @osum: tcp_csum_orig() of the packet, taken before L4 translation.
+ * without HW offload, th->check is updated incrementally from @osum
+ * so that the packet (may be segmented) needs no pulling or full sum.
+ */
 static inline int tcp_send_csum(int af, int iphdrlen, struct tcphdr *th,
-        const struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
+        const struct dp_vs_conn *conn, struct rte_mbuf *mbuf, uint32_t osum)
 {
     /* leverage HW TX TCP csum offload if possible */
 
     struct netif_port *dev = NULL;
 
+    /*
+     * TCP aggregates (LRO/GRO) are checksummed per segment at egress,
+     * by TSO or GSO, only offsets and L3 type (nat64) need updating.
+     */
+    if (mbuf->ol_flags & PKT_TX_TCP_SEG) {
+        mbuf->l3_len = iphdrlen;
+        mbuf->l4_len = th->doff << 2;
+        if (AF_INET6 == af) {
+            mbuf->ol_flags &= ~(PKT_TX_IPV4 | PKT_TX_IP_CKSUM);
+            mbuf->ol_flags |= PKT_TX_IPV6;
+        } else {
+            mbuf->ol_flags &= ~PKT_TX_IPV6;
+            mbuf->ol_flags |= (PKT_TX_IPV4 | PKT_TX_IP_CKSUM);
+        }
+        return EDPVS_OK;
+    }
+
     if (AF_INET6 == af) {
         struct route6 *rt6 = mbuf->userdata;
         struct ip6_hdr *ip6h = ip6_hdr(mbuf);
@@ -175,10 +256,7 @@ static inline int tcp_send_csum(int af, int iphdrlen, struct tcphdr *th,
             mbuf->l4_len = ntohs(ip6h->ip6_plen) + sizeof(struct ip6_hdr) - iphdrlen;
             mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IPV6);
             th->check = ip6_phdr_cksum(ip6h, mbuf->ol_flags, iphdrlen, IPPROTO_TCP);
-        } else {
-            if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
-                return EDPVS_INVPKT;
-            tcp6_send_csum((struct ipv6_hdr *)ip6h, th);
+            return EDPVS_OK;
         }
     } else { /* AF_INET */
         struct route_entry *rt = mbuf->userdata;
@@ -192,13 +270,12 @@ static inline int tcp_send_csum(int af, int iphdrlen, struct tcphdr *th,
             mbuf->l3_len = iphdrlen;
             mbuf->ol_flags |= (PKT_TX_TCP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
             th->check = ip4_phdr_cksum(iph, mbuf->ol_flags);
-        } else {
-            if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
-                return EDPVS_INVPKT;
-            tcp4_send_csum(iph, th);
+            return EDPVS_OK;
         }
     }
 
+    th->check = inet_csum_update(th->check, osum,
+                                 tcp_csum_curr(af, iphdrlen, th, mbuf));
     return EDPVS_OK;
 }
 
@@ -300,20 +377,239 @@ static void tcp_in_remove_ts(struct tcphdr *tcph)
     }
 }
 
+/*
+ * build the new option area of @tcph in @buf: TOA first, then the
+ * original options. if they do not fit in 40 bytes, drop the NOP/EOL
+ * paddings (e.g., timestamp replaced by tcp_in_remove_ts) and pad the
+ * rest to 4 bytes. return the new option length, which is never less
+ * than the original one, or -1 if no room.
+ */
+static int tcp_in_build_toa_opts(struct dp_vs_conn *conn,
+                                 const struct tcphdr *tcph, uint8_t *buf)
+{
+    struct tcpopt_addr *toa = (struct tcpopt_addr *)buf;
+    const uint8_t *ptr = (const uint8_t *)(tcph + 1);
+    int toa_len, opt_len, len, pos;
+
+    toa_len = conn->af == AF_INET ? TCP_OLEN_IP4_ADDR : TCP_OLEN_IP6_ADDR;
+    opt_len = (tcph->doff << 2) - sizeof(struct tcphdr);
+
+    toa->opcode = TCP_OPT_ADDR;
+    toa->opsize = toa_len;
+    toa->port = conn->cport;
+
+    if (conn->af == AF_INET)
+        ((struct tcpopt_ip4_addr *)buf)->addr = conn->caddr.in;
+    else
+        ((struct tcpopt_ip6_addr *)buf)->addr = conn->caddr.in6;
+
+    if (likely(toa_len + opt_len <= MAX_TCP_OPT_LEN)) {
+        memcpy(buf + toa_len, ptr, opt_len);
+        return toa_len + opt_len;
+    }
+
+    pos = toa_len;
+    len = opt_len;
+    while (len > 0) {
+        int opcode = *ptr;
+        int opsize;
+
+        if (opcode == TCP_OPT_EOL)
+            break;
+        if (opcode == TCP_OPT_NOP) {
+            ptr++, len--;
+            continue;
+        }
+
+        if (len < 2)
+            return -1;
+        opsize = ptr[1];
+        if (opsize < 2 || opsize > len)
+            return -1; /* silly or partial options, keep them intact */
+        if (pos + opsize > MAX_TCP_OPT_LEN)
+            return -1;
+
+        memcpy(buf + pos, ptr, opsize);
+        pos += opsize;
+        ptr += opsize;
+        len -= opsize;
+    }
+
+    /* never shrink the header, the room is already there */
+    while ((pos & 3) || pos < opt_len)
+        buf[pos++] = TCP_OPT_NOP;
+
+    dp_vs_estats_inc(FULLNAT_ADD_TOA_COMPACT);
+    return pos;
+}
+
+/*
+ * make @delta more bytes of room for TCP options right after the TCP
+ * header @tcph of length @hdr_len (from L3 header), in order of cost:
+ *
+ * 1. move L3 and TCP basic header backwards into headroom, only headers
+ *    are touched whatever the payload size.
+ * 2. for segmented mbuf, move the payload of the first segment to a new
+ *    segment, so that the first one holds the headers only and the room
+ *    comes from its tailroom.
+ * 3. shift the payload forward into tailroom.
+ *
+ * return the new TCP header, or NULL if no room.
+ */
+static struct tcphdr *tcp_in_make_opt_room(struct rte_mbuf *mbuf,
+                                           struct tcphdr *tcph,
+                                           uint32_t hdr_len, uint32_t delta)
+{
+    uint8_t *hdr = rte_pktmbuf_mtod(mbuf, uint8_t *);
+    uint32_t base_len = (uint8_t *)(tcph + 1) - hdr;
+    struct rte_mbuf *seg;
+    uint8_t *p;
+
+    if (rte_pktmbuf_headroom(mbuf) >= delta) {
+        p = (uint8_t *)rte_pktmbuf_prepend(mbuf, delta);
+        memmove(p, hdr, base_len);
+        dp_vs_estats_inc(FULLNAT_ADD_TOA_HEADROOM);
+        return (struct tcphdr *)(p + base_len - sizeof(struct tcphdr));
+    }
+
+    if (mbuf->data_len < mbuf->pkt_len) {
+        if (unlikely(mbuf->data_len < hdr_len))
+            return NULL;
+
+        if (mbuf->data_len > hdr_len) {
+            seg = rte_pktmbuf_alloc(mbuf->pool);
+            if (unlikely(!seg))
+                return NULL;
+            seg->data_off = 0;
+            seg->data_len = mbuf->data_len - hdr_len;
+            if (unlikely(seg->data_len > seg->buf_len)) {
+                rte_pktmbuf_free(seg);
+                return NULL;
+            }
+            rte_memcpy(rte_pktmbuf_mtod(seg, void *), hdr + hdr_len,
+                       seg->data_len);
+
+            seg->next = mbuf->next;
+            mbuf->next = seg;
+            mbuf->nb_segs++;
+            mbuf->data_len = hdr_len;
+        }
+
+        /* rte_pktmbuf_append() works on the last segment */
+        if (unlikely(rte_pktmbuf_tailroom(mbuf) < delta))
+            return NULL;
+        mbuf->data_len += delta;
+        mbuf->pkt_len += delta;
+        dp_vs_estats_inc(FULLNAT_ADD_TOA_SPLIT);
+        return tcph;
+    }
+
+    if (unlikely(!rte_pktmbuf_append(mbuf, delta)))
+        return NULL;
+    memmove(hdr + hdr_len + delta, hdr + hdr_len,
+            mbuf->data_len - delta - hdr_len);
+    dp_vs_estats_inc(FULLNAT_ADD_TOA_SHIFT);
+    return tcph;
+}
+
+/*
+ * microbenchmark of tcp_in_make_opt_room(), run by `dpvs --toa-bench N`
+ * before data plane starts. synthetic IPv4 TCP segments of some payload
+ * sizes get room for an IPv4 TOA, with default headroom (path 1) and
+ * without headroom (path 3, the payload shift), N rounds each.
+ */
+#define TOA_BENCH_POOL_SIZE     1023
+
+static uint64_t tcp_toa_bench_run(struct rte_mempool *pool, uint16_t payload,
+                                  bool headroom, int rounds, int *failed)
+{
+    uint32_t hdr_len = sizeof(struct ipv4_hdr) + sizeof(struct tcphdr);
+    struct rte_mbuf *mbuf;
+    struct ipv4_hdr *iph;
+    struct tcphdr *tcph;
+    uint64_t start, cycles = 0;
+    int i;
+
+    for (i = 0; i < rounds; i++) {
+        mbuf = rte_pktmbuf_alloc(pool);
+        if (unlikely(!mbuf)) {
+            (*failed)++;
+            continue;
+        }
+        if (!headroom)
+            mbuf->data_off = 0;
+
+        iph = (struct ipv4_hdr *)rte_pktmbuf_append(mbuf, hdr_len + payload);
+        if (unlikely(!iph)) {
+            rte_pktmbuf_free(mbuf);
+            (*failed)++;
+            continue;
+        }
+        memset(iph, 0, hdr_len);
+        iph->version_ihl = 0x45;
+        iph->total_length = htons(hdr_len + payload);
+        iph->next_proto_id = IPPROTO_TCP;
+        tcph = (struct tcphdr *)(iph + 1);
+        tcph->doff = sizeof(struct tcphdr) >> 2;
+        tcph->ack = 1;
+
+        start = rte_rdtsc();
+        tcph = tcp_in_make_opt_room(mbuf, tcph, hdr_len, TCP_OLEN_IP4_ADDR);
+        cycles += rte_rdtsc() - start;
+        if (unlikely(!tcph))
+            (*failed)++;
+
+        rte_pktmbuf_free(mbuf);
+    }
+
+    return cycles;
+}
+
+int tcp_toa_benchmark(int rounds)
+{
+    static const uint16_t payloads[] = { 0, 64, 512, 1400 };
+    struct rte_mempool *pool;
+    uint64_t head, shift;
+    int i, failed = 0;
+
+    if (rounds <= 0)
+        return EDPVS_INVAL;
+
+    pool = rte_pktmbuf_pool_create("toa_bench", TOA_BENCH_POOL_SIZE, 0, 0,
+                                   RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    if (!pool)
+        return EDPVS_NOMEM;
+
+    printf("TOA insertion, %d rounds, cycles per segment:\n", rounds);
+    printf("%-10s %-12s %-12s\n", "payload", "headroom", "shift");
+    for (i = 0; i < NELEMS(payloads); i++) {
+        head = tcp_toa_bench_run(pool, payloads[i], true, rounds, &failed);
+        shift = tcp_toa_bench_run(pool, payloads[i], false, rounds, &failed);
+        printf("%-10u %-12lu %-12lu\n", payloads[i],
+               head / rounds, shift / rounds);
+    }
+    if (failed)
+        printf("%d rounds failed\n", failed);
+
+    rte_mempool_free(pool);
+    return failed ? EDPVS_NOROOM : EDPVS_OK;
+}
+
 static inline int tcp_in_add_toa(struct dp_vs_conn *conn, struct rte_mbuf *mbuf,
                           struct tcphdr *tcph)
 {
     uint32_t mtu;
-    struct tcpopt_addr *toa;
-    uint32_t tcp_opt_len;
-    uint8_t *p, *q, *tail;
+    uint8_t opts[MAX_TCP_OPT_LEN];
+    uint32_t hdr_len, delta;
+    int opt_len;
     struct route_entry *rt;
     struct route6 *rt6;
 
-    if (unlikely(conn->af != AF_INET && conn->af != AF_INET6))
+    if (unlikely(conn->af != AF_INET && conn->af != AF_INET6)) {
+        dp_vs_estats_inc(FULLNAT_ADD_TOA_FAIL_PROTO);
         return EDPVS_NOTSUPP;
+    }
 
-    tcp_opt_len = conn->af == AF_INET ? TCP_OLEN_IP4_ADDR : TCP_OLEN_IP6_ADDR;
     /*
      * check if we can add the new option
      */
@@ -329,76 +625,69 @@ static inline int tcp_in_add_toa(struct dp_vs_conn *conn, struct rte_mbuf *mbuf,
         return EDPVS_NOROUTE;
     }
 
-    if (unlikely(mbuf->pkt_len > (mtu - tcp_opt_len))) {
-        RTE_LOG(DEBUG, IPVS, "add toa: need fragment, tcp opt len : %u.\n",
-                tcp_opt_len);
-        return EDPVS_FRAG;
-    }
-
     /* maximum TCP header is 60, and 40 for options */
-    if (unlikely((60 - (tcph->doff << 2)) < tcp_opt_len)) {
+    opt_len = tcp_in_build_toa_opts(conn, tcph, opts);
+    if (unlikely(opt_len < 0)) {
         RTE_LOG(DEBUG, IPVS, "add toa: no TCP header room, tcp opt len : %u.\n",
-                tcp_opt_len);
+                (tcph->doff << 2) - (uint32_t)sizeof(struct tcphdr));
+        dp_vs_estats_inc(FULLNAT_ADD_TOA_HEAD_FULL);
         return EDPVS_NOROOM;
     }
+    delta = sizeof(struct tcphdr) + opt_len - (tcph->doff << 2);
 
-    /* check tail room and expand mbuf.
-     * have to pull all bits in segments for later operation. */
-    if (unlikely(mbuf_may_pull(mbuf, mbuf->pkt_len) != 0))
-        return EDPVS_INVPKT;
-    tail = (uint8_t *)rte_pktmbuf_append(mbuf, tcp_opt_len);
-    if (unlikely(!tail)) {
-        RTE_LOG(DEBUG, IPVS, "add toa: no mbuf tail room, tcp opt len : %u.\n",
-                tcp_opt_len);
-        return EDPVS_NOROOM;
+    if (mbuf->ol_flags & PKT_TX_TCP_SEG) {
+        /* each segment carries the option, keep it within MTU */
+        if (unlikely(mbuf->tso_segsz <= delta)) {
+            dp_vs_estats_inc(FULLNAT_ADD_TOA_FAIL_LEN);
+            return EDPVS_NOROOM;
+        }
+    } else if (unlikely(mbuf_l3_seg_len(mbuf) > (mtu - delta))) {
+        RTE_LOG(DEBUG, IPVS, "add toa: need fragment, tcp opt len : %u.\n",
+                delta);
+        dp_vs_estats_inc(FULLNAT_ADD_TOA_FAIL_LEN);
+        return EDPVS_FRAG;
     }
 
     /*
-     * now add address option
+     * headers may be moved, callers must re-fetch IP/TCP header pointers.
      */
-
-    /* move data down, including existing tcp options
-     * @p is last data byte,
-     * @q is new position of last data byte */
-    p = tail - 1;
-    q = p + tcp_opt_len;
-    while (p >= ((uint8_t *)tcph + sizeof(struct tcphdr))) {
-        *q = *p;
-        p--, q--;
-    }
-
-    /* insert toa right after TCP basic header */
-    toa = (struct tcpopt_addr *)(tcph + 1);
-    toa->opcode = TCP_OPT_ADDR;
-    toa->opsize = tcp_opt_len;
-    toa->port = conn->cport;
-
-    if (conn->af == AF_INET) {
-        struct tcpopt_ip4_addr *toa_ip4 = (struct tcpopt_ip4_addr *)(tcph + 1);
-        toa_ip4->addr = conn->caddr.in;
-    }
-    else {
-        struct tcpopt_ip6_addr *toa_ip6 = (struct tcpopt_ip6_addr *)(tcph + 1);
-        toa_ip6->addr = conn->caddr.in6;
+    hdr_len = (uint8_t *)tcph + (tcph->doff << 2)
+            - rte_pktmbuf_mtod(mbuf, uint8_t *);
+    if (delta)
+        tcph = tcp_in_make_opt_room(mbuf, tcph, hdr_len, delta);
+    if (unlikely(!tcph)) {
+        RTE_LOG(DEBUG, IPVS, "add toa: no mbuf room, tcp opt len : %u.\n",
+                delta);
+        dp_vs_estats_inc(FULLNAT_ADD_TOA_FAIL_MEM);
+        return EDPVS_NOROOM;
     }
 
+    /*
+     * now add address option, right after TCP basic header
+     */
+    memcpy(tcph + 1, opts, opt_len);
 
     /* reset tcp header length */
-    tcph->doff += tcp_opt_len >> 2;
+    tcph->doff = (sizeof(struct tcphdr) + opt_len) >> 2;
+
+    if (mbuf->ol_flags & PKT_TX_TCP_SEG)
+        mbuf->tso_segsz -= delta;
 
     /*
      * reset ip header total length, notice nat64
      * toa is always for rs which is tuplehash_out conn
      */
     if (tuplehash_out(conn).af == AF_INET)
-        ip4_hdr(mbuf)->total_length =
-            htons(ntohs(ip4_hdr(mbuf)->total_length) + tcp_opt_len);
+        ip4_set_tot_len(ip4_hdr(mbuf),
+                htons(ntohs(ip4_hdr(mbuf)->total_length) + delta));
     else
         ip6_hdr(mbuf)->ip6_plen =
-            htons(ntohs(ip6_hdr(mbuf)->ip6_plen) + tcp_opt_len);
+            htons(ntohs(ip6_hdr(mbuf)->ip6_plen) + delta);
 
-    /* tcp csum will be recalc later,
-     * so as IP hdr csum since iph.tot_len has been chagned. */
+    dp_vs_estats_inc(FULLNAT_ADD_TOA_OK);
+
+    /* tcp csum will be updated later, the option is part of the
+     * TCP header sum, and the L4 length of the pseudo-header. */
     return EDPVS_OK;
 }
 
@@ -664,14 +953,9 @@ tcp_conn_lookup(struct dp_vs_proto *proto, const struct dp_vs_iphdr *iph,
             }
         }
     } else {
-        struct dp_vs_redirect *r;
-
-        r = dp_vs_redirect_get(iph->af, iph->proto,
-                               &iph->saddr, &iph->daddr,
-                               th->source, th->dest);
-        if (r) {
-            *peer_cid = r->cid;
-        }
+        dp_vs_redirect_get(iph->af, iph->proto,
+                           &iph->saddr, &iph->daddr,
+                           th->source, th->dest, peer_cid);
     }
 
     return conn;
@@ -681,6 +965,7 @@ static int tcp_fnat_in_handler(struct dp_vs_proto *proto,
                         struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
 {
     struct tcphdr *th;
+    uint32_t osum;
     /* af/mbuf may be changed for nat64 which in af is ipv6 and out is ipv4 */
     int af = tuplehash_out(conn).af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
@@ -695,6 +980,8 @@ static int tcp_fnat_in_handler(struct dp_vs_proto *proto,
     if (mbuf_may_pull(mbuf, iphdrlen + (th->doff << 2)) != 0)
         return EDPVS_INVPKT;
 
+    osum = tcp_csum_orig(af, iphdrlen, &tuplehash_in(conn), th, mbuf);
+
     /*
      * for SYN packet
      * 1. remove tcp timestamp option
@@ -708,12 +995,16 @@ static int tcp_fnat_in_handler(struct dp_vs_proto *proto,
         tcp_in_remove_ts(th);
         tcp_in_init_seq(conn, mbuf, th);
         tcp_in_add_toa(conn, mbuf, th);
+        th = tcp_hdr(mbuf);
     }
 
     /* add toa to first data packet */
     if (ntohl(th->ack_seq) == conn->fnat_seq.fdata_seq
-            && !th->syn && !th->rst && !th->fin)
+            && !th->syn && !th->rst && !th->fin) {
         tcp_in_add_toa(conn, mbuf, th);
+        /* headers may be moved into headroom */
+        th = tcp_hdr(mbuf);
+    }
 
     tcp_in_adjust_seq(conn, th);
 
@@ -722,13 +1013,14 @@ static int tcp_fnat_in_handler(struct dp_vs_proto *proto,
     th->dest    = conn->dport;
 
 
-    return tcp_send_csum(af, iphdrlen, th, conn, mbuf);
+    return tcp_send_csum(af, iphdrlen, th, conn, mbuf, osum);
 }
 
 static int tcp_fnat_out_handler(struct dp_vs_proto *proto,
                         struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
 {
     struct tcphdr *th;
+    uint32_t osum;
     /* af/mbuf may be changed for nat64 which in af is ipv6 and out is ipv4*/
     int af = tuplehash_in(conn).af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
@@ -743,6 +1035,8 @@ static int tcp_fnat_out_handler(struct dp_vs_proto *proto,
     if (mbuf_may_pull(mbuf, iphdrlen + (th->doff<<2)) != 0)
         return EDPVS_INVPKT;
 
+    osum = tcp_csum_orig(af, iphdrlen, &tuplehash_out(conn), th, mbuf);
+
     /* save last seq/ack from RS for RST when conn expire */
     tcp_out_save_seq(mbuf, conn, th);
 
@@ -760,13 +1054,14 @@ static int tcp_fnat_out_handler(struct dp_vs_proto *proto,
     if (th->syn && th->ack)
         tcp_out_init_seq(conn, th);
 
-    return tcp_send_csum(af, iphdrlen, th, conn, mbuf);
+    return tcp_send_csum(af, iphdrlen, th, conn, mbuf, osum);
 }
 
 static int tcp_snat_in_handler(struct dp_vs_proto *proto,
                                struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
 {
     struct tcphdr *th;
+    uint32_t osum;
     int af = conn->af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
 
@@ -780,17 +1075,20 @@ static int tcp_snat_in_handler(struct dp_vs_proto *proto,
     if (mbuf_may_pull(mbuf, iphdrlen + (th->doff << 2)) != 0)
         return EDPVS_INVPKT;
 
+    osum = tcp_csum_orig(af, iphdrlen, &tuplehash_in(conn), th, mbuf);
+
     /* L4 translation */
     th->dest = conn->dport;
 
     /* L4 re-checksum */
-    return tcp_send_csum(af, iphdrlen, th, conn, mbuf);
+    return tcp_send_csum(af, iphdrlen, th, conn, mbuf, osum);
 }
 
 static int tcp_snat_out_handler(struct dp_vs_proto *proto,
                                 struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
 {
     struct tcphdr *th;
+    uint32_t osum;
     int af = conn->af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
 
@@ -804,11 +1102,13 @@ static int tcp_snat_out_handler(struct dp_vs_proto *proto,
     if (mbuf_may_pull(mbuf, iphdrlen + (th->doff << 2)) != 0)
         return EDPVS_INVPKT;
 
+    osum = tcp_csum_orig(af, iphdrlen, &tuplehash_out(conn), th, mbuf);
+
     /* L4 translation */
     th->source = conn->vport;
 
     /* L4 re-checksum */
-    return tcp_send_csum(af, iphdrlen, th, conn, mbuf);
+    return tcp_send_csum(af, iphdrlen, th, conn, mbuf, osum);
 }
 
 static inline int tcp_state_idx(struct tcphdr *th)
@@ -857,7 +1157,8 @@ static int tcp_state_trans(struct dp_vs_proto *proto, struct dp_vs_conn *conn,
     th = mbuf_header_pointer(mbuf, iphdrlen, sizeof(_tcph), &_tcph);
     if (unlikely(!th))
         return EDPVS_INVPKT;
-    if (dest->fwdmode == DPVS_FWD_MODE_DR || dest->fwdmode == DPVS_FWD_MODE_TUNNEL)
+    if (dest->fwdmode == DPVS_FWD_MODE_DR || dest->fwdmode == DPVS_FWD_MODE_TUNNEL
+            || dest->fwdmode == DPVS_FWD_MODE_VXLAN)
         off = 8;
     else if (dir == DPVS_CONN_DIR_INBOUND)
         off = 0;
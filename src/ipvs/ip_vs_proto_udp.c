@@ -44,6 +44,7 @@ enum uoa_state {
 enum uoa_mode {
     UOA_M_OPP,      /* priave "option-protocol" (IPPROTO_OPT) with UOA */
     UOA_M_IPO,      /* add UOA as IPv4 Option field */
+    UOA_M_BATCH,    /* UOA of many conns in mapping datagrams per RS */
 };
 
 struct conn_uoa {
@@ -55,6 +56,54 @@ struct conn_uoa {
 static int g_uoa_max_trail = UOA_DEF_MAX_TRAIL; /* zero to disable UOA */
 static int g_uoa_mode = UOA_M_OPP; /* by default */
 
+/*
+ * batched UOA (UOA_M_BATCH), see uoa.h for the mapping datagram.
+ *
+ * UOA of new conns is queued per (LIP, RS) by each lcore, and a batch is
+ * sent in one datagram at the end of rx burst, ahead of the translated
+ * packets staged by fast-xmit, or at once if a packet of its conns goes
+ * by slow path. the conns' own packets carry no UOA, so
+ * fast-xmit is never disabled. a batch not acked in UOA_BATCH_RTO_MS is
+ * resent, up to uoa_max_trail times.
+ */
+#define UOA_BATCH_SLOTS     16
+#define UOA_BATCH_ENTS      32
+#define UOA_BATCH_RTO_MS    20
+
+/* identify the batch (lcore, slot) in ACK */
+#define UOA_BATCH_COOKIE(cid, idx)  (((uint32_t)(cid) << 8) | (idx))
+#define UOA_BATCH_COOKIE_CID(ck)    ((ck) >> 8)
+#define UOA_BATCH_COOKIE_IDX(ck)    ((ck) & 0xff)
+
+enum uoa_batch_state {
+    UOA_B_FREE      = 0,
+    UOA_B_FILLING,
+    UOA_B_INFLIGHT,
+};
+
+struct uoa_batch {
+    uint8_t                 state;
+    uint8_t                 af;     /* of LIP and RS */
+    uint8_t                 sent;
+    uint8_t                 count;
+    uint32_t                seq;
+    volatile uint32_t       acked;  /* seq of ACK, set by any lcore */
+    __be16                  rport;
+    uint64_t                sent_tsc;
+    struct rte_mempool      *pool;
+    union inet_addr         laddr;
+    union inet_addr         raddr;
+    struct uoa_batch_ent    ents[UOA_BATCH_ENTS];
+};
+
+struct uoa_batch_stage {
+    uint32_t                seq;
+    uint16_t                nactive;    /* slots not free */
+    struct uoa_batch        batches[UOA_BATCH_SLOTS];
+} __rte_cache_aligned;
+
+static struct uoa_batch_stage uoa_batch_stages[DPVS_MAX_LCORE];
+
 int g_defence_udp_drop = 0;
 
 static int udp_timeouts[DPVS_UDP_S_LAST + 1] = {
@@ -75,9 +124,51 @@ inline void udp6_send_csum(struct ipv6_hdr *iph, struct udp_hdr *uh)
             (void *)uh - (void *)iph, IPPROTO_UDP);
 }
 
+/*
+ * raw sum of the words NAT may change in a UDP datagram, i.e., ports
+ * and pseudo-header addresses. taken before and after translation,
+ * it gives the RFC 1624 update of the checksum without the payload.
+ */
+static inline uint32_t udp_csum_partial(int af, const union inet_addr *saddr,
+                                        const union inet_addr *daddr,
+                                        const struct udp_hdr *uh)
+{
+    return (uint32_t)uh->src_port + uh->dst_port +
+           inet_addr_csum(af, saddr) + inet_addr_csum(af, daddr);
+}
+
+/* @tuple is what the packet matched, i.e., the original addresses */
+static inline uint32_t udp_csum_orig(const struct conn_tuple_hash *tuple,
+                                     const struct udp_hdr *uh)
+{
+    return udp_csum_partial(tuple->af, &tuple->saddr, &tuple->daddr, uh);
+}
+
+static inline uint32_t udp_csum_curr(int af, const struct udp_hdr *uh,
+                                     struct rte_mbuf *mbuf)
+{
+    if (AF_INET6 == af) {
+        struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+
+        return udp_csum_partial(af, (union inet_addr *)&ip6h->ip6_src,
+                                (union inet_addr *)&ip6h->ip6_dst, uh);
+    } else {
+        struct ipv4_hdr *iph = ip4_hdr(mbuf);
+
+        return udp_csum_partial(af, (union inet_addr *)&iph->src_addr,
+                                (union inet_addr *)&iph->dst_addr, uh);
+    }
+}
+
+/*
+ * @osum: udp_csum_orig() of the datagram, taken before L4 translation.
+ * without HW offload, the checksum is updated incrementally from @osum,
+ * unless the original datagram has none (zero) and IPv6 requires one.
+ */
 static inline int udp_send_csum(int af, int iphdrlen, struct udp_hdr *uh,
                                 const struct dp_vs_conn *conn,
-                                struct rte_mbuf *mbuf, const struct opphdr *opp)
+                                struct rte_mbuf *mbuf, const struct opphdr *opp,
+                                uint32_t osum)
 {
     /* leverage HW TX UDP csum offload if possible */
 
@@ -100,7 +191,13 @@ static inline int udp_send_csum(int af, int iphdrlen, struct udp_hdr *uh,
                 mbuf->ol_flags |= (PKT_TX_UDP_CKSUM | PKT_TX_IPV6);
                 uh->dgram_cksum = ip6_phdr_cksum(ip6h, mbuf->ol_flags,
                         iphdrlen, IPPROTO_UDP);
+            } else if (likely(uh->dgram_cksum != 0)) {
+                uh->dgram_cksum = inet_csum_update(uh->dgram_cksum, osum,
+                                                   udp_csum_curr(af, uh, mbuf));
+                if (uh->dgram_cksum == 0)
+                    uh->dgram_cksum = 0xffff;
             } else {
+                /* no checksum from IPv4 (nat46) */
                 if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
                     return EDPVS_INVPKT;
                 udp6_send_csum((struct ipv6_hdr*)ip6h, uh);
@@ -132,16 +229,303 @@ static inline int udp_send_csum(int af, int iphdrlen, struct udp_hdr *uh,
                 mbuf->l4_len = ntohs(iph->total_length) - iphdrlen;
                 mbuf->ol_flags |= (PKT_TX_UDP_CKSUM | PKT_TX_IP_CKSUM | PKT_TX_IPV4);
                 uh->dgram_cksum = ip4_phdr_cksum(iph, mbuf->ol_flags);
-            } else {
-                if (mbuf_may_pull(mbuf, mbuf->pkt_len) != 0)
-                    return EDPVS_INVPKT;
-                udp4_send_csum(iph, uh);
+            } else if (likely(uh->dgram_cksum != 0)) {
+                uh->dgram_cksum = inet_csum_update(uh->dgram_cksum, osum,
+                                                   udp_csum_curr(af, uh, mbuf));
+                if (uh->dgram_cksum == 0)
+                    uh->dgram_cksum = 0xffff;
             }
+            /* else: no checksum, and none is needed */
         }
     }
     return EDPVS_OK;
 }
 
+static int uoa_batch_xmit(lcoreid_t cid, int idx, struct uoa_batch *b)
+{
+    struct rte_mbuf *mbuf;
+    struct opphdr *opp;
+    struct uoa_batch_hdr *bh;
+    int len = sizeof(*opp) + sizeof(*bh) +
+              b->count * sizeof(struct uoa_batch_ent);
+
+    b->sent++;
+    b->sent_tsc = rte_get_timer_cycles();
+
+    mbuf = rte_pktmbuf_alloc(b->pool);
+    if (unlikely(!mbuf))
+        return EDPVS_NOMEM;
+
+    opp = (struct opphdr *)rte_pktmbuf_append(mbuf, len);
+    if (unlikely(!opp)) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_NOROOM;
+    }
+
+    memset(opp, 0, sizeof(*opp));
+    opp->version  = (AF_INET6 == b->af) ? OPPHDR_IPV6 : OPPHDR_IPV4;
+    opp->protocol = IPPROTO_NONE;
+    opp->length   = htons(sizeof(*opp));
+
+    bh = (struct uoa_batch_hdr *)(opp + 1);
+    bh->flags  = 0;
+    bh->count  = b->count;
+    bh->rport  = b->rport;
+    bh->seq    = htonl(b->seq);
+    bh->cookie = htonl(UOA_BATCH_COOKIE(cid, idx));
+    rte_memcpy(bh + 1, b->ents, b->count * sizeof(struct uoa_batch_ent));
+
+    if (AF_INET6 == b->af) {
+        struct flow6 fl6;
+
+        memset(&fl6, 0, sizeof(fl6));
+        fl6.fl6_saddr = b->laddr.in6;
+        fl6.fl6_daddr = b->raddr.in6;
+        fl6.fl6_proto = IPPROTO_OPT;
+        return ipv6_xmit(mbuf, &fl6);
+    } else {
+        struct flow4 fl4;
+
+        memset(&fl4, 0, sizeof(fl4));
+        fl4.fl4_saddr = b->laddr.in;
+        fl4.fl4_daddr = b->raddr.in;
+        fl4.fl4_proto = IPPROTO_OPT;
+        return ipv4_xmit(mbuf, &fl4);
+    }
+}
+
+static inline void uoa_batch_release(struct uoa_batch_stage *stage,
+                                     struct uoa_batch *b)
+{
+    b->state = UOA_B_FREE;
+    stage->nactive--;
+}
+
+/*
+ * send the filling batches and resend or reap the inflight ones.
+ * called at the end of each rx burst, before fast-xmit staged packets
+ * are flushed, so RS may get the UOA before the flows' packets.
+ */
+void udp_uoa_batch_flush(lcoreid_t cid)
+{
+    struct uoa_batch_stage *stage = &uoa_batch_stages[cid];
+    struct uoa_batch *b;
+    uint64_t now, rto;
+    int i, err;
+
+    if (likely(!stage->nactive))
+        return;
+
+    now = rte_get_timer_cycles();
+    rto = rte_get_timer_hz() * UOA_BATCH_RTO_MS / 1000;
+
+    for (i = 0; i < UOA_BATCH_SLOTS; i++) {
+        b = &stage->batches[i];
+
+        switch (b->state) {
+        case UOA_B_FILLING:
+            b->state = UOA_B_INFLIGHT;
+            break;
+
+        case UOA_B_INFLIGHT:
+            if (b->acked == b->seq) {
+                uoa_batch_release(stage, b);
+                continue;
+            }
+            if (now - b->sent_tsc < rto)
+                continue;
+            if (b->sent >= g_uoa_max_trail) {
+                RTE_LOG(DEBUG, IPVS, "%s: UOA batch %u not acked\n",
+                        __func__, b->seq);
+                uoa_batch_release(stage, b);
+                continue;
+            }
+            break;
+
+        default:
+            continue;
+        }
+
+        err = uoa_batch_xmit(cid, i, b);
+        if (err != EDPVS_OK)
+            RTE_LOG(DEBUG, IPVS, "%s: fail to send UOA batch: %s\n",
+                    __func__, dpvs_strerror(err));
+    }
+}
+
+/* slot for new batch, the oldest inflight one is given up if none free */
+static struct uoa_batch *uoa_batch_get(lcoreid_t cid)
+{
+    struct uoa_batch_stage *stage = &uoa_batch_stages[cid];
+    struct uoa_batch *b, *old = NULL;
+    int i;
+
+    if (stage->nactive == UOA_BATCH_SLOTS)
+        udp_uoa_batch_flush(cid);
+
+    for (i = 0; i < UOA_BATCH_SLOTS; i++) {
+        b = &stage->batches[i];
+        if (b->state == UOA_B_FREE)
+            goto found;
+        if (b->state == UOA_B_INFLIGHT &&
+                (!old || (int64_t)(b->sent_tsc - old->sent_tsc) < 0))
+            old = b;
+    }
+
+    /* all filling slots were sent by flush */
+    assert(old);
+    RTE_LOG(DEBUG, IPVS, "%s: UOA batch %u given up\n", __func__, old->seq);
+    uoa_batch_release(stage, old);
+    b = old;
+
+found:
+    b->state = UOA_B_FILLING;
+    b->sent  = 0;
+    b->count = 0;
+    b->acked = 0;
+    if (unlikely(++stage->seq == 0))
+        stage->seq = 1;
+    b->seq   = stage->seq;
+    stage->nactive++;
+
+    return b;
+}
+
+/* queue UOA of new @conn to the batch of its (LIP, RS) */
+static void uoa_batch_add(struct dp_vs_conn *conn, struct rte_mempool *pool)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct uoa_batch_stage *stage = &uoa_batch_stages[cid];
+    int af = tuplehash_out(conn).af;
+    struct uoa_batch_ent *ent;
+    struct uoa_batch *b;
+    int i;
+
+    for (i = 0; i < UOA_BATCH_SLOTS; i++) {
+        b = &stage->batches[i];
+        if (b->state == UOA_B_FILLING && b->af == af
+                && b->rport == conn->dport
+                && inet_addr_equal(af, &b->laddr, &conn->laddr)
+                && inet_addr_equal(af, &b->raddr, &conn->daddr))
+            goto found;
+    }
+
+    b = uoa_batch_get(cid);
+    b->af    = af;
+    b->rport = conn->dport;
+    b->laddr = conn->laddr;
+    b->raddr = conn->daddr;
+    b->pool  = pool;
+    i = b - stage->batches;
+
+found:
+    ent = &b->ents[b->count++];
+    memset(ent, 0, sizeof(*ent));
+    ent->lport     = conn->lport;
+    ent->real_port = conn->cport;
+    if (AF_INET6 == tuplehash_in(conn).af) {
+        ent->real_af = OPPHDR_IPV6;
+        memcpy(ent->real_addr, &conn->caddr.in6, IPV6_ADDR_LEN_IN_BYTES);
+    } else {
+        ent->real_af = OPPHDR_IPV4;
+        memcpy(ent->real_addr, &conn->caddr.in, IPV4_ADDR_LEN_IN_BYTES);
+    }
+
+    /* full, no need to wait for the burst end */
+    if (b->count == UOA_BATCH_ENTS) {
+        b->state = UOA_B_INFLIGHT;
+        uoa_batch_xmit(cid, i, b);
+    }
+}
+
+/*
+ * send the filling batch holding UOA of @conn at once. packets going out
+ * by slow path are not held to the burst end, so the first packet of a
+ * new conn would overtake its mapping otherwise.
+ */
+void udp_uoa_batch_kick(struct dp_vs_conn *conn)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct uoa_batch_stage *stage = &uoa_batch_stages[cid];
+    int af = tuplehash_out(conn).af;
+    struct uoa_batch *b;
+    int i, j;
+
+    if (g_uoa_mode != UOA_M_BATCH || likely(!stage->nactive))
+        return;
+
+    for (i = 0; i < UOA_BATCH_SLOTS; i++) {
+        b = &stage->batches[i];
+        if (b->state != UOA_B_FILLING || b->af != af
+                || b->rport != conn->dport
+                || !inet_addr_equal(af, &b->laddr, &conn->laddr)
+                || !inet_addr_equal(af, &b->raddr, &conn->daddr))
+            continue;
+
+        for (j = 0; j < b->count; j++) {
+            if (b->ents[j].lport == conn->lport) {
+                b->state = UOA_B_INFLIGHT;
+                uoa_batch_xmit(cid, i, b);
+                return;
+            }
+        }
+        return;
+    }
+}
+
+/*
+ * ACK of mapping datagram from RS, may be on any lcore. other IPPROTO_OPT
+ * packets to local addresses are not ours, leave them to KNI.
+ */
+static int uoa_batch_ack_rcv(struct rte_mbuf *mbuf)
+{
+    struct opphdr *opp;
+    struct uoa_batch_hdr *bh;
+    struct uoa_batch *b;
+    uint32_t cookie;
+    lcoreid_t cid;
+    int idx;
+
+    if (g_uoa_mode != UOA_M_BATCH)
+        return EDPVS_KNICONTINUE;
+
+    if (mbuf_may_pull(mbuf, sizeof(*opp)) != 0)
+        return EDPVS_KNICONTINUE;
+    opp = rte_pktmbuf_mtod(mbuf, struct opphdr *);
+    if (opp->protocol != IPPROTO_NONE)
+        return EDPVS_KNICONTINUE;
+
+    if (mbuf_may_pull(mbuf, ntohs(opp->length) + sizeof(*bh)) != 0)
+        return EDPVS_KNICONTINUE;
+    bh = rte_pktmbuf_mtod_offset(mbuf, struct uoa_batch_hdr *,
+                                 ntohs(opp->length));
+    if (!(bh->flags & UOA_BATCH_F_ACK))
+        return EDPVS_KNICONTINUE;
+
+    cookie = ntohl(bh->cookie);
+    cid = UOA_BATCH_COOKIE_CID(cookie);
+    idx = UOA_BATCH_COOKIE_IDX(cookie);
+    if (cid >= DPVS_MAX_LCORE || idx >= UOA_BATCH_SLOTS)
+        goto drop;
+
+    /* owner lcore checks it against seq, a stale ACK never matches */
+    b = &uoa_batch_stages[cid].batches[idx];
+    b->acked = ntohl(bh->seq);
+
+drop:
+    rte_pktmbuf_free(mbuf);
+    return EDPVS_OK;
+}
+
+static struct inet_protocol uoa_batch_ack_proto = {
+    .handler    = uoa_batch_ack_rcv,
+};
+
+static struct inet6_protocol uoa_batch_ack_proto6 = {
+    .handler    = uoa_batch_ack_rcv,
+    .flags      = INET6_PROTO_F_FINAL,
+};
+
 static int udp_conn_sched(struct dp_vs_proto *proto,
                         const struct dp_vs_iphdr *iph,
                         struct rte_mbuf *mbuf,
@@ -174,7 +558,11 @@ static int udp_conn_sched(struct dp_vs_proto *proto,
         return EDPVS_RESOURCE;
     }
 
-    if ((*conn)->dest->fwdmode == DPVS_FWD_MODE_FNAT && g_uoa_max_trail > 0) {
+    if ((*conn)->dest->fwdmode == DPVS_FWD_MODE_FNAT && g_uoa_max_trail > 0
+            && g_uoa_mode == UOA_M_BATCH) {
+        uoa_batch_add(*conn, mbuf->pool);
+    } else if ((*conn)->dest->fwdmode == DPVS_FWD_MODE_FNAT
+            && g_uoa_max_trail > 0) {
         struct conn_uoa *uoa;
 
         (*conn)->prot_data = rte_zmalloc(NULL, sizeof(struct conn_uoa), 0);
@@ -229,14 +617,9 @@ udp_conn_lookup(struct dp_vs_proto *proto,
             neigh_confirm(tuplehash_out(conn).af, &conn->in_nexthop, conn->in_dev);
         }
     } else {
-        struct dp_vs_redirect *r;
-
-        r = dp_vs_redirect_get(iph->af, iph->proto,
-                               &iph->saddr, &iph->daddr,
-                               uh->src_port, uh->dst_port);
-        if (r) {
-            *peer_cid = r->cid;
-        }
+        dp_vs_redirect_get(iph->af, iph->proto,
+                           &iph->saddr, &iph->daddr,
+                           uh->src_port, uh->dst_port, peer_cid);
     }
 
     return conn;
@@ -406,6 +789,7 @@ static int insert_ipopt_uoa(struct dp_vs_conn *conn, struct rte_mbuf *mbuf,
 {
     struct iphdr *niph = NULL;
     struct ipopt_uoa *optuoa;
+    uint16_t ver_ihl;
 
     assert(AF_INET == tuplehash_in(conn).af && AF_INET == tuplehash_out(conn).af);
     if ((ip4_hdrlen(mbuf) + sizeof(struct ipopt_uoa) >
@@ -449,9 +833,15 @@ static int insert_ipopt_uoa(struct dp_vs_conn *conn, struct rte_mbuf *mbuf,
     optuoa->op_port = uh->source;
     memcpy(&optuoa->op_addr, &niph->saddr, IPV4_ADDR_LEN_IN_BYTES);
 
+    /* update IP checksum for the new option, IHL and total length,
+     * UDP checksum is not affected. */
+    ver_ihl = *(uint16_t *)niph;
     niph->ihl += IPOLEN_UOA_IPV4 / 4;
-    niph->tot_len = htons(ntohs(niph->tot_len) + IPOLEN_UOA_IPV4);
-    /* UDP/IP checksum will recalc later*/
+    inet_csum_replace2(&niph->check, ver_ihl, *(uint16_t *)niph);
+    niph->check = inet_csum_update(niph->check, 0,
+                            __rte_raw_cksum(optuoa, IPOLEN_UOA_IPV4, 0));
+    ip4_set_tot_len((struct ipv4_hdr *)niph,
+                    htons(ntohs(niph->tot_len) + IPOLEN_UOA_IPV4));
 
     return EDPVS_OK;
 
@@ -568,12 +958,16 @@ static int insert_opp_uoa(struct dp_vs_conn *conn, struct rte_mbuf *mbuf,
                     htons(ntohs(((struct ip6_hdr *)niph)->ip6_plen) +
                     sizeof(*opph) + ipolen_uoa);
     } else {
+        /* TTL and protocol share a checksum word */
+        uint16_t *ttl_proto = (uint16_t *)&((struct ipv4_hdr *)niph)->time_to_live;
+        uint16_t old = *ttl_proto;
+
         memcpy(&uoa->op_addr, &((struct iphdr *)niph)->saddr,
                                                     IPV4_ADDR_LEN_IN_BYTES);
         ((struct iphdr *)niph)->protocol = IPPROTO_OPT;
-        /* UDP/IP checksum will recalc later*/
-        ((struct iphdr *)niph)->tot_len =
-                               htons(iptot_len + sizeof(*opph) + ipolen_uoa);
+        inet_csum_replace2(&((struct iphdr *)niph)->check, old, *ttl_proto);
+        ip4_set_tot_len((struct ipv4_hdr *)niph,
+                        htons(iptot_len + sizeof(*opph) + ipolen_uoa));
     }
 
     return EDPVS_OK;
@@ -665,6 +1059,7 @@ static int udp_fnat_in_handler(struct dp_vs_proto *proto,
 {
     struct udp_hdr *uh = NULL;
     struct opphdr *opp = NULL;
+    uint32_t osum;
     void *iph = NULL;
     /* af/mbuf may be changed for nat64 which in af is ipv6 and out is ipv4 */
     int af = tuplehash_out(conn).af;
@@ -698,10 +1093,12 @@ static int udp_fnat_in_handler(struct dp_vs_proto *proto,
     if (unlikely(!uh))
         return EDPVS_INVPKT;
 
+    osum = udp_csum_orig(&tuplehash_in(conn), uh);
+
     uh->src_port = conn->lport;
     uh->dst_port = conn->dport;
 
-    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, opp);
+    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, opp, osum);
 }
 
 static int udp_fnat_out_handler(struct dp_vs_proto *proto,
@@ -709,6 +1106,7 @@ static int udp_fnat_out_handler(struct dp_vs_proto *proto,
                     struct rte_mbuf *mbuf)
 {
     struct udp_hdr *uh;
+    uint32_t osum;
     /* af/mbuf may be changed for nat64 which in af is ipv6 and out is ipv4 */
     int af = tuplehash_in(conn).af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
@@ -720,10 +1118,12 @@ static int udp_fnat_out_handler(struct dp_vs_proto *proto,
     if (unlikely(!uh))
         return EDPVS_INVPKT;
 
+    osum = udp_csum_orig(&tuplehash_out(conn), uh);
+
     uh->src_port = conn->vport;
     uh->dst_port = conn->cport;
 
-    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, NULL);
+    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, NULL, osum);
 }
 
 static int udp_fnat_in_pre_handler(struct dp_vs_proto *proto,
@@ -743,6 +1143,7 @@ static int udp_snat_in_handler(struct dp_vs_proto *proto,
                     struct rte_mbuf *mbuf)
 {
     struct udp_hdr *uh;
+    uint32_t osum;
     int af = conn->af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
 
@@ -753,9 +1154,11 @@ static int udp_snat_in_handler(struct dp_vs_proto *proto,
     if (unlikely(!uh))
         return EDPVS_INVPKT;
 
+    osum = udp_csum_orig(&tuplehash_in(conn), uh);
+
     uh->dst_port = conn->dport;
 
-    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, NULL);
+    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, NULL, osum);
 }
 
 static int udp_snat_out_handler(struct dp_vs_proto *proto,
@@ -763,6 +1166,7 @@ static int udp_snat_out_handler(struct dp_vs_proto *proto,
                     struct rte_mbuf *mbuf)
 {
     struct udp_hdr *uh;
+    uint32_t osum;
     int af = conn->af;
     int iphdrlen = ((AF_INET6 == af) ? ip6_hdrlen(mbuf): ip4_hdrlen(mbuf));
 
@@ -773,14 +1177,42 @@ static int udp_snat_out_handler(struct dp_vs_proto *proto,
     if (unlikely(!uh))
         return EDPVS_INVPKT;
 
+    osum = udp_csum_orig(&tuplehash_out(conn), uh);
+
     uh->src_port = conn->vport;
 
-    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, NULL);
+    return udp_send_csum(af, iphdrlen, uh, conn, mbuf, NULL, osum);
+}
+
+static int udp_init(struct dp_vs_proto *proto)
+{
+    int err;
+
+    err = ipv4_register_protocol(&uoa_batch_ack_proto, IPPROTO_OPT);
+    if (err != EDPVS_OK)
+        return err;
+
+    err = ipv6_register_protocol(&uoa_batch_ack_proto6, IPPROTO_OPT);
+    if (err != EDPVS_OK) {
+        ipv4_unregister_protocol(&uoa_batch_ack_proto, IPPROTO_OPT);
+        return err;
+    }
+
+    return EDPVS_OK;
+}
+
+static int udp_exit(struct dp_vs_proto *proto)
+{
+    ipv6_unregister_protocol(&uoa_batch_ack_proto6, IPPROTO_OPT);
+    ipv4_unregister_protocol(&uoa_batch_ack_proto, IPPROTO_OPT);
+    return EDPVS_OK;
 }
 
 struct dp_vs_proto dp_vs_proto_udp = {
     .name               = "UDP",
     .proto              = IPPROTO_UDP,
+    .init               = udp_init,
+    .exit               = udp_exit,
     .conn_sched         = udp_conn_sched,
     .conn_lookup        = udp_conn_lookup,
     .conn_expire        = udp_conn_expire,
@@ -828,6 +1260,8 @@ static void uoa_mode_handler(vector_t tokens)
         g_uoa_mode = UOA_M_OPP;
     else if (strcmp(str, "ipo") == 0)
         g_uoa_mode = UOA_M_IPO;
+    else if (strcmp(str, "batch") == 0)
+        g_uoa_mode = UOA_M_BATCH;
     else
         RTE_LOG(WARNING, IPVS, "invalid uoa_mode: %s\n", str);
 
@@ -23,13 +23,53 @@
 #define DPVS_CR_TBL_SIZE   (1 << DPVS_CR_TBL_BITS)
 #define DPVS_CR_TBL_MASK   (DPVS_CR_TBL_SIZE - 1)
 
+/*
+ * the redirect table is read by all workers for every packet missing the
+ * local conn table, while it's only changed on conn (un)hash. buckets are
+ * striped to seqcounts, readers never write shared memory and retry if a
+ * writer touched the stripe meanwhile. writers are serialized by the
+ * stripe lock. it's safe for readers to step on entries being freed since
+ * they come from mempool and are never unmapped.
+ */
+#define DPVS_CR_LOCK_BITS  16
+#define DPVS_CR_LOCK_SIZE  (1 << DPVS_CR_LOCK_BITS)
+#define DPVS_CR_LOCK_MASK  (DPVS_CR_LOCK_SIZE - 1)
+
+struct dp_vs_cr_stripe {
+    rte_spinlock_t         lock;    /* writers only */
+    volatile uint32_t      seq;     /* odd while writing */
+};
+
 static struct list_head   *dp_vs_cr_tbl;
-static rte_spinlock_t      dp_vs_cr_lock[DPVS_CR_TBL_SIZE];
+static struct dp_vs_cr_stripe dp_vs_cr_stripes[DPVS_CR_LOCK_SIZE];
 static struct rte_mempool *dp_vs_cr_cache[DPVS_MAX_SOCKET];
 #define this_cr_cache      (dp_vs_cr_cache[rte_socket_id()])
 
 static struct rte_ring    *dp_vs_redirect_ring[DPVS_MAX_LCORE][DPVS_MAX_LCORE];
 
+/*
+ * packets to redirect are staged per peer and flushed by burst at the end
+ * of each rx loop, see dp_vs_redirect_ring_flush(). the owner of the
+ * receiving rings is told which of them are not empty by a bitmap, so it
+ * doesn't poll all the peers.
+ */
+struct dp_vs_redirect_stage {
+    uint16_t             len;
+    struct rte_mbuf     *mbufs[NETIF_MAX_PKT_BURST];
+};
+
+struct dp_vs_redirect_pending {
+    volatile uint64_t    mask;      /* bit of each non-empty ring[cid][peer] */
+} __rte_cache_aligned;
+
+static struct dp_vs_redirect_stage *dp_vs_redirect_stages[DPVS_MAX_LCORE];
+static uint64_t            dp_vs_redirect_stage_mask[DPVS_MAX_LCORE];
+static struct dp_vs_redirect_pending dp_vs_redirect_pending[DPVS_MAX_LCORE];
+
+/* worker lcores owning IPv4 reassembly, see dp_vs_redirect_frag_lcore() */
+static lcoreid_t           dp_vs_frag_lcores[DPVS_MAX_LCORE];
+static uint8_t             dp_vs_frag_lcore_nb;
+
 #ifdef CONFIG_DPVS_IPVS_DEBUG
 static inline void
 dp_vs_redirect_show(struct dp_vs_redirect *r, const char *action)
@@ -96,23 +136,59 @@ void dp_vs_redirect_free(struct dp_vs_conn *conn)
     }
 }
 
+static inline void dp_vs_cr_write_lock(struct dp_vs_cr_stripe *s)
+{
+    rte_spinlock_lock(&s->lock);
+    s->seq++;
+    rte_smp_wmb();
+}
+
+static inline void dp_vs_cr_write_unlock(struct dp_vs_cr_stripe *s)
+{
+    rte_smp_wmb();
+    s->seq++;
+    rte_spinlock_unlock(&s->lock);
+}
+
+static inline uint32_t dp_vs_cr_read_begin(const struct dp_vs_cr_stripe *s)
+{
+    uint32_t seq;
+
+    while (unlikely((seq = s->seq) & 1)) {
+        rte_pause();
+    }
+    rte_smp_rmb();
+
+    return seq;
+}
+
+static inline bool dp_vs_cr_read_retry(const struct dp_vs_cr_stripe *s,
+                                       uint32_t seq)
+{
+    rte_smp_rmb();
+    return s->seq != seq;
+}
+
 void dp_vs_redirect_hash(struct dp_vs_conn *conn)
 {
     uint32_t hash;
     struct dp_vs_redirect *r = conn->redirect;
+    struct dp_vs_cr_stripe *s;
 
     if (!r || unlikely(dp_vs_conn_is_redirect_hashed(conn))) {
         return;
     }
 
+    /* same key as unhash and lookup, it's tuplehash_in for SNAT */
     hash = dp_vs_conn_hashkey(r->af,
-                    &tuplehash_out(conn).saddr, tuplehash_out(conn).sport,
-                    &tuplehash_out(conn).daddr, tuplehash_out(conn).dport,
-                    DPVS_CR_TBL_MASK);
+                              &r->saddr, r->sport,
+                              &r->daddr, r->dport,
+                              DPVS_CR_TBL_MASK);
+    s = &dp_vs_cr_stripes[hash & DPVS_CR_LOCK_MASK];
 
-    rte_spinlock_lock(&dp_vs_cr_lock[hash]);
+    dp_vs_cr_write_lock(s);
     list_add(&r->list, &dp_vs_cr_tbl[hash]);
-    rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
+    dp_vs_cr_write_unlock(s);
 
     dp_vs_conn_set_redirect_hashed(conn);
 }
@@ -121,6 +197,7 @@ void dp_vs_redirect_unhash(struct dp_vs_conn *conn)
 {
     uint32_t hash;
     struct dp_vs_redirect *r = conn->redirect;
+    struct dp_vs_cr_stripe *s;
 
     if (r && likely(dp_vs_conn_is_redirect_hashed(conn))) {
         hash = dp_vs_conn_hashkey(r->af,
@@ -128,9 +205,11 @@ void dp_vs_redirect_unhash(struct dp_vs_conn *conn)
                                   &r->daddr, r->dport,
                                   DPVS_CR_TBL_MASK);
 
-        rte_spinlock_lock(&dp_vs_cr_lock[hash]);
+        s = &dp_vs_cr_stripes[hash & DPVS_CR_LOCK_MASK];
+
+        dp_vs_cr_write_lock(s);
         list_del(&r->list);
-        rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
+        dp_vs_cr_write_unlock(s);
 
         dp_vs_conn_clear_redirect_hashed(conn);
     }
@@ -181,75 +260,150 @@ void dp_vs_redirect_init(struct dp_vs_conn *conn)
  *
  *  <af, proto, saddr, sport, daddr, dport>.
  *
- * return r if found or NULL if not exist.
+ * return EDPVS_OK and set @cid to the redirect owner core if found,
+ * or EDPVS_NOTEXIST if not exist.
  */
-struct dp_vs_redirect *
-dp_vs_redirect_get(int af, uint16_t proto,
+int dp_vs_redirect_get(int af, uint16_t proto,
     const union inet_addr *saddr, const union inet_addr *daddr,
-    uint16_t sport, uint16_t dport)
+    uint16_t sport, uint16_t dport, lcoreid_t *cid)
 {
-    uint32_t hash;
+    uint32_t hash, seq;
     struct dp_vs_redirect *r;
+    struct list_head *head, *pos, *next;
+    const struct dp_vs_cr_stripe *s;
+    lcoreid_t owner;
+    bool match;
 
     if (dp_vs_redirect_disable) {
-        return NULL;
+        return EDPVS_NOTEXIST;
     }
 
     hash = dp_vs_conn_hashkey(af, saddr, sport, daddr, dport, DPVS_CR_TBL_MASK);
+    head = &dp_vs_cr_tbl[hash];
+    s = &dp_vs_cr_stripes[hash & DPVS_CR_LOCK_MASK];
+
+again:
+    seq = dp_vs_cr_read_begin(s);
 
-    rte_spinlock_lock(&dp_vs_cr_lock[hash]);
-    list_for_each_entry(r, &dp_vs_cr_tbl[hash], list) {
-        if (r->af == af
-            && r->proto == proto
-            && r->sport == sport
-            && r->dport == dport
-            && inet_addr_equal(af, &r->saddr, saddr)
-            && inet_addr_equal(af, &r->daddr, daddr)) {
-            goto found;
+    /* every pointer is validated by seq before it's dereferenced */
+    next = head->next;
+    if (dp_vs_cr_read_retry(s, seq)) {
+        goto again;
+    }
+
+    for (pos = next; pos != head; pos = next) {
+        r = list_entry(pos, struct dp_vs_redirect, list);
+        match = (r->af == af
+                 && r->proto == proto
+                 && r->sport == sport
+                 && r->dport == dport
+                 && inet_addr_equal(af, &r->saddr, saddr)
+                 && inet_addr_equal(af, &r->daddr, daddr));
+        owner = r->cid;
+        next = pos->next;
+
+        if (dp_vs_cr_read_retry(s, seq)) {
+            goto again;
+        }
+
+        if (match) {
+#ifdef CONFIG_DPVS_IPVS_DEBUG
+            dp_vs_redirect_show(r, "get");
+#endif
+            *cid = owner;
+            return EDPVS_OK;
         }
     }
-    rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
 
-    return NULL;
+    return EDPVS_NOTEXIST;
+}
 
-found:
-    rte_spinlock_unlock(&dp_vs_cr_lock[hash]);
+/* enqueue staged mbufs to the peer ring by burst, drop those not fit. */
+static void dp_vs_redirect_stage_flush(lcoreid_t cid, lcoreid_t peer_cid)
+{
+    struct dp_vs_redirect_stage *stage = &dp_vs_redirect_stages[cid][peer_cid];
+    struct dp_vs_redirect_pending *pending = &dp_vs_redirect_pending[peer_cid];
+    uint64_t bit = 1ULL << cid;
+    unsigned int n, i;
+
+    n = rte_ring_enqueue_burst(dp_vs_redirect_ring[peer_cid][cid],
+                               (void **)stage->mbufs, stage->len, NULL);
+    if (likely(n > 0)) {
+        /* make the ring tail visible before checking the bitmap,
+         * or the peer may clear the bit without seeing the mbufs. */
+        rte_smp_mb();
+        if (!(pending->mask & bit)) {
+            __sync_fetch_and_or(&pending->mask, bit);
+        }
+    }
+
+    if (unlikely(n < stage->len)) {
+        RTE_LOG(ERR, IPVS,
+                "%s: [%d] failed to enqueue %d mbufs to redirect_ring[%d][%d]\n",
+                __func__, cid, stage->len - n, peer_cid, cid);
+        for (i = n; i < stage->len; i++) {
+            rte_pktmbuf_free(stage->mbufs[i]);
+        }
+    }
 
 #ifdef CONFIG_DPVS_IPVS_DEBUG
-    dp_vs_redirect_show(r, "get");
+    RTE_LOG(DEBUG, IPVS,
+            "%s: [%d] enqueued %d mbufs to redirect_ring[%d][%d]\n",
+            __func__, cid, n, peer_cid, cid);
 #endif
 
-    return r;
+    stage->len = 0;
+    dp_vs_redirect_stage_mask[cid] &= ~(1ULL << peer_cid);
 }
 
 /**
  * Forward the packet to the found redirect owner core.
+ *
+ * The packet is staged and enqueued with others to the same peer,
+ * when the staging buffer is full or at the end of the rx loop.
  */
 int dp_vs_redirect_pkt(struct rte_mbuf *mbuf, lcoreid_t peer_cid)
 {
     lcoreid_t cid = rte_lcore_id();
-    int ret;
+    struct dp_vs_redirect_stage *stage;
 
-    ret = rte_ring_enqueue(dp_vs_redirect_ring[peer_cid][cid], mbuf);
-    if (ret < 0) {
-        RTE_LOG(ERR, IPVS,
-                "%s: [%d] failed to enqueue mbuf to redirect_ring[%d][%d]\n",
-                __func__, cid, peer_cid, cid);
+    if (unlikely(!dp_vs_redirect_stages[cid] ||
+                 !dp_vs_redirect_ring[peer_cid][cid])) {
         return INET_DROP;
     }
 
-#ifdef CONFIG_DPVS_IPVS_DEBUG
-    RTE_LOG(DEBUG, IPVS,
-            "%s: [%d] enqueued mbuf to redirect_ring[%d][%d]\n",
-            __func__, cid, peer_cid, cid);
-#endif
+    stage = &dp_vs_redirect_stages[cid][peer_cid];
+    stage->mbufs[stage->len++] = mbuf;
+    dp_vs_redirect_stage_mask[cid] |= (1ULL << peer_cid);
+
+    if (stage->len >= NETIF_MAX_PKT_BURST) {
+        dp_vs_redirect_stage_flush(cid, peer_cid);
+    }
 
     return INET_STOLEN;
 }
 
+void dp_vs_redirect_ring_flush(lcoreid_t cid)
+{
+    uint64_t mask;
+
+    if (dp_vs_redirect_disable) {
+        return;
+    }
+
+    mask = dp_vs_redirect_stage_mask[cid];
+    while (mask) {
+        dp_vs_redirect_stage_flush(cid, __builtin_ctzll(mask));
+        mask &= mask - 1;
+    }
+}
+
 void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid)
 {
     struct rte_mbuf *mbufs[NETIF_MAX_PKT_BURST];
+    struct dp_vs_redirect_pending *pending;
+    struct rte_ring *ring;
+    uint64_t mask;
     uint16_t nb_rb;
     lcoreid_t peer_cid;
 
@@ -258,15 +412,65 @@ void dp_vs_redirect_ring_proc(struct netif_queue_conf *qconf, lcoreid_t cid)
     }
 
     cid = rte_lcore_id();
+    pending = &dp_vs_redirect_pending[cid];
 
-    for (peer_cid = 0; peer_cid < DPVS_MAX_LCORE; peer_cid++) {
-        if (dp_vs_redirect_ring[cid][peer_cid]) {
-            nb_rb = rte_ring_dequeue_burst(dp_vs_redirect_ring[cid][peer_cid],
-                                           (void**)mbufs,
-                                           NETIF_MAX_PKT_BURST, NULL);
-            if (nb_rb > 0) {
-                lcore_process_packets(qconf, mbufs, cid, nb_rb, 1);
-            }
+    if (likely(!pending->mask)) {
+        return;
+    }
+
+    mask = __sync_lock_test_and_set(&pending->mask, 0);
+    while (mask) {
+        peer_cid = __builtin_ctzll(mask);
+        mask &= mask - 1;
+
+        ring = dp_vs_redirect_ring[cid][peer_cid];
+        nb_rb = rte_ring_dequeue_burst(ring, (void**)mbufs,
+                                       NETIF_MAX_PKT_BURST, NULL);
+        if (nb_rb > 0) {
+            lcore_process_packets(qconf, mbufs, cid, nb_rb, 1);
+        }
+
+        /* leave the rest for next loop */
+        if (!rte_ring_empty(ring)) {
+            __sync_fetch_and_or(&pending->mask, 1ULL << peer_cid);
+        }
+    }
+}
+
+/*
+ * Fragments of one datagram may arrive at different lcores, since RSS
+ * and flow-director cannot see L4 ports of non-first fragments. All of
+ * them are hashed by (saddr, daddr, ip_id, proto) to the same worker,
+ * which owns the per-lcore reassembly table for the datagram. No shared
+ * state is needed, every lcore computes the same owner.
+ */
+lcoreid_t dp_vs_redirect_frag_lcore(const struct ipv4_hdr *iph)
+{
+    uint32_t hash;
+
+    if (dp_vs_redirect_disable || !dp_vs_frag_lcore_nb) {
+        return rte_lcore_id();
+    }
+
+    hash = rte_jhash_3words(iph->src_addr, iph->dst_addr,
+                            ((uint32_t)iph->packet_id << 16) | iph->next_proto_id,
+                            0);
+
+    return dp_vs_frag_lcores[hash % dp_vs_frag_lcore_nb];
+}
+
+static void dp_vs_redirect_frag_lcores_init(void)
+{
+    uint64_t slave_lcore_mask;
+    uint8_t slave_lcore_nb;
+    lcoreid_t cid;
+
+    netif_get_slave_lcores(&slave_lcore_nb, &slave_lcore_mask);
+
+    dp_vs_frag_lcore_nb = 0;
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (slave_lcore_mask & (1L << cid)) {
+            dp_vs_frag_lcores[dp_vs_frag_lcore_nb++] = cid;
         }
     }
 }
@@ -327,7 +531,11 @@ static int dp_vs_redirect_table_create(void)
     /* init the global redirect hash table */
     for (i = 0; i < DPVS_CR_TBL_SIZE; i++) {
         INIT_LIST_HEAD(&dp_vs_cr_tbl[i]);
-        rte_spinlock_init(&dp_vs_cr_lock[i]);
+    }
+
+    for (i = 0; i < DPVS_CR_LOCK_SIZE; i++) {
+        rte_spinlock_init(&dp_vs_cr_stripes[i].lock);
+        dp_vs_cr_stripes[i].seq = 0;
     }
 
     return EDPVS_OK;
@@ -363,6 +571,16 @@ static int dp_vs_redirect_ring_create(void)
             continue;
         }
 
+        dp_vs_redirect_stages[cid] =
+            rte_zmalloc_socket(NULL,
+                    sizeof(struct dp_vs_redirect_stage) * DPVS_MAX_LCORE,
+                    RTE_CACHE_LINE_SIZE, rte_lcore_to_socket_id(cid));
+        if (!dp_vs_redirect_stages[cid]) {
+            RTE_LOG(ERR, IPVS, "%s: no memory for redirect stage[%d]\n",
+                    __func__, cid);
+            return EDPVS_NOMEM;
+        }
+
         for (peer_cid = 0; peer_cid < DPVS_MAX_LCORE; peer_cid++) {
             if (!rte_lcore_is_enabled(peer_cid)
                 || peer_cid == rte_get_master_lcore()
@@ -396,7 +614,11 @@ static void dp_vs_redirect_ring_free(void)
     for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
         for (peer_cid = 0; peer_cid < DPVS_MAX_LCORE; peer_cid++) {
             rte_ring_free(dp_vs_redirect_ring[cid][peer_cid]);
+            dp_vs_redirect_ring[cid][peer_cid] = NULL;
         }
+
+        rte_free(dp_vs_redirect_stages[cid]);
+        dp_vs_redirect_stages[cid] = NULL;
     }
 }
 
@@ -413,6 +635,8 @@ int dp_vs_redirects_init(void)
         return err;
     }
 
+    dp_vs_redirect_frag_lcores_init();
+
     return dp_vs_redirect_table_create();
 }
 
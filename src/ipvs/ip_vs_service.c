@@ -678,10 +678,10 @@ int dp_vs_del_service(struct dp_vs_service *svc)
     return EDPVS_OK;
 }
 
-static int
-dp_vs_copy_service(struct dp_vs_service_entry *dst, struct dp_vs_service *src)
+static void
+dp_vs_fill_service_entry(struct dp_vs_service_entry *dst,
+                         const struct dp_vs_service *src)
 {
-    int err = 0;
     struct dp_vs_match *m;
 
     memset(dst, 0, sizeof(*dst));
@@ -699,19 +699,22 @@ dp_vs_copy_service(struct dp_vs_service_entry *dst, struct dp_vs_service *src)
     dst->num_dests = src->num_dests;
     dst->num_laddrs = src->num_laddrs;
 
-    err = dp_vs_copy_stats(&dst->stats, src->stats);
-
     m = src->match;
     if (!m)
-        return err;
+        return;
 
     inet_addr_range_dump(m->af, &m->srange, dst->srange, sizeof(dst->srange));
     inet_addr_range_dump(m->af, &m->drange, dst->drange, sizeof(dst->drange));
 
     snprintf(dst->iifname, sizeof(dst->iifname), "%s", m->iifname);
     snprintf(dst->oifname, sizeof(dst->oifname), "%s", m->oifname);
+}
 
-    return err;
+static int
+dp_vs_copy_service(struct dp_vs_service_entry *dst, struct dp_vs_service *src)
+{
+    dp_vs_fill_service_entry(dst, src);
+    return dp_vs_copy_stats(&dst->stats, src->stats);
 }
 
 int dp_vs_get_service_entries(const struct dp_vs_get_services *get,
@@ -757,6 +760,119 @@ out:
 }
 
 
+/* snapshot builder, see dp_vs_get_snapshot() */
+struct dp_vs_snapshot_ctx {
+    struct dp_vs_get_snapshot   *snap;
+    size_t                      off;        /* next entry in snap */
+    size_t                      size;       /* size of snap */
+    int                         nstats;
+    struct dp_vs_stats          **src;      /* per-lcore stats, by entry */
+    struct dp_vs_stats          **dst;      /* where their sums go */
+};
+
+static int dp_vs_snapshot_service(struct dp_vs_snapshot_ctx *ctx,
+                                  struct dp_vs_service *svc)
+{
+    struct dp_vs_service_entry *se;
+    struct dp_vs_dest_entry *de;
+    struct dp_vs_dest *dest;
+
+    if (ctx->off + sizeof(*se) > ctx->size)
+        return EDPVS_NOROOM;
+
+    se = (struct dp_vs_service_entry *)((char *)ctx->snap + ctx->off);
+    dp_vs_fill_service_entry(se, svc);
+    se->num_dests = 0;
+    ctx->off += sizeof(*se);
+    ctx->src[ctx->nstats] = svc->stats;
+    ctx->dst[ctx->nstats++] = &se->stats;
+    ctx->snap->num_services++;
+
+    list_for_each_entry(dest, &svc->dests, n_list) {
+        if (ctx->off + sizeof(*de) > ctx->size)
+            return EDPVS_NOROOM;
+
+        de = (struct dp_vs_dest_entry *)((char *)ctx->snap + ctx->off);
+        dp_vs_fill_dest_entry(de, dest);
+        ctx->off += sizeof(*de);
+        ctx->src[ctx->nstats] = dest->stats;
+        ctx->dst[ctx->nstats++] = &de->stats;
+        se->num_dests++;
+        ctx->snap->num_dests++;
+    }
+
+    return EDPVS_OK;
+}
+
+/*
+ * all services, each followed by its dests, with stats summed over
+ * lcores by a single message round. it's for agents polling stats of
+ * many services, which otherwise takes a round per service and dest.
+ */
+static int dp_vs_get_snapshot(struct dp_vs_get_snapshot **out, size_t *outlen)
+{
+    struct dp_vs_snapshot_ctx ctx;
+    struct dp_vs_service *svc;
+    int idx, nents = 0, err = EDPVS_OK;
+
+    for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
+        list_for_each_entry(svc, &dp_vs_svc_table[idx], s_list)
+            nents += 1 + svc->num_dests;
+        list_for_each_entry(svc, &dp_vs_svc_fwm_table[idx], f_list)
+            nents += 1 + svc->num_dests;
+    }
+    list_for_each_entry(svc, &dp_vs_svc_match_list, m_list)
+        nents += 1 + svc->num_dests;
+
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.size = sizeof(*ctx.snap) + dp_vs_num_services * sizeof(struct dp_vs_service_entry)
+        + (nents - dp_vs_num_services) * sizeof(struct dp_vs_dest_entry);
+    ctx.snap = rte_zmalloc("get_snapshot", ctx.size, 0);
+    ctx.src = rte_malloc(NULL, (nents + 1) * sizeof(struct dp_vs_stats *), 0);
+    ctx.dst = rte_malloc(NULL, (nents + 1) * sizeof(struct dp_vs_stats *), 0);
+    if (unlikely(!ctx.snap || !ctx.src || !ctx.dst)) {
+        err = EDPVS_NOMEM;
+        goto errout;
+    }
+    ctx.off = sizeof(*ctx.snap);
+
+    for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
+        list_for_each_entry(svc, &dp_vs_svc_table[idx], s_list) {
+            if ((err = dp_vs_snapshot_service(&ctx, svc)) != EDPVS_OK)
+                goto errout;
+        }
+    }
+    for (idx = 0; idx < DP_VS_SVC_TAB_SIZE; idx++) {
+        list_for_each_entry(svc, &dp_vs_svc_fwm_table[idx], f_list) {
+            if ((err = dp_vs_snapshot_service(&ctx, svc)) != EDPVS_OK)
+                goto errout;
+        }
+    }
+    list_for_each_entry(svc, &dp_vs_svc_match_list, m_list) {
+        if ((err = dp_vs_snapshot_service(&ctx, svc)) != EDPVS_OK)
+            goto errout;
+    }
+
+    err = dp_vs_copy_stats_bulk(ctx.dst, ctx.src, ctx.nstats);
+    if (err != EDPVS_OK)
+        goto errout;
+
+    rte_free(ctx.src);
+    rte_free(ctx.dst);
+    *out = ctx.snap;
+    *outlen = ctx.off;
+    return EDPVS_OK;
+
+errout:
+    if (ctx.snap)
+        rte_free(ctx.snap);
+    if (ctx.src)
+        rte_free(ctx.src);
+    if (ctx.dst)
+        rte_free(ctx.dst);
+    return err;
+}
+
 unsigned dp_vs_get_conn_timeout(struct dp_vs_conn *conn)
 {
     unsigned conn_timeout;
@@ -1013,6 +1129,19 @@ static int dp_vs_set_svc(sockoptid_t opt, const void *user, size_t len)
     return ret;
 }
 
+/* undo add of a failed atomic batch, others can't be reverted */
+static int dp_vs_rollback_svc(sockoptid_t opt, const void *user, size_t len)
+{
+    switch (opt) {
+        case DPVS_SO_SET_ADD:
+            return dp_vs_set_svc(DPVS_SO_SET_DEL, user, len);
+        case DPVS_SO_SET_ADDDEST:
+            return dp_vs_set_svc(DPVS_SO_SET_DELDEST, user, len);
+        default:
+            return EDPVS_NOTSUPP;
+    }
+}
+
 static int dp_vs_get_svc(sockoptid_t opt, const void *user, size_t len, void **out, size_t *outlen)
 {
     int ret = 0;
@@ -1111,6 +1240,18 @@ static int dp_vs_get_svc(sockoptid_t opt, const void *user, size_t len, void **o
                 }
             }
             break;
+        case DPVS_SO_GET_SNAPSHOT:
+            {
+                struct dp_vs_get_snapshot *snap;
+
+                ret = dp_vs_get_snapshot(&snap, outlen);
+                if (ret != EDPVS_OK) {
+                    *outlen = 0;
+                    return ret;
+                }
+                *out = snap;
+            }
+            break;
         case DPVS_SO_GET_DESTS:
             {
                 struct dp_vs_service *svc = NULL;
@@ -1181,6 +1322,7 @@ struct dpvs_sockopts sockopts_svc = {
     .set_opt_min    = SOCKOPT_SVC_BASE,
     .set_opt_max    = SOCKOPT_SVC_SET_CMD_MAX,
     .set            = dp_vs_set_svc,
+    .rollback       = dp_vs_rollback_svc,
     .get_opt_min    = SOCKOPT_SVC_BASE,
     .get_opt_max    = SOCKOPT_SVC_GET_CMD_MAX,
     .get            = dp_vs_get_svc,
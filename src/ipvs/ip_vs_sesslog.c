@@ -0,0 +1,559 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Session logging.
+ *
+ * the record is copied to a per-lcore batch buffer on the worker, nothing
+ * else: no syscall, no lock, no formatting. full batches are passed to
+ * master through per-lcore SP/SC rings and partial batches are flushed
+ * by a slow loop job. master converts TSC to wall-clock time and writes
+ * the batches as they are. sampling is decided at creation, the expiry
+ * of a logged session is always logged (DPVS_CONN_F_LOGGED).
+ */
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "common.h"
+#include "dpdk.h"
+#include "netif.h"
+#include "ctrl.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/conn.h"
+#include "ipvs/dest.h"
+#include "ipvs/sesslog.h"
+
+#define SESSLOG_BUFF_RECS           64      /* records per batch */
+#define SESSLOG_POOL_SIZE           8191
+#define SESSLOG_POOL_CACHE          64
+#define SESSLOG_RING_SIZE           1024
+#define SESSLOG_DEQ_BURST           32
+#define SESSLOG_FLUSH_LOOPS         1024
+
+struct sesslog_buff {
+    uint16_t                    nr;
+    struct dp_vs_sesslog_rec    recs[SESSLOG_BUFF_RECS];
+};
+
+/* per-lcore ring and statistics, written by owner lcore only */
+struct sesslog_lcore {
+    struct rte_ring                     *ring;
+    struct sesslog_buff                 *curr;
+    uint32_t                            sample_cnt;
+    struct dp_vs_sesslog_lcore_stats    stats;
+} __rte_cache_aligned;
+
+/* fields read by workers are set before dp_vs_sesslog_on. */
+struct sesslog_session {
+    bool                running;
+    struct dp_vs_sesslog_conf conf;
+
+    /* master only */
+    FILE                *fp;
+    int                 sockfd;
+    struct sockaddr_un  peer;
+    uint64_t            written;
+    uint64_t            write_errors;
+    uint64_t            tsc_base;
+    uint64_t            ns_base;
+} __rte_cache_aligned;
+
+volatile bool dp_vs_sesslog_on = false;
+
+static struct sesslog_lcore sesslog_lcores[DPVS_MAX_LCORE];
+static struct rte_mempool *sesslog_pool;
+static struct sesslog_session sesslog_sess = { .sockfd = -1 };
+static struct netif_lcore_loop_job sesslog_job;
+
+/*
+ * workers
+ */
+static void sesslog_lcore_flush(struct sesslog_lcore *sl)
+{
+    struct sesslog_buff *buff = sl->curr;
+
+    if (!buff)
+        return;
+    sl->curr = NULL;
+
+    if (unlikely(rte_ring_sp_enqueue(sl->ring, buff) != 0)) {
+        sl->stats.ring_full += buff->nr;
+        rte_mempool_put(sesslog_pool, buff);
+        return;
+    }
+
+    sl->stats.logged += buff->nr;
+}
+
+static struct dp_vs_sesslog_rec *sesslog_rec_get(struct sesslog_lcore *sl)
+{
+    struct sesslog_buff *buff = sl->curr;
+
+    if (!buff) {
+        if (unlikely(rte_mempool_get(sesslog_pool, (void **)&buff) != 0)) {
+            sl->stats.nobuf++;
+            return NULL;
+        }
+        buff->nr = 0;
+        sl->curr = buff;
+    }
+
+    return &buff->recs[buff->nr++];
+}
+
+static void sesslog_rec_fill(struct dp_vs_sesslog_rec *rec,
+                             const struct dp_vs_conn *conn, uint8_t type)
+{
+    rec->type       = type;
+    rec->af         = conn->af;
+    rec->daf        = tuplehash_out(conn).af;
+    rec->proto      = conn->proto;
+    rec->fwdmode    = conn->dest ? conn->dest->fwdmode : 0;
+    rec->cid        = rte_lcore_id();
+    rec->state      = conn->state;
+    rec->cport      = conn->cport;
+    rec->vport      = conn->vport;
+    rec->lport      = conn->lport;
+    rec->dport      = conn->dport;
+    rec->caddr      = conn->caddr;
+    rec->vaddr      = conn->vaddr;
+    rec->laddr      = conn->laddr;
+    rec->daddr      = conn->daddr;
+}
+
+void __dp_vs_sesslog_conn_new(struct dp_vs_conn *conn)
+{
+    struct sesslog_lcore *sl = &sesslog_lcores[rte_lcore_id()];
+    const struct dp_vs_sesslog_conf *conf = &sesslog_sess.conf;
+    struct dp_vs_sesslog_rec *rec;
+
+    if (unlikely(!sl->ring) || (conn->flags & DPVS_CONN_F_TEMPLATE))
+        return;
+
+    if (conf->sample > 1 && ++sl->sample_cnt < conf->sample) {
+        sl->stats.sampled++;
+        return;
+    }
+    sl->sample_cnt = 0;
+
+    if (conf->events & SESSLOG_REC_EXPIRE)
+        conn->flags |= DPVS_CONN_F_LOGGED;
+
+    if (!(conf->events & SESSLOG_REC_CREATE))
+        return;
+
+    rec = sesslog_rec_get(sl);
+    if (unlikely(!rec))
+        return;
+
+    sesslog_rec_fill(rec, conn, SESSLOG_REC_CREATE);
+    rec->time       = conn->ctime;
+    rec->duration   = 0;
+    rec->inpkts     = 0;
+    rec->inbytes    = 0;
+    rec->outpkts    = 0;
+    rec->outbytes   = 0;
+
+    if (sl->curr->nr >= SESSLOG_BUFF_RECS)
+        sesslog_lcore_flush(sl);
+}
+
+void __dp_vs_sesslog_conn_expire(struct dp_vs_conn *conn)
+{
+    struct sesslog_lcore *sl = &sesslog_lcores[rte_lcore_id()];
+    struct dp_vs_sesslog_rec *rec;
+    uint64_t now;
+
+    conn->flags &= ~DPVS_CONN_F_LOGGED;
+
+    if (unlikely(!sl->ring) || !dp_vs_sesslog_on)
+        return;
+
+    rec = sesslog_rec_get(sl);
+    if (unlikely(!rec))
+        return;
+
+    now = rte_rdtsc();
+    sesslog_rec_fill(rec, conn, SESSLOG_REC_EXPIRE);
+    rec->time       = now;
+    rec->duration   = now - conn->ctime;    /* in TSC, converted by master */
+    rec->inpkts     = conn->stats.inpkts;
+    rec->inbytes    = conn->stats.inbytes;
+    rec->outpkts    = conn->stats.outpkts;
+    rec->outbytes   = conn->stats.outbytes;
+
+    if (sl->curr->nr >= SESSLOG_BUFF_RECS)
+        sesslog_lcore_flush(sl);
+}
+
+static void sesslog_lcore_job(void *arg)
+{
+    struct sesslog_lcore *sl = &sesslog_lcores[rte_lcore_id()];
+
+    if (sl->curr)
+        sesslog_lcore_flush(sl);
+}
+
+/* reset by master before a session starts, on the owner lcore */
+static int sesslog_reset_msg_cb(struct dpvs_msg *msg)
+{
+    lcoreid_t cid = rte_lcore_id();
+    struct sesslog_lcore *sl = &sesslog_lcores[cid];
+
+    memset(&sl->stats, 0, sizeof(sl->stats));
+    sl->stats.cid = cid;
+    sl->sample_cnt = 0;
+    return EDPVS_OK;
+}
+
+static struct dpvs_msg_type sesslog_reset_msg = {
+    .type           = MSG_TYPE_SESSLOG_RESET,
+    .mode           = DPVS_MSG_MULTICAST,
+    .unicast_msg_cb = sesslog_reset_msg_cb,
+};
+
+/*
+ * master
+ */
+static void sesslog_write(struct sesslog_session *sess, struct sesslog_buff *buff)
+{
+    struct dp_vs_sesslog_rec *rec;
+    uint64_t hz = rte_get_tsc_hz();
+    uint64_t ts;
+    size_t len = buff->nr * sizeof(struct dp_vs_sesslog_rec);
+    unsigned i;
+
+    for (i = 0; i < buff->nr; i++) {
+        rec = &buff->recs[i];
+        ts = rec->time - sess->tsc_base;
+        rec->time = sess->ns_base + ts / hz * 1000000000ULL
+                  + ts % hz * 1000000000ULL / hz;
+        rec->duration = rec->duration / hz * 1000000ULL
+                      + rec->duration % hz * 1000000ULL / hz;
+    }
+
+    if (sess->fp) {
+        if (fwrite(buff->recs, len, 1, sess->fp) != 1) {
+            sess->write_errors += buff->nr;
+            return;
+        }
+    } else {
+        /* non-blocking, a slow reader costs records, not the master loop */
+        if (sendto(sess->sockfd, buff->recs, len, MSG_DONTWAIT,
+                   (struct sockaddr *)&sess->peer, sizeof(sess->peer)) < 0) {
+            sess->write_errors += buff->nr;
+            return;
+        }
+    }
+
+    sess->written += buff->nr;
+}
+
+void dp_vs_sesslog_process_on_master(void)
+{
+    struct sesslog_buff *buffs[SESSLOG_DEQ_BURST];
+    struct sesslog_session *sess = &sesslog_sess;
+    unsigned i, n;
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!sesslog_lcores[cid].ring)
+            continue;
+
+        n = rte_ring_sc_dequeue_burst(sesslog_lcores[cid].ring, (void **)buffs,
+                                      SESSLOG_DEQ_BURST, NULL);
+        for (i = 0; i < n; i++) {
+            /* batches still in flight after stop are dropped */
+            if (sess->running)
+                sesslog_write(sess, buffs[i]);
+            rte_mempool_put(sesslog_pool, buffs[i]);
+        }
+    }
+}
+
+static void sesslog_stop(void)
+{
+    struct sesslog_session *sess = &sesslog_sess;
+
+    if (!sess->running)
+        return;
+
+    dp_vs_sesslog_on = false;
+    rte_wmb();
+
+    sess->running = false;
+    if (sess->fp) {
+        fclose(sess->fp);
+        sess->fp = NULL;
+    }
+    if (sess->sockfd >= 0) {
+        close(sess->sockfd);
+        sess->sockfd = -1;
+    }
+
+    RTE_LOG(INFO, IPVS, "session logging stopped, %lu records written to %s\n",
+            sess->written, sess->conf.path);
+}
+
+/*
+ * a worker may still be in a call began before the last stop. once all
+ * of them replied to the reset msg, none reads the session or its own
+ * state till dp_vs_sesslog_on is set again.
+ */
+static int sesslog_lcores_reset(void)
+{
+    struct dpvs_msg *msg;
+    int err;
+
+    msg = msg_make(MSG_TYPE_SESSLOG_RESET, 0, DPVS_MSG_MULTICAST,
+                   rte_lcore_id(), 0, NULL);
+    if (unlikely(!msg))
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(msg, 0, NULL);
+    msg_destroy(&msg);
+
+    if (err != EDPVS_OK)
+        RTE_LOG(ERR, IPVS, "%s: fail to reset sesslog on slaves -- %s\n",
+                __func__, dpvs_strerror(err));
+    return err;
+}
+
+static int sesslog_start(const struct dp_vs_sesslog_conf *conf)
+{
+    struct sesslog_session *sess = &sesslog_sess;
+    struct dp_vs_sesslog_file_hdr hdr;
+    struct timeval tv;
+    int err;
+
+    if (sess->running)
+        return EDPVS_BUSY;
+
+    if ((conf->sink != SESSLOG_SINK_FILE && conf->sink != SESSLOG_SINK_UNIX) ||
+            !strlen(conf->path))
+        return EDPVS_INVAL;
+
+    err = sesslog_lcores_reset();
+    if (err != EDPVS_OK)
+        return err;
+
+    memset(sess, 0, sizeof(*sess));
+    sess->sockfd = -1;
+    memcpy(&sess->conf, conf, sizeof(sess->conf));
+    sess->conf.path[SESSLOG_PATH_LEN - 1] = '\0';
+    if (!sess->conf.events)
+        sess->conf.events = SESSLOG_REC_CREATE | SESSLOG_REC_EXPIRE;
+
+    if (conf->sink == SESSLOG_SINK_FILE) {
+        sess->fp = fopen(sess->conf.path, "a");
+        if (!sess->fp) {
+            RTE_LOG(ERR, IPVS, "%s: fail to open %s: %s\n", __func__,
+                    sess->conf.path, strerror(errno));
+            return EDPVS_IO;
+        }
+
+        if (ftell(sess->fp) == 0) {
+            hdr.magic = SESSLOG_FILE_MAGIC;
+            hdr.version = SESSLOG_FILE_VERSION;
+            hdr.rec_size = sizeof(struct dp_vs_sesslog_rec);
+            if (fwrite(&hdr, sizeof(hdr), 1, sess->fp) != 1) {
+                fclose(sess->fp);
+                sess->fp = NULL;
+                return EDPVS_IO;
+            }
+        }
+    } else {
+        sess->sockfd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (sess->sockfd < 0)
+            return EDPVS_SYSCALL;
+        sess->peer.sun_family = AF_UNIX;
+        snprintf(sess->peer.sun_path, sizeof(sess->peer.sun_path), "%s",
+                 sess->conf.path);
+    }
+
+    gettimeofday(&tv, NULL);
+    sess->tsc_base = rte_rdtsc();
+    sess->ns_base = tv.tv_sec * 1000000000ULL + tv.tv_usec * 1000ULL;
+
+    sess->running = true;
+    rte_wmb();
+    dp_vs_sesslog_on = true;
+
+    RTE_LOG(INFO, IPVS, "session logging started to %s, sample %u\n",
+            sess->conf.path, sess->conf.sample);
+    return EDPVS_OK;
+}
+
+/*
+ * control plane
+ */
+static int sesslog_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    switch (opt) {
+    case SOCKOPT_SET_SESSLOG_START:
+        if (!conf || size < sizeof(struct dp_vs_sesslog_conf))
+            return EDPVS_INVAL;
+        return sesslog_start(conf);
+    case SOCKOPT_SET_SESSLOG_STOP:
+        if (!sesslog_sess.running)
+            return EDPVS_NOTEXIST;
+        sesslog_stop();
+        return EDPVS_OK;
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static int sesslog_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                               void **out, size_t *outsize)
+{
+    struct dp_vs_sesslog_show *show;
+    lcoreid_t cid;
+    size_t len;
+    int nlcore = 0;
+
+    if (opt != SOCKOPT_GET_SESSLOG_SHOW)
+        return EDPVS_NOTSUPP;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (sesslog_lcores[cid].ring)
+            nlcore++;
+    }
+
+    len = sizeof(*show) + nlcore * sizeof(struct dp_vs_sesslog_lcore_stats);
+    show = rte_zmalloc(NULL, len, 0);
+    if (!show)
+        return EDPVS_NOMEM;
+
+    show->running = sesslog_sess.running;
+    memcpy(&show->conf, &sesslog_sess.conf, sizeof(show->conf));
+    show->written = sesslog_sess.written;
+    show->write_errors = sesslog_sess.write_errors;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!sesslog_lcores[cid].ring)
+            continue;
+        show->lcores[show->nlcore] = sesslog_lcores[cid].stats;
+        show->lcores[show->nlcore].cid = cid;
+        show->nlcore++;
+    }
+
+    *out = show;
+    *outsize = len;
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts sesslog_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_SET_SESSLOG_START,
+    .set_opt_max    = SOCKOPT_SET_SESSLOG_STOP,
+    .set            = sesslog_sockopt_set,
+    .get_opt_min    = SOCKOPT_GET_SESSLOG_SHOW,
+    .get_opt_max    = SOCKOPT_GET_SESSLOG_SHOW,
+    .get            = sesslog_sockopt_get,
+};
+
+int dp_vs_sesslog_init(void)
+{
+    char name[RTE_RING_NAMESIZE];
+    lcoreid_t cid;
+    int err;
+
+    sesslog_pool = rte_mempool_create("dp_vs_sesslog", SESSLOG_POOL_SIZE,
+                                      sizeof(struct sesslog_buff),
+                                      SESSLOG_POOL_CACHE, 0, NULL, NULL,
+                                      NULL, NULL, SOCKET_ID_ANY, 0);
+    if (!sesslog_pool) {
+        RTE_LOG(ERR, IPVS, "%s: fail to create sesslog pool\n", __func__);
+        return EDPVS_NOMEM;
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!rte_lcore_is_enabled(cid) || cid == rte_get_master_lcore())
+            continue;
+
+        snprintf(name, sizeof(name), "dp_vs_sesslog_c%d", cid);
+        sesslog_lcores[cid].ring = rte_ring_create(name, SESSLOG_RING_SIZE,
+                rte_lcore_to_socket_id(cid), RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!sesslog_lcores[cid].ring) {
+            RTE_LOG(ERR, IPVS, "%s: fail to create %s\n", __func__, name);
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
+        sesslog_lcores[cid].stats.cid = cid;
+    }
+
+    snprintf(sesslog_job.name, sizeof(sesslog_job.name) - 1, "%s", "ipvs_sesslog");
+    sesslog_job.func = sesslog_lcore_job;
+    sesslog_job.data = NULL;
+    sesslog_job.type = NETIF_LCORE_JOB_SLOW;
+    sesslog_job.skip_loops = SESSLOG_FLUSH_LOOPS;
+    if ((err = netif_lcore_loop_job_register(&sesslog_job)) != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register loop job\n", __func__);
+        goto errout;
+    }
+
+    sesslog_reset_msg.cid = rte_lcore_id();
+    if ((err = msg_type_mc_register(&sesslog_reset_msg)) != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register msg\n", __func__);
+        netif_lcore_loop_job_unregister(&sesslog_job);
+        goto errout;
+    }
+
+    if ((err = sockopt_register(&sesslog_sockopts)) != EDPVS_OK) {
+        msg_type_mc_unregister(&sesslog_reset_msg);
+        netif_lcore_loop_job_unregister(&sesslog_job);
+        goto errout;
+    }
+
+    return EDPVS_OK;
+
+errout:
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(sesslog_lcores[cid].ring);
+        sesslog_lcores[cid].ring = NULL;
+    }
+    rte_mempool_free(sesslog_pool);
+    sesslog_pool = NULL;
+    return err;
+}
+
+int dp_vs_sesslog_term(void)
+{
+    lcoreid_t cid;
+    int err;
+
+    sesslog_stop();
+
+    if ((err = sockopt_unregister(&sesslog_sockopts)) != EDPVS_OK)
+        return err;
+
+    msg_type_mc_unregister(&sesslog_reset_msg);
+    netif_lcore_loop_job_unregister(&sesslog_job);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(sesslog_lcores[cid].ring);
+        sesslog_lcores[cid].ring = NULL;
+    }
+    rte_mempool_free(sesslog_pool);
+    sesslog_pool = NULL;
+
+    return EDPVS_OK;
+}
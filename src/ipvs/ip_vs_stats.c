@@ -24,6 +24,7 @@
 #include "ipvs/dest.h"
 #include "ipvs/service.h"
 #include "ipvs/stats.h"
+#include "conf/estats.h"
 
 #define this_dpvs_stats             (dpvs_stats[rte_lcore_id()])
 #define this_dpvs_estats            (dpvs_estats[rte_lcore_id()])
@@ -181,6 +182,75 @@ int dp_vs_copy_stats(struct dp_vs_stats* dst, struct dp_vs_stats* src)
     return EDPVS_OK;
 }
 
+static int get_stats_bulk_uc_cb(struct dpvs_msg *msg)
+{
+    struct dp_vs_stats **src, *reply;
+    lcoreid_t cid = rte_lcore_id();
+    int i, n;
+
+    if (msg->len % sizeof(struct dp_vs_stats *)) {
+        RTE_LOG(ERR, SERVICE, "%s: bad message.\n", __func__);
+        return EDPVS_INVAL;
+    }
+    n = msg->len / sizeof(struct dp_vs_stats *);
+    src = (struct dp_vs_stats **)msg->data;
+
+    reply = rte_malloc(NULL, n * sizeof(struct dp_vs_stats), RTE_CACHE_LINE_SIZE);
+    if (unlikely(!reply))
+        return EDPVS_NOMEM;
+
+    for (i = 0; i < n; i++)
+        reply[i] = src[i][cid];
+
+    msg->reply.len = n * sizeof(struct dp_vs_stats);
+    msg->reply.data = (void *)reply;
+    return EDPVS_OK;
+}
+
+/*
+ * sum per-lcore stats of @n objects into @dst[0..n-1], with one message
+ * round to all lcores instead of one per object.
+ */
+int dp_vs_copy_stats_bulk(struct dp_vs_stats **dst, struct dp_vs_stats **src, int n)
+{
+    struct dpvs_msg *msg;
+    struct dpvs_multicast_queue *reply = NULL;
+    struct dpvs_msg *cur;
+    struct dp_vs_stats *per_stats;
+    int i, err;
+
+    if (n <= 0)
+        return EDPVS_OK;
+
+    msg = msg_make(MSG_TYPE_STATS_GET_BULK, 0, DPVS_MSG_MULTICAST, rte_lcore_id(),
+            n * sizeof(struct dp_vs_stats *), src);
+    if (!msg)
+        return EDPVS_NOMEM;
+
+    err = multicast_msg_send(msg, 0, &reply);
+    if (err != EDPVS_OK) {
+        msg_destroy(&msg);
+        RTE_LOG(ERR, SERVICE, "%s: send message fail.\n", __func__);
+        return err;
+    }
+
+    list_for_each_entry(cur, &reply->mq, mq_node) {
+        if (cur->len != n * sizeof(struct dp_vs_stats))
+            continue;
+        per_stats = (struct dp_vs_stats *)(cur->data);
+        for (i = 0; i < n; i++) {
+            dst[i]->conns += per_stats[i].conns;
+            dst[i]->inpkts += per_stats[i].inpkts;
+            dst[i]->inbytes += per_stats[i].inbytes;
+            dst[i]->outbytes += per_stats[i].outbytes;
+            dst[i]->outpkts += per_stats[i].outpkts;
+        }
+    }
+
+    msg_destroy(&msg);
+    return EDPVS_OK;
+}
+
 static void register_stats_cb(void)
 {
     struct dpvs_msg_type mt;
@@ -189,6 +259,12 @@ static void register_stats_cb(void)
     mt.unicast_msg_cb = get_stats_uc_cb;
     mt.multicast_msg_cb = NULL;
     assert(msg_type_mc_register(&mt) == 0);
+
+    memset(&mt, 0 ,sizeof(mt));
+    mt.type = MSG_TYPE_STATS_GET_BULK;
+    mt.unicast_msg_cb = get_stats_bulk_uc_cb;
+    mt.multicast_msg_cb = NULL;
+    assert(msg_type_mc_register(&mt) == 0);
 }
 
 static void unregister_stats_cb(void)
@@ -199,6 +275,12 @@ static void unregister_stats_cb(void)
     mt.unicast_msg_cb = get_stats_uc_cb;
     mt.multicast_msg_cb = NULL;
     assert(msg_type_mc_unregister(&mt) == 0);
+
+    memset(&mt, 0, sizeof(mt));
+    mt.type = MSG_TYPE_STATS_GET_BULK;
+    mt.unicast_msg_cb = get_stats_bulk_uc_cb;
+    mt.multicast_msg_cb = NULL;
+    assert(msg_type_mc_unregister(&mt) == 0);
 }
 
 int dp_vs_stats_in(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
@@ -220,10 +302,8 @@ int dp_vs_stats_in(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
         dest->stats[cid].inbytes += mbuf->pkt_len;
     }
 
-#ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
-    rte_atomic64_inc(&conn->stats.inpkts);
-    rte_atomic64_add(&conn->stats.inbytes, mbuf->pkt_len);
-#endif
+    conn->stats.inpkts++;
+    conn->stats.inbytes += mbuf->pkt_len;
 
     this_dpvs_stats.inpkts++;
     this_dpvs_stats.inbytes += mbuf->pkt_len;
@@ -249,10 +329,8 @@ int dp_vs_stats_out(struct dp_vs_conn *conn, struct rte_mbuf *mbuf)
         dest->stats[cid].outbytes += mbuf->pkt_len;
     }
 
-#ifdef CONFIG_DPVS_IPVS_STATS_DEBUG
-    rte_atomic64_inc(&conn->stats.outpkts);
-    rte_atomic64_add(&conn->stats.outbytes, mbuf->pkt_len);
-#endif
+    conn->stats.outpkts++;
+    conn->stats.outbytes += mbuf->pkt_len;
 
     this_dpvs_stats.outpkts++;
     this_dpvs_stats.outbytes += mbuf->pkt_len;
@@ -284,16 +362,127 @@ uint64_t dp_vs_estats_get(enum dp_vs_estats_type field)
     return this_dpvs_estats.mibs[field];
 }
 
+#define ESTATS_NAME(f)  [f] = #f
+
+static const char *dp_vs_estats_names[DP_VS_EXT_STAT_LAST] = {
+    ESTATS_NAME(FULLNAT_ADD_TOA_OK),
+    ESTATS_NAME(FULLNAT_ADD_TOA_FAIL_LEN),
+    ESTATS_NAME(FULLNAT_ADD_TOA_HEAD_FULL),
+    ESTATS_NAME(FULLNAT_ADD_TOA_FAIL_MEM),
+    ESTATS_NAME(FULLNAT_ADD_TOA_FAIL_PROTO),
+    ESTATS_NAME(FULLNAT_CONN_REUSED),
+    ESTATS_NAME(FULLNAT_CONN_REUSED_CLOSE),
+    ESTATS_NAME(FULLNAT_CONN_REUSED_TIMEWAIT),
+    ESTATS_NAME(FULLNAT_CONN_REUSED_FINWAIT),
+    ESTATS_NAME(FULLNAT_CONN_REUSED_CLOSEWAIT),
+    ESTATS_NAME(FULLNAT_CONN_REUSED_LASTACK),
+    ESTATS_NAME(FULLNAT_CONN_REUSED_ESTAB),
+    ESTATS_NAME(SYNPROXY_RS_ERROR),
+    ESTATS_NAME(SYNPROXY_NULL_ACK),
+    ESTATS_NAME(SYNPROXY_BAD_ACK),
+    ESTATS_NAME(SYNPROXY_OK_ACK),
+    ESTATS_NAME(SYNPROXY_SYN_CNT),
+    ESTATS_NAME(SYNPROXY_ACK_STORM),
+    ESTATS_NAME(SYNPROXY_SYNSEND_QLEN),
+    ESTATS_NAME(SYNPROXY_CONN_REUSED),
+    ESTATS_NAME(SYNPROXY_CONN_REUSED_CLOSE),
+    ESTATS_NAME(SYNPROXY_CONN_REUSED_TIMEWAIT),
+    ESTATS_NAME(SYNPROXY_CONN_REUSED_FINWAIT),
+    ESTATS_NAME(SYNPROXY_CONN_REUSED_CLOSEWAIT),
+    ESTATS_NAME(SYNPROXY_CONN_REUSED_LASTACK),
+    ESTATS_NAME(DEFENCE_IP_FRAG_DROP),
+    ESTATS_NAME(DEFENCE_TCP_DROP),
+    ESTATS_NAME(DEFENCE_UDP_DROP),
+    ESTATS_NAME(FAST_XMIT_REJECT),
+    ESTATS_NAME(FAST_XMIT_PASS),
+    ESTATS_NAME(FAST_XMIT_SKB_COPY),
+    ESTATS_NAME(FAST_XMIT_NO_MAC),
+    ESTATS_NAME(FAST_XMIT_SYNPROXY_SAVE),
+    ESTATS_NAME(FAST_XMIT_DEV_LOST),
+    ESTATS_NAME(FAST_XMIT_REJECT_INSIDE),
+    ESTATS_NAME(FAST_XMIT_PASS_INSIDE),
+    ESTATS_NAME(FAST_XMIT_SYNPROXY_SAVE_INSIDE),
+    ESTATS_NAME(RST_IN_SYN_SENT),
+    ESTATS_NAME(RST_OUT_SYN_SENT),
+    ESTATS_NAME(RST_IN_ESTABLISHED),
+    ESTATS_NAME(RST_OUT_ESTABLISHED),
+    ESTATS_NAME(GRO_PASS),
+    ESTATS_NAME(LRO_REJECT),
+    ESTATS_NAME(XMIT_UNEXPECTED_MTU),
+    ESTATS_NAME(CONN_SCHED_UNREACH),
+    ESTATS_NAME(SYNPROXY_NO_DEST),
+    ESTATS_NAME(CONN_EXCEEDED),
+    ESTATS_NAME(FULLNAT_ADD_TOA_HEADROOM),
+    ESTATS_NAME(FULLNAT_ADD_TOA_SPLIT),
+    ESTATS_NAME(FULLNAT_ADD_TOA_SHIFT),
+    ESTATS_NAME(FULLNAT_ADD_TOA_COMPACT),
+};
+
+/*
+ * sum of the counters over lcores. they are read without sync like the
+ * sesslog ones, a counter may be one burst behind.
+ */
+static int estats_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                              void **out, size_t *outsize)
+{
+    struct dp_vs_estats_show *show;
+    lcoreid_t cid;
+    size_t len;
+    int i, n = 0;
+
+    if (opt != SOCKOPT_GET_ESTATS_SHOW)
+        return EDPVS_NOTSUPP;
+
+    len = sizeof(*show) + DP_VS_EXT_STAT_LAST * sizeof(struct dp_vs_estats_entry);
+    show = rte_zmalloc(NULL, len, 0);
+    if (!show)
+        return EDPVS_NOMEM;
+
+    for (i = 0; i < DP_VS_EXT_STAT_LAST; i++) {
+        if (!dp_vs_estats_names[i])
+            continue;
+
+        snprintf(show->stats[n].name, sizeof(show->stats[n].name), "%s",
+                 dp_vs_estats_names[i]);
+        for (cid = 0; cid < DPVS_MAX_LCORE; cid++)
+            show->stats[n].value += dpvs_estats[cid].mibs[i];
+        n++;
+    }
+    show->nstats = n;
+
+    *out = show;
+    *outsize = sizeof(*show) + n * sizeof(struct dp_vs_estats_entry);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts estats_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = 0,
+    .set_opt_max    = 0,
+    .set            = NULL,
+    .get_opt_min    = SOCKOPT_GET_ESTATS_SHOW,
+    .get_opt_max    = SOCKOPT_GET_ESTATS_SHOW,
+    .get            = estats_sockopt_get,
+};
+
 int dp_vs_stats_init(void)
 {
+    int err;
+
     dp_vs_stats_clear();
     srand(rte_rdtsc());
     register_stats_cb();
+
+    if ((err = sockopt_register(&estats_sockopts)) != EDPVS_OK) {
+        unregister_stats_cb();
+        return err;
+    }
     return EDPVS_OK;
 }
 
 int dp_vs_stats_term(void)
 {
+    sockopt_unregister(&estats_sockopts);
     unregister_stats_cb();
     return EDPVS_OK;
 }
@@ -0,0 +1,1203 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/**
+ * Connection synchronization between directors.
+ *
+ * Master director: workers never touch the socket, they copy the conns
+ * to sync into per-lcore buffers (from a shared mempool) and pass full
+ * buffers to master through per-lcore SP/SC rings, partial buffers are
+ * flushed by a slow loop job. master encodes the events into compact
+ * datagrams (addresses sized by address family, seq block for TCP only)
+ * and sends them to the multicast group.
+ *
+ * Backup director: master receives the datagrams, validates them and
+ * passes the events to the lcore owning the conn (by FNAT local port, or
+ * the originating lcore) with async unicast msgs, the owner creates or
+ * updates the conn in its own table.
+ */
+#include <assert.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include "common.h"
+#include "dpdk.h"
+#include "netif.h"
+#include "ctrl.h"
+#include "sa_pool.h"
+#include "parser/parser.h"
+#include "ipvs/ipvs.h"
+#include "ipvs/conn.h"
+#include "ipvs/dest.h"
+#include "ipvs/service.h"
+#include "ipvs/proto.h"
+#include "ipvs/proto_tcp.h"
+#include "ipvs/proto_udp.h"
+#include "ipvs/sync.h"
+
+#define DP_VS_SYNC_VERSION          1
+
+#define DP_VS_SYNC_BUFF_EVENTS      32      /* events per worker buffer */
+#define DP_VS_SYNC_POOL_SIZE        2047
+#define DP_VS_SYNC_POOL_CACHE       32
+#define DP_VS_SYNC_RING_SIZE        256
+#define DP_VS_SYNC_DEQ_BURST        32
+#define DP_VS_SYNC_RECV_BURST       32      /* datagrams per master loop */
+#define DP_VS_SYNC_FLUSH_LOOPS      1024
+
+#define DP_VS_SYNC_MCAST_GROUP_DEF  "224.0.0.81"
+#define DP_VS_SYNC_MCAST_PORT_DEF   8848
+#define DP_VS_SYNC_MCAST_TTL_DEF    1
+#define DP_VS_SYNC_REFRESH_DEF      30      /* sec */
+#define DP_VS_SYNC_MAXLEN_DEF       1472    /* 1500 - IP - UDP */
+#define DP_VS_SYNC_MAXLEN_MIN       256
+#define DP_VS_SYNC_MAXLEN_MAX       8972    /* 9000 - IP - UDP */
+
+/* event types */
+#define DP_VS_SYNC_ADD              1
+#define DP_VS_SYNC_DEL              2
+
+/* wire options */
+#define DP_VS_SYNC_OPT_SEQ          0x1
+
+/* flags carried to the backup */
+#define DP_VS_SYNC_CONN_FLAGS       DPVS_CONN_F_SYNPROXY
+
+enum {
+    DP_VS_SYNC_DAEMON_MASTER = 0,
+    DP_VS_SYNC_DAEMON_BACKUP,
+    DP_VS_SYNC_DAEMON_MAX,
+};
+
+/* conn event, passed from workers to master (master director), or
+ * from master to workers (backup director). ports in network order. */
+struct dp_vs_sync_event {
+    uint8_t             type;
+    uint8_t             af;
+    uint8_t             daf;
+    uint8_t             proto;
+    uint8_t             fwdmode;
+    uint8_t             cid;        /* lcore owning the conn on master director */
+    uint16_t            flags;
+    uint16_t            state;
+    uint16_t            cport;
+    uint16_t            vport;
+    uint16_t            lport;
+    uint16_t            dport;
+    union inet_addr     caddr;
+    union inet_addr     vaddr;
+    union inet_addr     laddr;
+    union inet_addr     daddr;
+    struct dp_vs_seq    fnat_seq;
+    struct dp_vs_seq    syn_proxy_seq;
+    uint32_t            rs_end_seq;
+    uint32_t            rs_end_ack;
+};
+
+struct dp_vs_sync_buff {
+    uint16_t                nr;
+    struct dp_vs_sync_event events[DP_VS_SYNC_BUFF_EVENTS];
+};
+
+/*
+ * wire format, all fields in network order:
+ *
+ *   mesg header | conn header | caddr vaddr (af) | laddr daddr (daf) | [seq] | ...
+ */
+struct dp_vs_sync_mesg_hdr {
+    uint8_t             version;
+    uint8_t             syncid;
+    uint16_t            size;       /* whole datagram */
+    uint8_t             nr_conns;
+    uint8_t             reserved[3];
+} __attribute__((__packed__));
+
+struct dp_vs_sync_conn_hdr {
+    uint8_t             type;
+    uint8_t             af;
+    uint8_t             daf;
+    uint8_t             proto;
+    uint8_t             fwdmode;
+    uint8_t             cid;
+    uint8_t             opts;
+    uint8_t             reserved;
+    uint16_t            flags;
+    uint16_t            state;
+    uint16_t            cport;
+    uint16_t            vport;
+    uint16_t            lport;
+    uint16_t            dport;
+} __attribute__((__packed__));
+
+struct dp_vs_sync_seq_opt {
+    uint32_t            fnat_seq[4];        /* isn, delta, fdata_seq, prev_delta */
+    uint32_t            syn_proxy_seq[4];
+    uint32_t            rs_end_seq;
+    uint32_t            rs_end_ack;
+} __attribute__((__packed__));
+
+struct dp_vs_sync_lcore {
+    struct rte_ring         *ring;  /* buffers to master */
+    struct dp_vs_sync_buff  *curr;  /* buffer being filled */
+    struct dp_vs_sync_stats stats;  /* worker part */
+} __rte_cache_aligned;
+
+/* events pending for a worker on backup director */
+struct dp_vs_sync_pending {
+    uint16_t                nr;
+    struct dp_vs_sync_event events[DP_VS_SYNC_BUFF_EVENTS];
+};
+
+struct dp_vs_sync_daemon {
+    int                             sockfd;     /* -1 if stopped */
+    struct dp_vs_sync_daemon_conf   conf;
+    struct sockaddr_in              group;
+    uint16_t                        maxlen;
+    uint16_t                        len;        /* master: mesg being built */
+    uint8_t                         nr_conns;
+};
+
+volatile bool dp_vs_sync_master_on = false;
+
+static struct dp_vs_sync_lcore sync_lcores[DPVS_MAX_LCORE];
+static struct rte_mempool *sync_buff_pool;
+static struct netif_lcore_loop_job sync_job;
+
+/* master lcore only */
+static struct dp_vs_sync_daemon sync_daemons[DP_VS_SYNC_DAEMON_MAX];
+static struct dp_vs_sync_stats sync_stats;
+static struct dp_vs_sync_pending *sync_pendings;
+static char sync_mesg[DP_VS_SYNC_MAXLEN_MAX];
+static char sync_recv_buf[DP_VS_SYNC_MAXLEN_MAX];
+
+static uint8_t g_slave_lcore_nb;
+static uint64_t g_slave_lcore_mask;
+static lcoreid_t sync_first_slave;
+
+/* config */
+static struct in_addr sync_mcast_group;
+static uint16_t sync_mcast_port = DP_VS_SYNC_MCAST_PORT_DEF;
+static int sync_mcast_ttl = DP_VS_SYNC_MCAST_TTL_DEF;
+static int sync_refresh = DP_VS_SYNC_REFRESH_DEF;
+static int sync_maxlen = DP_VS_SYNC_MAXLEN_DEF;
+static uint64_t sync_refresh_cycles;
+
+static inline int sync_addr_len(int af)
+{
+    return af == AF_INET6 ? sizeof(struct in6_addr) : sizeof(struct in_addr);
+}
+
+/*
+ * workers, master director
+ */
+static void sync_lcore_flush(struct dp_vs_sync_lcore *sl)
+{
+    struct dp_vs_sync_buff *buff = sl->curr;
+
+    if (!buff)
+        return;
+    sl->curr = NULL;
+
+    if (unlikely(rte_ring_sp_enqueue(sl->ring, buff) != 0)) {
+        sl->stats.dropped += buff->nr;
+        rte_mempool_put(sync_buff_pool, buff);
+    }
+}
+
+static int sync_conn_queue(struct dp_vs_conn *conn, uint8_t type)
+{
+    struct dp_vs_sync_lcore *sl = &sync_lcores[rte_lcore_id()];
+    struct dp_vs_sync_buff *buff = sl->curr;
+    struct dp_vs_sync_event *ev;
+
+    if (unlikely(!sl->ring))
+        return EDPVS_NOTSUPP;
+
+    if (!buff) {
+        if (unlikely(rte_mempool_get(sync_buff_pool, (void **)&buff) != 0)) {
+            sl->stats.dropped++;
+            return EDPVS_NOMEM;
+        }
+        buff->nr = 0;
+        sl->curr = buff;
+    }
+
+    ev = &buff->events[buff->nr++];
+    ev->type        = type;
+    ev->af          = conn->af;
+    ev->daf         = tuplehash_out(conn).af;
+    ev->proto       = conn->proto;
+    ev->fwdmode     = conn->dest->fwdmode;
+    ev->cid         = rte_lcore_id();
+    ev->flags       = conn->flags & DP_VS_SYNC_CONN_FLAGS;
+    ev->state       = conn->state;
+    ev->cport       = conn->cport;
+    ev->vport       = conn->vport;
+    ev->lport       = conn->lport;
+    ev->dport       = conn->dport;
+    ev->caddr       = conn->caddr;
+    ev->vaddr       = conn->vaddr;
+    ev->laddr       = conn->laddr;
+    ev->daddr       = conn->daddr;
+    if (conn->proto == IPPROTO_TCP) {
+        ev->fnat_seq        = conn->fnat_seq;
+        ev->syn_proxy_seq   = conn->syn_proxy_seq;
+        ev->rs_end_seq      = conn->rs_end_seq;
+        ev->rs_end_ack      = conn->rs_end_ack;
+    }
+    sl->stats.queued++;
+
+    if (buff->nr >= DP_VS_SYNC_BUFF_EVENTS)
+        sync_lcore_flush(sl);
+
+    return EDPVS_OK;
+}
+
+void __dp_vs_sync_conn(struct dp_vs_conn *conn, uint16_t old_state)
+{
+    uint64_t now;
+
+    if ((conn->flags & DPVS_CONN_F_TEMPLATE) || !conn->dest)
+        return;
+    /* SNAT conns hold an address of the director's own pool */
+    if (conn->dest->fwdmode == DPVS_FWD_MODE_SNAT)
+        return;
+
+    now = rte_get_timer_cycles();
+
+    switch (conn->proto) {
+    case IPPROTO_TCP:
+        if (conn->state == DPVS_TCP_S_ESTABLISHED) {
+            if ((conn->flags & DPVS_CONN_F_SYNCED) && conn->state == old_state
+                    && now - conn->sync_tsc < sync_refresh_cycles)
+                return;
+        } else if (!(conn->flags & DPVS_CONN_F_SYNCED) || conn->state == old_state) {
+            /* only closing of established conns is interesting */
+            return;
+        }
+        break;
+    case IPPROTO_UDP:
+        if ((conn->flags & DPVS_CONN_F_SYNCED)
+                && now - conn->sync_tsc < sync_refresh_cycles)
+            return;
+        break;
+    default:
+        return;
+    }
+
+    if (sync_conn_queue(conn, DP_VS_SYNC_ADD) == EDPVS_OK) {
+        conn->flags |= DPVS_CONN_F_SYNCED;
+        conn->sync_tsc = now;
+    }
+}
+
+void __dp_vs_sync_conn_expire(struct dp_vs_conn *conn)
+{
+    if (!conn->dest)
+        return;
+
+    if (sync_conn_queue(conn, DP_VS_SYNC_DEL) == EDPVS_OK)
+        conn->flags &= ~DPVS_CONN_F_SYNCED;
+}
+
+static void sync_lcore_job(void *arg)
+{
+    struct dp_vs_sync_lcore *sl = &sync_lcores[rte_lcore_id()];
+
+    if (sl->curr)
+        sync_lcore_flush(sl);
+}
+
+/*
+ * master lcore, master director
+ */
+static void sync_master_send(struct dp_vs_sync_daemon *d)
+{
+    struct dp_vs_sync_mesg_hdr *hdr = (struct dp_vs_sync_mesg_hdr *)sync_mesg;
+
+    if (!d->nr_conns)
+        return;
+
+    hdr->version    = DP_VS_SYNC_VERSION;
+    hdr->syncid     = d->conf.syncid;
+    hdr->size       = htons(d->len);
+    hdr->nr_conns   = d->nr_conns;
+    memset(hdr->reserved, 0, sizeof(hdr->reserved));
+
+    if (sendto(d->sockfd, sync_mesg, d->len, 0, (struct sockaddr *)&d->group,
+               sizeof(d->group)) < 0) {
+        sync_stats.send_errors++;
+    } else {
+        sync_stats.sent_mesgs++;
+        sync_stats.sent_conns += d->nr_conns;
+    }
+
+    d->len = sizeof(*hdr);
+    d->nr_conns = 0;
+}
+
+static void sync_master_encode(struct dp_vs_sync_daemon *d,
+                               const struct dp_vs_sync_event *ev)
+{
+    struct dp_vs_sync_conn_hdr *ch;
+    struct dp_vs_sync_seq_opt *opt;
+    int alen = sync_addr_len(ev->af);
+    int dlen = sync_addr_len(ev->daf);
+    int len;
+    char *p;
+
+    len = sizeof(*ch) + 2 * alen + 2 * dlen;
+    if (ev->proto == IPPROTO_TCP)
+        len += sizeof(*opt);
+
+    if (d->len + len > d->maxlen || d->nr_conns == UINT8_MAX)
+        sync_master_send(d);
+
+    p = sync_mesg + d->len;
+    ch = (struct dp_vs_sync_conn_hdr *)p;
+    ch->type        = ev->type;
+    ch->af          = ev->af;
+    ch->daf         = ev->daf;
+    ch->proto       = ev->proto;
+    ch->fwdmode     = ev->fwdmode;
+    ch->cid         = ev->cid;
+    ch->opts        = ev->proto == IPPROTO_TCP ? DP_VS_SYNC_OPT_SEQ : 0;
+    ch->reserved    = 0;
+    ch->flags       = htons(ev->flags);
+    ch->state       = htons(ev->state);
+    ch->cport       = ev->cport;
+    ch->vport       = ev->vport;
+    ch->lport       = ev->lport;
+    ch->dport       = ev->dport;
+    p += sizeof(*ch);
+
+    rte_memcpy(p, &ev->caddr, alen);
+    p += alen;
+    rte_memcpy(p, &ev->vaddr, alen);
+    p += alen;
+    rte_memcpy(p, &ev->laddr, dlen);
+    p += dlen;
+    rte_memcpy(p, &ev->daddr, dlen);
+    p += dlen;
+
+    if (ch->opts & DP_VS_SYNC_OPT_SEQ) {
+        opt = (struct dp_vs_sync_seq_opt *)p;
+        opt->fnat_seq[0]        = htonl(ev->fnat_seq.isn);
+        opt->fnat_seq[1]        = htonl(ev->fnat_seq.delta);
+        opt->fnat_seq[2]        = htonl(ev->fnat_seq.fdata_seq);
+        opt->fnat_seq[3]        = htonl(ev->fnat_seq.prev_delta);
+        opt->syn_proxy_seq[0]   = htonl(ev->syn_proxy_seq.isn);
+        opt->syn_proxy_seq[1]   = htonl(ev->syn_proxy_seq.delta);
+        opt->syn_proxy_seq[2]   = htonl(ev->syn_proxy_seq.fdata_seq);
+        opt->syn_proxy_seq[3]   = htonl(ev->syn_proxy_seq.prev_delta);
+        opt->rs_end_seq         = htonl(ev->rs_end_seq);
+        opt->rs_end_ack         = htonl(ev->rs_end_ack);
+    }
+
+    d->len += len;
+    d->nr_conns++;
+}
+
+static void sync_master_process(void)
+{
+    struct dp_vs_sync_daemon *d = &sync_daemons[DP_VS_SYNC_DAEMON_MASTER];
+    struct dp_vs_sync_buff *buffs[DP_VS_SYNC_DEQ_BURST];
+    unsigned i, j, n;
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!sync_lcores[cid].ring)
+            continue;
+
+        n = rte_ring_sc_dequeue_burst(sync_lcores[cid].ring, (void **)buffs,
+                                      DP_VS_SYNC_DEQ_BURST, NULL);
+        for (i = 0; i < n; i++) {
+            /* buffers still in flight after stop are dropped */
+            if (d->sockfd >= 0) {
+                for (j = 0; j < buffs[i]->nr; j++)
+                    sync_master_encode(d, &buffs[i]->events[j]);
+            }
+            rte_mempool_put(sync_buff_pool, buffs[i]);
+        }
+    }
+
+    if (d->sockfd >= 0)
+        sync_master_send(d);
+}
+
+/*
+ * backup director
+ */
+static void sync_conn_set_state(struct dp_vs_conn *conn, uint16_t state)
+{
+    struct dp_vs_proto *pp = dp_vs_proto_lookup(conn->proto);
+    struct dp_vs_dest *dest = conn->dest;
+    unsigned conn_timeout = 0;
+
+    conn->old_state = conn->state;
+    conn->state = state;
+
+    if ((conn->proto == IPPROTO_TCP && state == DPVS_TCP_S_ESTABLISHED) ||
+        (conn->proto == IPPROTO_UDP && state == DPVS_UDP_S_NORMAL))
+        conn_timeout = dp_vs_get_conn_timeout(conn);
+
+    if (conn_timeout > 0)
+        conn->timeout.tv_sec = conn_timeout;
+    else if (pp && pp->timeout_table)
+        conn->timeout.tv_sec = pp->timeout_table[state];
+    else
+        conn->timeout.tv_sec = 60;
+    conn->timeout.tv_usec = 0;
+
+    if (conn->proto != IPPROTO_TCP || !dest)
+        return;
+
+    /* same accounting as tcp_state_trans */
+    if (!(conn->flags & DPVS_CONN_F_INACTIVE)
+            && (state != DPVS_TCP_S_ESTABLISHED)) {
+        rte_atomic32_dec(&dest->actconns);
+        rte_atomic32_inc(&dest->inactconns);
+        conn->flags |= DPVS_CONN_F_INACTIVE;
+    } else if ((conn->flags & DPVS_CONN_F_INACTIVE)
+            && (state == DPVS_TCP_S_ESTABLISHED)) {
+        rte_atomic32_inc(&dest->actconns);
+        rte_atomic32_dec(&dest->inactconns);
+        conn->flags &= ~DPVS_CONN_F_INACTIVE;
+    }
+}
+
+static void sync_conn_update(struct dp_vs_conn *conn,
+                             const struct dp_vs_sync_event *ev)
+{
+    if (ev->type == DP_VS_SYNC_DEL) {
+        /* let it expire soon, the timer does not accept zero delay */
+        if (conn->proto == IPPROTO_TCP)
+            sync_conn_set_state(conn, DPVS_TCP_S_CLOSE);
+        conn->timeout.tv_sec = 1;
+        conn->timeout.tv_usec = 0;
+        return;
+    }
+
+    if (conn->state != ev->state)
+        sync_conn_set_state(conn, ev->state);
+    else
+        sync_conn_set_state(conn, conn->state); /* refresh timeout */
+
+    if (conn->proto == IPPROTO_TCP) {
+        conn->fnat_seq      = ev->fnat_seq;
+        conn->syn_proxy_seq = ev->syn_proxy_seq;
+        conn->rs_end_seq    = ev->rs_end_seq;
+        conn->rs_end_ack    = ev->rs_end_ack;
+    }
+}
+
+static int sync_conn_install(const struct dp_vs_sync_event *ev)
+{
+    struct dp_vs_sync_lcore *sl = &sync_lcores[rte_lcore_id()];
+    struct dp_vs_conn_param param;
+    struct dp_vs_service *svc;
+    struct dp_vs_dest *dest;
+    struct dp_vs_conn *conn;
+    int dir;
+
+    conn = dp_vs_conn_get(ev->af, ev->proto, &ev->caddr, &ev->vaddr,
+                          ev->cport, ev->vport, &dir, false);
+    if (conn) {
+        if (dir != DPVS_CONN_DIR_INBOUND || conn->dport != ev->dport ||
+                !inet_addr_equal(ev->daf, &conn->daddr, &ev->daddr)) {
+            /* scheduled to another RS locally, keep ours */
+            dp_vs_conn_put_no_reset(conn);
+            sl->stats.install_errors++;
+            return EDPVS_EXIST;
+        }
+
+        sync_conn_update(conn, ev);
+        dp_vs_conn_put(conn);
+        sl->stats.updated++;
+        return EDPVS_OK;
+    }
+
+    if (ev->type == DP_VS_SYNC_DEL)
+        return EDPVS_OK;
+
+    svc = dp_vs_service_lookup(ev->af, ev->proto, &ev->vaddr, ev->vport,
+                               0, NULL, NULL);
+    if (!svc) {
+        sl->stats.install_errors++;
+        return EDPVS_NOSERV;
+    }
+
+    conn = NULL;
+    dp_vs_conn_fill_param(ev->af, ev->proto, &ev->caddr, &ev->vaddr,
+                          ev->cport, ev->vport, 0, &param);
+
+    rte_rwlock_read_lock(&svc->sched_lock);
+    dest = dp_vs_lookup_dest(ev->daf, svc, &ev->daddr, ev->dport);
+    if (dest && dest->fwdmode == ev->fwdmode)
+        conn = dp_vs_conn_sync_new(&param, dest, &ev->laddr, ev->lport,
+                                   &ev->daddr, ev->dport, ev->flags);
+    rte_rwlock_read_unlock(&svc->sched_lock);
+    dp_vs_service_put(svc);
+
+    if (!conn) {
+        sl->stats.install_errors++;
+        return dest ? EDPVS_RESOURCE : EDPVS_NOTEXIST;
+    }
+
+    sync_conn_update(conn, ev);
+    dp_vs_conn_put(conn);
+    sl->stats.installed++;
+    return EDPVS_OK;
+}
+
+static int sync_conn_msgcb_slave(struct dpvs_msg *msg)
+{
+    const struct dp_vs_sync_event *evs;
+    unsigned i, n;
+
+    if (!msg || !msg->data)
+        return EDPVS_INVAL;
+
+    evs = (const struct dp_vs_sync_event *)msg->data;
+    n = msg->len / sizeof(struct dp_vs_sync_event);
+
+    for (i = 0; i < n; i++)
+        sync_conn_install(&evs[i]);
+
+    return EDPVS_OK;
+}
+
+static lcoreid_t sync_backup_owner(const struct dp_vs_sync_event *ev)
+{
+    struct sockaddr_storage dss, sss;
+    lcoreid_t cid;
+
+    /* FNAT inbound is steered by <laddr, lport, rs>, see sa_pool */
+    if (ev->fwdmode == DPVS_FWD_MODE_FNAT) {
+        memset(&dss, 0, sizeof(dss));
+        memset(&sss, 0, sizeof(sss));
+        if (ev->daf == AF_INET) {
+            struct sockaddr_in *dsin = (struct sockaddr_in *)&dss;
+            struct sockaddr_in *ssin = (struct sockaddr_in *)&sss;
+            dsin->sin_family = ssin->sin_family = AF_INET;
+            dsin->sin_addr = ev->daddr.in;
+            dsin->sin_port = ev->dport;
+            ssin->sin_addr = ev->laddr.in;
+            ssin->sin_port = ev->lport;
+        } else {
+            struct sockaddr_in6 *dsin6 = (struct sockaddr_in6 *)&dss;
+            struct sockaddr_in6 *ssin6 = (struct sockaddr_in6 *)&sss;
+            dsin6->sin6_family = ssin6->sin6_family = AF_INET6;
+            dsin6->sin6_addr = ev->daddr.in6;
+            dsin6->sin6_port = ev->dport;
+            ssin6->sin6_addr = ev->laddr.in6;
+            ssin6->sin6_port = ev->lport;
+        }
+
+        cid = sa_lcore_of(&dss, &sss);
+        if (cid < 64 && (g_slave_lcore_mask & (1UL << cid)))
+            return cid;
+    }
+
+    if (ev->cid < 64 && (g_slave_lcore_mask & (1UL << ev->cid)))
+        return ev->cid;
+
+    return sync_first_slave;
+}
+
+static void sync_backup_dispatch(lcoreid_t cid)
+{
+    struct dp_vs_sync_pending *pd = &sync_pendings[cid];
+    struct dpvs_msg *msg;
+
+    if (!pd->nr)
+        return;
+
+    msg = msg_make(MSG_TYPE_SYNC_CONN, 0, DPVS_MSG_UNICAST, rte_lcore_id(),
+                   pd->nr * sizeof(struct dp_vs_sync_event), pd->events);
+    if (unlikely(!msg)) {
+        sync_stats.install_errors += pd->nr;
+        pd->nr = 0;
+        return;
+    }
+
+    if (msg_send(msg, cid, DPVS_MSG_F_ASYNC, NULL) != EDPVS_OK)
+        sync_stats.install_errors += pd->nr;
+
+    msg_destroy(&msg);
+    pd->nr = 0;
+}
+
+static int sync_backup_decode(struct dp_vs_sync_daemon *d,
+                              const char *buf, int len)
+{
+    const struct dp_vs_sync_mesg_hdr *hdr = (const struct dp_vs_sync_mesg_hdr *)buf;
+    const struct dp_vs_sync_conn_hdr *ch;
+    const struct dp_vs_sync_seq_opt *opt;
+    const char *p, *end = buf + len;
+    struct dp_vs_sync_event ev;
+    struct dp_vs_sync_pending *pd;
+    int i, alen, dlen;
+    lcoreid_t cid;
+
+    if (len < sizeof(*hdr) || hdr->version != DP_VS_SYNC_VERSION ||
+            ntohs(hdr->size) != len)
+        return EDPVS_INVPKT;
+
+    if (d->conf.syncid && hdr->syncid != d->conf.syncid)
+        return EDPVS_INVPKT;
+
+    p = buf + sizeof(*hdr);
+    for (i = 0; i < hdr->nr_conns; i++) {
+        if (p + sizeof(*ch) > end)
+            return EDPVS_INVPKT;
+        ch = (const struct dp_vs_sync_conn_hdr *)p;
+        p += sizeof(*ch);
+
+        if ((ch->af != AF_INET && ch->af != AF_INET6) ||
+                (ch->daf != AF_INET && ch->daf != AF_INET6) ||
+                (ch->type != DP_VS_SYNC_ADD && ch->type != DP_VS_SYNC_DEL))
+            return EDPVS_INVPKT;
+        if ((ch->proto == IPPROTO_TCP && ntohs(ch->state) >= DPVS_TCP_S_LAST) ||
+                (ch->proto == IPPROTO_UDP && ntohs(ch->state) >= DPVS_UDP_S_LAST) ||
+                (ch->proto != IPPROTO_TCP && ch->proto != IPPROTO_UDP))
+            return EDPVS_INVPKT;
+
+        alen = sync_addr_len(ch->af);
+        dlen = sync_addr_len(ch->daf);
+        if (p + 2 * alen + 2 * dlen > end)
+            return EDPVS_INVPKT;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.type     = ch->type;
+        ev.af       = ch->af;
+        ev.daf      = ch->daf;
+        ev.proto    = ch->proto;
+        ev.fwdmode  = ch->fwdmode;
+        ev.cid      = ch->cid;
+        ev.flags    = ntohs(ch->flags) & DP_VS_SYNC_CONN_FLAGS;
+        ev.state    = ntohs(ch->state);
+        ev.cport    = ch->cport;
+        ev.vport    = ch->vport;
+        ev.lport    = ch->lport;
+        ev.dport    = ch->dport;
+
+        rte_memcpy(&ev.caddr, p, alen);
+        p += alen;
+        rte_memcpy(&ev.vaddr, p, alen);
+        p += alen;
+        rte_memcpy(&ev.laddr, p, dlen);
+        p += dlen;
+        rte_memcpy(&ev.daddr, p, dlen);
+        p += dlen;
+
+        if (ch->opts & DP_VS_SYNC_OPT_SEQ) {
+            if (p + sizeof(*opt) > end)
+                return EDPVS_INVPKT;
+            opt = (const struct dp_vs_sync_seq_opt *)p;
+            p += sizeof(*opt);
+
+            ev.fnat_seq.isn             = ntohl(opt->fnat_seq[0]);
+            ev.fnat_seq.delta           = ntohl(opt->fnat_seq[1]);
+            ev.fnat_seq.fdata_seq       = ntohl(opt->fnat_seq[2]);
+            ev.fnat_seq.prev_delta      = ntohl(opt->fnat_seq[3]);
+            ev.syn_proxy_seq.isn        = ntohl(opt->syn_proxy_seq[0]);
+            ev.syn_proxy_seq.delta      = ntohl(opt->syn_proxy_seq[1]);
+            ev.syn_proxy_seq.fdata_seq  = ntohl(opt->syn_proxy_seq[2]);
+            ev.syn_proxy_seq.prev_delta = ntohl(opt->syn_proxy_seq[3]);
+            ev.rs_end_seq               = ntohl(opt->rs_end_seq);
+            ev.rs_end_ack               = ntohl(opt->rs_end_ack);
+        }
+
+        cid = sync_backup_owner(&ev);
+        pd = &sync_pendings[cid];
+        pd->events[pd->nr++] = ev;
+        if (pd->nr >= DP_VS_SYNC_BUFF_EVENTS)
+            sync_backup_dispatch(cid);
+
+        sync_stats.recv_conns++;
+    }
+
+    return EDPVS_OK;
+}
+
+static void sync_backup_process(void)
+{
+    struct dp_vs_sync_daemon *d = &sync_daemons[DP_VS_SYNC_DAEMON_BACKUP];
+    lcoreid_t cid;
+    ssize_t len;
+    int i;
+
+    for (i = 0; i < DP_VS_SYNC_RECV_BURST; i++) {
+        len = recv(d->sockfd, sync_recv_buf, sizeof(sync_recv_buf), 0);
+        if (len < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                sync_stats.recv_errors++;
+            break;
+        }
+
+        sync_stats.recv_mesgs++;
+        if (sync_backup_decode(d, sync_recv_buf, len) != EDPVS_OK)
+            sync_stats.recv_errors++;
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (sync_pendings[cid].nr)
+            sync_backup_dispatch(cid);
+    }
+}
+
+void dp_vs_sync_process_on_master(void)
+{
+    sync_master_process();
+
+    if (sync_daemons[DP_VS_SYNC_DAEMON_BACKUP].sockfd >= 0)
+        sync_backup_process();
+}
+
+/*
+ * control plane
+ */
+static int sync_daemon_start(const struct dp_vs_sync_daemon_conf *conf)
+{
+    struct dp_vs_sync_daemon *d;
+    struct ip_mreqn mreq;
+    unsigned char ttl, loop = 0;
+    int sockfd, ifindex, on = 1;
+
+    if (conf->state == DP_VS_SYNC_MASTER)
+        d = &sync_daemons[DP_VS_SYNC_DAEMON_MASTER];
+    else if (conf->state == DP_VS_SYNC_BACKUP)
+        d = &sync_daemons[DP_VS_SYNC_DAEMON_BACKUP];
+    else
+        return EDPVS_INVAL;
+
+    if (d->sockfd >= 0)
+        return EDPVS_EXIST;
+
+    if (conf->syncid < 0 || conf->syncid > UINT8_MAX)
+        return EDPVS_INVAL;
+
+    ifindex = if_nametoindex(conf->mcast_ifn);
+    if (!ifindex) {
+        RTE_LOG(ERR, IPVS, "%s: no kernel interface %s\n", __func__, conf->mcast_ifn);
+        return EDPVS_NODEV;
+    }
+
+    sockfd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (sockfd < 0)
+        return EDPVS_SYSCALL;
+
+    memset(&d->group, 0, sizeof(d->group));
+    d->group.sin_family = AF_INET;
+    d->group.sin_addr = sync_mcast_group;
+    d->group.sin_port = htons(sync_mcast_port);
+
+    memset(&mreq, 0, sizeof(mreq));
+    mreq.imr_multiaddr = sync_mcast_group;
+    mreq.imr_ifindex = ifindex;
+
+    if (conf->state == DP_VS_SYNC_MASTER) {
+        ttl = sync_mcast_ttl;
+        if (setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_IF, &mreq, sizeof(mreq)) < 0 ||
+            setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0 ||
+            setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop)) < 0)
+            goto errout;
+    } else {
+        if (!sync_pendings) {
+            sync_pendings = rte_zmalloc(NULL, DPVS_MAX_LCORE *
+                                        sizeof(struct dp_vs_sync_pending), 0);
+            if (!sync_pendings) {
+                close(sockfd);
+                return EDPVS_NOMEM;
+            }
+        }
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+            bind(sockfd, (struct sockaddr *)&d->group, sizeof(d->group)) < 0 ||
+            setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+            goto errout;
+    }
+
+    d->conf = *conf;
+    d->conf.mcast_ifn[IFNAMSIZ - 1] = '\0';
+    d->maxlen = sync_maxlen;
+    d->len = sizeof(struct dp_vs_sync_mesg_hdr);
+    d->nr_conns = 0;
+    d->sockfd = sockfd;
+
+    if (conf->state == DP_VS_SYNC_MASTER) {
+        sync_refresh_cycles = (uint64_t)sync_refresh * rte_get_timer_hz();
+        rte_wmb();
+        dp_vs_sync_master_on = true;
+    }
+
+    RTE_LOG(INFO, IPVS, "sync %s started: %s:%u on %s, syncid %d\n",
+            conf->state == DP_VS_SYNC_MASTER ? "master" : "backup",
+            inet_ntoa(sync_mcast_group), sync_mcast_port,
+            d->conf.mcast_ifn, d->conf.syncid);
+    return EDPVS_OK;
+
+errout:
+    RTE_LOG(ERR, IPVS, "%s: fail to setup sync socket on %s: %s\n",
+            __func__, conf->mcast_ifn, strerror(errno));
+    close(sockfd);
+    return EDPVS_SYSCALL;
+}
+
+static int sync_daemon_stop(int state)
+{
+    struct dp_vs_sync_daemon *d;
+
+    if (state == DP_VS_SYNC_MASTER)
+        d = &sync_daemons[DP_VS_SYNC_DAEMON_MASTER];
+    else if (state == DP_VS_SYNC_BACKUP)
+        d = &sync_daemons[DP_VS_SYNC_DAEMON_BACKUP];
+    else
+        return EDPVS_INVAL;
+
+    if (d->sockfd < 0)
+        return EDPVS_NOTEXIST;
+
+    if (state == DP_VS_SYNC_MASTER) {
+        dp_vs_sync_master_on = false;
+        sync_master_send(d);
+    } else {
+        /* events decoded are always dispatched in the same round */
+        if (sync_pendings)
+            memset(sync_pendings, 0, DPVS_MAX_LCORE * sizeof(struct dp_vs_sync_pending));
+    }
+
+    close(d->sockfd);
+    d->sockfd = -1;
+
+    RTE_LOG(INFO, IPVS, "sync %s stopped\n",
+            state == DP_VS_SYNC_MASTER ? "master" : "backup");
+    return EDPVS_OK;
+}
+
+static int sync_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    const struct dp_vs_sync_daemon_conf *dconf = conf;
+
+    if (!conf || size < sizeof(struct dp_vs_sync_daemon_conf))
+        return EDPVS_INVAL;
+
+    switch (opt) {
+    case SOCKOPT_SET_SYNC_START:
+        return sync_daemon_start(dconf);
+    case SOCKOPT_SET_SYNC_STOP:
+        return sync_daemon_stop(dconf->state);
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static int sync_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
+                            void **out, size_t *outsize)
+{
+    struct dp_vs_sync_show *show;
+    struct dp_vs_sync_stats *st;
+    lcoreid_t cid;
+    int i;
+
+    if (opt != SOCKOPT_GET_SYNC_SHOW)
+        return EDPVS_NOTSUPP;
+
+    show = rte_zmalloc(NULL, sizeof(*show), 0);
+    if (!show)
+        return EDPVS_NOMEM;
+
+    for (i = 0; i < DP_VS_SYNC_DAEMON_MAX; i++) {
+        if (sync_daemons[i].sockfd >= 0)
+            show->daemons[i] = sync_daemons[i].conf;
+    }
+
+    show->stats = sync_stats;
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        st = &sync_lcores[cid].stats;
+        show->stats.queued          += st->queued;
+        show->stats.dropped         += st->dropped;
+        show->stats.installed       += st->installed;
+        show->stats.updated         += st->updated;
+        show->stats.install_errors  += st->install_errors;
+    }
+
+    *out = show;
+    *outsize = sizeof(*show);
+    return EDPVS_OK;
+}
+
+static struct dpvs_sockopts sync_sockopts = {
+    .version        = SOCKOPT_VERSION,
+    .set_opt_min    = SOCKOPT_SET_SYNC_START,
+    .set_opt_max    = SOCKOPT_SET_SYNC_STOP,
+    .set            = sync_sockopt_set,
+    .get_opt_min    = SOCKOPT_GET_SYNC_SHOW,
+    .get_opt_max    = SOCKOPT_GET_SYNC_SHOW,
+    .get            = sync_sockopt_get,
+};
+
+static int sync_msg_register(bool reg)
+{
+    struct dpvs_msg_type msg_type;
+    lcoreid_t cid;
+    int err;
+
+    memset(&msg_type, 0, sizeof(struct dpvs_msg_type));
+    msg_type.type = MSG_TYPE_SYNC_CONN;
+    msg_type.mode = DPVS_MSG_UNICAST;
+    msg_type.unicast_msg_cb = sync_conn_msgcb_slave;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(g_slave_lcore_mask & (1UL << cid)))
+            continue;
+        msg_type.cid = cid;
+        err = reg ? msg_type_register(&msg_type) : msg_type_unregister(&msg_type);
+        if (err != EDPVS_OK) {
+            RTE_LOG(ERR, IPVS, "%s: fail to %sregister sync msg on lcore%d -- %s\n",
+                    __func__, reg ? "" : "un", cid, dpvs_strerror(err));
+            return err;
+        }
+    }
+
+    return EDPVS_OK;
+}
+
+int dp_vs_sync_init(void)
+{
+    char name[RTE_RING_NAMESIZE];
+    lcoreid_t cid;
+    int i, err;
+
+    for (i = 0; i < DP_VS_SYNC_DAEMON_MAX; i++)
+        sync_daemons[i].sockfd = -1;
+
+    netif_get_slave_lcores(&g_slave_lcore_nb, &g_slave_lcore_mask);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (g_slave_lcore_mask & (1UL << cid)) {
+            sync_first_slave = cid;
+            break;
+        }
+    }
+
+    sync_buff_pool = rte_mempool_create("dp_vs_sync_buff", DP_VS_SYNC_POOL_SIZE,
+                                        sizeof(struct dp_vs_sync_buff),
+                                        DP_VS_SYNC_POOL_CACHE, 0, NULL, NULL,
+                                        NULL, NULL, SOCKET_ID_ANY, 0);
+    if (!sync_buff_pool) {
+        RTE_LOG(ERR, IPVS, "%s: fail to create sync buffer pool\n", __func__);
+        return EDPVS_NOMEM;
+    }
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(g_slave_lcore_mask & (1UL << cid)))
+            continue;
+
+        snprintf(name, sizeof(name), "dp_vs_sync_ring_c%d", cid);
+        sync_lcores[cid].ring = rte_ring_create(name, DP_VS_SYNC_RING_SIZE,
+                rte_lcore_to_socket_id(cid), RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!sync_lcores[cid].ring) {
+            RTE_LOG(ERR, IPVS, "%s: fail to create %s\n", __func__, name);
+            err = EDPVS_NOMEM;
+            goto errout;
+        }
+    }
+
+    snprintf(sync_job.name, sizeof(sync_job.name) - 1, "%s", "ipvs_sync");
+    sync_job.func = sync_lcore_job;
+    sync_job.data = NULL;
+    sync_job.type = NETIF_LCORE_JOB_SLOW;
+    sync_job.skip_loops = DP_VS_SYNC_FLUSH_LOOPS;
+    if ((err = netif_lcore_loop_job_register(&sync_job)) != EDPVS_OK) {
+        RTE_LOG(ERR, IPVS, "%s: fail to register loop job\n", __func__);
+        goto errout;
+    }
+
+    if ((err = sync_msg_register(true)) != EDPVS_OK)
+        goto unreg_job;
+
+    if ((err = sockopt_register(&sync_sockopts)) != EDPVS_OK)
+        goto unreg_msg;
+
+    return EDPVS_OK;
+
+unreg_msg:
+    sync_msg_register(false);
+unreg_job:
+    netif_lcore_loop_job_unregister(&sync_job);
+errout:
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(sync_lcores[cid].ring);
+        sync_lcores[cid].ring = NULL;
+    }
+    rte_mempool_free(sync_buff_pool);
+    sync_buff_pool = NULL;
+    return err;
+}
+
+int dp_vs_sync_term(void)
+{
+    lcoreid_t cid;
+    int err;
+
+    sync_daemon_stop(DP_VS_SYNC_MASTER);
+    sync_daemon_stop(DP_VS_SYNC_BACKUP);
+
+    if ((err = sockopt_unregister(&sync_sockopts)) != EDPVS_OK)
+        return err;
+
+    sync_msg_register(false);
+    netif_lcore_loop_job_unregister(&sync_job);
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        rte_ring_free(sync_lcores[cid].ring);
+        sync_lcores[cid].ring = NULL;
+    }
+    rte_free(sync_pendings);
+    sync_pendings = NULL;
+    rte_mempool_free(sync_buff_pool);
+    sync_buff_pool = NULL;
+
+    return EDPVS_OK;
+}
+
+/*
+ * config file
+ */
+static void sync_mcast_group_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    struct in_addr addr;
+
+    assert(str);
+
+    if (inet_pton(AF_INET, str, &addr) == 1 && IN_MULTICAST(ntohl(addr.s_addr))) {
+        RTE_LOG(INFO, IPVS, "sync mcast_group = %s\n", str);
+        sync_mcast_group = addr;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync mcast_group %s, using default %s\n",
+                str, DP_VS_SYNC_MCAST_GROUP_DEF);
+        inet_pton(AF_INET, DP_VS_SYNC_MCAST_GROUP_DEF, &sync_mcast_group);
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_mcast_port_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int port;
+
+    assert(str);
+
+    port = atoi(str);
+    if (port > 0 && port <= 65535) {
+        RTE_LOG(INFO, IPVS, "sync mcast_port = %d\n", port);
+        sync_mcast_port = port;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync mcast_port %s, using default %d\n",
+                str, DP_VS_SYNC_MCAST_PORT_DEF);
+        sync_mcast_port = DP_VS_SYNC_MCAST_PORT_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_mcast_ttl_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int ttl;
+
+    assert(str);
+
+    ttl = atoi(str);
+    if (ttl > 0 && ttl <= 255) {
+        RTE_LOG(INFO, IPVS, "sync mcast_ttl = %d\n", ttl);
+        sync_mcast_ttl = ttl;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync mcast_ttl %s, using default %d\n",
+                str, DP_VS_SYNC_MCAST_TTL_DEF);
+        sync_mcast_ttl = DP_VS_SYNC_MCAST_TTL_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_refresh_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int refresh;
+
+    assert(str);
+
+    refresh = atoi(str);
+    if (refresh > 0 && refresh < IPVS_TIMEOUT_MAX) {
+        RTE_LOG(INFO, IPVS, "sync_refresh = %d\n", refresh);
+        sync_refresh = refresh;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync_refresh %s, using default %d\n",
+                str, DP_VS_SYNC_REFRESH_DEF);
+        sync_refresh = DP_VS_SYNC_REFRESH_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+static void sync_maxlen_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    int maxlen;
+
+    assert(str);
+
+    maxlen = atoi(str);
+    if (maxlen >= DP_VS_SYNC_MAXLEN_MIN && maxlen <= DP_VS_SYNC_MAXLEN_MAX) {
+        RTE_LOG(INFO, IPVS, "sync_maxlen = %d\n", maxlen);
+        sync_maxlen = maxlen;
+    } else {
+        RTE_LOG(WARNING, IPVS, "invalid sync_maxlen %s, using default %d\n",
+                str, DP_VS_SYNC_MAXLEN_DEF);
+        sync_maxlen = DP_VS_SYNC_MAXLEN_DEF;
+    }
+
+    FREE_PTR(str);
+}
+
+void ipvs_sync_keyword_value_init(void)
+{
+    /* KW_TYPE_NORMAL keyword, applied on next start of the daemon */
+    inet_pton(AF_INET, DP_VS_SYNC_MCAST_GROUP_DEF, &sync_mcast_group);
+    sync_mcast_port = DP_VS_SYNC_MCAST_PORT_DEF;
+    sync_mcast_ttl = DP_VS_SYNC_MCAST_TTL_DEF;
+    sync_refresh = DP_VS_SYNC_REFRESH_DEF;
+    sync_maxlen = DP_VS_SYNC_MAXLEN_DEF;
+}
+
+void install_ipvs_sync_keywords(void)
+{
+    install_sublevel();
+    install_keyword("mcast_group", sync_mcast_group_handler, KW_TYPE_NORMAL);
+    install_keyword("mcast_port", sync_mcast_port_handler, KW_TYPE_NORMAL);
+    install_keyword("mcast_ttl", sync_mcast_ttl_handler, KW_TYPE_NORMAL);
+    install_keyword("sync_refresh", sync_refresh_handler, KW_TYPE_NORMAL);
+    install_keyword("sync_maxlen", sync_maxlen_handler, KW_TYPE_NORMAL);
+    install_sublevel_end();
+}
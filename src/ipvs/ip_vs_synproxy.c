@@ -892,6 +892,9 @@ static int syn_proxy_send_rs_syn(int af, const struct tcphdr *th,
         syn_ip6h->ip6_hlim = IPV6_DEFAULT_HOPLIMIT;
 
         syn_mbuf->l3_len = sizeof(*syn_ip6h);
+
+        /* fnat_in_handler updates it incrementally */
+        tcp6_send_csum((struct ipv6_hdr *)syn_ip6h, syn_th);
     } else {
         struct iphdr *ack_iph;
         struct iphdr *syn_iph;
@@ -915,8 +918,9 @@ static int syn_proxy_send_rs_syn(int af, const struct tcphdr *th,
 
         syn_mbuf->l3_len = sizeof(*syn_iph);
 
-        /* checksum is done by fnat_in_handler */
-        syn_iph->check = 0;
+        /* xmit and fnat_in_handler update them incrementally */
+        tcp4_send_csum((struct ipv4_hdr *)syn_iph, syn_th);
+        ip4_send_csum((struct ipv4_hdr *)syn_iph);
     }
 
     /* Save syn_mbuf if syn retransmission is on */
@@ -1169,6 +1173,7 @@ static int syn_proxy_send_window_update(int af, struct rte_mbuf *mbuf, struct dp
         ack_ip6h->ip6_plen = htons(sizeof(struct tcphdr));
         ack_ip6h->ip6_nxt = NEXTHDR_TCP;
         ack_mbuf->l3_len = sizeof(*ack_ip6h);
+        tcp6_send_csum((struct ipv6_hdr *)ack_ip6h, ack_th);
     } else {
         struct ipv4_hdr *ack_iph;
         struct ipv4_hdr *reuse_iph = ip4_hdr(mbuf);
@@ -1188,6 +1193,8 @@ static int syn_proxy_send_window_update(int af, struct rte_mbuf *mbuf, struct dp
         ack_iph->fragment_offset = htons(IPV4_HDR_DF_FLAG);
         ack_iph->total_length = htons(pkt_ack_len);
         ack_mbuf->l3_len = sizeof(*ack_iph);
+        tcp4_send_csum(ack_iph, ack_th);
+        ip4_send_csum(ack_iph);
     }
 
     conn->packet_out_xmit(pp, conn, ack_mbuf);
@@ -1205,6 +1212,7 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
     struct list_head save_mbuf;
     struct dp_vs_dest *dest = cp->dest;
     unsigned conn_timeout = 0;
+    uint32_t old_seq;
 
     th = mbuf_header_pointer(mbuf, th_offset, sizeof(_tcph), &_tcph);
     if (unlikely(!th)) {
@@ -1312,8 +1320,9 @@ int dp_vs_synproxy_synack_rcv(struct rte_mbuf *mbuf, struct dp_vs_conn *cp,
         cp->state = DPVS_TCP_S_CLOSE;
         cp->timeout.tv_sec = pp->timeout_table[cp->state];
         dpvs_time_rand_delay(&cp->timeout, 1000000);
+        old_seq = th->seq;
         th->seq = htonl(ntohl(th->seq) + 1);
-        //syn_proxy_seq_csum_update ?
+        inet_csum_replace4(&th->check, old_seq, th->seq);
 
         return 1;
     }
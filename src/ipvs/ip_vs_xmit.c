@@ -17,6 +17,7 @@
  */
 #include <netinet/ip_icmp.h>
 #include <netinet/icmp6.h>
+#include <arpa/inet.h>
 #include <assert.h>
 #include "dpdk.h"
 #include "ipv4.h"
@@ -26,29 +27,179 @@
 #include "icmp.h"
 #include "icmp6.h"
 #include "neigh.h"
+#include "conf/neigh.h"
 #include "ipvs/xmit.h"
 #include "ipvs/nat64.h"
+#include "ipvs/proto_udp.h"
+#include "vxlan.h"
 #include "parser/parser.h"
 
 static bool fast_xmit_close = false;
 static bool xmit_ttl = false;
 
+/*
+ * burst xmit stage of fast-xmit.
+ *
+ * packets translated in one rx burst are staged per lcore and grouped by
+ * (output device, L2 header). at the end of the burst, L2 header of each
+ * group is written by vector stores, and the group is queued to txq at
+ * once, see dp_vs_xmit_burst_flush().
+ */
+#define DP_VS_XMIT_GROUPS       8
+
+struct dp_vs_xmit_group {
+    union {
+        xmm_t               l2_v;   /* L2 header in the lower 14 bytes */
+        struct ether_hdr    l2;
+    };
+    struct netif_port       *dev;
+    uint16_t                len;
+    struct rte_mbuf         *mbufs[NETIF_MAX_PKT_BURST];
+};
+
+struct dp_vs_xmit_stage {
+    uint16_t                ngroups;
+    struct dp_vs_xmit_group groups[DP_VS_XMIT_GROUPS];
+} __rte_cache_aligned;
+
+static struct dp_vs_xmit_stage dp_vs_xmit_stages[DPVS_MAX_LCORE];
+
+static inline void dp_vs_xmit_l2_fill(struct ether_hdr *eth,
+                                      const struct dp_vs_xmit_group *grp)
+{
+#ifdef RTE_MACHINE_CPUFLAG_SSE4_1
+    /* one 16-byte store, with the 2 bytes after L2 header unchanged */
+    xmm_t v = _mm_loadu_si128((xmm_t *)eth);
+
+    v = _mm_blend_epi16(v, grp->l2_v, 0x7f);
+    _mm_storeu_si128((xmm_t *)eth, v);
+#else
+    rte_memcpy(eth, &grp->l2, sizeof(struct ether_hdr));
+#endif
+}
+
+static void dp_vs_xmit_group_flush(struct dp_vs_xmit_group *grp)
+{
+    int i;
+
+    for (i = 0; i < grp->len; i++)
+        dp_vs_xmit_l2_fill(rte_pktmbuf_mtod(grp->mbufs[i], struct ether_hdr *),
+                           grp);
+
+    netif_xmit_burst(grp->mbufs, grp->len, grp->dev);
+    grp->len = 0;
+}
+
+void dp_vs_xmit_burst_flush(lcoreid_t cid)
+{
+    int i;
+    struct dp_vs_xmit_stage *stage = &dp_vs_xmit_stages[cid];
+
+    /* UOA mapping of new UDP conns goes ahead of their packets */
+    udp_uoa_batch_flush(cid);
+
+    for (i = 0; i < stage->ngroups; i++) {
+        if (stage->groups[i].len)
+            dp_vs_xmit_group_flush(&stage->groups[i]);
+    }
+    stage->ngroups = 0;
+}
+
+/* stage translated @mbuf (at L3) for burst xmit, @mbuf is always consumed */
+static int dp_vs_xmit_burst_add(struct rte_mbuf *mbuf, struct netif_port *dev,
+                                const struct ether_addr *dmac,
+                                const struct ether_addr *smac,
+                                uint16_t packet_type)
+{
+    int i;
+    lcoreid_t cid = rte_lcore_id();
+    struct dp_vs_xmit_stage *stage = &dp_vs_xmit_stages[cid];
+    struct dp_vs_xmit_group *grp;
+    struct ether_hdr *eth;
+
+    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
+                    (uint16_t)sizeof(struct ether_hdr));
+    if (unlikely(!eth)) {
+        RTE_LOG(DEBUG, IPVS, "%s: no mbuf head room for L2 header.\n", __func__);
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_OK;
+    }
+    mbuf->packet_type = packet_type;
+
+    /* not in rx burst (no flush follows) */
+    if (unlikely(rte_get_master_lcore() == cid)) {
+        ether_addr_copy(dmac, &eth->d_addr);
+        ether_addr_copy(smac, &eth->s_addr);
+        eth->ether_type = rte_cpu_to_be_16(packet_type);
+        if (netif_xmit(mbuf, dev) != EDPVS_OK)
+            RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
+        return EDPVS_OK;
+    }
+
+    for (i = 0; i < stage->ngroups; i++) {
+        grp = &stage->groups[i];
+        if (grp->dev == dev
+                && grp->l2.ether_type == rte_cpu_to_be_16(packet_type)
+                && is_same_ether_addr(&grp->l2.d_addr, dmac)
+                && is_same_ether_addr(&grp->l2.s_addr, smac))
+            goto found;
+    }
+
+    if (unlikely(stage->ngroups == DP_VS_XMIT_GROUPS))
+        dp_vs_xmit_burst_flush(cid);
+
+    grp = &stage->groups[stage->ngroups++];
+    grp->dev = dev;
+    grp->len = 0;
+    ether_addr_copy(dmac, &grp->l2.d_addr);
+    ether_addr_copy(smac, &grp->l2.s_addr);
+    grp->l2.ether_type = rte_cpu_to_be_16(packet_type);
+
+found:
+    grp->mbufs[grp->len++] = mbuf;
+    if (unlikely(grp->len == NETIF_MAX_PKT_BURST)) {
+        udp_uoa_batch_flush(cid);
+        dp_vs_xmit_group_flush(grp);
+    }
+
+    return EDPVS_OK;
+}
+
+/*
+ * next hop to RS of @conn cached by current lcore, NULL if not cached
+ * or stale. conn learns its inbound device from the cache, which is
+ * used to know MTU without route.
+ */
+static inline struct dp_vs_dest_nh *dp_vs_conn_nh(struct dp_vs_conn *conn)
+{
+    struct dp_vs_dest_nh *nh;
+
+    if (unlikely(!conn->dest))
+        return NULL;
+
+    nh = dp_vs_dest_lcore_nh(conn->dest);
+    if (nh->gen != neigh_generation())
+        return NULL;
+
+    if (unlikely(!conn->in_dev))
+        conn->in_dev = nh->dev;
+
+    return nh;
+}
+
 static int __dp_vs_fast_xmit_fnat4(struct dp_vs_proto *proto,
                                    struct dp_vs_conn *conn,
                                    struct rte_mbuf *mbuf)
 {
     struct ipv4_hdr *ip4h = ip4_hdr(mbuf);
-    struct ether_hdr *eth;
     uint16_t packet_type = ETHER_TYPE_IPv4;
+    struct dp_vs_dest_nh *nh;
     int err;
 
-    if (unlikely(conn->in_dev == NULL))
+    nh = dp_vs_conn_nh(conn);
+    if (unlikely(!nh))
         return EDPVS_NOROUTE;
 
-    if (unlikely(is_zero_ether_addr(&conn->in_dmac) ||
-                 is_zero_ether_addr(&conn->in_smac)))
-        return EDPVS_NOTSUPP;
-
     /* pre-handler before translation */
     if (proto->fnat_in_pre_handler) {
         err = proto->fnat_in_pre_handler(proto, conn, mbuf);
@@ -62,35 +213,27 @@ static int __dp_vs_fast_xmit_fnat4(struct dp_vs_proto *proto,
         ip4h = ip4_hdr(mbuf);
     }
 
-    ip4h->hdr_checksum = 0;
-    ip4h->src_addr = conn->laddr.in.s_addr;
-    ip4h->dst_addr = conn->daddr.in.s_addr;
+    ip4_set_saddr(ip4h, conn->laddr.in.s_addr);
+    ip4_set_daddr(ip4h, conn->daddr.in.s_addr);
 
     if(proto->fnat_in_handler) {
         err = proto->fnat_in_handler(proto, conn, mbuf);
         if(err != EDPVS_OK)
             return err;
-    }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
-        ip4h->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(ip4h);
+        /*
+         * re-fetch IP header
+         * the offset may changed during handler (TOA of aggregates)
+         */
+        ip4h = ip4_hdr(mbuf);
     }
 
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
-                    (uint16_t)sizeof(struct ether_hdr));
-    ether_addr_copy(&conn->in_dmac, &eth->d_addr);
-    ether_addr_copy(&conn->in_smac, &eth->s_addr);
-    eth->ether_type = rte_cpu_to_be_16(packet_type);
-    mbuf->packet_type = packet_type;
-
-    err = netif_xmit(mbuf, conn->in_dev);
-    if (err != EDPVS_OK)
-        RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
+        ip4h->hdr_checksum = 0;
 
-    /* must return OK since netif_xmit alway consume mbuf */
-    return EDPVS_OK;
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, packet_type);
 }
 
 static int __dp_vs_fast_xmit_fnat6(struct dp_vs_proto *proto,
@@ -98,17 +241,14 @@ static int __dp_vs_fast_xmit_fnat6(struct dp_vs_proto *proto,
                                    struct rte_mbuf *mbuf)
 {
     struct ip6_hdr *ip6h = ip6_hdr(mbuf);
-    struct ether_hdr *eth;
     uint16_t packet_type = ETHER_TYPE_IPv6;
+    struct dp_vs_dest_nh *nh;
     int err;
 
-    if (unlikely(conn->in_dev == NULL))
+    nh = dp_vs_conn_nh(conn);
+    if (unlikely(!nh))
         return EDPVS_NOROUTE;
 
-    if (unlikely(is_zero_ether_addr(&conn->in_dmac) ||
-                 is_zero_ether_addr(&conn->in_smac)))
-        return EDPVS_NOTSUPP;
-
     /* pre-handler before translation */
     if (proto->fnat_in_pre_handler) {
         err = proto->fnat_in_pre_handler(proto, conn, mbuf);
@@ -131,19 +271,9 @@ static int __dp_vs_fast_xmit_fnat6(struct dp_vs_proto *proto,
             return err;
     }
 
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
-                    (uint16_t)sizeof(struct ether_hdr));
-    ether_addr_copy(&conn->in_dmac, &eth->d_addr);
-    ether_addr_copy(&conn->in_smac, &eth->s_addr);
-    eth->ether_type = rte_cpu_to_be_16(packet_type);
-    mbuf->packet_type = packet_type;
-
-    err = netif_xmit(mbuf, conn->in_dev);
-    if (err != EDPVS_OK)
-        RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
-
-    /* must return OK since netif_xmit alway consume mbuf */
-    return EDPVS_OK;
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, packet_type);
 }
 
 static int dp_vs_fast_xmit_fnat(int af,
@@ -160,7 +290,6 @@ static int __dp_vs_fast_outxmit_fnat4(struct dp_vs_proto *proto,
                                       struct rte_mbuf *mbuf)
 {
     struct ipv4_hdr *ip4h = ip4_hdr(mbuf);
-    struct ether_hdr *eth;
     uint16_t packet_type = ETHER_TYPE_IPv4;
     int err;
 
@@ -184,9 +313,8 @@ static int __dp_vs_fast_outxmit_fnat4(struct dp_vs_proto *proto,
         ip4h = ip4_hdr(mbuf);
     }
 
-    ip4h->hdr_checksum = 0;
-    ip4h->src_addr = conn->vaddr.in.s_addr;
-    ip4h->dst_addr = conn->caddr.in.s_addr;
+    ip4_set_saddr(ip4h, conn->vaddr.in.s_addr);
+    ip4_set_daddr(ip4h, conn->caddr.in.s_addr);
 
     if(proto->fnat_out_handler) {
         err = proto->fnat_out_handler(proto, conn, mbuf);
@@ -194,25 +322,12 @@ static int __dp_vs_fast_outxmit_fnat4(struct dp_vs_proto *proto,
             return err;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         ip4h->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(ip4h);
-    }
-
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
-                    (uint16_t)sizeof(struct ether_hdr));
-    ether_addr_copy(&conn->out_dmac, &eth->d_addr);
-    ether_addr_copy(&conn->out_smac, &eth->s_addr);
-    eth->ether_type = rte_cpu_to_be_16(packet_type);
-    mbuf->packet_type = packet_type;
-
-    err = netif_xmit(mbuf, conn->out_dev);
-    if (err != EDPVS_OK)
-        RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
 
-    /* must return OK since netif_xmit alway consume mbuf */
-    return EDPVS_OK;
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, conn->out_dev, &conn->out_dmac,
+                                &conn->out_smac, packet_type);
 }
 
 static int __dp_vs_fast_outxmit_fnat6(struct dp_vs_proto *proto,
@@ -220,7 +335,6 @@ static int __dp_vs_fast_outxmit_fnat6(struct dp_vs_proto *proto,
                                       struct rte_mbuf *mbuf)
 {
     struct ip6_hdr *ip6h = ip6_hdr(mbuf);
-    struct ether_hdr *eth;
     uint16_t packet_type = ETHER_TYPE_IPv6;
     int err;
 
@@ -253,19 +367,9 @@ static int __dp_vs_fast_outxmit_fnat6(struct dp_vs_proto *proto,
             return err;
     }
 
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
-                    (uint16_t)sizeof(struct ether_hdr));
-    ether_addr_copy(&conn->out_dmac, &eth->d_addr);
-    ether_addr_copy(&conn->out_smac, &eth->s_addr);
-    eth->ether_type = rte_cpu_to_be_16(packet_type);
-    mbuf->packet_type = packet_type;
-
-    err = netif_xmit(mbuf, conn->out_dev);
-    if (err != EDPVS_OK)
-        RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
-
-    /* must return OK since netif_xmit alway consume mbuf */
-    return EDPVS_OK;
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, conn->out_dev, &conn->out_dmac,
+                                &conn->out_smac, packet_type);
 }
 
 static int dp_vs_fast_outxmit_fnat(int af,
@@ -277,6 +381,131 @@ static int dp_vs_fast_outxmit_fnat(int af,
         : __dp_vs_fast_outxmit_fnat6(proto, conn, mbuf);
 }
 
+/*
+ * NAT64 fast xmit, v4 next hop from dest's cache.
+ * anything needs ICMPv6 (PMTU, TTL) falls back to slow path before
+ * the packet is touched.
+ */
+static int __dp_vs_fast_xmit_fnat64(struct dp_vs_proto *proto,
+                                    struct dp_vs_conn *conn,
+                                    struct rte_mbuf *mbuf)
+{
+    struct ip6_hdr *ip6h = ip6_hdr(mbuf);
+    struct ipv4_hdr *ip4h;
+    uint16_t packet_type = ETHER_TYPE_IPv4;
+    struct dp_vs_dest_nh *nh;
+    int err;
+
+    nh = dp_vs_conn_nh(conn);
+    if (unlikely(!nh))
+        return EDPVS_NOROUTE;
+
+    /* ext_hdr not support */
+    if (unlikely(mbuf->l3_len != sizeof(struct ip6_hdr)))
+        return EDPVS_NOTSUPP;
+
+    if (unlikely(mbuf_nat6to4_len(mbuf) > nh->mtu))
+        return EDPVS_FRAG;
+
+    if (xmit_ttl && unlikely(ip6h->ip6_hops <= 1))
+        return EDPVS_DROP;
+
+    /* pre-handler before translation */
+    if (proto->fnat_in_pre_handler) {
+        err = proto->fnat_in_pre_handler(proto, conn, mbuf);
+        if (err != EDPVS_OK)
+            return err;
+
+        /*
+         * re-fetch IP header
+         * the offset may changed during pre-handler
+         */
+        ip6h = ip6_hdr(mbuf);
+    }
+
+    if (xmit_ttl)
+        ip6h->ip6_hops--;
+
+    /* L3 translation before l4 re-csum */
+    err = mbuf_6to4(mbuf, &conn->laddr.in, &conn->daddr.in);
+    if (err != EDPVS_OK)
+        return err;
+
+    if (proto->fnat_in_handler) {
+        err = proto->fnat_in_handler(proto, conn, mbuf);
+        if (err != EDPVS_OK)
+            return err;
+    }
+
+    /* header checksum is kept valid since translation */
+    ip4h = ip4_hdr(mbuf);
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
+        ip4h->hdr_checksum = 0;
+
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, packet_type);
+}
+
+/* NAT46 fast xmit to client, by L2 info saved from client's packets. */
+static int __dp_vs_fast_outxmit_fnat46(struct dp_vs_proto *proto,
+                                       struct dp_vs_conn *conn,
+                                       struct rte_mbuf *mbuf)
+{
+    struct ipv4_hdr *ip4h = ip4_hdr(mbuf);
+    uint16_t packet_type = ETHER_TYPE_IPv6;
+    int err;
+
+    if (unlikely(conn->out_dev == NULL))
+        return EDPVS_NOROUTE;
+
+    if (unlikely(is_zero_ether_addr(&conn->out_dmac) ||
+                 is_zero_ether_addr(&conn->out_smac)))
+        return EDPVS_NOTSUPP;
+
+    if (unlikely(mbuf->l3_len != sizeof(struct ipv4_hdr)))
+        return EDPVS_NOTSUPP;
+
+    /* IPv6 never fragments on the way, let slow path decide */
+    if (unlikely(mbuf_nat4to6_len(mbuf) > conn->out_dev->mtu))
+        return EDPVS_FRAG;
+
+    if (xmit_ttl && unlikely(ip4h->time_to_live <= 1))
+        return EDPVS_DROP;
+
+    /* pre-handler before translation */
+    if (proto->fnat_out_pre_handler) {
+        err = proto->fnat_out_pre_handler(proto, conn, mbuf);
+        if (err != EDPVS_OK)
+            return err;
+
+        /*
+         * re-fetch IP header
+         * the offset may changed during pre-handler
+         */
+        ip4h = ip4_hdr(mbuf);
+    }
+
+    /* no need to fix IPv4 header checksum, it's dropped */
+    if (xmit_ttl)
+        ip4h->time_to_live--;
+
+    /* L3 translation before l4 re-csum */
+    err = mbuf_4to6(mbuf, &conn->vaddr.in6, &conn->caddr.in6);
+    if (err != EDPVS_OK)
+        return err;
+
+    if (proto->fnat_out_handler) {
+        err = proto->fnat_out_handler(proto, conn, mbuf);
+        if (err != EDPVS_OK)
+            return err;
+    }
+
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, conn->out_dev, &conn->out_dmac,
+                                &conn->out_smac, packet_type);
+}
+
 /*
  * ARP_HDR_ETHER SUPPORT ONLY
  * save source mac(client) for output in conn as dest mac
@@ -308,7 +537,7 @@ static void dp_vs_save_xmit_info(struct rte_mbuf *mbuf,
 }
 
 /*
- * save source mac(rs) for input in conn as dest mac
+ * save source mac(rs) for input in dest's next hop cache as dest mac
  */
 static void dp_vs_save_outxmit_info(struct rte_mbuf *mbuf,
                              struct dp_vs_proto *proto,
@@ -316,22 +545,30 @@ static void dp_vs_save_outxmit_info(struct rte_mbuf *mbuf,
 {
     struct ether_hdr *eth = NULL;
     struct netif_port *port = NULL;
+    struct dp_vs_dest_nh *nh;
 
-    if (!is_zero_ether_addr(&conn->in_dmac) &&
-        !is_zero_ether_addr(&conn->in_smac))
+    if (unlikely(!conn->dest))
+        return;
+
+    nh = dp_vs_dest_lcore_nh(conn->dest);
+    if (nh->gen == neigh_generation())
         return;
 
     if (mbuf->l2_len != sizeof(struct ether_hdr))
         return;
 
     port = netif_port_get(mbuf->port);
-    if (port)
-        conn->in_dev = port;
+    if (!port)
+        return;
+    conn->in_dev = port;
 
     eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf, mbuf->l2_len);
 
-    ether_addr_copy(&eth->s_addr, &conn->in_dmac);
-    ether_addr_copy(&eth->d_addr, &conn->in_smac);
+    nh->dev = port;
+    ether_addr_copy(&eth->s_addr, &nh->dmac);
+    ether_addr_copy(&eth->d_addr, &nh->smac);
+    nh->mtu = port->mtu;
+    nh->gen = neigh_generation();
 
     rte_pktmbuf_adj(mbuf, sizeof(struct ether_hdr));
 }
@@ -388,6 +625,170 @@ static void dp_vs_conn_cache_rt6(struct dp_vs_conn *conn, struct route6 *rt, boo
     }
 }
 
+/*
+ * cache next hop to RS in dest on slow path, so that all conns to the
+ * dest are fast xmitted. only reachable neighbours are cached, and the
+ * cache is stale as soon as neighbour or route of current lcore changes
+ * (see neigh_generation()).
+ */
+static void __dp_vs_dest_cache_nh(struct dp_vs_conn *conn, int af,
+                                  const union inet_addr *nexthop,
+                                  struct netif_port *dev, uint32_t mtu,
+                                  struct in_addr src)
+{
+    struct neighbour_entry *neigh;
+    struct dp_vs_dest_nh *nh;
+
+    if (fast_xmit_close || (conn->flags & DPVS_CONN_F_NOFASTXMIT))
+        return;
+
+    if (unlikely(!conn->dest) || !dev || (dev->flag & NETIF_PORT_FLAG_NO_ARP))
+        return;
+
+    nh = dp_vs_dest_lcore_nh(conn->dest);
+    if (nh->gen == neigh_generation())
+        return;
+
+    neigh = neigh_lookup_entry(af, nexthop, dev,
+                               neigh_hashkey(af, nexthop, dev));
+    if (!neigh || neigh->state != DPVS_NUD_S_REACHABLE)
+        return;
+
+    nh->dev = dev;
+    ether_addr_copy(&neigh->eth_addr, &nh->dmac);
+    ether_addr_copy(&dev->addr, &nh->smac);
+    nh->mtu = mtu;
+    nh->tun_src = src;
+    nh->vxlan = false;
+    nh->gen = neigh_generation();
+}
+
+static void dp_vs_dest_cache_nh4(struct dp_vs_conn *conn,
+                                 struct route_entry *rt)
+{
+    union inet_addr nexthop;
+
+    if (rt->gw.s_addr == htonl(INADDR_ANY))
+        nexthop.in = conn->daddr.in;
+    else
+        nexthop.in = rt->gw;
+
+    __dp_vs_dest_cache_nh(conn, AF_INET, &nexthop, rt->port,
+                          rt->mtu, rt->src);
+}
+
+static void dp_vs_dest_cache_nh6(struct dp_vs_conn *conn,
+                                 struct route6 *rt6)
+{
+    union inet_addr nexthop;
+    struct in_addr any = { .s_addr = htonl(INADDR_ANY) };
+
+    if (ipv6_addr_any(&rt6->rt6_gateway))
+        nexthop.in6 = conn->daddr.in6;
+    else
+        nexthop.in6 = rt6->rt6_gateway;
+
+    __dp_vs_dest_cache_nh(conn, AF_INET6, &nexthop, rt6->rt6_dev,
+                          rt6->rt6_mtu, any);
+}
+
+/*
+ * cache outer headers of VXLAN device @vdev, the route device to RS, in
+ * dest. both the RS on overlay and the remote VTEP on underlay must be
+ * reachable neighbours. @mtu is of the inner packet.
+ */
+static void dp_vs_dest_cache_vxlan(struct dp_vs_conn *conn,
+                                   struct netif_port *vdev, uint32_t mtu)
+{
+    struct neighbour_entry *neigh, *oneigh;
+    struct netif_port *odev;
+    union inet_addr onexthop;
+    struct vxlan_encap encap;
+    struct dp_vs_dest *dest = conn->dest;
+    struct dp_vs_dest_nh *nh;
+    uint8_t idx;
+
+    if (fast_xmit_close || (conn->flags & DPVS_CONN_F_NOFASTXMIT))
+        return;
+
+    if (unlikely(!dest) || !vdev || !is_vxlan_dev(vdev))
+        return;
+
+    nh = dp_vs_dest_lcore_nh(conn->dest);
+    if (nh->gen == neigh_generation())
+        return;
+
+    neigh = neigh_lookup_entry(conn->af, &conn->daddr, vdev,
+                               neigh_hashkey(conn->af, &conn->daddr, vdev));
+    if (!neigh || neigh->state != DPVS_NUD_S_REACHABLE)
+        return;
+
+    if (vxlan_encap_build(vdev, &encap, &odev, &onexthop) != EDPVS_OK)
+        return;
+
+    if (odev->flag & NETIF_PORT_FLAG_NO_ARP)
+        return;
+
+    oneigh = neigh_lookup_entry(AF_INET, &onexthop, odev,
+                                neigh_hashkey(AF_INET, &onexthop, odev));
+    if (!oneigh || oneigh->state != DPVS_NUD_S_REACHABLE)
+        return;
+
+    ether_addr_copy(&neigh->eth_addr, &encap.eth.d_addr);
+
+    /*
+     * headers change only if VXLAN device or RS changed, which bumps the
+     * generation of all lcores, so lcores still on the old copy leave it
+     * with their next packet. it's never rewritten while they are on it.
+     */
+    rte_spinlock_lock(&dest->encap_lock);
+    idx = dest->encap_cur;
+    if (memcmp(&dest->encap[idx], &encap, sizeof(encap)) != 0) {
+        idx ^= 1;
+        dest->encap[idx] = encap;
+        rte_wmb();
+        dest->encap_cur = idx;
+    }
+    rte_spinlock_unlock(&dest->encap_lock);
+
+    nh->dev = odev;
+    ether_addr_copy(&oneigh->eth_addr, &nh->dmac);
+    ether_addr_copy(&odev->addr, &nh->smac);
+    nh->mtu = mtu;
+    nh->tun_src.s_addr = htonl(INADDR_ANY);
+    nh->vxlan = true;
+    nh->encap_idx = idx;
+    nh->gen = neigh_generation();
+}
+
+/*
+ * DR fast xmit, neither route lookup nor neighbour resolution.
+ * packets need fragmentation or ICMP go to slow path.
+ */
+static int dp_vs_fast_xmit_dr(struct dp_vs_conn *conn,
+                              struct rte_mbuf *mbuf,
+                              uint16_t packet_type)
+{
+    struct dp_vs_dest_nh *nh;
+
+    if (fast_xmit_close || (conn->flags & DPVS_CONN_F_NOFASTXMIT))
+        return EDPVS_NOTSUPP;
+
+    nh = dp_vs_conn_nh(conn);
+    if (!nh || nh->vxlan)
+        return EDPVS_NOTEXIST;
+
+    if (unlikely(mbuf->userdata != NULL))
+        return EDPVS_NOTSUPP;
+
+    if (unlikely(mbuf_l3_seg_len(mbuf) > nh->mtu))
+        return EDPVS_FRAG;
+
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, packet_type);
+}
+
 static int __dp_vs_xmit_fnat4(struct dp_vs_proto *proto,
                               struct dp_vs_conn *conn,
                               struct rte_mbuf *mbuf)
@@ -404,6 +805,10 @@ static int __dp_vs_xmit_fnat4(struct dp_vs_proto *proto,
         }
     }
 
+    /* slow path sends at once, UOA mapping of the conn must go first */
+    if (conn->proto == IPPROTO_UDP)
+        udp_uoa_batch_kick(conn);
+
     /*
      * drop old route. just for safe, because
      * FNAT is PRE_ROUTING, should not have route.
@@ -430,9 +835,10 @@ static int __dp_vs_xmit_fnat4(struct dp_vs_proto *proto,
      * this is for neighbour confirm
      */
     dp_vs_conn_cache_rt(conn, rt, true);
+    dp_vs_dest_cache_nh4(conn, rt);
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG, htonl(mtu));
@@ -450,7 +856,7 @@ static int __dp_vs_xmit_fnat4(struct dp_vs_proto *proto,
             goto errout;
         }
 
-        iph->time_to_live--;
+        ip4_decrease_ttl(iph);
     }
 
     /* pre-handler before translation */
@@ -467,22 +873,24 @@ static int __dp_vs_xmit_fnat4(struct dp_vs_proto *proto,
     }
 
     /* L3 translation before l4 re-csum */
-    iph->hdr_checksum = 0;
-    iph->src_addr = conn->laddr.in.s_addr;
-    iph->dst_addr = conn->daddr.in.s_addr;
+    ip4_set_saddr(iph, conn->laddr.in.s_addr);
+    ip4_set_daddr(iph, conn->daddr.in.s_addr);
 
     /* L4 FNAT translation */
     if (proto->fnat_in_handler) {
         err = proto->fnat_in_handler(proto, conn, mbuf);
         if (err != EDPVS_OK)
             goto errout;
+
+        /*
+         * re-fetch IP header
+         * the offset may changed during handler (TOA of aggregates)
+         */
+        iph = ip4_hdr(mbuf);
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(iph);
-    }
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -510,6 +918,10 @@ static int __dp_vs_xmit_fnat6(struct dp_vs_proto *proto,
         }
     }
 
+    /* slow path sends at once, UOA mapping of the conn must go first */
+    if (conn->proto == IPPROTO_UDP)
+        udp_uoa_batch_kick(conn);
+
     /*
      * drop old route. just for safe, because
      * FNAT is PRE_ROUTING, should not have route.
@@ -535,10 +947,11 @@ static int __dp_vs_xmit_fnat6(struct dp_vs_proto *proto,
      * this is for neighbour confirm.
      */
     dp_vs_conn_cache_rt6(conn, rt6, true);
+    dp_vs_dest_cache_nh6(conn, rt6);
 
     // check mtu
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, mtu);
 
@@ -604,6 +1017,17 @@ static int __dp_vs_xmit_fnat64(struct dp_vs_proto *proto,
     struct route_entry *rt;
     int err, mtu;
 
+    if (!fast_xmit_close && !(conn->flags & DPVS_CONN_F_NOFASTXMIT)) {
+        dp_vs_save_xmit_info(mbuf, proto, conn);
+        if (!__dp_vs_fast_xmit_fnat64(proto, conn, mbuf)) {
+            return EDPVS_OK;
+        }
+    }
+
+    /* slow path sends at once, UOA mapping of the conn must go first */
+    if (conn->proto == IPPROTO_UDP)
+        udp_uoa_batch_kick(conn);
+
     /*
      * drop old route. just for safe, because
      * FNAT is PRE_ROUTING, should not have route.
@@ -629,6 +1053,7 @@ static int __dp_vs_xmit_fnat64(struct dp_vs_proto *proto,
      * this is for neighbour confirm
      */
     dp_vs_conn_cache_rt(conn, rt, true);
+    dp_vs_dest_cache_nh4(conn, rt);
 
     /*
      * mbuf is from IPv6, icmp should send by icmp6
@@ -666,8 +1091,6 @@ static int __dp_vs_xmit_fnat64(struct dp_vs_proto *proto,
     err = mbuf_6to4(mbuf, &conn->laddr.in, &conn->daddr.in);
     if (err)
         goto errout;
-    ip4h = ip4_hdr(mbuf);
-    ip4h->hdr_checksum = 0;
 
     /* L4 FNAT translation */
     if (proto->fnat_in_handler) {
@@ -676,11 +1099,14 @@ static int __dp_vs_xmit_fnat64(struct dp_vs_proto *proto,
             goto errout;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    /*
+     * re-fetch IP header
+     * the offset may changed during handler (TOA of aggregates)
+     * header checksum is kept valid since translation.
+     */
+    ip4h = ip4_hdr(mbuf);
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         ip4h->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(ip4h);
-    }
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -754,7 +1180,7 @@ static int __dp_vs_out_xmit_fnat4(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt(conn, rt, false);
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG, htonl(mtu));
@@ -772,7 +1198,7 @@ static int __dp_vs_out_xmit_fnat4(struct dp_vs_proto *proto,
             goto errout;
         }
 
-        iph->time_to_live--;
+        ip4_decrease_ttl(iph);
     }
 
     /* pre-handler before translation */
@@ -789,9 +1215,8 @@ static int __dp_vs_out_xmit_fnat4(struct dp_vs_proto *proto,
     }
 
     /* L3 translation before l4 re-csum */
-    iph->hdr_checksum = 0;
-    iph->src_addr = conn->vaddr.in.s_addr;
-    iph->dst_addr = conn->caddr.in.s_addr;
+    ip4_set_saddr(iph, conn->vaddr.in.s_addr);
+    ip4_set_daddr(iph, conn->caddr.in.s_addr);
 
     /* L4 FNAT translation */
     if (proto->fnat_out_handler) {
@@ -800,11 +1225,8 @@ static int __dp_vs_out_xmit_fnat4(struct dp_vs_proto *proto,
             goto errout;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(iph);
-    }
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -856,7 +1278,7 @@ static int __dp_vs_out_xmit_fnat6(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt6(conn, rt6, false);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
@@ -920,6 +1342,13 @@ static int __dp_vs_out_xmit_fnat46(struct dp_vs_proto *proto,
     struct route6 *rt6;
     int err, mtu;
 
+    if (!fast_xmit_close && !(conn->flags & DPVS_CONN_F_NOFASTXMIT)) {
+        dp_vs_save_outxmit_info(mbuf, proto, conn);
+        if (!__dp_vs_fast_outxmit_fnat46(proto, conn, mbuf)) {
+            return EDPVS_OK;
+        }
+    }
+
     /*
      * drop old route. just for safe, because
      * FNAT is PRE_ROUTING, should not have route.
@@ -1234,6 +1663,9 @@ static int __dp_vs_xmit_dr4(struct dp_vs_proto *proto,
     struct route_entry *rt;
     int err, mtu;
 
+    if (dp_vs_fast_xmit_dr(conn, mbuf, ETHER_TYPE_IPv4) == EDPVS_OK)
+        return EDPVS_OK;
+
     if (unlikely(mbuf->userdata != NULL)) {
         RTE_LOG(WARNING, IPVS, "%s: Already have route %p ?\n",
                 __func__, mbuf->userdata);
@@ -1254,7 +1686,7 @@ static int __dp_vs_xmit_dr4(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt(conn, rt, true);
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG, htonl(mtu));
@@ -1262,6 +1694,13 @@ static int __dp_vs_xmit_dr4(struct dp_vs_proto *proto,
         goto errout;
     }
 
+    /* DR always goes to RS directly */
+    if (conn->dest && conn->dest->fwdmode == DPVS_FWD_MODE_VXLAN)
+        dp_vs_dest_cache_vxlan(conn, rt->port, mtu);
+    else
+        __dp_vs_dest_cache_nh(conn, AF_INET, &conn->daddr, rt->port, mtu,
+                              rt->src);
+
     mbuf->packet_type = ETHER_TYPE_IPv4;
     err = neigh_output(AF_INET, (union inet_addr *)&conn->daddr.in, mbuf, rt->port);
     route4_put(rt);
@@ -1283,6 +1722,9 @@ static int __dp_vs_xmit_dr6(struct dp_vs_proto *proto,
     struct route6 *rt6;
     int err, mtu;
 
+    if (dp_vs_fast_xmit_dr(conn, mbuf, ETHER_TYPE_IPv6) == EDPVS_OK)
+        return EDPVS_OK;
+
     if (unlikely(mbuf->userdata != NULL)) {
         RTE_LOG(WARNING, IPVS, "%s: Already have route %p ?\n",
                 __func__, mbuf->userdata);
@@ -1302,13 +1744,19 @@ static int __dp_vs_xmit_dr6(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt6(conn, rt6, true);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
         goto errout;
     }
 
+    if (conn->dest && conn->dest->fwdmode == DPVS_FWD_MODE_VXLAN)
+        dp_vs_dest_cache_vxlan(conn, rt6->rt6_dev, mtu);
+    else
+        __dp_vs_dest_cache_nh(conn, AF_INET6, &conn->daddr, rt6->rt6_dev, mtu,
+                              (struct in_addr) { .s_addr = htonl(INADDR_ANY) });
+
     mbuf->packet_type = ETHER_TYPE_IPv6;
     err = neigh_output(AF_INET6, (union inet_addr *)&conn->daddr.in6, mbuf, rt6->rt6_dev);
     route6_put(rt6);
@@ -1370,7 +1818,7 @@ static int __dp_vs_xmit_snat4(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt(conn, rt, true);
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG, htonl(mtu));
@@ -1388,12 +1836,11 @@ static int __dp_vs_xmit_snat4(struct dp_vs_proto *proto,
             goto errout;
         }
 
-        iph->time_to_live--;
+        ip4_decrease_ttl(iph);
     }
 
     /* L3 translation before l4 re-csum */
-    iph->hdr_checksum = 0;
-    iph->dst_addr = conn->daddr.in.s_addr;
+    ip4_set_daddr(iph, conn->daddr.in.s_addr);
 
     /* L4 translation */
     if (proto->snat_in_handler) {
@@ -1405,8 +1852,6 @@ static int __dp_vs_xmit_snat4(struct dp_vs_proto *proto,
     /* L3 re-checksum */
     if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    else
-        ip4_send_csum(iph);
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -1454,7 +1899,7 @@ static int __dp_vs_xmit_snat6(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt6(conn, rt6, true);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
@@ -1531,7 +1976,7 @@ static int __dp_vs_out_xmit_snat4(struct dp_vs_proto *proto,
         dp_vs_conn_cache_rt(conn, rt, false);
     }
 
-    if (mbuf->pkt_len > rt->mtu &&
+    if (mbuf_l3_seg_len(mbuf) > rt->mtu &&
             (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG,
@@ -1548,12 +1993,11 @@ static int __dp_vs_out_xmit_snat4(struct dp_vs_proto *proto,
             goto errout;
         }
 
-        iph->time_to_live--;
+        ip4_decrease_ttl(iph);
     }
 
     /* L3 translation before L4 re-csum */
-    iph->hdr_checksum = 0;
-    iph->src_addr = conn->vaddr.in.s_addr;
+    ip4_set_saddr(iph, conn->vaddr.in.s_addr);
 
     /* L4 translation */
     if (proto->snat_out_handler) {
@@ -1565,8 +2009,6 @@ static int __dp_vs_out_xmit_snat4(struct dp_vs_proto *proto,
     /* L3 re-checksum */
     if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    else
-        ip4_send_csum(iph);
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -1583,18 +2025,14 @@ static int dp_vs_fast_xmit_nat(struct dp_vs_proto *proto,
                     struct rte_mbuf *mbuf)
 {
     struct ipv4_hdr *iph = ip4_hdr(mbuf);
-    struct ether_hdr *eth;
+    struct dp_vs_dest_nh *nh;
     int err;
 
-    if (unlikely(conn->in_dev == NULL))
+    nh = dp_vs_conn_nh(conn);
+    if (unlikely(!nh))
         return EDPVS_NOROUTE;
 
-    if (unlikely(is_zero_ether_addr(&conn->in_dmac) ||
-                 is_zero_ether_addr(&conn->in_smac)))
-        return EDPVS_NOTSUPP;
-
-    iph->hdr_checksum = 0;
-    iph->dst_addr = conn->daddr.in.s_addr;
+    ip4_set_daddr(iph, conn->daddr.in.s_addr);
 
     if (proto->nat_in_handler) {
         err = proto->nat_in_handler(proto, conn, mbuf);
@@ -1602,25 +2040,12 @@ static int dp_vs_fast_xmit_nat(struct dp_vs_proto *proto,
             return err;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(iph);
-    }
-
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
-                    (uint16_t)sizeof(struct ether_hdr));
-    ether_addr_copy(&conn->in_dmac, &eth->d_addr);
-    ether_addr_copy(&conn->in_smac, &eth->s_addr);
-    eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
-    mbuf->packet_type = ETHER_TYPE_IPv4;
 
-    err = netif_xmit(mbuf, conn->in_dev);
-    if (err != EDPVS_OK)
-        RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
-
-    /* must return OK since netif_xmit alway consume mbuf */
-    return EDPVS_OK;
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, ETHER_TYPE_IPv4);
 }
 
 static int dp_vs_fast_outxmit_nat(struct dp_vs_proto *proto,
@@ -1628,7 +2053,6 @@ static int dp_vs_fast_outxmit_nat(struct dp_vs_proto *proto,
                           struct rte_mbuf *mbuf)
 {
     struct ipv4_hdr *iph = ip4_hdr(mbuf);
-    struct ether_hdr *eth;
     int err;
 
     if (unlikely(conn->out_dev == NULL))
@@ -1638,8 +2062,7 @@ static int dp_vs_fast_outxmit_nat(struct dp_vs_proto *proto,
                  is_zero_ether_addr(&conn->out_smac)))
         return EDPVS_NOTSUPP;
 
-    iph->hdr_checksum = 0;
-    iph->src_addr = conn->vaddr.in.s_addr;
+    ip4_set_saddr(iph, conn->vaddr.in.s_addr);
 
     if (proto->nat_out_handler) {
         err = proto->nat_out_handler(proto, conn, mbuf);
@@ -1647,25 +2070,12 @@ static int dp_vs_fast_outxmit_nat(struct dp_vs_proto *proto,
             return err;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(iph);
-    }
 
-    eth = (struct ether_hdr *)rte_pktmbuf_prepend(mbuf,
-                    (uint16_t)sizeof(struct ether_hdr));
-    ether_addr_copy(&conn->out_dmac, &eth->d_addr);
-    ether_addr_copy(&conn->out_smac, &eth->s_addr);
-    eth->ether_type = rte_cpu_to_be_16(ETHER_TYPE_IPv4);
-    mbuf->packet_type = ETHER_TYPE_IPv4;
-
-    err = netif_xmit(mbuf, conn->out_dev);
-    if (err != EDPVS_OK)
-        RTE_LOG(DEBUG, IPVS, "%s: fail to netif_xmit.\n", __func__);
-
-    /* must return OK since netif_xmit alway consume mbuf */
-    return EDPVS_OK;
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, conn->out_dev, &conn->out_dmac,
+                                &conn->out_smac, ETHER_TYPE_IPv4);
 }
 
 static int __dp_vs_out_xmit_snat6(struct dp_vs_proto *proto,
@@ -1692,7 +2102,7 @@ static int __dp_vs_out_xmit_snat6(struct dp_vs_proto *proto,
         dp_vs_conn_cache_rt6(conn, rt6, false);
     }
 
-    if (mbuf->pkt_len > rt6->rt6_mtu) {
+    if (mbuf_l3_seg_len(mbuf) > rt6->rt6_mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(rt6->rt6_mtu));
         err = EDPVS_FRAG;
@@ -1779,9 +2189,10 @@ static int __dp_vs_xmit_nat4(struct dp_vs_proto *proto,
     }
 
     dp_vs_conn_cache_rt(conn, rt, true);
+    dp_vs_dest_cache_nh4(conn, rt);
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG,
@@ -1800,12 +2211,11 @@ static int __dp_vs_xmit_nat4(struct dp_vs_proto *proto,
             goto errout;
         }
 
-        iph->time_to_live--;
+        ip4_decrease_ttl(iph);
     }
 
     /* L3 translation before l4 re-csum */
-    iph->hdr_checksum = 0;
-    iph->dst_addr = conn->daddr.in.s_addr;
+    ip4_set_daddr(iph, conn->daddr.in.s_addr);
 
     /* L4 NAT translation */
     if (proto->nat_in_handler) {
@@ -1814,11 +2224,8 @@ static int __dp_vs_xmit_nat4(struct dp_vs_proto *proto,
             goto errout;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(iph);
-    }
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -1859,9 +2266,10 @@ static int __dp_vs_xmit_nat6(struct dp_vs_proto *proto,
     }
 
     dp_vs_conn_cache_rt6(conn, rt6, true);
+    dp_vs_dest_cache_nh6(conn, rt6);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
@@ -1952,7 +2360,7 @@ static int __dp_vs_out_xmit_nat4(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt(conn, rt, false);
 
     mtu = rt->mtu;
-    if (mbuf->pkt_len > mtu
+    if (mbuf_l3_seg_len(mbuf) > mtu
             && (iph->fragment_offset & htons(IPV4_HDR_DF_FLAG))) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp_send(mbuf, ICMP_DEST_UNREACH, ICMP_UNREACH_NEEDFRAG,
@@ -1972,12 +2380,11 @@ static int __dp_vs_out_xmit_nat4(struct dp_vs_proto *proto,
             goto errout;
         }
 
-        iph->time_to_live--;
+        ip4_decrease_ttl(iph);
     }
 
     /* L3 translation before l4 re-csum */
-    iph->hdr_checksum = 0;
-    iph->src_addr = conn->vaddr.in.s_addr;
+    ip4_set_saddr(iph, conn->vaddr.in.s_addr);
 
     /* L4 NAT translation */
     if (proto->nat_out_handler) {
@@ -1986,11 +2393,8 @@ static int __dp_vs_out_xmit_nat4(struct dp_vs_proto *proto,
             goto errout;
     }
 
-    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM)) {
+    if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
         iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(iph);
-    }
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -2033,7 +2437,7 @@ static int __dp_vs_out_xmit_nat6(struct dp_vs_proto *proto,
     dp_vs_conn_cache_rt6(conn, rt6, false);
 
     mtu = rt6->rt6_mtu;
-    if (mbuf->pkt_len > mtu) {
+    if (mbuf_l3_seg_len(mbuf) > mtu) {
         RTE_LOG(DEBUG, IPVS, "%s: frag needed.\n", __func__);
         icmp6_send(mbuf, ICMP6_PACKET_TOO_BIG, 0, htonl(mtu));
         err = EDPVS_FRAG;
@@ -2085,6 +2489,106 @@ int dp_vs_out_xmit_nat(struct dp_vs_proto *proto,
         : __dp_vs_out_xmit_nat6(proto, conn, mbuf);
 }
 
+/* fill outer IP header of IP-IP tunnel, @mbuf is at the outer header. */
+static void dp_vs_tunnel4_fill(struct rte_mbuf *mbuf, uint32_t saddr,
+                               uint32_t daddr, struct netif_port *dev)
+{
+    struct ipv4_hdr *new_iph = ip4_hdr(mbuf);
+    const struct ipv4_hdr *old_iph = (struct ipv4_hdr *)(new_iph + 1);
+
+    memset(new_iph, 0, sizeof(struct ipv4_hdr));
+    new_iph->version_ihl = 0x45;
+    new_iph->type_of_service = old_iph->type_of_service;
+    new_iph->total_length = htons(mbuf->pkt_len);
+    new_iph->fragment_offset = old_iph->fragment_offset & htons(IPV4_HDR_DF_FLAG);
+    new_iph->time_to_live = old_iph->time_to_live;
+    new_iph->next_proto_id = IPPROTO_IPIP;
+    new_iph->src_addr = saddr;
+    new_iph->dst_addr = daddr;
+    new_iph->packet_id = ip4_select_id(new_iph);
+
+    mbuf->l3_len = sizeof(struct ipv4_hdr);
+    if (dev && dev->flag & NETIF_PORT_FLAG_TX_IP_CSUM_OFFLOAD)
+        mbuf->ol_flags |= PKT_TX_IP_CKSUM;
+    else
+        ip4_send_csum(new_iph);
+}
+
+/* fill outer IP header of IPv6-IPv6 tunnel, @mbuf is at the outer header. */
+static void dp_vs_tunnel6_fill(struct rte_mbuf *mbuf,
+                               const struct in6_addr *daddr)
+{
+    struct ip6_hdr *new_ip6h = ip6_hdr(mbuf);
+    const struct ip6_hdr *old_ip6h = (struct ip6_hdr *)(new_ip6h + 1);
+
+    memset(new_ip6h, 0, sizeof(struct ip6_hdr));
+    new_ip6h->ip6_flow = old_ip6h->ip6_flow;
+    new_ip6h->ip6_plen = htons(mbuf->pkt_len - sizeof(struct ip6_hdr));
+    new_ip6h->ip6_nxt = IPPROTO_IPV6;
+    new_ip6h->ip6_hops = old_ip6h->ip6_hops;
+
+    /* FIXME: How to set outter IP source ?
+     * 1. why not use `rt6->rt6_src.addr` ?
+     *   `rt6->rt6_src` is not set due to src-validation in route6
+     * 2. why not use `inet_addr_select` ?
+     *   `inet_addr_select` return the vip as source(note the vip is configured on
+     *    ip6tnl0), and has performance concerns because of locking.
+     * For a compromise, the original source IP is used. Routing problem may exist.
+     */
+    new_ip6h->ip6_src = old_ip6h->ip6_src;
+
+    /*
+    new_ip6h->ip6_src = rt6->rt6_src.addr;
+    if (ipv6_addr_any(&new_ip6h->ip6_src))
+        inet_addr_select(AF_INET6, rt6->rt6_dev,
+                (const union inet_addr*)&fl6.fl6_daddr, 0,
+                (union inet_addr*)&new_ip6h->ip6_src);
+    */
+
+    new_ip6h->ip6_dst = *daddr;
+}
+
+/*
+ * TUNNEL fast xmit, the outer header is built from conn cached by slow
+ * path. TCP aggregates and packets exceeding MTU go to slow path.
+ */
+static int dp_vs_fast_xmit_tunnel(struct dp_vs_conn *conn,
+                                  struct rte_mbuf *mbuf)
+{
+    uint16_t hlen = conn->af == AF_INET ? sizeof(struct ipv4_hdr)
+                                        : sizeof(struct ip6_hdr);
+
+    struct dp_vs_dest_nh *nh;
+
+    if (fast_xmit_close || (conn->flags & DPVS_CONN_F_NOFASTXMIT))
+        return EDPVS_NOTSUPP;
+
+    nh = dp_vs_conn_nh(conn);
+    if (!nh || (conn->af == AF_INET && nh->tun_src.s_addr == htonl(INADDR_ANY)))
+        return EDPVS_NOTEXIST;
+
+    if (unlikely(mbuf->userdata != NULL
+                || (mbuf->ol_flags & PKT_TX_TCP_SEG)))
+        return EDPVS_NOTSUPP;
+
+    if (unlikely(mbuf->pkt_len + hlen > nh->mtu))
+        return EDPVS_FRAG;
+
+    if (unlikely(!rte_pktmbuf_prepend(mbuf, hlen)))
+        return EDPVS_NOROOM;
+
+    if (conn->af == AF_INET) {
+        dp_vs_tunnel4_fill(mbuf, nh->tun_src.s_addr,
+                           conn->daddr.in.s_addr, nh->dev);
+        return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                    &nh->smac, ETHER_TYPE_IPv4);
+    }
+
+    dp_vs_tunnel6_fill(mbuf, &conn->daddr.in6);
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, ETHER_TYPE_IPv6);
+}
+
 /*
  * IP-IP tunnel is used for IPv4 IPVS tunnel forwarding.
  * `tunl0` should be configured up on RS.
@@ -2100,6 +2604,9 @@ static int __dp_vs_xmit_tunnel4(struct dp_vs_proto *proto,
     uint16_t df = old_iph->fragment_offset & htons(IPV4_HDR_DF_FLAG);
     int err, mtu;
 
+    if (dp_vs_fast_xmit_tunnel(conn, mbuf) == EDPVS_OK)
+        return EDPVS_OK;
+
     /*
      * drop old route. just for safe, because
      * TUNNEL is PREROUTING, should not have route.
@@ -2124,6 +2631,12 @@ static int __dp_vs_xmit_tunnel4(struct dp_vs_proto *proto,
     mtu = rt->mtu;
     mbuf->userdata = rt;
 
+    /* no segmentation offload for IP tunnel, drop TCP aggregates (LRO/GRO) */
+    if (unlikely(mbuf->ol_flags & PKT_TX_TCP_SEG)) {
+        err = EDPVS_NOTSUPP;
+        goto errout;
+    }
+
     new_iph = (struct ipv4_hdr*)rte_pktmbuf_prepend(mbuf, sizeof(struct ipv4_hdr));
     if (!new_iph) {
         RTE_LOG(WARNING, IPVS, "%s: mbuf has not enough headroom"
@@ -2140,23 +2653,8 @@ static int __dp_vs_xmit_tunnel4(struct dp_vs_proto *proto,
         goto errout;
     }
 
-    memset(new_iph, 0, sizeof(struct ipv4_hdr));
-    new_iph->version_ihl = 0x45;
-    new_iph->type_of_service = tos;
-    new_iph->total_length = htons(mbuf->pkt_len);
-    new_iph->fragment_offset = df;
-    new_iph->time_to_live = old_iph->time_to_live;
-    new_iph->next_proto_id = IPPROTO_IPIP;
-    new_iph->src_addr = rt->src.s_addr;
-    new_iph->dst_addr=conn->daddr.in.s_addr;
-    new_iph->packet_id = ip4_select_id(new_iph);
-
-    if (rt->port && rt->port->flag & NETIF_PORT_FLAG_TX_IP_CSUM_OFFLOAD) {
-        mbuf->ol_flags |= PKT_TX_IP_CKSUM;
-        new_iph->hdr_checksum = 0;
-    } else {
-        ip4_send_csum(new_iph);
-    }
+    dp_vs_tunnel4_fill(mbuf, rt->src.s_addr, conn->daddr.in.s_addr, rt->port);
+    dp_vs_dest_cache_nh4(conn, rt);
 
     return INET_HOOK(AF_INET, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt->port, ipv4_output);
@@ -2177,10 +2675,13 @@ static int __dp_vs_xmit_tunnel6(struct dp_vs_proto *proto,
                    struct rte_mbuf *mbuf)
 {
     struct flow6 fl6;
-    struct ip6_hdr *new_ip6h, *old_ip6h = ip6_hdr(mbuf);
+    struct ip6_hdr *new_ip6h;
     struct route6 *rt6;
     int err, mtu;
 
+    if (dp_vs_fast_xmit_tunnel(conn, mbuf) == EDPVS_OK)
+        return EDPVS_OK;
+
     /*
      * drop old route. just for safe, because
      * TUNNEL is PREROUTING, should not have route.
@@ -2204,6 +2705,12 @@ static int __dp_vs_xmit_tunnel6(struct dp_vs_proto *proto,
     mtu = rt6->rt6_mtu;
     mbuf->userdata = rt6;
 
+    /* no segmentation offload for IP tunnel, drop TCP aggregates (LRO/GRO) */
+    if (unlikely(mbuf->ol_flags & PKT_TX_TCP_SEG)) {
+        err = EDPVS_NOTSUPP;
+        goto errout;
+    }
+
     new_ip6h = (struct ip6_hdr*)rte_pktmbuf_prepend(mbuf, sizeof(struct ip6_hdr));
     if (!new_ip6h) {
         RTE_LOG(WARNING, IPVS, "%s: mbuf has not enough headroom"
@@ -2219,31 +2726,8 @@ static int __dp_vs_xmit_tunnel6(struct dp_vs_proto *proto,
         goto errout;
     }
 
-    memset(new_ip6h, 0, sizeof(struct ip6_hdr));
-    new_ip6h->ip6_flow = old_ip6h->ip6_flow;
-    new_ip6h->ip6_plen = htons(mbuf->pkt_len - sizeof(struct ip6_hdr));
-    new_ip6h->ip6_nxt = IPPROTO_IPV6;
-    new_ip6h->ip6_hops = old_ip6h->ip6_hops;
-
-    /* FIXME: How to set outter IP source ?
-     * 1. why not use `rt6->rt6_src.addr` ?
-     *   `rt6->rt6_src` is not set due to src-validation in route6
-     * 2. why not use `inet_addr_select` ?
-     *   `inet_addr_select` return the vip as source(note the vip is configured on
-     *    ip6tnl0), and has performance concerns because of locking.
-     * For a compromise, the original source IP is used. Routing problem may exist.
-     */
-    new_ip6h->ip6_src = old_ip6h->ip6_src;
-
-    /*
-    new_ip6h->ip6_src = rt6->rt6_src.addr;
-    if (ipv6_addr_any(&new_ip6h->ip6_src))
-        inet_addr_select(AF_INET6, rt6->rt6_dev,
-                (const union inet_addr*)&fl6.fl6_daddr, 0,
-                (union inet_addr*)&new_ip6h->ip6_src);
-    */
-
-    new_ip6h->ip6_dst = conn->daddr.in6;
+    dp_vs_tunnel6_fill(mbuf, &conn->daddr.in6);
+    dp_vs_dest_cache_nh6(conn, rt6);
 
     return INET_HOOK(AF_INET6, INET_HOOK_LOCAL_OUT, mbuf,
                      NULL, rt6->rt6_dev, ip6_output);
@@ -2267,6 +2751,262 @@ int dp_vs_xmit_tunnel(struct dp_vs_proto *proto,
         : __dp_vs_xmit_tunnel6(proto, conn, mbuf);
 }
 
+/*
+ * VXLAN fast xmit, the outer headers prebuilt in dest are copied and
+ * per-packet fields are filled. TCP aggregates and packets exceeding
+ * MTU of VXLAN device go to slow path.
+ */
+static int dp_vs_fast_xmit_vxlan(struct dp_vs_conn *conn,
+                                 struct rte_mbuf *mbuf)
+{
+    uint16_t eth_type = conn->af == AF_INET ? ETHER_TYPE_IPv4
+                                            : ETHER_TYPE_IPv6;
+    struct dp_vs_dest_nh *nh;
+    struct vxlan_encap *hdr;
+    uint32_t hash;
+
+    if (fast_xmit_close || (conn->flags & DPVS_CONN_F_NOFASTXMIT))
+        return EDPVS_NOTSUPP;
+
+    nh = dp_vs_conn_nh(conn);
+    if (!nh || !nh->vxlan)
+        return EDPVS_NOTEXIST;
+
+    if (unlikely(mbuf->userdata != NULL
+                || (mbuf->ol_flags & PKT_TX_TCP_SEG)))
+        return EDPVS_NOTSUPP;
+
+    if (unlikely(mbuf->pkt_len > nh->mtu))
+        return EDPVS_FRAG;
+
+    hash = vxlan_flow_hash(mbuf, eth_type, 0);
+
+    hdr = (struct vxlan_encap *)rte_pktmbuf_prepend(mbuf, sizeof(*hdr));
+    if (unlikely(!hdr))
+        return EDPVS_NOROOM;
+
+    rte_memcpy(hdr, &conn->dest->encap[nh->encap_idx], sizeof(*hdr));
+    hdr->eth.ether_type = htons(eth_type);
+    vxlan_encap_fill(mbuf, hdr, hash, nh->dev);
+
+    /* must return OK since burst xmit alway consume mbuf */
+    return dp_vs_xmit_burst_add(mbuf, nh->dev, &nh->dmac,
+                                &nh->smac, ETHER_TYPE_IPv4);
+}
+
+/*
+ * VXLAN forwarding is DR over VXLAN device, which is the route device
+ * to RS, the RS replies to client directly.
+ */
+int dp_vs_xmit_vxlan(struct dp_vs_proto *proto,
+                     struct dp_vs_conn *conn,
+                     struct rte_mbuf *mbuf)
+{
+    if (dp_vs_fast_xmit_vxlan(conn, mbuf) == EDPVS_OK)
+        return EDPVS_OK;
+
+    return dp_vs_xmit_dr(proto, conn, mbuf);
+}
+
+/*
+ * microbenchmark of NAT64 fast xmit against FNAT4 fast xmit, run by
+ * `dpvs --nat64-bench N` before data plane starts. synthetic UDP
+ * datagrams of some payload sizes are sent by __dp_vs_fast_xmit_fnat64
+ * (IPv6 client) and __dp_vs_fast_xmit_fnat4 (IPv4 client) to a sink
+ * device through a cached next hop, N rounds each. it runs on master,
+ * so burst xmit writes L2 and hands each packet to the sink at once.
+ */
+#define NAT64_BENCH_POOL_SIZE   1023
+
+extern struct dp_vs_proto dp_vs_proto_udp;
+
+static struct rte_mbuf *nat64_bench_sunk;
+
+static int nat64_bench_sink_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    nat64_bench_sunk = mbuf;
+    return EDPVS_OK;
+}
+
+static struct netif_ops nat64_bench_sink_ops = {
+    .op_xmit        = nat64_bench_sink_xmit,
+};
+
+static struct rte_mbuf *nat64_bench_mbuf(struct rte_mempool *pool, int af,
+                                         uint16_t payload)
+{
+    uint16_t l3len = af == AF_INET6 ? sizeof(struct ip6_hdr)
+                                    : sizeof(struct ipv4_hdr);
+    uint16_t ulen = sizeof(struct udp_hdr) + payload;
+    struct rte_mbuf *mbuf;
+    struct udp_hdr *uh;
+    void *iph;
+
+    mbuf = rte_pktmbuf_alloc(pool);
+    if (unlikely(!mbuf))
+        return NULL;
+
+    iph = rte_pktmbuf_append(mbuf, l3len + ulen);
+    if (unlikely(!iph)) {
+        rte_pktmbuf_free(mbuf);
+        return NULL;
+    }
+    memset(iph, 0, l3len + sizeof(*uh));
+    mbuf->userdata = NULL;
+    mbuf->l3_len = l3len;
+
+    if (af == AF_INET6) {
+        struct ip6_hdr *ip6h = iph;
+
+        ip6h->ip6_flow = htonl(0x60000000);
+        ip6h->ip6_plen = htons(ulen);
+        ip6h->ip6_nxt = IPPROTO_UDP;
+        ip6h->ip6_hlim = 64;
+        inet_pton(AF_INET6, "2001:db8::1", &ip6h->ip6_src);
+        inet_pton(AF_INET6, "2001:db8::100", &ip6h->ip6_dst);
+    } else {
+        struct ipv4_hdr *ip4h = iph;
+
+        ip4h->version_ihl = 0x45;
+        ip4h->total_length = htons(l3len + ulen);
+        ip4h->time_to_live = 64;
+        ip4h->next_proto_id = IPPROTO_UDP;
+        ip4h->src_addr = htonl(0x0a000001);
+        ip4h->dst_addr = htonl(0x0a000064);
+        ip4_send_csum(ip4h);
+    }
+
+    uh = (struct udp_hdr *)((char *)iph + l3len);
+    uh->src_port = htons(10000);
+    uh->dst_port = htons(80);
+    uh->dgram_len = htons(ulen);
+    uh->dgram_cksum = htons(0x1234); /* any non-zero, updated incrementally */
+
+    return mbuf;
+}
+
+static uint64_t nat64_bench_run(struct rte_mempool *pool,
+                                struct dp_vs_conn *conn, uint16_t payload,
+                                int rounds, int *failed)
+{
+    struct dp_vs_proto *proto = &dp_vs_proto_udp;
+    struct rte_mbuf *mbuf;
+    uint64_t start, cycles = 0;
+    int i, err;
+
+    for (i = 0; i < rounds; i++) {
+        mbuf = nat64_bench_mbuf(pool, conn->af, payload);
+        if (unlikely(!mbuf)) {
+            (*failed)++;
+            continue;
+        }
+
+        nat64_bench_sunk = NULL;
+        start = rte_rdtsc();
+        if (conn->af == AF_INET6)
+            err = __dp_vs_fast_xmit_fnat64(proto, conn, mbuf);
+        else
+            err = __dp_vs_fast_xmit_fnat4(proto, conn, mbuf);
+        cycles += rte_rdtsc() - start;
+
+        if (unlikely(err != EDPVS_OK || !nat64_bench_sunk)) {
+            (*failed)++;
+            if (err != EDPVS_OK)
+                rte_pktmbuf_free(mbuf);
+        }
+        if (nat64_bench_sunk)
+            rte_pktmbuf_free(nat64_bench_sunk);
+    }
+
+    return cycles;
+}
+
+static void nat64_bench_conn(struct dp_vs_conn *conn, int af,
+                             struct dp_vs_dest *dest)
+{
+    memset(conn, 0, sizeof(*conn));
+    conn->af = af;
+    conn->proto = IPPROTO_UDP;
+    conn->dest = dest;
+    conn->cport = htons(10000);
+    conn->vport = htons(80);
+    conn->lport = htons(20000);
+    conn->dport = htons(8080);
+    conn->laddr.in.s_addr = htonl(0xc0a80001);
+    conn->daddr.in.s_addr = htonl(0xc0a80101);
+
+    tuplehash_in(conn).af = af;
+    if (af == AF_INET6) {
+        inet_pton(AF_INET6, "2001:db8::1", &tuplehash_in(conn).saddr.in6);
+        inet_pton(AF_INET6, "2001:db8::100", &tuplehash_in(conn).daddr.in6);
+    } else {
+        tuplehash_in(conn).saddr.in.s_addr = htonl(0x0a000001);
+        tuplehash_in(conn).daddr.in.s_addr = htonl(0x0a000064);
+    }
+    tuplehash_out(conn).af = AF_INET;
+    tuplehash_out(conn).saddr = conn->daddr;
+    tuplehash_out(conn).daddr = conn->laddr;
+}
+
+int dp_vs_xmit_nat64_benchmark(int rounds)
+{
+    static const uint16_t payloads[] = { 0, 64, 512, 1400 };
+    struct rte_mempool *pool = NULL;
+    struct netif_port *dev = NULL;
+    struct dp_vs_dest *dest = NULL;
+    struct dp_vs_conn *conn4 = NULL, *conn6 = NULL;
+    struct dp_vs_dest_nh *nh;
+    uint64_t fnat4, fnat64;
+    int i, failed = 0, err = EDPVS_NOMEM;
+
+    if (rounds <= 0)
+        return EDPVS_INVAL;
+
+    pool = rte_pktmbuf_pool_create("nat64_bench", NAT64_BENCH_POOL_SIZE, 0, 0,
+                                   RTE_MBUF_DEFAULT_BUF_SIZE, rte_socket_id());
+    dev = rte_zmalloc(NULL, sizeof(*dev), RTE_CACHE_LINE_SIZE);
+    /* one next hop slot, dp_vs_dest_nh_index[] is all 0 before init */
+    dest = rte_zmalloc(NULL, sizeof(*dest) + sizeof(struct dp_vs_dest_nh),
+                       RTE_CACHE_LINE_SIZE);
+    conn4 = rte_zmalloc(NULL, sizeof(*conn4), RTE_CACHE_LINE_SIZE);
+    conn6 = rte_zmalloc(NULL, sizeof(*conn6), RTE_CACHE_LINE_SIZE);
+    if (!pool || !dev || !dest || !conn4 || !conn6)
+        goto out;
+
+    snprintf(dev->name, sizeof(dev->name), "%s", "bench0");
+    dev->mtu = ETHER_MTU;
+    dev->netif_ops = &nat64_bench_sink_ops;
+
+    nh = dp_vs_dest_lcore_nh(dest);
+    nh->dev = dev;
+    nh->mtu = ETHER_MTU;
+    nh->gen = neigh_generation();
+
+    nat64_bench_conn(conn4, AF_INET, dest);
+    nat64_bench_conn(conn6, AF_INET6, dest);
+
+    printf("UDP fast xmit, %d rounds, cycles per datagram:\n", rounds);
+    printf("%-10s %-12s %-12s\n", "payload", "fnat4", "nat64");
+    for (i = 0; i < NELEMS(payloads); i++) {
+        fnat4 = nat64_bench_run(pool, conn4, payloads[i], rounds, &failed);
+        fnat64 = nat64_bench_run(pool, conn6, payloads[i], rounds, &failed);
+        printf("%-10u %-12lu %-12lu\n", payloads[i],
+               fnat4 / rounds, fnat64 / rounds);
+    }
+    if (failed)
+        printf("%d rounds failed\n", failed);
+
+    err = failed ? EDPVS_NOROOM : EDPVS_OK;
+
+out:
+    rte_free(conn6);
+    rte_free(conn4);
+    rte_free(dest);
+    rte_free(dev);
+    rte_mempool_free(pool);
+    return err;
+}
+
 static void conn_fast_xmit_handler(vector_t tockens)
 {
     RTE_LOG(INFO, IPVS, "fast xmit OFF\n");
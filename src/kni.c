@@ -46,6 +46,10 @@
 
 static struct rte_mempool *kni_mbuf_pool[DPVS_MAX_SOCKET];
 
+/* serialize kni tx among workers, and kni device release against
+ * the dedicated kni lcore. */
+rte_spinlock_t kni_lock;
+
 static void kni_fill_conf(const struct netif_port *dev, const char *ifname,
                           struct rte_kni_conf *conf)
 {
@@ -368,11 +372,17 @@ int kni_add_dev(struct netif_port *dev, const char *kniname)
 
 int kni_del_dev(struct netif_port *dev)
 {
+    struct rte_kni *kni;
+
     if (!kni_dev_exist(dev))
         return EDPVS_INVAL;
 
-    rte_kni_release(dev->kni.kni);
+    rte_spinlock_lock(&kni_lock);
+    kni = dev->kni.kni;
     dev->kni.kni = NULL;
+    rte_spinlock_unlock(&kni_lock);
+
+    rte_kni_release(kni);
     return EDPVS_OK;
 }
 
@@ -381,6 +391,8 @@ int kni_init(void)
     int i;
     char poolname[32];
 
+    rte_spinlock_init(&kni_lock);
+
     for (i = 0; i < get_numa_nodes(); i++) {
         memset(poolname, 0, sizeof(poolname));
         snprintf(poolname, sizeof(poolname) - 1, "kni_mbuf_pool_%d", i);
@@ -33,8 +33,15 @@
 #include "ipvs/ipvs.h"
 #include "cfgfile.h"
 #include "ip_tunnel.h"
+#include "ip6_tunnel.h"
 #include "sys_time.h"
 #include "route6.h"
+#include "capture.h"
+#include "ipvs/sync.h"
+#include "ipvs/sesslog.h"
+#include "ipvs/ipfix.h"
+#include "ipvs/proto_tcp.h"
+#include "ipvs/xmit.h"
 
 #define DPVS    "dpvs"
 #define RTE_LOGTYPE_DPVS RTE_LOGTYPE_USER1
@@ -84,12 +91,17 @@ static void dpvs_usage(const char *prgname)
     printf("DPVS application options:\n"
             "   -v  version     display DPVS version info\n"
             "   -h  help        display DPVS help info\n"
+            "   -B  toa-bench N benchmark TOA insertion with N rounds and exit\n"
+            "   -N  nat64-bench N benchmark NAT64 fast xmit against FNAT4 with N rounds and exit\n"
     );
 }
 
+static int toa_bench_rounds;
+static int nat64_bench_rounds;
+
 static int parse_app_args(int argc, char **argv)
 {
-    const char *short_options = "vh";
+    const char *short_options = "vhB:N:";
     char *prgname = argv[0];
     int c, ret = -1;
 
@@ -100,6 +112,8 @@ static int parse_app_args(int argc, char **argv)
     struct option long_options[] = {
         {"version", 0, NULL, 'v'},
         {"help", 0, NULL, 'h'},
+        {"toa-bench", 1, NULL, 'B'},
+        {"nat64-bench", 1, NULL, 'N'},
         {NULL, 0, 0, 0}
     };
 
@@ -115,6 +129,20 @@ static int parse_app_args(int argc, char **argv)
             case 'h':
                 dpvs_usage(prgname);
                 exit(EXIT_SUCCESS);
+            case 'B':
+                toa_bench_rounds = atoi(optarg);
+                if (toa_bench_rounds <= 0) {
+                    dpvs_usage(prgname);
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'N':
+                nat64_bench_rounds = atoi(optarg);
+                if (nat64_bench_rounds <= 0) {
+                    dpvs_usage(prgname);
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case '?':
             default:
                 dpvs_usage(prgname);
@@ -187,6 +215,21 @@ int main(int argc, char *argv[])
         rte_exit(EXIT_FAILURE, "Invalid EAL parameters\n");
     argc -= err, argv += err;
 
+    /* needs EAL for mbufs only, no port or config */
+    if (toa_bench_rounds) {
+        err = tcp_toa_benchmark(toa_bench_rounds);
+        if (err != EDPVS_OK)
+            fprintf(stderr, "toa benchmark: %s\n", dpvs_strerror(err));
+        exit(err == EDPVS_OK ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    if (nat64_bench_rounds) {
+        err = dp_vs_xmit_nat64_benchmark(nat64_bench_rounds);
+        if (err != EDPVS_OK)
+            fprintf(stderr, "nat64 benchmark: %s\n", dpvs_strerror(err));
+        exit(err == EDPVS_OK ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
     RTE_LOG(INFO, DPVS, "dpvs version: %s, build on %s\n", DPVS_VERSION, DPVS_BUILD_DATE);
 
     rte_timer_subsystem_init();
@@ -231,6 +274,10 @@ int main(int argc, char *argv[])
     if ((err = ip_tunnel_init()) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init tunnel: %s\n", dpvs_strerror(err));
 
+    if ((err = ip6_tunnel_init()) != EDPVS_OK)
+        rte_exit(EXIT_FAILURE, "Fail to init ipv6 tunnel: %s\n",
+                 dpvs_strerror(err));
+
     if ((err = dp_vs_init()) != EDPVS_OK)
         rte_exit(EXIT_FAILURE, "Fail to init ipvs: %s\n", dpvs_strerror(err));
 
@@ -238,6 +285,10 @@ int main(int argc, char *argv[])
         rte_exit(EXIT_FAILURE, "Fail to init netif_ctrl: %s\n",
                  dpvs_strerror(err));
 
+    if ((err = capture_init()) != EDPVS_OK)
+        rte_exit(EXIT_FAILURE, "Fail to init capture: %s\n",
+                 dpvs_strerror(err));
+
     /* config and start all available dpdk ports */
     nports = rte_eth_dev_count();
     for (pid = 0; pid < nports; pid++) {
@@ -286,6 +337,18 @@ int main(int argc, char *argv[])
         /* kni */
         kni_process_on_master();
 
+        /* packet capture */
+        capture_process_on_master();
+
+        /* connection synchronization */
+        dp_vs_sync_process_on_master();
+
+        /* session logging */
+        dp_vs_sesslog_process_on_master();
+
+        /* flow export */
+        dp_vs_ipfix_process_on_master();
+
         /* process mac ring on master */
         neigh_process_ring(NULL);
 
@@ -295,11 +358,16 @@ int main(int argc, char *argv[])
 
 end:
     dpvs_state_set(DPVS_STATE_FINISH);
+    if ((err = capture_term()) != EDPVS_OK)
+        RTE_LOG(ERR, DPVS, "Fail to term capture: %s\n", dpvs_strerror(err));
     if ((err = netif_ctrl_term()) !=0 )
         rte_exit(EXIT_FAILURE, "Fail to term netif_ctrl: %s\n",
                  dpvs_strerror(err));
     if ((err = dp_vs_term()) != EDPVS_OK)
         RTE_LOG(ERR, DPVS, "Fail to term ipvs: %s\n", dpvs_strerror(err));
+    if ((err = ip6_tunnel_term()) != EDPVS_OK)
+        RTE_LOG(ERR, DPVS, "Fail to term ipv6 tunnel: %s\n",
+                dpvs_strerror(err));
     if ((err = ip_tunnel_term()) != EDPVS_OK)
         RTE_LOG(ERR, DPVS, "Fail to term tunnel: %s\n", dpvs_strerror(err));
     if ((err = sa_pool_term()) != EDPVS_OK)
@@ -41,6 +41,7 @@
 #define DPVS_NEIGH_TIMEOUT_MAX 3600
 
 static int neigh_nums[DPVS_MAX_LCORE] = {0};
+uint32_t neigh_gen[DPVS_MAX_LCORE];
 
 struct neighbour_mbuf_entry {
     struct rte_mbuf   *m;
@@ -209,6 +210,7 @@ static inline int neigh_unhash(struct neighbour_entry *neighbour)
     if((neighbour->flag & NEIGHBOUR_HASHED)){
         list_del(&neighbour->neigh_list);
         neighbour->flag &= ~NEIGHBOUR_HASHED;
+        neigh_generation_bump();
         err = EDPVS_OK;
     } else {
         err = EDPVS_NOTEXIST;
@@ -266,6 +268,8 @@ void neigh_entry_state_trans(struct neighbour_entry *neighbour, int idx)
                  * do not update timer unless half timeout passed */
                 if ((now.tv_sec - neighbour->ts)*2 < nud_timeouts[old_state])
                     return;
+        } else {
+            neigh_generation_bump();
         }
 
         timeout.tv_sec = nud_timeouts[neighbour->state];
@@ -307,6 +311,9 @@ struct neighbour_entry *neigh_lookup_entry(int af, const union inet_addr *key,
 
 int neigh_edit(struct neighbour_entry *neighbour, struct ether_addr *eth_addr)
 {
+    if (!is_same_ether_addr(&neighbour->eth_addr, eth_addr))
+        neigh_generation_bump();
+
     rte_memcpy(&neighbour->eth_addr, eth_addr, 6);
 
     return EDPVS_OK;
@@ -919,7 +926,9 @@ int neigh_sync_core(const void *param, bool add_del, enum param_kind kind)
     cid = rte_lcore_id();
 
     for (i = 0; i < DPVS_MAX_LCORE; i++) {
-        if ((i == cid) || (!is_lcore_id_valid(i)) || (i == master_cid))
+        /* KNI lcore has no neighbour table and never drains its ring */
+        if ((i == cid) || (!is_lcore_id_valid(i)) || (i == master_cid) ||
+                netif_lcore_is_kni(i))
             continue;
         switch (kind) {
         case NEIGH_ENTRY:
@@ -952,14 +961,10 @@ int neigh_sync_core(const void *param, bool add_del, enum param_kind kind)
     return EDPVS_OK;
 }
 
-static int neigh_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+static int neigh_conf_apply(const struct dp_vs_neigh_conf *param, int add)
 {
-    const struct dp_vs_neigh_conf *param = conf;
     struct netif_port *port;
 
-    if (!conf || size < sizeof(*param))
-        return EDPVS_INVAL;
-
     if (inet_is_addr_any(param->af, &param->ip_addr))
         return EDPVS_INVAL;
 
@@ -970,28 +975,47 @@ static int neigh_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
         return EDPVS_INVAL;
     }
 
+    if (EDPVS_OK != neigh_sync_core(param, add, NEIGH_PARAM)) {
+        RTE_LOG(WARNING, NEIGHBOUR, "%s: sync failed\n", __func__);
+        return EDPVS_INVAL;
+    }
+
+    return EDPVS_OK;
+}
+
+static int neigh_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    const struct dp_vs_neigh_conf *param = conf;
+    const struct dp_vs_neigh_conf_array *array = conf;
+    int i, err, ret = EDPVS_OK;
+
     switch (opt) {
     case SOCKOPT_SET_NEIGH_ADD:
-        if (EDPVS_OK != neigh_sync_core(param, 1, NEIGH_PARAM)) {
-            RTE_LOG(WARNING, NEIGHBOUR, "%s: sync failed\n", __func__);
+    case SOCKOPT_SET_NEIGH_DEL:
+        if (!conf || size < sizeof(*param))
             return EDPVS_INVAL;
-        }
 
-        break;
+        return neigh_conf_apply(param, opt == SOCKOPT_SET_NEIGH_ADD);
 
-    case SOCKOPT_SET_NEIGH_DEL:
-        if (EDPVS_OK != neigh_sync_core(param, 0, NEIGH_PARAM)) {
-            RTE_LOG(WARNING, NEIGHBOUR, "%s: sync failed\n", __func__);
+    case SOCKOPT_SET_NEIGH_ADD_BULK:
+    case SOCKOPT_SET_NEIGH_DEL_BULK:
+        if (!conf || size < sizeof(*array) || array->neigh_nums <= 0 ||
+            size != sizeof(*array) + array->neigh_nums * sizeof(*param))
             return EDPVS_INVAL;
-        }
 
-        break;
+        /* entries are synced to all lcores through the neigh rings,
+         * keep going on failure and return the first error */
+        for (i = 0; i < array->neigh_nums; i++) {
+            err = neigh_conf_apply(&array->addrs[i],
+                                   opt == SOCKOPT_SET_NEIGH_ADD_BULK);
+            if (err != EDPVS_OK && ret == EDPVS_OK)
+                ret = err;
+        }
+        return ret;
 
     default:
         return EDPVS_NOTSUPP;
     }
-
-    return EDPVS_OK;
 }
 
 static struct dpvs_sockopts neigh_sockopts = {
@@ -1001,7 +1025,7 @@ static struct dpvs_sockopts neigh_sockopts = {
     .get         = neigh_sockopt_get,
 
     .set_opt_min = SOCKOPT_SET_NEIGH_ADD,
-    .set_opt_max = SOCKOPT_SET_NEIGH_DEL,
+    .set_opt_max = SOCKOPT_SET_NEIGH_DEL_BULK,
     .set         = neigh_sockopt_set,
 };
 
@@ -1064,6 +1088,11 @@ static void unregister_stats_cb(void)
 
 int neigh_init(void)
 {
+    lcoreid_t cid;
+
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++)
+        neigh_gen[cid] = 1;
+
     if(EDPVS_NOMEM == arp_init()){
         return EDPVS_NOMEM;
     }
@@ -37,11 +37,15 @@
 #include "timer.h"
 #include "parser/parser.h"
 #include "neigh.h"
+#include "capture.h"
+#include "ipv4.h"
+#include "ipv6.h"
 
 #include <rte_arp.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <ipvs/redirect.h>
+#include <ipvs/xmit.h>
 
 #define NETIF_PKTPOOL_NB_MBUF_DEF   65535
 #define NETIF_PKTPOOL_NB_MBUF_MIN   1023
@@ -65,6 +69,7 @@ static int netif_pktpool_mbuf_cache = NETIF_PKTPOOL_MBUF_CACHE_DEF;
 #define NETIF_ISOL_RXQ_RING_SZ_DEF  1048576 // 1M bytes
 
 #define ARP_RING_SIZE 2048
+#define KNI_RING_SIZE 2048
 
 /* physical nic id = phy_pid_base + index */
 static portid_t phy_pid_base = 0;
@@ -92,12 +97,15 @@ struct port_conf_stream {
 
     int tx_queue_nb;
     int tx_desc_nb;
+    netif_txq_policy_t txq_policy;
 
     enum rte_fdir_mode fdir_mode;
     enum rte_fdir_pballoc_type fdir_pballoc;
     enum rte_fdir_status_mode fdir_status;
 
     bool promisc_mode;
+    bool lro;
+    bool gro;
 
     struct list_head port_list_node;
 };
@@ -149,6 +157,8 @@ static uint8_t g_slave_lcore_num;
 static uint8_t g_isol_rx_lcore_num;
 static uint64_t g_slave_lcore_mask;
 static uint64_t g_isol_rx_lcore_mask;
+/* dedicated KNI lcore, KNI is served by master if invalid */
+static lcoreid_t g_kni_lcore_id = NETIF_LCORE_ID_INVALID;
 
 bool is_lcore_id_valid(lcoreid_t cid)
 {
@@ -156,10 +166,16 @@ bool is_lcore_id_valid(lcoreid_t cid)
         return false;
 
     return ((cid == rte_get_master_lcore()) ||
+            (cid == g_kni_lcore_id) ||
             (g_slave_lcore_mask & (1L << cid)) ||
             (g_isol_rx_lcore_mask & (1L << cid)));
 }
 
+bool netif_lcore_is_kni(lcoreid_t cid)
+{
+    return cid == g_kni_lcore_id && cid != NETIF_LCORE_ID_INVALID;
+}
+
 static bool is_lcore_id_fwd(lcoreid_t cid)
 {
     if (unlikely(cid >= DPVS_MAX_LCORE))
@@ -259,7 +275,10 @@ static void device_handler(vector_t tokens)
     port_cfg->tx_queue_nb = -1;
     port_cfg->rx_desc_nb = NETIF_NB_RX_DESC_DEF;
     port_cfg->tx_desc_nb = NETIF_NB_TX_DESC_DEF;
+    port_cfg->txq_policy = NETIF_TXQ_POLICY_LCORE;
     port_cfg->promisc_mode = false;
+    port_cfg->lro = false;
+    port_cfg->gro = false;
     strncpy(port_cfg->rss, "tcp", sizeof(port_cfg->rss));
     port_cfg->fdir_mode = RTE_FDIR_MODE_PERFECT;
     port_cfg->fdir_pballoc = RTE_FDIR_PBALLOC_64K;
@@ -334,6 +353,24 @@ static void rss_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void lro_handler(vector_t tokens)
+{
+    struct port_conf_stream *current_device = list_entry(port_list.next,
+            struct port_conf_stream, port_list_node);
+
+    RTE_LOG(INFO, NETIF, "%s:lro = on\n", current_device->name);
+    current_device->lro = true;
+}
+
+static void gro_handler(vector_t tokens)
+{
+    struct port_conf_stream *current_device = list_entry(port_list.next,
+            struct port_conf_stream, port_list_node);
+
+    RTE_LOG(INFO, NETIF, "%s:gro = on\n", current_device->name);
+    current_device->gro = true;
+}
+
 static void tx_queue_number_handler(vector_t tokens)
 {
     char *str = set_value(tokens);
@@ -379,6 +416,32 @@ static void tx_desc_nb_handler(vector_t tokens)
     FREE_PTR(str);
 }
 
+static void tx_policy_handler(vector_t tokens)
+{
+    char *str = set_value(tokens);
+    struct port_conf_stream *current_device = list_entry(port_list.next,
+            struct port_conf_stream, port_list_node);
+
+    assert(str);
+    if (!strcmp(str, "lcore"))
+        current_device->txq_policy = NETIF_TXQ_POLICY_LCORE;
+    else if (!strcmp(str, "flowhash"))
+        current_device->txq_policy = NETIF_TXQ_POLICY_FLOWHASH;
+    else if (!strcmp(str, "priority"))
+        current_device->txq_policy = NETIF_TXQ_POLICY_PRIORITY;
+    else {
+        RTE_LOG(WARNING, NETIF, "invalid %s:tx_policy %s, using default lcore\n",
+                current_device->name, str);
+        current_device->txq_policy = NETIF_TXQ_POLICY_LCORE;
+        FREE_PTR(str);
+        return;
+    }
+
+    RTE_LOG(INFO, NETIF, "%s:tx_policy = %s\n", current_device->name, str);
+
+    FREE_PTR(str);
+}
+
 static void fdir_mode_handler(vector_t tokens)
 {
     char *mode, *str = set_value(tokens);
@@ -650,7 +713,7 @@ static void worker_type_handler(vector_t tokens)
             struct worker_conf_stream, worker_list_node);
 
     assert(str);
-    if (!strcmp(str, "master") || !strcmp(str, "slave")) {
+    if (!strcmp(str, "master") || !strcmp(str, "slave") || !strcmp(str, "kni")) {
         RTE_LOG(INFO, NETIF, "%s:type = %s\n", current_worker->name, str);
         strncpy(current_worker->type, str, sizeof(current_worker->type));
     } else {
@@ -834,11 +897,14 @@ void install_netif_keywords(void)
     install_keyword("queue_number", rx_queue_number_handler, KW_TYPE_INIT);
     install_keyword("descriptor_number", rx_desc_nb_handler, KW_TYPE_INIT);
     install_keyword("rss", rss_handler, KW_TYPE_INIT);
+    install_keyword("lro", lro_handler, KW_TYPE_INIT);
+    install_keyword("gro", gro_handler, KW_TYPE_INIT);
     install_sublevel_end();
     install_keyword("tx", NULL, KW_TYPE_INIT);
     install_sublevel();
     install_keyword("queue_number", tx_queue_number_handler, KW_TYPE_INIT);
     install_keyword("descriptor_number", tx_desc_nb_handler, KW_TYPE_INIT);
+    install_keyword("policy", tx_policy_handler, KW_TYPE_INIT);
     install_sublevel_end();
     install_keyword("fdir", NULL, KW_TYPE_INIT);
     install_sublevel();
@@ -1113,6 +1179,9 @@ int netif_lcore_loop_job_unregister(struct netif_lcore_loop_job *lcore_job)
 static void kni_ingress(struct rte_mbuf *mbuf, struct netif_port *dev,
                         struct netif_queue_conf *qconf);
 static void kni_send2kern_loop(uint8_t port_id, struct netif_queue_conf *qconf);
+static void lcore_process_kni_ring(lcoreid_t cid);
+static void try_kni_lcore_loop(void);
+static int kni_lcore_init(void);
 
 
 /****************************************** lcore  conf ********************************************/
@@ -1154,15 +1223,22 @@ static void config_lcores(struct list_head *worker_list)
     portid_t pid;
     struct netif_port *port;
     struct queue_conf_stream *queue;
-    struct worker_conf_stream *worker, *worker_min;
-
-    cpu_left = list_elems(worker_list);
-    list_for_each_entry(worker, worker_list, worker_list_node) {
-        if (strcmp(worker->type, "slave")) {
-            list_move_tail(&worker->worker_list_node, worker_list);
-            cpu_left--;
+    struct worker_conf_stream *worker, *worker_next, *worker_min;
+    struct list_head non_slaves;
+
+    /* move non-slave workers to the tail, slaves are sorted below */
+    INIT_LIST_HEAD(&non_slaves);
+    cpu_left = 0;
+    list_for_each_entry_safe(worker, worker_next, worker_list, worker_list_node) {
+        if (!strcmp(worker->type, "slave")) {
+            cpu_left++;
+            continue;
         }
+        if (!strcmp(worker->type, "kni"))
+            g_kni_lcore_id = worker->cpu_id;
+        list_move_tail(&worker->worker_list_node, &non_slaves);
     }
+    list_splice_tail(&non_slaves, worker_list);
     while (cpu_left > 0) {
         cpu_id_min = DPVS_MAX_LCORE;
         worker_min = NULL;
@@ -1620,6 +1696,121 @@ static inline uint16_t netif_rx_burst(portid_t pid, struct netif_queue_conf *qco
     return nrx;
 }
 
+/*
+ * parse TCP packet for GRO and segmentation offsets, @tso_segsz is the
+ * MSS which the aggregate (by LRO or later GRO) will be segmented with.
+ */
+static inline void netif_rx_tcp_parse(struct rte_mbuf *mbuf,
+                                      const struct netif_port *dev)
+{
+    struct ether_hdr *eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    struct ipv4_hdr *iph;
+    struct ip6_hdr *ip6h;
+    struct tcp_hdr *th;
+    uint32_t l2_len = sizeof(struct ether_hdr);
+    uint32_t l3_len, hdr_len, tot_len, ptype;
+
+    mbuf->packet_type = 0;
+
+    /* do not aggregate corrupted packets, checksums are re-computed */
+    if (mbuf->ol_flags & (PKT_RX_IP_CKSUM_BAD | PKT_RX_L4_CKSUM_BAD))
+        return;
+
+    if (eth->ether_type == htons(ETHER_TYPE_IPv4)) {
+        if (mbuf->data_len < l2_len + sizeof(struct ipv4_hdr))
+            return;
+        iph = (struct ipv4_hdr *)(eth + 1);
+        if (iph->next_proto_id != IPPROTO_TCP || ip4_is_frag(iph))
+            return;
+        l3_len = (iph->version_ihl & 0xf) << 2;
+        tot_len = ntohs(iph->total_length);
+        ptype = RTE_PTYPE_L3_IPV4;
+    } else if (eth->ether_type == htons(ETHER_TYPE_IPv6)
+            && (dev->flag & NETIF_PORT_FLAG_RX_TCP_LRO)) {
+        /* no GRO for IPv6, only LRO aggregates are concerned */
+        if (mbuf->data_len < l2_len + sizeof(struct ip6_hdr))
+            return;
+        ip6h = (struct ip6_hdr *)(eth + 1);
+        if (ip6h->ip6_nxt != IPPROTO_TCP)
+            return;
+        l3_len = sizeof(struct ip6_hdr);
+        tot_len = ntohs(ip6h->ip6_plen) + l3_len;
+        ptype = RTE_PTYPE_L3_IPV6;
+    } else {
+        return;
+    }
+
+    if (mbuf->data_len < l2_len + l3_len + sizeof(struct tcp_hdr))
+        return;
+    th = rte_pktmbuf_mtod_offset(mbuf, struct tcp_hdr *, l2_len + l3_len);
+    hdr_len = l3_len + ((th->data_off & 0xf0) >> 2);
+    if (tot_len < hdr_len || mbuf->pkt_len < l2_len + tot_len)
+        return;
+
+    /* trim ethernet padding, or it's taken as TCP payload by GRO */
+    if (mbuf->pkt_len > l2_len + tot_len
+            && rte_pktmbuf_trim(mbuf, mbuf->pkt_len - l2_len - tot_len) != 0)
+        return;
+
+    mbuf->l2_len = l2_len;
+    mbuf->l3_len = l3_len;
+    mbuf->l4_len = hdr_len - l3_len;
+    mbuf->packet_type = RTE_PTYPE_L2_ETHER | ptype | RTE_PTYPE_L4_TCP;
+
+    if (tot_len > dev->mtu) {
+        /* LRO aggregate, MSS is given by PMD or guessed by MTU */
+        if (!(mbuf->ol_flags & PKT_RX_LRO) || !mbuf->tso_segsz)
+            mbuf->tso_segsz = dev->mtu - hdr_len;
+    } else {
+        mbuf->tso_segsz = tot_len - hdr_len;
+    }
+}
+
+/*
+ * TCP aggregation of received packets, by LRO of NIC or by software GRO.
+ * aggregates are translated once and marked PKT_TX_TCP_SEG, then are
+ * segmented at egress by TSO, or by GSO if TSO is not supported.
+ */
+static uint16_t netif_rx_aggregate(struct netif_port *dev,
+                                   struct rte_mbuf **mbufs, uint16_t nb)
+{
+    struct rte_gro_param param;
+    struct rte_mbuf *mbuf;
+    struct ipv4_hdr *iph;
+    uint16_t i;
+
+    for (i = 0; i < nb; i++)
+        netif_rx_tcp_parse(mbufs[i], dev);
+
+    if (dev->flag & NETIF_PORT_FLAG_RX_GRO) {
+        param.gro_types = RTE_GRO_TCP_IPV4;
+        param.max_flow_num = NETIF_MAX_PKT_BURST;
+        param.max_item_per_flow = NETIF_MAX_PKT_BURST;
+        param.socket_id = dev->socket;
+        nb = rte_gro_reassemble_burst(mbufs, nb, &param);
+    }
+
+    for (i = 0; i < nb; i++) {
+        mbuf = mbufs[i];
+        if (!(mbuf->packet_type & RTE_PTYPE_L4_TCP) ||
+                mbuf->pkt_len <= mbuf->l2_len + mbuf->l3_len +
+                                 mbuf->l4_len + mbuf->tso_segsz)
+            continue;
+
+        if (RTE_ETH_IS_IPV4_HDR(mbuf->packet_type)) {
+            /* IP header of aggregate is updated without checksum */
+            iph = rte_pktmbuf_mtod_offset(mbuf, struct ipv4_hdr *,
+                                          mbuf->l2_len);
+            ip4_send_csum(iph);
+            mbuf->ol_flags |= PKT_TX_TCP_SEG | PKT_TX_IPV4 | PKT_TX_IP_CKSUM;
+        } else {
+            mbuf->ol_flags |= PKT_TX_TCP_SEG | PKT_TX_IPV6;
+        }
+    }
+
+    return nb;
+}
+
 /* just for print */
 struct port_queue_lcore_map {
     portid_t pid;
@@ -1931,8 +2122,6 @@ static inline void netif_tx_burst(lcoreid_t cid, portid_t pid, queueid_t qindex)
 {
     int ntx, ii;
     struct netif_queue_conf *txq;
-    unsigned i = 0;
-    struct rte_mbuf *mbuf_copied = NULL;
     struct netif_port *dev = NULL;
 
     assert(LCORE_ID_ANY != cid);
@@ -1940,16 +2129,12 @@ static inline void netif_tx_burst(lcoreid_t cid, portid_t pid, queueid_t qindex)
     if (0 == txq->len)
         return;
 
+    /* capture (and forward2kni) takes refcount clones of TX packets,
+     * they are never modified after this point. */
     dev = netif_port_get(pid);
-    if (dev && (dev->flag & NETIF_PORT_FLAG_FORWARD2KNI)) {
-        for (; i<txq->len; i++) {
-            if (NULL == (mbuf_copied = mbuf_copy(txq->mbufs[i],
-                pktmbuf_pool[dev->socket])))
-                RTE_LOG(WARNING, NETIF, "%s: Failed to copy mbuf\n", __func__);
-            else
-                kni_ingress(mbuf_copied, dev, txq);
-        }
-        kni_send2kern_loop(pid, txq);
+    if (dev && unlikely(dev->flag & NETIF_PORT_FLAG_CAPTURE_ANY)) {
+        for (ii = 0; ii < txq->len; ii++)
+            capture_packet(dev, txq->mbufs[ii], CAPTURE_DIR_TX);
     }
 
     ntx = rte_eth_tx_burst(pid, txq->id, txq->mbufs, txq->len);
@@ -1963,21 +2148,22 @@ static inline void netif_tx_burst(lcoreid_t cid, portid_t pid, queueid_t qindex)
     }
 }
 
+/* round robin over workers, @next is the caller's own cursor */
+static inline lcoreid_t worker_lcore_rr(int *next)
+{
+    /* workers are listed first in lcore_conf, ended by nports == 0 */
+    if (*next >= DPVS_MAX_LCORE || lcore_conf[*next].nports == 0)
+        *next = 0;
+
+    return lcore_conf[(*next)++].id;
+}
+
 /* Call me on MASTER lcore */
 static inline lcoreid_t get_master_xmit_lcore(void)
 {
-    static int i = 0;
-    lcoreid_t cid;
+    static int next = 0;
 
-    if (lcore_conf[i].nports > 0) {
-        cid = lcore_conf[i].id;
-        i++;
-    } else {
-        cid = lcore_conf[0].id;
-        i = 1;
-    }
-
-    return cid;
+    return worker_lcore_rr(&next);
 }
 
 struct master_xmit_msg_data {
@@ -2033,6 +2219,126 @@ int netif_register_master_xmit_msg(void)
     return EDPVS_OK;
 }
 
+/* pfifo_fast priomap, band 0 is of the highest priority */
+static const uint8_t txq_prio2band[16] = {
+    1, 2, 2, 2, 1, 2, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1
+};
+
+/*
+ * RSS hash of the received packet is reused for forwarded packets,
+ * otherwise hash on L3/L4 header. packets of a flow always go through
+ * the same txq, @mbuf data starts at ether header.
+ */
+static inline uint32_t netif_tx_flow_hash(struct rte_mbuf *mbuf)
+{
+    struct ether_hdr *eth;
+    struct ipv4_hdr *iph;
+    struct ipv6_hdr *ip6h;
+    uint16_t eth_type;
+    uint32_t ports = 0, hash;
+    void *l4hdr;
+
+    if (mbuf->ol_flags & PKT_RX_RSS_HASH)
+        return mbuf->hash.rss;
+
+    eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    eth_type = eth->ether_type;
+    l4hdr = eth + 1;
+    if (eth_type == htons(ETHER_TYPE_VLAN)) {
+        eth_type = ((struct vlan_hdr *)l4hdr)->eth_proto;
+        l4hdr = (struct vlan_hdr *)l4hdr + 1;
+    }
+
+    if (eth_type == htons(ETHER_TYPE_IPv4)) {
+        iph = l4hdr;
+        l4hdr = (uint8_t *)iph + ((iph->version_ihl & IPV4_HDR_IHL_MASK) << 2);
+        if ((iph->next_proto_id == IPPROTO_TCP || iph->next_proto_id == IPPROTO_UDP)
+                && !(iph->fragment_offset & htons(IPV4_HDR_MF_FLAG | IPV4_HDR_OFFSET_MASK)))
+            ports = *(uint32_t *)l4hdr;
+        hash = rte_jhash_3words(iph->src_addr, iph->dst_addr, ports, 0);
+    } else if (eth_type == htons(ETHER_TYPE_IPv6)) {
+        ip6h = l4hdr;
+        /* no extension headers walk, flow label helps */
+        if (ip6h->proto == IPPROTO_TCP || ip6h->proto == IPPROTO_UDP)
+            ports = *(uint32_t *)(ip6h + 1);
+        hash = rte_jhash_32b((uint32_t *)ip6h->src_addr, 8, ports ^ ip6h->vtc_flow);
+    } else {
+        hash = 0;
+    }
+
+    return hash;
+}
+
+/*
+ * priority from TOS/traffic class as ipv4 output does for tc:pfifo_fast.
+ * read from the header since not every path sets mbuf->udata64, which
+ * shares storage with mbuf->userdata. @mbuf data starts at ether header.
+ */
+static inline uint8_t netif_tx_prio(struct rte_mbuf *mbuf)
+{
+    struct ether_hdr *eth;
+    uint16_t eth_type;
+    void *l3hdr;
+
+    eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    eth_type = eth->ether_type;
+    l3hdr = eth + 1;
+    if (eth_type == htons(ETHER_TYPE_VLAN)) {
+        eth_type = ((struct vlan_hdr *)l3hdr)->eth_proto;
+        l3hdr = (struct vlan_hdr *)l3hdr + 1;
+    }
+
+    if (eth_type == htons(ETHER_TYPE_IPv4))
+        return (((struct ipv4_hdr *)l3hdr)->type_of_service >> 1) & 15;
+    else if (eth_type == htons(ETHER_TYPE_IPv6))
+        return (ntohl(((struct ipv6_hdr *)l3hdr)->vtc_flow) >> 21) & 15;
+
+    return 0;
+}
+
+static inline int netif_txq_select(const struct netif_port *dev,
+                                   struct rte_mbuf *mbuf, int ntxq)
+{
+    uint8_t band;
+
+    if (likely(ntxq == 1))
+        return 0;
+
+    switch (dev->txq_policy) {
+    case NETIF_TXQ_POLICY_FLOWHASH:
+        return netif_tx_flow_hash(mbuf) % ntxq;
+    case NETIF_TXQ_POLICY_PRIORITY:
+        band = txq_prio2band[netif_tx_prio(mbuf)];
+        return band < ntxq ? band : ntxq - 1;
+    default:
+        return 0;
+    }
+}
+
+/*
+ * txqs with buffered packets of each lcore, so that lcore_job_xmit
+ * flushes them without scanning all ports and queues.
+ */
+struct netif_txq_dirty {
+    portid_t    pid;
+    queueid_t   qindex;
+};
+
+static struct {
+    uint16_t                ndirty;
+    struct netif_txq_dirty  q[NETIF_MAX_RTE_PORTS * NETIF_MAX_QUEUES];
+} txq_dirty_list[DPVS_MAX_LCORE] __rte_cache_aligned;
+
+static inline void txq_dirty_add(lcoreid_t cid, portid_t pid, queueid_t qindex)
+{
+    struct netif_txq_dirty *ent;
+
+    assert(txq_dirty_list[cid].ndirty < NELEMS(txq_dirty_list[cid].q));
+    ent = &txq_dirty_list[cid].q[txq_dirty_list[cid].ndirty++];
+    ent->pid = pid;
+    ent->qindex = qindex;
+}
+
 static inline int validate_xmit_mbuf(struct rte_mbuf *mbuf,
                                      const struct netif_port *dev)
 {
@@ -2051,11 +2357,151 @@ static inline int validate_xmit_mbuf(struct rte_mbuf *mbuf,
     return err;
 }
 
+static inline void netif_txq_enqueue(lcoreid_t cid, struct netif_port *dev,
+                                     struct netif_port_conf *pconf,
+                                     struct rte_mbuf *mbuf)
+{
+    int qindex;
+    struct netif_queue_conf *txq;
+
+    qindex = netif_txq_select(dev, mbuf, pconf->ntxq);
+    txq = &pconf->txqs[qindex];
+
+    if (unlikely(txq->len == NETIF_MAX_PKT_BURST)) {
+        netif_tx_burst(cid, dev->id, qindex);
+        txq->len = 0;
+    }
+
+    if (!txq->dirty) {
+        txq_dirty_add(cid, dev->id, qindex);
+        txq->dirty = 1;
+    }
+
+    lcore_stats[cid].obytes += mbuf->pkt_len;
+    txq->mbufs[txq->len] = mbuf;
+    txq->len++;
+}
+
+/* maximum segments of a TCP aggregate to be segmented by GSO */
+#define NETIF_GSO_SEGS_MAX      256
+
+static inline void netif_tcp_seg_l2_len(struct rte_mbuf *mbuf)
+{
+    struct ether_hdr *eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+
+    if (eth->ether_type == htons(ETH_P_8021Q))
+        mbuf->l2_len = sizeof(struct vlan_ethhdr);
+    else
+        mbuf->l2_len = sizeof(struct ether_hdr);
+}
+
+/* TSO needs pseudo-header checksum without length, and zero IP checksum */
+static void netif_tso_prepare(struct rte_mbuf *mbuf)
+{
+    struct ipv4_hdr *iph;
+    struct ip6_hdr *ip6h;
+    struct tcp_hdr *th;
+
+    th = rte_pktmbuf_mtod_offset(mbuf, struct tcp_hdr *,
+                                 mbuf->l2_len + mbuf->l3_len);
+
+    if (mbuf->ol_flags & PKT_TX_IPV4) {
+        iph = rte_pktmbuf_mtod_offset(mbuf, struct ipv4_hdr *, mbuf->l2_len);
+        iph->hdr_checksum = 0;
+        mbuf->ol_flags |= PKT_TX_IP_CKSUM;
+        th->cksum = ip4_phdr_cksum(iph, mbuf->ol_flags);
+    } else {
+        ip6h = rte_pktmbuf_mtod_offset(mbuf, struct ip6_hdr *, mbuf->l2_len);
+        th->cksum = ip6_phdr_cksum(ip6h, mbuf->ol_flags,
+                                   mbuf->l3_len, IPPROTO_TCP);
+    }
+}
+
+/* checksums of a GSO segment, by offload or by software */
+static int netif_gso_seg_csum(struct rte_mbuf *seg, struct netif_port *dev)
+{
+    struct ipv4_hdr *iph;
+    struct tcp_hdr *th;
+    uint16_t csum;
+    uint32_t sum;
+
+    iph = rte_pktmbuf_mtod_offset(seg, struct ipv4_hdr *, seg->l2_len);
+    th = rte_pktmbuf_mtod_offset(seg, struct tcp_hdr *,
+                                 seg->l2_len + seg->l3_len);
+
+    if (dev->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD) {
+        seg->ol_flags |= PKT_TX_TCP_CKSUM;
+        th->cksum = ip4_phdr_cksum(iph, seg->ol_flags);
+    } else {
+        th->cksum = 0;
+        if (rte_raw_cksum_mbuf(seg, seg->l2_len + seg->l3_len,
+                    seg->pkt_len - seg->l2_len - seg->l3_len, &csum) != 0)
+            return EDPVS_INVPKT;
+        sum = (uint32_t)csum + ip4_phdr_cksum(iph, 0);
+        sum = (sum & 0xffff) + (sum >> 16);
+        sum = (sum & 0xffff) + (sum >> 16);
+        th->cksum = (uint16_t)~sum;
+    }
+
+    if (dev->flag & NETIF_PORT_FLAG_TX_IP_CSUM_OFFLOAD) {
+        iph->hdr_checksum = 0;
+    } else {
+        seg->ol_flags &= ~PKT_TX_IP_CKSUM;
+        ip4_send_csum(iph);
+    }
+
+    return EDPVS_OK;
+}
+
+/*
+ * software segmentation of TCP aggregate for device without TSO.
+ * librte_gso of DPDK 17.11 supports TCP/IPv4 only.
+ */
+static int netif_gso_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    struct rte_gso_ctx ctx;
+    struct rte_mbuf *segs[NETIF_GSO_SEGS_MAX];
+    int i, nseg, err = EDPVS_OK;
+
+    if (unlikely(!(mbuf->ol_flags & PKT_TX_IPV4))) {
+        RTE_LOG(DEBUG, NETIF, "%s: no TSO for IPv6 aggregate on %s\n",
+                __func__, dev->name);
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_NOTSUPP;
+    }
+
+    ctx.direct_pool = pktmbuf_pool[dev->socket];
+    ctx.indirect_pool = pktmbuf_pool[dev->socket];
+    ctx.flag = 0;
+    ctx.gso_types = DEV_TX_OFFLOAD_TCP_TSO;
+    ctx.gso_size = mbuf->l2_len + mbuf->l3_len + mbuf->l4_len + mbuf->tso_segsz;
+
+    nseg = rte_gso_segment(mbuf, &ctx, segs, NETIF_GSO_SEGS_MAX);
+    if (unlikely(nseg < 0)) {
+        RTE_LOG(DEBUG, NETIF, "%s: fail to segment on %s\n",
+                __func__, dev->name);
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_NOMEM;
+    }
+
+    /* segments (or @mbuf itself if not segmented) has PKT_TX_TCP_SEG cleared */
+    for (i = 0; i < nseg; i++) {
+        if (unlikely(netif_gso_seg_csum(segs[i], dev) != EDPVS_OK)) {
+            rte_pktmbuf_free(segs[i]);
+            err = EDPVS_INVPKT;
+            continue;
+        }
+        if (netif_hard_xmit(segs[i], dev) != EDPVS_OK)
+            err = EDPVS_DROP;
+    }
+
+    return err;
+}
+
 int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
 {
     lcoreid_t cid;
-    int pid, qindex;
-    struct netif_queue_conf *txq;
+    struct netif_port_conf *pconf;
     struct netif_ops *ops;
     int ret = EDPVS_OK;
 
@@ -2108,22 +2554,55 @@ int netif_hard_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
         return ret;
     }
 
+    /* TCP aggregate (LRO/GRO), segmented by TSO or GSO */
+    if (unlikely(mbuf->ol_flags & PKT_TX_TCP_SEG)) {
+        netif_tcp_seg_l2_len(mbuf);
+        if (!(dev->flag & NETIF_PORT_FLAG_TX_TCP_TSO_OFFLOAD))
+            return netif_gso_xmit(mbuf, dev);
+        netif_tso_prepare(mbuf);
+    }
+
     /* port id is determined by routing */
-    pid = dev->id;
-    /* qindex is hashed by physical address of mbuf */
-    qindex = (((uint32_t) mbuf->buf_physaddr) >> 8) %
-        (lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].ntxq);
-    //RTE_LOG(DEBUG, NETIF, "tx-queue hash(%x) = %d\n", ((uint32_t)mbuf->buf_physaddr) >> 8, qindex);
-    txq = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][pid]].txqs[qindex];
+    pconf = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][dev->id]];
+    netif_txq_enqueue(cid, dev, pconf, mbuf);
+    return EDPVS_OK;
+}
 
-    if (unlikely(txq->len == NETIF_MAX_PKT_BURST)) {
-        netif_tx_burst(cid, pid, qindex);
-        txq->len = 0;
+/*
+ * xmit a burst of packets, whose L2 headers are filled already, on @dev.
+ * that's for the burst xmit stage of ipvs fast-xmit, the packets are put
+ * to txq directly if no per-packet processing is needed by @dev.
+ */
+int netif_xmit_burst(struct rte_mbuf **mbufs, int n, struct netif_port *dev)
+{
+    int i;
+    lcoreid_t cid = rte_lcore_id();
+    struct netif_port_conf *pconf;
+    struct rte_mbuf *mbuf;
+
+    if (unlikely((dev->netif_ops && dev->netif_ops->op_xmit)
+                || (dev->flag & NETIF_PORT_FLAG_TC_EGRESS)
+                || rte_get_master_lcore() == cid)) {
+        for (i = 0; i < n; i++)
+            netif_xmit(mbufs[i], dev);
+        return EDPVS_OK;
+    }
+
+    pconf = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][dev->id]];
+    for (i = 0; i < n; i++) {
+        mbuf = mbufs[i];
+        if (unlikely(mbuf->ol_flags & (PKT_TX_VLAN_PKT | PKT_TX_TCP_SEG))) {
+            netif_xmit(mbuf, dev);
+            continue;
+        }
+
+        mbuf->port = dev->id;
+        if (likely(mbuf->ol_flags & PKT_TX_IP_CKSUM))
+            mbuf->l2_len = sizeof(struct ether_hdr);
+
+        netif_txq_enqueue(cid, dev, pconf, mbuf);
     }
 
-    lcore_stats[cid].obytes += mbuf->pkt_len;
-    txq->mbufs[txq->len] = mbuf;
-    txq->len++;
     return EDPVS_OK;
 }
 
@@ -2274,6 +2753,29 @@ static inline int netif_deliver_mbuf(struct rte_mbuf *mbuf,
     return EDPVS_OK;
 }
 
+/*
+ * deliver ethernet frame @mbuf received by virtual L2 device @dev,
+ * e.g., the inner frame of VXLAN. frames not handled by dpvs go to
+ * the KNI of @dev if any, or dropped.
+ */
+int netif_rcv_l2(struct netif_port *dev, struct rte_mbuf *mbuf)
+{
+    struct ether_hdr *eth_hdr;
+
+    if (unlikely(mbuf_may_pull(mbuf, sizeof(*eth_hdr)) != 0)) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_INVPKT;
+    }
+
+    mbuf->port = dev->id;
+
+    eth_hdr = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    mbuf->packet_type = eth_type_parse(eth_hdr, dev);
+
+    return netif_deliver_mbuf(mbuf, eth_hdr->ether_type, dev, NULL, false,
+                              rte_lcore_id(), false);
+}
+
 static int netif_arp_ring_init(void)
 {
     char name_buf[RTE_RING_NAMESIZE];
@@ -2297,7 +2799,6 @@ void lcore_process_packets(struct netif_queue_conf *qconf, struct rte_mbuf **mbu
 {
     int i, t;
     struct ether_hdr *eth_hdr;
-    struct rte_mbuf *mbuf_copied = NULL;
 
     /* prefetch packets */
     for (t = 0; t < count && t < NETIF_PKT_PREFETCH_OFFSET; t++)
@@ -2328,20 +2829,12 @@ void lcore_process_packets(struct netif_queue_conf *qconf, struct rte_mbuf **mbu
         mbuf->packet_type = eth_type_parse(eth_hdr, dev);
 
         /*
-         * In NETIF_PORT_FLAG_FORWARD2KNI mode.
-         * All packets received are deep copied and sent to  KNI
-         * for the purpose of capturing forwarding packets.Since the
-         * rte_mbuf will be modified in the following procedure,
-         * we should use mbuf_copy instead of rte_pktmbuf_clone.
+         * packet capture and NETIF_PORT_FLAG_FORWARD2KNI mode.
+         * the rte_mbuf will be modified in the following procedure,
+         * so capture module copies (snaplen bounded) rather than clones
+         * the received packets that pass sampling and BPF filter.
          */
-        if (dev->flag & NETIF_PORT_FLAG_FORWARD2KNI) {
-            if (likely(NULL != (mbuf_copied = mbuf_copy(mbuf,
-                                pktmbuf_pool[dev->socket]))))
-                kni_ingress(mbuf_copied, dev, qconf);
-            else
-                RTE_LOG(WARNING, NETIF, "%s: Failed to copy mbuf\n",
-                        __func__);
-        }
+        capture_packet_check(dev, mbuf, CAPTURE_DIR_RX);
 
         /*
          * do not drop pkt to other hosts (ETH_PKT_OTHERHOST)
@@ -2395,9 +2888,16 @@ static void lcore_process_arp_ring(struct netif_queue_conf *qconf, lcoreid_t cid
     }
 }
 
-static void lcore_process_redirect_ring(struct netif_queue_conf *qconf, lcoreid_t cid)
+/* redirect rings are per lcore rather than per rx queue, process them
+ * once a loop with the first rx queue as context. */
+static void lcore_process_redirect_ring(lcoreid_t cid)
 {
-    dp_vs_redirect_ring_proc(qconf, cid);
+    struct netif_lcore_conf *lcore = &lcore_conf[lcore2index[cid]];
+
+    if (unlikely(!lcore->nports || !lcore->pqs[0].nrxq))
+        return;
+
+    dp_vs_redirect_ring_proc(&lcore->pqs[0].rxqs[0], cid);
 }
 
 static void lcore_job_recv_fwd(void *arg)
@@ -2405,11 +2905,15 @@ static void lcore_job_recv_fwd(void *arg)
     int i, j;
     portid_t pid;
     lcoreid_t cid;
+    struct netif_port *dev;
     struct netif_queue_conf *qconf;
 
     cid = rte_lcore_id();
     assert(LCORE_ID_ANY != cid);
 
+    lcore_process_kni_ring(cid);
+    lcore_process_redirect_ring(cid);
+
     for (i = 0; i < lcore_conf[lcore2index[cid]].nports; i++) {
         pid = lcore_conf[lcore2index[cid]].pqs[i].id;
         assert(pid <= bond_pid_end);
@@ -2418,41 +2922,45 @@ static void lcore_job_recv_fwd(void *arg)
             qconf = &lcore_conf[lcore2index[cid]].pqs[i].rxqs[j];
 
             lcore_process_arp_ring(qconf, cid);
-            lcore_process_redirect_ring(qconf, cid);
             qconf->len = netif_rx_burst(pid, qconf);
 
             lcore_stats_burst(&lcore_stats[cid], qconf->len);
 
+            dev = netif_port_get(pid);
+            if (dev && (dev->flag & (NETIF_PORT_FLAG_RX_TCP_LRO |
+                                     NETIF_PORT_FLAG_RX_GRO)))
+                qconf->len = netif_rx_aggregate(dev, qconf->mbufs, qconf->len);
+
             lcore_process_packets(qconf, qconf->mbufs, cid, qconf->len, 0);
+            dp_vs_xmit_burst_flush(cid);
             kni_send2kern_loop(pid, qconf);
         }
     }
+
+    /* packets of kni/redirect rings staged for burst xmit */
+    dp_vs_xmit_burst_flush(cid);
+
+    /* packets redirected in this loop are enqueued to peers by burst */
+    dp_vs_redirect_ring_flush(cid);
 }
 
 static void lcore_job_xmit(void *args)
 {
-    int i, j;
+    int i;
     lcoreid_t cid;
-    portid_t pid;
+    struct netif_txq_dirty *ent;
     struct netif_queue_conf *qconf;
 
     cid = rte_lcore_id();
-    for (i = 0; i < lcore_conf[lcore2index[cid]].nports; i++) {
-        pid = lcore_conf[lcore2index[cid]].pqs[i].id;
-#ifdef CONFIG_DPVS_NETIF_DEBUG
-        if (unlikely(pid >= rte_eth_dev_count())) {
-            RTE_LOG(DEBUG, NETIF, "[%s] No enough NICs\n", __func__);
-            continue;
-        }
-#endif
-        for (j = 0; j < lcore_conf[lcore2index[cid]].pqs[i].ntxq; j++) {
-            qconf = &lcore_conf[lcore2index[cid]].pqs[i].txqs[j];
-            if (qconf->len <= 0)
-                continue;
-            netif_tx_burst(cid, pid, j);
-            qconf->len = 0;
-        }
+    for (i = 0; i < txq_dirty_list[cid].ndirty; i++) {
+        ent = &txq_dirty_list[cid].q[i];
+        qconf = &lcore_conf[lcore2index[cid]].pqs[port2index[cid][ent->pid]]
+                    .txqs[ent->qindex];
+        netif_tx_burst(cid, ent->pid, ent->qindex);
+        qconf->len = 0;
+        qconf->dirty = 0;
     }
+    txq_dirty_list[cid].ndirty = 0;
 }
 
 static int timer_sched_interval_us;
@@ -2500,6 +3008,10 @@ static void netif_lcore_init(void)
     /* build port fast searching table */
     port_index_init();
 
+    if ((res = kni_lcore_init()) != EDPVS_OK)
+        rte_exit(EXIT_FAILURE, "[%s] fail to init kni rings: %s, exit ...\n",
+                 __func__, dpvs_strerror(res));
+
     /* register lcore jobs*/
     snprintf(netif_jobs[0].name, sizeof(netif_jobs[0].name) - 1, "%s", "recv_fwd");
     netif_jobs[0].func = lcore_job_recv_fwd;
@@ -2535,7 +3047,8 @@ static inline void netif_lcore_cleanup(void)
 }
 
 /********************************************** kni *************************************************/
-static rte_spinlock_t kni_lock;
+static struct rte_ring *kni_rx_ring[DPVS_MAX_LCORE];    /* worker -> dedicated kni lcore */
+static struct rte_ring *kni_tx_ring[DPVS_MAX_LCORE];    /* kernel -> worker */
 
 /* always update bond port macaddr and its KNI macaddr together */
 static int update_bond_macaddr(struct netif_port *port)
@@ -2566,6 +3079,45 @@ static inline void free_mbufs(struct rte_mbuf **pkts, unsigned num)
     }
 }
 
+static inline bool kni_lcore_dedicated(void)
+{
+    return g_kni_lcore_id != NETIF_LCORE_ID_INVALID;
+}
+
+/* hand the buffered exception packets of a worker to the dedicated
+ * KNI lcore, mbuf->port tells which device each one belongs to. */
+static void kni_send2ring(lcoreid_t cid, struct netif_queue_conf *qconf)
+{
+    unsigned pkt_num;
+
+    pkt_num = rte_ring_sp_enqueue_burst(kni_rx_ring[cid],
+                (void *const *)qconf->kni_mbufs, qconf->kni_len, NULL);
+    if (unlikely(pkt_num < qconf->kni_len)) {
+        lcore_stats[cid].dropped += qconf->kni_len - pkt_num;
+        free_mbufs(&(qconf->kni_mbufs[pkt_num]), qconf->kni_len - pkt_num);
+    }
+    qconf->kni_len = 0;
+}
+
+/* send a single packet of @dev to kernel without rx queue buffering */
+static void kni_ingress_one(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    lcoreid_t cid = rte_lcore_id();
+    unsigned pkt_num = 0;
+
+    mbuf->port = dev->id;
+
+    if (!kni_lcore_dedicated())
+        pkt_num = kni_send2kern_burst(dev, &mbuf, 1);
+    else if (kni_rx_ring[cid])
+        pkt_num = rte_ring_sp_enqueue(kni_rx_ring[cid], mbuf) == 0;
+
+    if (unlikely(!pkt_num)) {
+        lcore_stats[cid].dropped++;
+        rte_pktmbuf_free(mbuf);
+    }
+}
+
 static void kni_ingress(struct rte_mbuf *mbuf, struct netif_port *dev,
                         struct netif_queue_conf *qconf)
 {
@@ -2576,13 +3128,26 @@ static void kni_ingress(struct rte_mbuf *mbuf, struct netif_port *dev,
         return;
     }
 
+    /* no rx queue for virtual L2 devices, see netif_rcv_l2 */
+    if (!qconf) {
+        kni_ingress_one(mbuf, dev);
+        return;
+    }
+
     if (likely(qconf->kni_len < NETIF_MAX_PKT_BURST)) {
+        mbuf->port = dev->id;
         qconf->kni_mbufs[qconf->kni_len] = mbuf;
         qconf->kni_len++;
     } else {
         rte_pktmbuf_free(mbuf);
     }
 
+    if (kni_lcore_dedicated()) {
+        if (unlikely(qconf->kni_len == NETIF_MAX_PKT_BURST))
+            kni_send2ring(rte_lcore_id(), qconf);
+        return;
+    }
+
     /* VLAN device cannot be scheduled by kni_send2kern_loop */
     if ((dev->type == PORT_TYPE_VLAN && qconf->kni_len > 0) ||
         unlikely(qconf->kni_len == NETIF_MAX_PKT_BURST)) {
@@ -2604,6 +3169,11 @@ static void kni_send2kern_loop(uint8_t port_id, struct netif_queue_conf *qconf)
     struct netif_port *dev;
     unsigned pkt_num;
 
+    if (qconf->kni_len > 0 && kni_lcore_dedicated()) {
+        kni_send2ring(rte_lcore_id(), qconf);
+        return;
+    }
+
     dev = netif_port_get(port_id);
 
     if (qconf->kni_len > 0) {
@@ -2623,9 +3193,37 @@ static void kni_send2kern_loop(uint8_t port_id, struct netif_queue_conf *qconf)
     }
 }
 
+/* send a burst to kernel from non-worker lcore, unsent mbufs are not freed */
+unsigned kni_send2kern_burst(struct netif_port *dev,
+                             struct rte_mbuf **mbufs, unsigned npkts)
+{
+    unsigned pkt_num = 0;
+
+    rte_spinlock_lock(&kni_lock);
+    if (kni_dev_exist(dev))
+        pkt_num = rte_kni_tx_burst(dev->kni.kni, mbufs, npkts);
+    rte_spinlock_unlock(&kni_lock);
+
+    return pkt_num;
+}
+
+/* pick the worker to transmit a burst from KNI */
+static inline lcoreid_t kni_xmit_lcore(void)
+{
+    static int next = 0;
+
+    return worker_lcore_rr(&next);
+}
+
+/*
+ * packets from kernel are handed to a worker by burst through its
+ * kni_tx_ring, rather than a MSG_TYPE_MASTER_XMIT message per packet.
+ * called on master or the dedicated KNI lcore, the only producer.
+ */
 static void kni_send2port_loop(struct netif_port *port)
 {
-    unsigned i, npkts;
+    unsigned i, npkts, pkt_num;
+    lcoreid_t cid = rte_lcore_id();
     struct rte_mbuf *kni_pkts_burst[NETIF_MAX_PKT_BURST];
 
     if (!kni_dev_exist(port))
@@ -2636,9 +3234,33 @@ static void kni_send2port_loop(struct netif_port *port)
         RTE_LOG(WARNING, NETIF, "%s: fail to recieve pkts from kni\n", __func__);
         return;
     }
+    if (!npkts)
+        return;
 
-    for (i = 0; i < npkts; i++)
-        netif_xmit(kni_pkts_burst[i], port);
+    for (i = 0; i < npkts; i++) {
+        kni_pkts_burst[i]->port = port->id;
+        lcore_stats[cid].obytes += kni_pkts_burst[i]->pkt_len;
+    }
+
+    pkt_num = rte_ring_sp_enqueue_burst(kni_tx_ring[kni_xmit_lcore()],
+                (void *const *)kni_pkts_burst, npkts, NULL);
+    lcore_stats[cid].opackets += pkt_num;
+    if (unlikely(pkt_num < npkts)) {
+        lcore_stats[cid].dropped += npkts - pkt_num;
+        free_mbufs(&kni_pkts_burst[pkt_num], npkts - pkt_num);
+    }
+}
+
+/* transmit packets from kernel on worker lcore */
+static void lcore_process_kni_ring(lcoreid_t cid)
+{
+    struct rte_mbuf *mbufs[NETIF_MAX_PKT_BURST];
+    unsigned i, nb_rb;
+
+    nb_rb = rte_ring_sc_dequeue_burst(kni_tx_ring[cid], (void **)mbufs,
+                                      NETIF_MAX_PKT_BURST, NULL);
+    for (i = 0; i < nb_rb; i++)
+        netif_xmit(mbufs[i], netif_port_get(mbufs[i]->port));
 }
 
 void kni_process_on_master(void)
@@ -2646,14 +3268,140 @@ void kni_process_on_master(void)
     struct netif_port *dev;
     portid_t id;
 
-    for (id = 0; id < g_nports; id++) {
+    if (kni_lcore_dedicated())
+        return;
+
+    /* ids of virtual devices (VLAN, VXLAN) are not reused, they may
+     * exceed the number of ports after some devices are deleted */
+    for (id = 0; id < netif_port_count(); id++) {
+        dev = netif_port_get(id);
+        if (!dev || !kni_dev_exist(dev))
+            continue;
+
+        kni_handle_request(dev);
+        kni_send2port_loop(dev);
+    }
+}
+
+/* send a run of packets of same device to kernel */
+static void kni_lcore_send2kern(lcoreid_t cid, struct rte_mbuf **mbufs,
+                                unsigned npkts)
+{
+    struct netif_port *dev = netif_port_get(mbufs[0]->port);
+    unsigned pkt_num = 0;
+
+    if (likely(dev != NULL))
+        pkt_num = kni_send2kern_burst(dev, mbufs, npkts);
+
+    lcore_stats[cid].ipackets += pkt_num;
+    if (unlikely(pkt_num < npkts)) {
+        lcore_stats[cid].dropped += npkts - pkt_num;
+        free_mbufs(&mbufs[pkt_num], npkts - pkt_num);
+    }
+}
+
+static void kni_lcore_ingress(lcoreid_t cid)
+{
+    struct rte_mbuf *mbufs[NETIF_MAX_PKT_BURST];
+    unsigned i, start, nb_rb;
+    lcoreid_t wid;
+
+    for (wid = 0; wid < DPVS_MAX_LCORE; wid++) {
+        if (!kni_rx_ring[wid])
+            continue;
+
+        nb_rb = rte_ring_sc_dequeue_burst(kni_rx_ring[wid], (void **)mbufs,
+                                          NETIF_MAX_PKT_BURST, NULL);
+        if (!nb_rb)
+            continue;
+        lcore_stats_burst(&lcore_stats[cid], nb_rb);
+
+        /* workers mostly feed one device per burst, send runs of
+         * packets with the same port by one rte_kni_tx_burst. */
+        for (start = 0, i = 1; i <= nb_rb; i++) {
+            if (i < nb_rb && mbufs[i]->port == mbufs[start]->port)
+                continue;
+            kni_lcore_send2kern(cid, &mbufs[start], i - start);
+            start = i;
+        }
+    }
+}
+
+static void kni_lcore_egress(void)
+{
+    struct netif_port *dev;
+    portid_t id;
+
+    for (id = 0; id < netif_port_count(); id++) {
         dev = netif_port_get(id);
         if (!dev || !kni_dev_exist(dev))
             continue;
 
+        /* kni_lock keeps kni_del_dev on master off */
+        rte_spinlock_lock(&kni_lock);
         kni_handle_request(dev);
         kni_send2port_loop(dev);
+        rte_spinlock_unlock(&kni_lock);
+    }
+}
+
+static void try_kni_lcore_loop(void)
+{
+    lcoreid_t cid = rte_lcore_id();
+
+    if (cid != g_kni_lcore_id)
+        return;
+    RTE_LOG(INFO, NETIF, "dedicated kni lcore%d started\n", cid);
+
+    while (1) {
+        kni_lcore_ingress(cid);
+        kni_lcore_egress();
+        lcore_stats[cid].lcore_loop++;
+    }
+}
+
+static int kni_lcore_init(void)
+{
+    char name_buf[RTE_RING_NAMESIZE];
+    uint64_t slave_lcore_mask;
+    lcoreid_t cid;
+
+    if (kni_lcore_dedicated() && (g_kni_lcore_id >= DPVS_MAX_LCORE ||
+                !rte_lcore_is_enabled(g_kni_lcore_id) ||
+                g_kni_lcore_id == rte_get_master_lcore() ||
+                !netif_lcore_is_idle(g_kni_lcore_id))) {
+        RTE_LOG(WARNING, NETIF, "%s: invalid kni lcore %d, serve kni on master\n",
+                __func__, g_kni_lcore_id);
+        g_kni_lcore_id = NETIF_LCORE_ID_INVALID;
+    }
+
+    netif_get_slave_lcores(NULL, &slave_lcore_mask);
+    for (cid = 0; cid < DPVS_MAX_LCORE; cid++) {
+        if (!(slave_lcore_mask & (1UL << cid)))
+            continue;
+
+        snprintf(name_buf, RTE_RING_NAMESIZE, "kni_tx_ring_c%d", cid);
+        kni_tx_ring[cid] = rte_ring_create(name_buf, KNI_RING_SIZE,
+                                           rte_lcore_to_socket_id(cid),
+                                           RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!kni_tx_ring[cid])
+            return EDPVS_NOMEM;
+
+        if (!kni_lcore_dedicated())
+            continue;
+
+        snprintf(name_buf, RTE_RING_NAMESIZE, "kni_rx_ring_c%d", cid);
+        kni_rx_ring[cid] = rte_ring_create(name_buf, KNI_RING_SIZE,
+                                           rte_lcore_to_socket_id(cid),
+                                           RING_F_SP_ENQ | RING_F_SC_DEQ);
+        if (!kni_rx_ring[cid])
+            return EDPVS_NOMEM;
     }
+
+    if (kni_lcore_dedicated())
+        RTE_LOG(INFO, NETIF, "kni is served by dedicated lcore%d\n", g_kni_lcore_id);
+
+    return EDPVS_OK;
 }
 
 /********************************************* port *************************************************/
@@ -2949,6 +3697,56 @@ static int dpdk_set_fdir_filt(struct netif_port *dev, enum rte_filter_op op,
     return EDPVS_OK;
 }
 
+static int __netif_flow_add(struct netif_port *dev, const struct rte_flow_attr *attr,
+                            const struct rte_flow_item pattern[],
+                            const struct rte_flow_action actions[],
+                            struct netif_flow *flow)
+{
+    struct rte_flow_error error;
+    struct rte_flow *f;
+
+    if (flow->nflows >= NETIF_MAX_BOND_SLAVES)
+        return EDPVS_NOROOM;
+
+    memset(&error, 0, sizeof(error));
+    f = rte_flow_create(dev->id, attr, pattern, actions, &error);
+    if (!f) {
+        RTE_LOG(INFO, NETIF, "%s: fail to create flow on %s - %s\n",
+                __func__, dev->name, error.message ? : "unknown");
+        return EDPVS_DPDKAPIFAIL;
+    }
+
+    flow->flows[flow->nflows].pid = dev->id;
+    flow->flows[flow->nflows].flow = f;
+    flow->nflows++;
+
+    return EDPVS_OK;
+}
+
+static int bond_flow_create(struct netif_port *dev, const struct rte_flow_attr *attr,
+                            const struct rte_flow_item pattern[],
+                            const struct rte_flow_action actions[],
+                            struct netif_flow *flow)
+{
+    int i, err;
+    struct netif_port *slave;
+
+    if (dev->type != PORT_TYPE_BOND_MASTER)
+        return EDPVS_INVAL;
+
+    flow->nflows = 0;
+    for (i = 0; i < dev->bond->master.slave_nb; i++) {
+        slave = dev->bond->master.slaves[i];
+        err = __netif_flow_add(slave, attr, pattern, actions, flow);
+        if (err != EDPVS_OK) {
+            netif_flow_destroy(flow);
+            return err;
+        }
+    }
+
+    return EDPVS_OK;
+}
+
 static struct netif_ops dpdk_netif_ops = {
     .op_set_mc_list      = dpdk_set_mc_list,
     .op_set_fdir_filt    = dpdk_set_fdir_filt,
@@ -2959,6 +3757,7 @@ static struct netif_ops bond_netif_ops = {
     .op_set_mc_list      = bond_set_mc_list,
     .op_set_fdir_filt    = bond_set_fdir_filt,
     .op_filter_supported = bond_filter_supported,
+    .op_flow_create      = bond_flow_create,
 };
 
 static inline void setup_dev_of_flags(struct netif_port *port)
@@ -2979,6 +3778,9 @@ static inline void setup_dev_of_flags(struct netif_port *port)
     else
         port->dev_info.default_txconf.txq_flags |= ETH_TXQ_FLAGS_NOXSUMUDP;
 
+    if (port->dev_info.tx_offload_capa & DEV_TX_OFFLOAD_TCP_TSO)
+        port->flag |= NETIF_PORT_FLAG_TX_TCP_TSO_OFFLOAD;
+
     /* FIXME: may be a bug in dev_info get for virtio device,
      *        set the txq_of_flags manually for this type device */
     if (strncmp(port->dev_info.driver_name, "net_virtio", strlen("net_virtio")) == 0) {
@@ -3177,6 +3979,51 @@ int netif_get_stats(struct netif_port *dev, struct rte_eth_stats *stats)
     return EDPVS_OK;
 }
 
+/* RSS key and RETA of @dev, RETA entries are translated to rx lcores */
+int netif_get_rss(struct netif_port *dev, struct netif_rss *rss)
+{
+    struct rte_eth_rss_reta_entry64 reta_conf[NETIF_RSS_RETA_SIZE_MAX /
+                                              RTE_RETA_GROUP_SIZE];
+    struct rte_eth_rss_conf rss_conf;
+    uint16_t reta_size, i;
+    queueid_t qid;
+
+    assert(dev && dev->netif_ops && rss);
+
+    if (dev->netif_ops->op_get_rss)
+        return dev->netif_ops->op_get_rss(dev, rss);
+
+    reta_size = dev->dev_info.reta_size;
+    if (!reta_size || reta_size > NETIF_RSS_RETA_SIZE_MAX ||
+            (reta_size & (reta_size - 1)))
+        return EDPVS_NOTSUPP;
+
+    memset(rss, 0, sizeof(*rss));
+    rss->port = dev->id;
+    memset(&rss_conf, 0, sizeof(rss_conf));
+    rss_conf.rss_key = rss->key;
+    rss_conf.rss_key_len = sizeof(rss->key);
+    if (rte_eth_dev_rss_hash_conf_get((uint8_t)dev->id, &rss_conf) < 0)
+        return EDPVS_DPDKAPIFAIL;
+    rss->rss_hf = rss_conf.rss_hf;
+    rss->key_len = rss_conf.rss_key_len;
+
+    memset(reta_conf, 0, sizeof(reta_conf));
+    for (i = 0; i < (reta_size + RTE_RETA_GROUP_SIZE - 1) / RTE_RETA_GROUP_SIZE; i++)
+        reta_conf[i].mask = ~0ULL;
+    if (rte_eth_dev_rss_reta_query((uint8_t)dev->id, reta_conf, reta_size) < 0)
+        return EDPVS_DPDKAPIFAIL;
+
+    rss->reta_size = reta_size;
+    for (i = 0; i < reta_size; i++) {
+        qid = reta_conf[i / RTE_RETA_GROUP_SIZE].reta[i % RTE_RETA_GROUP_SIZE];
+        rss->reta[i] = qid < NETIF_MAX_QUEUES ?
+                       pql_map[dev->id].rx_qid[qid] : NETIF_LCORE_ID_INVALID;
+    }
+
+    return EDPVS_OK;
+}
+
 int netif_fdir_filter_set(struct netif_port *port, enum rte_filter_op opcode,
                           const struct rte_eth_fdir_filter *fdir_flt)
 {
@@ -3188,6 +4035,39 @@ int netif_fdir_filter_set(struct netif_port *port, enum rte_filter_op opcode,
     return port->netif_ops->op_set_fdir_filt(port, opcode, fdir_flt);
 }
 
+int netif_flow_create(struct netif_port *dev, const struct rte_flow_attr *attr,
+                      const struct rte_flow_item pattern[],
+                      const struct rte_flow_action actions[],
+                      struct netif_flow *flow)
+{
+    assert(dev && dev->netif_ops && flow);
+
+    if (dev->netif_ops->op_flow_create)
+        return dev->netif_ops->op_flow_create(dev, attr, pattern, actions, flow);
+
+    flow->nflows = 0;
+    return __netif_flow_add(dev, attr, pattern, actions, flow);
+}
+
+int netif_flow_destroy(struct netif_flow *flow)
+{
+    struct rte_flow_error error;
+    int i, err = EDPVS_OK;
+
+    assert(flow);
+
+    for (i = 0; i < flow->nflows; i++) {
+        if (rte_flow_destroy(flow->flows[i].pid, flow->flows[i].flow, &error) < 0) {
+            RTE_LOG(WARNING, NETIF, "%s: fail to destroy flow on port %d - %s\n",
+                    __func__, flow->flows[i].pid, error.message ? : "unknown");
+            err = EDPVS_DPDKAPIFAIL;
+        }
+    }
+    flow->nflows = 0;
+
+    return err;
+}
+
 int netif_port_conf_get(struct netif_port *port, struct rte_eth_conf *eth_conf)
 {
 
@@ -3285,6 +4165,19 @@ static int rss_resolve_proc(char *rss)
     return rss_value;
 }
 
+/* RX aggregates are multi-segment and must be accepted by all tx queues */
+static bool rx_aggregate_configured(void)
+{
+    struct port_conf_stream *cfg_stream;
+
+    list_for_each_entry(cfg_stream, &port_list, port_list_node) {
+        if (cfg_stream->lro || cfg_stream->gro)
+            return true;
+    }
+
+    return false;
+}
+
 /* fill in rx/tx queue configurations, including queue number,
  * decriptor number, bonding device's rss */
 static void fill_port_config(struct netif_port *port, char *promisc_on)
@@ -3344,10 +4237,26 @@ static void fill_port_config(struct netif_port *port, char *promisc_on)
         }
         port->rxq_desc_nb = cfg_stream->rx_desc_nb;
         port->txq_desc_nb = cfg_stream->tx_desc_nb;
+        port->txq_policy = cfg_stream->txq_policy;
+
+        /* aggregates are segmented again by TSO, or by GSO if no TSO */
+        if (cfg_stream->lro) {
+            if (port->dev_info.rx_offload_capa & DEV_RX_OFFLOAD_TCP_LRO) {
+                port->dev_conf.rxmode.enable_lro = 1;
+                port->flag |= NETIF_PORT_FLAG_RX_TCP_LRO;
+            } else {
+                RTE_LOG(WARNING, NETIF, "%s: lro not supported by device, "
+                        "use gro instead\n", port->name);
+                cfg_stream->gro = true;
+            }
+        }
+        if (cfg_stream->gro)
+            port->flag |= NETIF_PORT_FLAG_RX_GRO;
     } else {
         /* using default configurations */
         port->rxq_desc_nb = NETIF_NB_RX_DESC_DEF;
         port->txq_desc_nb = NETIF_NB_TX_DESC_DEF;
+        port->txq_policy = NETIF_TXQ_POLICY_LCORE;
     }
 
     if (port->type == PORT_TYPE_BOND_MASTER) {
@@ -3370,9 +4279,13 @@ static void fill_port_config(struct netif_port *port, char *promisc_on)
         if (cfg_stream) {
             port->rxq_desc_nb = cfg_stream->rx_desc_nb;
             port->txq_desc_nb = cfg_stream->tx_desc_nb;
+            port->txq_policy = cfg_stream->txq_policy;
+            if (cfg_stream->gro)
+                port->flag |= NETIF_PORT_FLAG_RX_GRO;
         } else {
             port->rxq_desc_nb = NETIF_NB_RX_DESC_DEF;
             port->txq_desc_nb = NETIF_NB_TX_DESC_DEF;
+            port->txq_policy = NETIF_TXQ_POLICY_LCORE;
         }
     }
     /* enable promicuous mode if configured */
@@ -3501,7 +4414,9 @@ int netif_port_start(struct netif_port *port)
             if (port->dev_conf.rxmode.jumbo_frame
                     || (port->flag & NETIF_PORT_FLAG_TX_IP_CSUM_OFFLOAD)
                     || (port->flag & NETIF_PORT_FLAG_TX_UDP_CSUM_OFFLOAD)
-                    || (port->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD))
+                    || (port->flag & NETIF_PORT_FLAG_TX_TCP_CSUM_OFFLOAD)
+                    || (port->flag & NETIF_PORT_FLAG_TX_TCP_TSO_OFFLOAD)
+                    || rx_aggregate_configured())
                 txconf.txq_flags = 0;
             ret = rte_eth_tx_queue_setup(port->id, qid, port->txq_desc_nb,
                     port->socket, &txconf);
@@ -4006,6 +4921,7 @@ static int netif_loop(void *dummy)
     assert(LCORE_ID_ANY != cid);
 
     try_isol_rxq_lcore_loop();
+    try_kni_lcore_loop();
     if (0 == lcore_conf[lcore2index[cid]].nports) {
         RTE_LOG(INFO, NETIF, "[%s] Lcore %d has nothing to do.\n", __func__, cid);
         return EDPVS_IDLE;
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <assert.h>
 #include "route.h"
+#include "neigh.h"
 #include "conf/route.h"
 #include "ctrl.h"
 
@@ -236,6 +237,9 @@ static int route_add_lcore(struct in_addr* dest,uint8_t netmask, uint32_t flag,
               struct in_addr* gw, struct netif_port *port,
               struct in_addr* src, unsigned long mtu,short metric)
 {
+    /* next hops cached out of routes may change */
+    neigh_generation_bump();
+
     if((flag & RTF_LOCALIN) || (flag & RTF_KNI))
         return route_local_add(dest, netmask, flag, gw,
                                port, src, mtu, metric);
@@ -260,6 +264,8 @@ static int route_del_lcore(struct in_addr* dest,uint8_t netmask, uint32_t flag,
 {
     struct route_entry *route = NULL;
 
+    neigh_generation_bump();
+
     if(flag & RTF_LOCALIN || (flag & RTF_KNI)){
         route = route_local_lookup(dest->s_addr, port);
         if (!route)
@@ -428,6 +434,8 @@ static int route_lcore_flush(void)
     int i = 0;
     struct route_entry *route_node;
 
+    neigh_generation_bump();
+
     for (i = 0; i < LOCAL_ROUTE_TAB_SIZE; i++){
         list_for_each_entry(route_node, &this_local_route_table[i], list){
             list_del(&route_node->list);
@@ -455,39 +463,138 @@ int route_flush(void)
  * control plane
  */
 
-static int route_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+/* check user config and translate its scope to route flags */
+static int route_conf_check(const struct dp_vs_route_conf *cf,
+                            uint32_t *flags, struct netif_port **dev)
 {
-    struct dp_vs_route_conf *cf = (void *)conf;
-    struct netif_port *dev;
-    uint32_t flags = 0;
-
-    if (!conf || size < sizeof(*cf))
-        return EDPVS_INVAL;
+    *flags = 0;
 
     if (cf->af != AF_INET && cf->af != AF_UNSPEC)
         return EDPVS_NOTSUPP;
 
     if (cf->scope == ROUTE_CF_SCOPE_HOST) {
-        flags |= RTF_LOCALIN;
+        *flags |= RTF_LOCALIN;
 
         if (inet_is_addr_any(cf->af, &cf->dst) || cf->plen != 32)
             return EDPVS_INVAL;
     }
     else if (cf->scope == ROUTE_CF_SCOPE_KNI) {
-        flags |= RTF_KNI;
+        *flags |= RTF_KNI;
         if (inet_is_addr_any(cf->af, &cf->dst) || cf->plen != 32)
             return EDPVS_INVAL;
     }
     else {
-        flags |= RTF_FORWARD;
+        *flags |= RTF_FORWARD;
         if (inet_is_addr_any(cf->af, &cf->dst))
-            flags |= RTF_DEFAULT;
+            *flags |= RTF_DEFAULT;
     }
 
-    dev = netif_port_get_by_name(cf->ifname);
-    if (!dev) /* no dev is OK ? */
+    *dev = netif_port_get_by_name(cf->ifname);
+    if (!*dev) /* no dev is OK ? */
         return EDPVS_INVAL;
 
+    return EDPVS_OK;
+}
+
+/*
+ * apply all routes of @array on master, and sync them to slaves
+ * with one multicast msg rather than one msg per route.
+ * routes failed on master are skipped, the first error is returned.
+ */
+static int route_add_del_bulk(bool add, struct dp_vs_route_conf_array *array)
+{
+    struct dp_vs_route_conf *cfs, *cf;
+    struct netif_port *dev;
+    struct dpvs_msg *msg;
+    uint32_t flags;
+    int i, n = 0, err, ret = EDPVS_OK;
+
+    if (rte_lcore_id() != rte_get_master_lcore())
+        return EDPVS_NOTSUPP;
+
+    cfs = rte_malloc(NULL, sizeof(*cfs) * array->nroute, 0);
+    if (!cfs)
+        return EDPVS_NOMEM;
+
+    for (i = 0; i < array->nroute; i++) {
+        struct dp_vs_route_conf *ucf = &array->routes[i];
+
+        err = route_conf_check(ucf, &flags, &dev);
+        if (err == EDPVS_OK) {
+            if (add)
+                err = route_add_lcore(&ucf->dst.in, ucf->plen, flags,
+                                      &ucf->via.in, dev, &ucf->src.in,
+                                      ucf->mtu, ucf->metric);
+            else
+                err = route_del_lcore(&ucf->dst.in, ucf->plen, flags,
+                                      &ucf->via.in, dev, &ucf->src.in,
+                                      ucf->mtu, ucf->metric);
+        }
+        if (err != EDPVS_OK && err != EDPVS_EXIST && err != EDPVS_NOTEXIST) {
+            RTE_LOG(INFO, ROUTE, "[%s] fail to set route #%d: %s\n",
+                    __func__, i, dpvs_strerror(err));
+            if (ret == EDPVS_OK)
+                ret = err;
+            continue;
+        }
+
+        /* slaves use internal flags rather than user scope */
+        cf = &cfs[n++];
+        memset(cf, 0, sizeof(*cf));
+        cf->dst = ucf->dst;
+        cf->plen = ucf->plen;
+        cf->flags = flags;
+        cf->via = ucf->via;
+        cf->src = ucf->src;
+        snprintf(cf->ifname, sizeof(cf->ifname), "%s", dev->name);
+        cf->mtu = ucf->mtu;
+        cf->metric = ucf->metric;
+    }
+
+    if (!n)
+        goto out;
+
+    msg = msg_make(add ? MSG_TYPE_ROUTE_ADD : MSG_TYPE_ROUTE_DEL, 0,
+                   DPVS_MSG_MULTICAST, rte_lcore_id(), sizeof(*cfs) * n, cfs);
+    if (!msg) {
+        ret = EDPVS_NOMEM;
+        goto out;
+    }
+
+    err = multicast_msg_send(msg, 0, NULL);
+    if (err != EDPVS_OK) /* see route_add_del */
+        RTE_LOG(INFO, ROUTE, "[%s] fail to send multicast message, error code = %d\n",
+                __func__, err);
+    msg_destroy(&msg);
+
+out:
+    rte_free(cfs);
+    return ret;
+}
+
+static int route_sockopt_set(sockoptid_t opt, const void *conf, size_t size)
+{
+    struct dp_vs_route_conf *cf = (void *)conf;
+    struct dp_vs_route_conf_array *array = (void *)conf;
+    struct netif_port *dev;
+    uint32_t flags;
+    int err;
+
+    if (opt == SOCKOPT_SET_ROUTE_ADD_BULK || opt == SOCKOPT_SET_ROUTE_DEL_BULK) {
+        if (!conf || size < sizeof(*array) || array->nroute <= 0 ||
+            size != sizeof(*array) + array->nroute * sizeof(*cf))
+            return EDPVS_INVAL;
+
+        return route_add_del_bulk(opt == SOCKOPT_SET_ROUTE_ADD_BULK, array);
+    }
+
+    if (!conf || size < sizeof(*cf))
+        return EDPVS_INVAL;
+
+    err = route_conf_check(cf, &flags, &dev);
+    if (err != EDPVS_OK)
+        return err;
+
     switch (opt) {
     case SOCKOPT_SET_ROUTE_ADD:
         return route_add(&cf->dst.in, cf->plen, flags,
@@ -610,29 +717,34 @@ static int route_sockopt_get(sockoptid_t opt, const void *conf, size_t size,
 static int route_msg_process(bool add, struct dpvs_msg *msg)
 {
     struct dp_vs_route_conf *cf;
-    int err;
+    int i, n, err, ret = EDPVS_OK;
 
     assert(msg);
-    if (msg->len != sizeof(struct dp_vs_route_conf)) {
+    if (!msg->len || msg->len % sizeof(struct dp_vs_route_conf)) {
         RTE_LOG(ERR, ROUTE, "%s: bad message.\n", __func__);
         return EDPVS_INVAL;
     }
 
-    /* set route config */
-    cf = (struct dp_vs_route_conf *)msg->data;
-    if (add)
-        err = route_add_lcore(&cf->dst.in, cf->plen, cf->flags,
-                              &cf->via.in, netif_port_get_by_name(cf->ifname),
-                              &cf->src.in, cf->mtu, cf->metric);
-    else
-        err = route_del_lcore(&cf->dst.in, cf->plen, cf->flags,
-                              &cf->via.in, netif_port_get_by_name(cf->ifname),
-                              &cf->src.in, cf->mtu, cf->metric);
-    if (err != EDPVS_OK)
-        RTE_LOG(ERR, ROUTE, "%s: fail to %s route: %s.\n",
-                __func__, add ? "add" : "del", dpvs_strerror(err));
+    /* set route config, bulk msg carries more than one config */
+    n = msg->len / sizeof(struct dp_vs_route_conf);
+    for (i = 0; i < n; i++) {
+        cf = &((struct dp_vs_route_conf *)msg->data)[i];
+        if (add)
+            err = route_add_lcore(&cf->dst.in, cf->plen, cf->flags,
+                                  &cf->via.in, netif_port_get_by_name(cf->ifname),
+                                  &cf->src.in, cf->mtu, cf->metric);
+        else
+            err = route_del_lcore(&cf->dst.in, cf->plen, cf->flags,
+                                  &cf->via.in, netif_port_get_by_name(cf->ifname),
+                                  &cf->src.in, cf->mtu, cf->metric);
+        if (err != EDPVS_OK) {
+            RTE_LOG(ERR, ROUTE, "%s: fail to %s route: %s.\n",
+                    __func__, add ? "add" : "del", dpvs_strerror(err));
+            ret = err;
+        }
+    }
 
-    return err;
+    return ret;
 }
 
 static int route_add_msg_cb(struct dpvs_msg *msg)
@@ -648,7 +760,7 @@ static int route_del_msg_cb(struct dpvs_msg *msg)
 static struct dpvs_sockopts route_sockopts = {
     .version        = SOCKOPT_VERSION,
     .set_opt_min    = SOCKOPT_SET_ROUTE_ADD,
-    .set_opt_max    = SOCKOPT_SET_ROUTE_FLUSH,
+    .set_opt_max    = SOCKOPT_SET_ROUTE_DEL_BULK,
     .set            = route_sockopt_set,
     .get_opt_min    = SOCKOPT_GET_ROUTE_SHOW,
     .get_opt_max    = SOCKOPT_GET_ROUTE_SHOW,
@@ -37,12 +37,22 @@
  * when needed, release it after used. no trial needed, it's
  * efficient and all resource available can be used.
  *
+ * for NIC without legacy fdir, rte_flow rules of the same semantic are
+ * installed. if the NIC refuses them, the first way is used: the NIC's
+ * RSS key and RETA are read, and for each <laddr, rs> a table of the
+ * lports whose back traffic is hashed to current lcore's rx queue is
+ * built on demand. the toeplitz hash is linear (XOR) in its input, so
+ * the hash of the lport alone is pre-calculated per device and only
+ * combined with the hash of <rs, laddr> when building the table.
+ * at last, the back traffic can be redirected by ipvs (conn redirect).
+ *
  * Lei Chen <raychen@qiyi.com>, June 2017, initial.
  */
 #include <stdint.h>
 #include <assert.h>
 #include <arpa/inet.h>
 #include <linux/rtnetlink.h>
+#include <rte_thash.h>
 #include "list.h"
 #include "dpdk.h"
 #include "inet.h"
@@ -51,6 +61,7 @@
 #include "route6.h"
 #include "ctrl.h"
 #include "sa_pool.h"
+#include "ipvs/conn.h"
 #include "linux_ipv6.h"
 #include "parser/parser.h"
 #include "parser/vector.h"
@@ -73,6 +84,23 @@ enum {
     SA_F_USED               = 0x01,
 };
 
+/* how the back traffic reaches the lcore owning the <laddr, lport> */
+enum {
+    SA_STEER_NONE           = 0,    /* single rx queue */
+    SA_STEER_FDIR,                  /* legacy fdir filter per lcore */
+    SA_STEER_FLOW,                  /* rte_flow rule per lcore */
+    SA_STEER_RSS,                   /* lports selected by software RSS */
+    SA_STEER_REDIRECT,              /* redirected by ipvs between lcores */
+};
+
+static const char *sa_steer_names[] = {
+    [SA_STEER_NONE]         = "none",
+    [SA_STEER_FDIR]         = "fdir",
+    [SA_STEER_FLOW]         = "flow",
+    [SA_STEER_RSS]          = "rss",
+    [SA_STEER_REDIRECT]     = "redirect",
+};
+
 /**
  * if really need to to save memory, we can;
  * 1. use hlist_head
@@ -92,6 +120,21 @@ struct sa_entry {
     __be16                  port;
 };
 
+/* lports of <laddr, rs> whose back traffic RSS steers to current lcore */
+struct sa_rss_pool {
+    struct list_head        list;       /* node of sa_pool.rss_hash[] */
+    int                     af;
+    union inet_addr         daddr;      /* rs */
+    __be16                  dport;
+    uint16_t                nports;
+    uint16_t                head;       /* first free port in ports[] */
+    uint16_t                free_cnt;
+    uint16_t                used_cnt;
+    uint32_t                miss_cnt;
+    uint64_t                used[MAX_PORT / 64];    /* bitmap by port */
+    __be16                  ports[0];   /* ring of free ports */
+};
+
 struct sa_entry_pool {
     struct sa_entry         sa_entries[MAX_PORT];
     struct list_head        used_enties;
@@ -119,8 +162,25 @@ struct sa_pool {
     struct sa_entry_pool    *pool_hash;
     uint8_t                 pool_hash_sz;
 
+    uint8_t                 steer;      /* SA_STEER_XXX */
+
     /* fdir filter ID */
     uint32_t                filter_id[MAX_FDIR_PROTO];
+    /* or rte_flow rules */
+    struct netif_flow       flows[MAX_FDIR_PROTO];
+
+    /* software RSS for device without fdir, pool_hash is not used
+     * and the sa_rss_pool of each <laddr, rs> is hashed by rs. */
+    const struct sa_rss     *rss;
+    struct list_head        *rss_hash;
+};
+
+/* software RSS of a device */
+struct sa_rss {
+    struct netif_rss        conf;
+    bool                    l4[2];      /* [ipv4, ipv6], ports are hashed */
+    /* low bits of toeplitz hash of the tuple with only dport set */
+    uint16_t                port_hash[2][MAX_PORT];
 };
 
 struct sa_fdir {
@@ -140,6 +200,158 @@ static uint64_t             sa_lcore_mask;
 
 static uint8_t              sa_pool_hash_size   = SAPOOL_DEF_HASH_SZ;
 
+static struct sa_rss        *sa_rsses[NETIF_MAX_PORTS];
+
+/*
+ * toeplitz hash of the tuple as NIC sees the back traffic,
+ * i.e. @saddr is rs and @daddr is laddr.
+ */
+static uint32_t sa_rss_hash(const struct sa_rss *rss, int af,
+                            const union inet_addr *saddr,
+                            const union inet_addr *daddr,
+                            __be16 sport, __be16 dport)
+{
+    union rte_thash_tuple tuple;
+    uint32_t src[4], dst[4];
+    int i;
+
+    memset(&tuple, 0, sizeof(tuple));
+
+    if (af == AF_INET) {
+        tuple.v4.src_addr = rte_be_to_cpu_32(saddr->in.s_addr);
+        tuple.v4.dst_addr = rte_be_to_cpu_32(daddr->in.s_addr);
+        tuple.v4.sport = rte_be_to_cpu_16(sport);
+        tuple.v4.dport = rte_be_to_cpu_16(dport);
+        return rte_softrss((uint32_t *)&tuple, rss->l4[0] ?
+                           RTE_THASH_V4_L4_LEN : RTE_THASH_V4_L3_LEN,
+                           rss->conf.key);
+    }
+
+    memcpy(src, &saddr->in6, sizeof(src));
+    memcpy(dst, &daddr->in6, sizeof(dst));
+    for (i = 0; i < 4; i++) {
+        ((uint32_t *)tuple.v6.src_addr)[i] = rte_be_to_cpu_32(src[i]);
+        ((uint32_t *)tuple.v6.dst_addr)[i] = rte_be_to_cpu_32(dst[i]);
+    }
+    tuple.v6.sport = rte_be_to_cpu_16(sport);
+    tuple.v6.dport = rte_be_to_cpu_16(dport);
+    return rte_softrss((uint32_t *)&tuple, rss->l4[1] ?
+                       RTE_THASH_V6_L4_LEN : RTE_THASH_V6_L3_LEN,
+                       rss->conf.key);
+}
+
+/* rx lcore of back traffic to @lport, @base is hash with lport 0 */
+static inline lcoreid_t sa_rss_lcore(const struct sa_rss *rss, int af,
+                                     uint32_t base, __be16 lport)
+{
+    uint32_t hash = base ^ rss->port_hash[af == AF_INET6][ntohs(lport)];
+
+    return rss->conf.reta[hash & (rss->conf.reta_size - 1)];
+}
+
+static struct sa_rss *sa_rss_get(struct netif_port *dev)
+{
+    static const union inet_addr zero_addr;
+    struct sa_rss *rss;
+    uint32_t port;
+    int i, err;
+
+    if (sa_rsses[dev->id])
+        return sa_rsses[dev->id];
+
+    rss = rte_zmalloc(NULL, sizeof(*rss), RTE_CACHE_LINE_SIZE);
+    if (!rss)
+        return NULL;
+
+    err = netif_get_rss(dev, &rss->conf);
+    if (err != EDPVS_OK || rss->conf.key_len < 40) {
+        RTE_LOG(ERR, SAPOOL, "%s: fail to get RSS config of %s: %s\n",
+                __func__, dev->name, dpvs_strerror(err ? : EDPVS_NOTSUPP));
+        rte_free(rss);
+        return NULL;
+    }
+
+    /* stacked devices (vlan) share the tables of the device hashing */
+    if (rss->conf.port != dev->id && sa_rsses[rss->conf.port]) {
+        rte_free(rss);
+        sa_rsses[dev->id] = sa_rsses[rss->conf.port];
+        return sa_rsses[dev->id];
+    }
+
+    rss->l4[0] = !!(rss->conf.rss_hf &
+                    (ETH_RSS_NONFRAG_IPV4_TCP | ETH_RSS_NONFRAG_IPV4_UDP));
+    rss->l4[1] = !!(rss->conf.rss_hf &
+                    (ETH_RSS_NONFRAG_IPV6_TCP | ETH_RSS_NONFRAG_IPV6_UDP));
+    if (!rss->l4[0] || !rss->l4[1])
+        RTE_LOG(WARNING, SAPOOL, "%s: RSS of %s does not hash L4 ports, "
+                "back traffic of a <laddr, rs> reaches one lcore only\n",
+                __func__, dev->name);
+    else if ((rss->conf.rss_hf & (ETH_RSS_TCP | ETH_RSS_UDP)) !=
+             (ETH_RSS_TCP | ETH_RSS_UDP))
+        RTE_LOG(WARNING, SAPOOL, "%s: RSS of %s hashes ports of either TCP "
+                "or UDP, the other is steered wrongly\n", __func__, dev->name);
+
+    for (i = 0; i < 2; i++) {
+        if (!rss->l4[i])
+            continue;
+        for (port = 0; port < MAX_PORT; port++)
+            rss->port_hash[i][port] = sa_rss_hash(rss, i ? AF_INET6 : AF_INET,
+                    &zero_addr, &zero_addr, 0, htons((uint16_t)port));
+    }
+
+    sa_rsses[rss->conf.port] = rss;
+    sa_rsses[dev->id] = rss;
+    return rss;
+}
+
+/*
+ * legacy fdir is preferred as it's proven, then rte_flow, which may still
+ * fail on rule creation. see sa_steer_fallback() if it does.
+ */
+static int sa_steer_select(struct netif_port *dev)
+{
+    if (dev->netif_ops && dev->netif_ops->op_filter_supported &&
+            dev->netif_ops->op_filter_supported(dev, RTE_ETH_FILTER_FDIR) >= 0)
+        return SA_STEER_FDIR;
+
+    if (dev->nrxq <= 1)
+        return SA_STEER_NONE;
+
+    return SA_STEER_FLOW;
+}
+
+static int sa_steer_fallback(struct netif_port *dev)
+{
+    if (sa_rss_get(dev))
+        return SA_STEER_RSS;
+
+    if (!dp_vs_redirect_disable)
+        return SA_STEER_REDIRECT;
+
+    RTE_LOG(ERR, SAPOOL, "%s: no way to steer back traffic of %s to workers, "
+            "enable conn redirect or use single rxq\n", __func__, dev->name);
+    return EDPVS_NOTSUPP;
+}
+
+static inline int sa_ss_addr(const struct sockaddr_storage *ss,
+                             union inet_addr *addr, __be16 *port)
+{
+    if (ss->ss_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)ss;
+        memset(addr, 0, sizeof(*addr));
+        addr->in = sin->sin_addr;
+        *port = sin->sin_port;
+    } else if (ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)ss;
+        addr->in6 = sin6->sin6_addr;
+        *port = sin6->sin6_port;
+    } else {
+        return EDPVS_NOTSUPP;
+    }
+
+    return EDPVS_OK;
+}
+
 static int __add_del_filter(int af, struct netif_port *dev, lcoreid_t cid,
                             const union inet_addr *dip, __be16 dport,
                             uint32_t filter_id[MAX_FDIR_PROTO], bool add)
@@ -244,6 +456,143 @@ static inline int sa_del_filter(int af, struct netif_port *dev, lcoreid_t cid,
     return  __add_del_filter(af, dev, cid, dip, dport, filter_id, false);
 }
 
+/* rules of the same semantic as fdir filters, <dip, dport & mask> to queue */
+static int sa_add_flow(int af, struct netif_port *dev, lcoreid_t cid,
+                       const union inet_addr *dip, __be16 dport,
+                       struct netif_flow flows[MAX_FDIR_PROTO])
+{
+    struct rte_flow_attr attr = { .ingress = 1 };
+    struct rte_flow_item pattern[4];
+    struct rte_flow_action actions[2];
+    struct rte_flow_action_queue queue;
+    struct rte_flow_item_ipv4 ip4_spec, ip4_mask;
+    struct rte_flow_item_ipv6 ip6_spec, ip6_mask;
+    struct rte_flow_item_tcp tcp_spec, tcp_mask;
+    struct rte_flow_item_udp udp_spec, udp_mask;
+    queueid_t qid;
+    int err;
+
+    err = netif_get_queue(dev, cid, &qid);
+    if (err != EDPVS_OK)
+        return err;
+
+    memset(pattern, 0, sizeof(pattern));
+    memset(actions, 0, sizeof(actions));
+
+    pattern[0].type = RTE_FLOW_ITEM_TYPE_ETH;
+    if (af == AF_INET) {
+        memset(&ip4_spec, 0, sizeof(ip4_spec));
+        memset(&ip4_mask, 0, sizeof(ip4_mask));
+        ip4_spec.hdr.dst_addr = dip->in.s_addr;
+        ip4_mask.hdr.dst_addr = htonl(0xffffffff);
+        pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV4;
+        pattern[1].spec = &ip4_spec;
+        pattern[1].mask = &ip4_mask;
+    } else if (af == AF_INET6) {
+        memset(&ip6_spec, 0, sizeof(ip6_spec));
+        memset(&ip6_mask, 0, sizeof(ip6_mask));
+        memcpy(ip6_spec.hdr.dst_addr, &dip->in6, sizeof(ip6_spec.hdr.dst_addr));
+        memset(ip6_mask.hdr.dst_addr, 0xff, sizeof(ip6_mask.hdr.dst_addr));
+        pattern[1].type = RTE_FLOW_ITEM_TYPE_IPV6;
+        pattern[1].spec = &ip6_spec;
+        pattern[1].mask = &ip6_mask;
+    } else {
+        return EDPVS_NOTSUPP;
+    }
+    pattern[3].type = RTE_FLOW_ITEM_TYPE_END;
+
+    queue.index = qid;
+    actions[0].type = RTE_FLOW_ACTION_TYPE_QUEUE;
+    actions[0].conf = &queue;
+    actions[1].type = RTE_FLOW_ACTION_TYPE_END;
+
+    memset(&tcp_spec, 0, sizeof(tcp_spec));
+    memset(&tcp_mask, 0, sizeof(tcp_mask));
+    tcp_spec.hdr.dst_port = dport;
+    tcp_mask.hdr.dst_port = htons(sa_fdirs[cid].mask);
+    pattern[2].type = RTE_FLOW_ITEM_TYPE_TCP;
+    pattern[2].spec = &tcp_spec;
+    pattern[2].mask = &tcp_mask;
+
+    err = netif_flow_create(dev, &attr, pattern, actions, &flows[0]);
+    if (err != EDPVS_OK)
+        return err;
+
+    memset(&udp_spec, 0, sizeof(udp_spec));
+    memset(&udp_mask, 0, sizeof(udp_mask));
+    udp_spec.hdr.dst_port = dport;
+    udp_mask.hdr.dst_port = htons(sa_fdirs[cid].mask);
+    pattern[2].type = RTE_FLOW_ITEM_TYPE_UDP;
+    pattern[2].spec = &udp_spec;
+    pattern[2].mask = &udp_mask;
+
+    err = netif_flow_create(dev, &attr, pattern, actions, &flows[1]);
+    if (err != EDPVS_OK) {
+        netif_flow_destroy(&flows[0]);
+        return err;
+    }
+
+#ifdef CONFIG_DPVS_SAPOOL_DEBUG
+    RTE_LOG(DEBUG, SAPOOL, "FLOW: add %s %s TCP/UDP port %d mask 0x%04X "
+            "queue %d lcore %2d\n", dev->name, af == AF_INET ? "IPv4" : "IPv6",
+            ntohs(dport), sa_fdirs[cid].mask, qid, cid);
+#endif
+    return EDPVS_OK;
+}
+
+static inline void sa_del_flow(struct netif_flow flows[MAX_FDIR_PROTO])
+{
+    netif_flow_destroy(&flows[0]);
+    netif_flow_destroy(&flows[1]);
+}
+
+static int sa_pool_add_steer(struct sa_pool *ap, lcoreid_t cid)
+{
+    struct inet_ifaddr *ifa = ap->ifa;
+    struct sa_fdir *fdir = &sa_fdirs[cid];
+    uint32_t filtids[MAX_FDIR_PROTO];
+    int err;
+
+    switch (ap->steer) {
+    case SA_STEER_FDIR:
+        /* if add filter failed, waste some soft-id is acceptable. */
+        filtids[0] = fdir->soft_id++;
+        filtids[1] = fdir->soft_id++;
+
+        err = sa_add_filter(ifa->af, ifa->idev->dev, cid, &ifa->addr,
+                            fdir->port_base, filtids);
+        if (err != EDPVS_OK)
+            return err;
+        ap->filter_id[0] = filtids[0];
+        ap->filter_id[1] = filtids[1];
+        return EDPVS_OK;
+
+    case SA_STEER_FLOW:
+        return sa_add_flow(ifa->af, ifa->idev->dev, cid, &ifa->addr,
+                           fdir->port_base, ap->flows);
+
+    default:
+        return EDPVS_OK;
+    }
+}
+
+static void sa_pool_del_steer(struct sa_pool *ap, lcoreid_t cid)
+{
+    struct inet_ifaddr *ifa = ap->ifa;
+
+    switch (ap->steer) {
+    case SA_STEER_FDIR:
+        sa_del_filter(ifa->af, ifa->idev->dev, cid, &ifa->addr,
+                      sa_fdirs[cid].port_base, ap->filter_id);
+        break;
+    case SA_STEER_FLOW:
+        sa_del_flow(ap->flows);
+        break;
+    default:
+        break;
+    }
+}
+
 static int sa_pool_alloc_hash(struct sa_pool *ap, uint8_t hash_sz,
                                const struct sa_fdir *fdir)
 {
@@ -251,6 +600,16 @@ static int sa_pool_alloc_hash(struct sa_pool *ap, uint8_t hash_sz,
     struct sa_entry_pool *pool;
     uint32_t port; /* should be u32 or 65535==0 */
 
+    if (ap->rss) {
+        ap->rss_hash = rte_malloc(NULL, sizeof(struct list_head) * hash_sz, 0);
+        if (!ap->rss_hash)
+            return EDPVS_NOMEM;
+        for (hash = 0; hash < hash_sz; hash++)
+            INIT_LIST_HEAD(&ap->rss_hash[hash]);
+        ap->pool_hash_sz = hash_sz;
+        return EDPVS_OK;
+    }
+
     ap->pool_hash = rte_malloc(NULL, sizeof(struct sa_entry_pool) * hash_sz,
                                RTE_CACHE_LINE_SIZE);
     if (!ap->pool_hash)
@@ -287,6 +646,20 @@ static int sa_pool_alloc_hash(struct sa_pool *ap, uint8_t hash_sz,
 
 static int sa_pool_free_hash(struct sa_pool *ap)
 {
+    struct sa_rss_pool *pool, *next;
+    int hash;
+
+    if (ap->rss_hash) {
+        for (hash = 0; hash < ap->pool_hash_sz; hash++) {
+            list_for_each_entry_safe(pool, next, &ap->rss_hash[hash], list) {
+                list_del(&pool->list);
+                rte_free(pool);
+            }
+        }
+        rte_free(ap->rss_hash);
+        ap->rss_hash = NULL;
+    }
+
     rte_free(ap->pool_hash);
     ap->pool_hash_sz = 0;
     return EDPVS_OK;
@@ -295,7 +668,8 @@ static int sa_pool_free_hash(struct sa_pool *ap)
 int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
 {
     struct sa_pool *ap;
-    int err;
+    struct netif_port *dev;
+    int err, steer;
     lcoreid_t cid;
 
     low = low ? : DEF_MIN_PORT;
@@ -306,12 +680,15 @@ int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
         return EDPVS_INVAL;
     }
 
+    dev = ifa->idev->dev;
+    steer = sa_steer_select(dev);
+
+again:
     for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
-        uint32_t filtids[MAX_FDIR_PROTO];
         struct sa_fdir *fdir = &sa_fdirs[cid];
 
         /* skip master and unused cores */
-        if (cid > 64 || !(sa_lcore_mask & (1L << cid)))
+        if (cid >= 64 || !(sa_lcore_mask & (1L << cid)))
             continue;
         assert(rte_lcore_is_enabled(cid) && cid != rte_get_master_lcore());
 
@@ -324,6 +701,8 @@ int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
         ap->ifa = ifa;
         ap->low = low;
         ap->high = high;
+        ap->steer = steer;
+        ap->rss = steer == SA_STEER_RSS ? sa_rss_get(dev) : NULL;
         rte_atomic32_set(&ap->refcnt, 0);
 
         err = sa_pool_alloc_hash(ap, sa_pool_hash_size, fdir);
@@ -332,25 +711,33 @@ int sa_pool_create(struct inet_ifaddr *ifa, uint16_t low, uint16_t high)
             goto errout;
         }
 
-        /* if add filter failed, waste some soft-id is acceptable. */
-        filtids[0] = fdir->soft_id++;
-        filtids[1] = fdir->soft_id++;
-
-        err = sa_add_filter(ifa->af, ifa->idev->dev, cid, &ifa->addr,
-                            fdir->port_base, filtids);
+        err = sa_pool_add_steer(ap, cid);
         if (err != EDPVS_OK) {
             sa_pool_free_hash(ap);
             rte_free(ap);
+
+            /* rte_flow capability is only known by trying */
+            if (steer == SA_STEER_FLOW) {
+                sa_pool_destroy(ifa);
+                steer = sa_steer_fallback(dev);
+                if (steer < 0) {
+                    err = steer;
+                    goto errout;
+                }
+                RTE_LOG(INFO, SAPOOL, "%s: rte_flow not usable on %s, "
+                        "fall back to %s\n", __func__, dev->name,
+                        sa_steer_names[steer]);
+                goto again;
+            }
             goto errout;
         }
-        ap->filter_id[0] = filtids[0];
-        ap->filter_id[1] = filtids[1];
 
         ifa->sa_pools[cid] = ap;
     }
 
 #ifdef CONFIG_DPVS_SAPOOL_DEBUG
-    RTE_LOG(DEBUG, SAPOOL, "%s: sa pool created\n", __func__);
+    RTE_LOG(DEBUG, SAPOOL, "%s: sa pool created, steer by %s\n", __func__,
+            sa_steer_names[steer]);
 #endif
     return EDPVS_OK;
 
@@ -368,9 +755,8 @@ int sa_pool_destroy(struct inet_ifaddr *ifa)
 
     for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
         struct sa_pool *ap = ifa->sa_pools[cid];
-        struct sa_fdir *fdir = &sa_fdirs[cid];
 
-        if (cid > 64 || !(sa_lcore_mask & (1L << cid)))
+        if (cid >= 64 || !(sa_lcore_mask & (1L << cid)))
             continue;
         assert(rte_lcore_is_enabled(cid) && cid != rte_get_master_lcore());
 
@@ -382,8 +768,7 @@ int sa_pool_destroy(struct inet_ifaddr *ifa)
             return EDPVS_BUSY;
         }
 
-        sa_del_filter(ifa->af, ifa->idev->dev, cid, &ifa->addr,
-                      fdir->port_base, ap->filter_id);
+        sa_pool_del_steer(ap, cid);
         sa_pool_free_hash(ap);
         rte_free(ap);
         ifa->sa_pools[cid] = NULL;
@@ -527,6 +912,259 @@ static inline int sa_pool_release(struct sa_entry_pool *pool,
     return EDPVS_OK;
 }
 
+static inline int sa_pool_bind(struct sa_entry_pool *pool,
+                               const struct sa_fdir *fdir,
+                               uint16_t low, uint16_t high,
+                               const struct sockaddr_storage *ss)
+{
+    struct sa_entry *ent;
+    uint16_t port;
+
+    assert(pool && fdir && ss);
+
+    if (ss->ss_family == AF_INET)
+        port = ntohs(((const struct sockaddr_in *)ss)->sin_port);
+    else if (ss->ss_family == AF_INET6)
+        port = ntohs(((const struct sockaddr_in6 *)ss)->sin6_port);
+    else
+        return EDPVS_NOTSUPP;
+
+    /* not a port of this lcore's pool, entry is not initialized */
+    if (port < low || port > high ||
+            (fdir->mask && (port & fdir->mask) != ntohs(fdir->port_base)))
+        return EDPVS_INVAL;
+
+    ent = &pool->sa_entries[port];
+    if (ent->flags & SA_F_USED)
+        return EDPVS_EXIST;
+
+    ent->flags |= SA_F_USED;
+    list_move_tail(&ent->list, &pool->used_enties);
+    rte_atomic16_inc(&pool->used_cnt);
+    rte_atomic16_dec(&pool->free_cnt);
+
+    return EDPVS_OK;
+}
+
+static inline uint32_t sa_rss_hashkey(const struct sa_pool *ap, int af,
+                                      const union inet_addr *addr, __be16 port)
+{
+    uint32_t vect[5] = { 0 };
+
+    vect[0] = port;
+    memcpy(&vect[1], addr, af == AF_INET6 ? 16 : 4);
+    return rte_jhash_32b(vect, 5, af) % ap->pool_hash_sz;
+}
+
+/* lport table of <@ap's laddr, @ss>, built on the lcore owning @ap */
+static struct sa_rss_pool *sa_rss_pool_get(struct sa_pool *ap,
+                                           const struct sockaddr_storage *ss,
+                                           bool create)
+{
+    struct sa_rss_pool *pool;
+    union inet_addr daddr;
+    __be16 dport;
+    uint32_t hash, base, port;
+    lcoreid_t cid = rte_lcore_id();
+    int af = ss->ss_family, n = 0;
+
+    if (sa_ss_addr(ss, &daddr, &dport) != EDPVS_OK)
+        return NULL;
+
+    hash = sa_rss_hashkey(ap, af, &daddr, dport);
+    list_for_each_entry(pool, &ap->rss_hash[hash], list) {
+        if (pool->af == af && pool->dport == dport &&
+                inet_addr_equal(af, &pool->daddr, &daddr))
+            return pool;
+    }
+
+    if (!create)
+        return NULL;
+
+    base = sa_rss_hash(ap->rss, af, &daddr, &ap->ifa->addr, dport, 0);
+    for (port = ap->low; port <= ap->high; port++) {
+        if (sa_rss_lcore(ap->rss, af, base, htons((uint16_t)port)) == cid)
+            n++;
+    }
+
+    pool = rte_zmalloc(NULL, sizeof(*pool) + n * sizeof(__be16),
+                       RTE_CACHE_LINE_SIZE);
+    if (!pool)
+        return NULL;
+
+    pool->af = af;
+    pool->daddr = daddr;
+    pool->dport = dport;
+    for (port = ap->low; port <= ap->high; port++) {
+        if (sa_rss_lcore(ap->rss, af, base, htons((uint16_t)port)) == cid)
+            pool->ports[pool->nports++] = htons((uint16_t)port);
+    }
+    pool->free_cnt = pool->nports;
+
+    list_add(&pool->list, &ap->rss_hash[hash]);
+
+#ifdef CONFIG_DPVS_SAPOOL_DEBUG
+    RTE_LOG(DEBUG, SAPOOL, "%s: lcore %d rs port %d, %d lports\n",
+            __func__, cid, ntohs(dport), pool->nports);
+#endif
+    return pool;
+}
+
+static inline bool sa_rss_port_used(const struct sa_rss_pool *pool, uint16_t port)
+{
+    return pool->used[port / 64] & (1ULL << (port % 64));
+}
+
+static inline void sa_rss_port_set(struct sa_rss_pool *pool, uint16_t port,
+                                   bool used)
+{
+    if (used)
+        pool->used[port / 64] |= (1ULL << (port % 64));
+    else
+        pool->used[port / 64] &= ~(1ULL << (port % 64));
+}
+
+static int sa_rss_fetch(struct sa_rss_pool *pool, const union inet_addr *laddr,
+                        struct sockaddr_storage *ss)
+{
+    struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+    __be16 port;
+
+    if (!pool->free_cnt) {
+        pool->miss_cnt++;
+        return EDPVS_RESOURCE;
+    }
+
+    port = pool->ports[pool->head];
+
+    if (ss->ss_family == AF_INET) {
+        sin->sin_family = AF_INET;
+        sin->sin_addr.s_addr = laddr->in.s_addr;
+        sin->sin_port = port;
+    } else if (ss->ss_family == AF_INET6) {
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_addr = laddr->in6;
+        sin6->sin6_port = port;
+    } else {
+        return EDPVS_NOTSUPP;
+    }
+
+    pool->head = (pool->head + 1) % pool->nports;
+    pool->free_cnt--;
+    pool->used_cnt++;
+    sa_rss_port_set(pool, ntohs(port), true);
+
+    return EDPVS_OK;
+}
+
+static int sa_rss_release(struct sa_rss_pool *pool,
+                          const struct sockaddr_storage *ss)
+{
+    union inet_addr addr;
+    __be16 port;
+
+    if (sa_ss_addr(ss, &addr, &port) != EDPVS_OK)
+        return EDPVS_NOTSUPP;
+
+    if (!sa_rss_port_used(pool, ntohs(port))) {
+        RTE_LOG(WARNING, SAPOOL, "%s: port %d not in use !\n", __func__,
+                ntohs(port));
+        return EDPVS_INVAL;
+    }
+
+    /* free ports are reused in FIFO order, as sa_entry_pool does */
+    pool->ports[((uint32_t)pool->head + pool->free_cnt) % pool->nports] = port;
+    pool->free_cnt++;
+    pool->used_cnt--;
+    sa_rss_port_set(pool, ntohs(port), false);
+
+    return EDPVS_OK;
+}
+
+static int sa_rss_bind(struct sa_rss_pool *pool,
+                       const struct sockaddr_storage *ss)
+{
+    union inet_addr addr;
+    __be16 port;
+    uint32_t i, idx;
+
+    if (sa_ss_addr(ss, &addr, &port) != EDPVS_OK)
+        return EDPVS_NOTSUPP;
+
+    if (sa_rss_port_used(pool, ntohs(port)))
+        return EDPVS_EXIST;
+
+    /* binding is rare (synchronized conns), just search the ring */
+    for (i = 0; i < pool->free_cnt; i++) {
+        idx = ((uint32_t)pool->head + i) % pool->nports;
+        if (pool->ports[idx] != port)
+            continue;
+
+        pool->ports[idx] = pool->ports[pool->head];
+        pool->head = (pool->head + 1) % pool->nports;
+        pool->free_cnt--;
+        pool->used_cnt++;
+        sa_rss_port_set(pool, ntohs(port), true);
+        return EDPVS_OK;
+    }
+
+    /* back traffic of the port is not steered to this lcore */
+    return EDPVS_INVAL;
+}
+
+static int __sa_fetch(struct sa_pool *ap, const struct sockaddr_storage *daddr,
+                      struct sockaddr_storage *saddr)
+{
+    struct sa_rss_pool *pool;
+
+    if (!ap->rss)
+        return sa_pool_fetch(sa_pool_hash(ap, daddr), saddr);
+
+    /* lports depend on rs with software RSS */
+    if (!daddr)
+        return EDPVS_INVAL;
+
+    pool = sa_rss_pool_get(ap, daddr, true);
+    if (!pool)
+        return EDPVS_NOMEM;
+
+    return sa_rss_fetch(pool, &ap->ifa->addr, saddr);
+}
+
+static int __sa_release(struct sa_pool *ap, const struct sockaddr_storage *daddr,
+                        const struct sockaddr_storage *saddr)
+{
+    struct sa_rss_pool *pool;
+
+    if (!ap->rss)
+        return sa_pool_release(sa_pool_hash(ap, daddr), saddr);
+
+    if (!daddr || !(pool = sa_rss_pool_get(ap, daddr, false)))
+        return EDPVS_INVAL;
+
+    return sa_rss_release(pool, saddr);
+}
+
+static int __sa_bind(struct sa_pool *ap, const struct sockaddr_storage *daddr,
+                     const struct sockaddr_storage *saddr)
+{
+    struct sa_rss_pool *pool;
+
+    if (!ap->rss)
+        return sa_pool_bind(sa_pool_hash(ap, daddr), &sa_fdirs[rte_lcore_id()],
+                            ap->low, ap->high, saddr);
+
+    if (!daddr)
+        return EDPVS_INVAL;
+
+    pool = sa_rss_pool_get(ap, daddr, true);
+    if (!pool)
+        return EDPVS_NOMEM;
+
+    return sa_rss_bind(pool, saddr);
+}
+
 /*
  * fetch unused <saddr, sport> pair by given hint.
  * given @ap equivalent to @dev+@saddr, and dport is useless.
@@ -579,9 +1217,8 @@ static int sa4_fetch(struct netif_port *dev,
             return EDPVS_INVAL;
         }
 
-        err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
-                            (struct sockaddr_storage *)daddr),
-                            (struct sockaddr_storage *)saddr);
+        err = __sa_fetch(ifa->this_sa_pool, (struct sockaddr_storage *)daddr,
+                         (struct sockaddr_storage *)saddr);
         if (err == EDPVS_OK)
             rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
         inet_addr_ifa_put(ifa);
@@ -617,9 +1254,8 @@ static int sa4_fetch(struct netif_port *dev,
     }
 
     /* do fetch socket address */
-    err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
-                        (struct sockaddr_storage *)daddr),
-                        (struct sockaddr_storage *)saddr);
+    err = __sa_fetch(ifa->this_sa_pool, (struct sockaddr_storage *)daddr,
+                     (struct sockaddr_storage *)saddr);
     if (err == EDPVS_OK)
         rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
 
@@ -653,9 +1289,8 @@ static int sa6_fetch(struct netif_port *dev,
             return EDPVS_INVAL;
         }
 
-        err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
-                            (struct sockaddr_storage *)daddr),
-                            (struct sockaddr_storage *)saddr);
+        err = __sa_fetch(ifa->this_sa_pool, (struct sockaddr_storage *)daddr,
+                         (struct sockaddr_storage *)saddr);
         if (err == EDPVS_OK)
             rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
         inet_addr_ifa_put(ifa);
@@ -696,9 +1331,8 @@ static int sa6_fetch(struct netif_port *dev,
     }
 
     /* do fetch socket address */
-    err = sa_pool_fetch(sa_pool_hash(ifa->this_sa_pool,
-                        (struct sockaddr_storage *)daddr),
-                        (struct sockaddr_storage *)saddr);
+    err = __sa_fetch(ifa->this_sa_pool, (struct sockaddr_storage *)daddr,
+                     (struct sockaddr_storage *)saddr);
     if (err == EDPVS_OK)
         rte_atomic32_inc(&ifa->this_sa_pool->refcnt);
 
@@ -760,13 +1394,102 @@ int sa_release(const struct netif_port *dev,
         return EDPVS_INVAL;
     }
 
-    err = sa_pool_release(sa_pool_hash(ifa->this_sa_pool, daddr), saddr);
+    err = __sa_release(ifa->this_sa_pool, daddr, saddr);
     if (err == EDPVS_OK)
         rte_atomic32_dec(&ifa->this_sa_pool->refcnt);
     inet_addr_ifa_put(ifa);
     return err;
 }
 
+int sa_bind(const struct netif_port *dev,
+            const struct sockaddr_storage *daddr,
+            const struct sockaddr_storage *saddr)
+{
+    struct inet_ifaddr *ifa;
+    struct sa_pool *ap;
+    int err;
+
+    if (!saddr)
+        return EDPVS_INVAL;
+
+    if (daddr && saddr->ss_family != daddr->ss_family)
+        return EDPVS_INVAL;
+
+    if (AF_INET == saddr->ss_family) {
+        const struct sockaddr_in *saddr4 = (const struct sockaddr_in *)saddr;
+        ifa = inet_addr_ifa_get(AF_INET, dev,
+                (union inet_addr*)&saddr4->sin_addr);
+    } else if (AF_INET6 == saddr->ss_family) {
+        const struct sockaddr_in6 *saddr6 = (const struct sockaddr_in6 *)saddr;
+        ifa = inet_addr_ifa_get(AF_INET6, dev,
+                (union inet_addr*)&saddr6->sin6_addr);
+    } else {
+        return EDPVS_NOTSUPP;
+    }
+
+    if (!ifa)
+        return EDPVS_NOTEXIST;
+
+    ap = ifa->this_sa_pool;
+    if (!ap) {
+        RTE_LOG(WARNING, SAPOOL, "%s: bind addr on IP without pool.", __func__);
+        inet_addr_ifa_put(ifa);
+        return EDPVS_INVAL;
+    }
+
+    err = __sa_bind(ap, daddr, saddr);
+    if (err == EDPVS_OK)
+        rte_atomic32_inc(&ap->refcnt);
+    inet_addr_ifa_put(ifa);
+    return err;
+}
+
+lcoreid_t sa_lcore_of(const struct sockaddr_storage *daddr,
+                      const struct sockaddr_storage *saddr)
+{
+    struct inet_ifaddr *ifa;
+    const struct sa_rss *rss;
+    union inet_addr laddr, rsaddr;
+    __be16 port, rsport;
+    lcoreid_t cid;
+
+    if (!saddr || sa_ss_addr(saddr, &laddr, &port) != EDPVS_OK)
+        return NETIF_LCORE_ID_INVALID;
+
+    ifa = inet_addr_ifa_get(saddr->ss_family, NULL, &laddr);
+    if (!ifa)
+        return NETIF_LCORE_ID_INVALID;
+    rss = NULL;
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        if (cid >= 64 || !(sa_lcore_mask & (1L << cid)) || !ifa->sa_pools[cid])
+            continue;
+        rss = ifa->sa_pools[cid]->rss;
+        break;
+    }
+    inet_addr_ifa_put(ifa);
+
+    if (rss) {
+        if (!daddr || daddr->ss_family != saddr->ss_family ||
+                sa_ss_addr(daddr, &rsaddr, &rsport) != EDPVS_OK)
+            return NETIF_LCORE_ID_INVALID;
+
+        return sa_rss_lcore(rss, saddr->ss_family,
+                            sa_rss_hash(rss, saddr->ss_family, &rsaddr,
+                                        &laddr, rsport, 0), port);
+    }
+
+    for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
+        if (cid >= 64 || !(sa_lcore_mask & (1L << cid)))
+            continue;
+
+        if ((ntohs(port) & sa_fdirs[cid].mask) ==
+                ntohs(sa_fdirs[cid].port_base))
+            return cid;
+    }
+
+    return NETIF_LCORE_ID_INVALID;
+}
+
 int sa_pool_stats(const struct inet_ifaddr *ifa, struct sa_pool_stats *stats)
 {
     struct dpvs_msg *req, *reply;
@@ -826,6 +1549,19 @@ static int sa_msg_get_stats(struct dpvs_msg *msg)
     if (!ifa->this_sa_pool)
         goto reply;
 
+    if (ifa->this_sa_pool->rss) {
+        struct sa_rss_pool *rpool;
+
+        for (hash = 0; hash < ifa->this_sa_pool->pool_hash_sz; hash++) {
+            list_for_each_entry(rpool, &ifa->this_sa_pool->rss_hash[hash], list) {
+                stats->used_cnt += rpool->used_cnt;
+                stats->free_cnt += rpool->free_cnt;
+                stats->miss_cnt += rpool->miss_cnt;
+            }
+        }
+        goto reply;
+    }
+
     for (hash = 0; hash < ifa->this_sa_pool->pool_hash_sz; hash++) {
         pool = &ifa->this_sa_pool->pool_hash[hash];
         assert(pool);
@@ -864,7 +1600,7 @@ int sa_pool_init(void)
 
     port_base = 0;
     for (cid = 0; cid < RTE_MAX_LCORE; cid++) {
-        if (cid > 64 || !(sa_lcore_mask & (1L << cid)))
+        if (cid >= 64 || !(sa_lcore_mask & (1L << cid)))
             continue;
         assert(rte_lcore_is_enabled(cid) && cid != rte_get_master_lcore());
 
@@ -883,10 +1619,17 @@ int sa_pool_init(void)
 
 int sa_pool_term(void)
 {
-    int err;
+    int err, i;
 
     err = msg_type_mc_unregister(&sa_stats_msg);
 
+    for (i = 0; i < NETIF_MAX_PORTS; i++) {
+        /* shared ones are freed by the hashing device's entry */
+        if (sa_rsses[i] && sa_rsses[i]->conf.port == i)
+            rte_free(sa_rsses[i]);
+        sa_rsses[i] = NULL;
+    }
+
     return err;
 }
 
@@ -185,6 +185,25 @@ static int vlan_get_stats(struct netif_port *dev, struct rte_eth_stats *stats)
     return netif_get_stats(vlan->real_dev, stats);
 }
 
+static int vlan_get_rss(struct netif_port *dev, struct netif_rss *rss)
+{
+    struct vlan_dev_priv *vlan = netif_priv(dev);
+    assert(vlan && vlan->real_dev);
+
+    return netif_get_rss(vlan->real_dev, rss);
+}
+
+static int vlan_flow_create(struct netif_port *dev, const struct rte_flow_attr *attr,
+                            const struct rte_flow_item pattern[],
+                            const struct rte_flow_action actions[],
+                            struct netif_flow *flow)
+{
+    struct vlan_dev_priv *vlan = netif_priv(dev);
+    assert(vlan && vlan->real_dev);
+
+    return netif_flow_create(vlan->real_dev, attr, pattern, actions, flow);
+}
+
 static struct netif_ops vlan_netif_ops = {
     .op_xmit             = vlan_xmit,
     .op_set_mc_list      = vlan_set_mc_list,
@@ -194,6 +213,8 @@ static struct netif_ops vlan_netif_ops = {
     .op_get_link         = vlan_get_link,
     .op_get_promisc      = vlan_get_promisc,
     .op_get_stats        = vlan_get_stats,
+    .op_get_rss          = vlan_get_rss,
+    .op_flow_create      = vlan_flow_create,
 };
 
 static void vlan_setup(struct netif_port *dev)
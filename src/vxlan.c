@@ -0,0 +1,345 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+/*
+ * dpvs VXLAN device, ethernet over UDP/IPv4 tunnel.
+ * refer linux:drivers/net/vxlan.c
+ *
+ * VNI is configured as tunnel key, only point-to-point VXLAN devices
+ * (remote VTEP is set) are supported.
+ */
+#include <assert.h>
+#include <netinet/ip6.h>
+#include <linux/if_ether.h>
+#include "dpdk.h"
+#include "netif.h"
+#include "ipv4.h"
+#include "route.h"
+#include "neigh.h"
+#include "ip_tunnel.h"
+#include "vxlan.h"
+
+#define VXLAN
+#define RTE_LOGTYPE_VXLAN   RTE_LOGTYPE_USER1
+
+static struct ip_tunnel_tab vxlan_tunnel_tab;
+
+static struct netif_ops vxlan_dev_ops;
+
+bool is_vxlan_dev(const struct netif_port *dev)
+{
+    return dev->type == PORT_TYPE_TUNNEL && dev->netif_ops == &vxlan_dev_ops;
+}
+
+uint32_t vxlan_flow_hash(const struct rte_mbuf *mbuf, uint16_t eth_type,
+                         uint32_t l3_off)
+{
+    uint32_t _ports, ports = 0;
+    const uint32_t *pptr;
+
+    /* RSS hash of the received packet is a flow hash already */
+    if (mbuf->ol_flags & PKT_RX_RSS_HASH)
+        return mbuf->hash.rss;
+
+    if (eth_type == ETHER_TYPE_IPv4) {
+        struct ipv4_hdr _iph, *iph;
+
+        iph = mbuf_header_pointer(mbuf, l3_off, sizeof(_iph), &_iph);
+        if (unlikely(!iph))
+            return 0;
+
+        if (!ip4_is_frag(iph) && (iph->next_proto_id == IPPROTO_TCP ||
+                                  iph->next_proto_id == IPPROTO_UDP)) {
+            pptr = mbuf_header_pointer(mbuf,
+                        l3_off + ((iph->version_ihl & 0xf) << 2),
+                        sizeof(_ports), &_ports);
+            if (pptr)
+                ports = *pptr;
+        }
+
+        return rte_jhash_3words(iph->src_addr, iph->dst_addr, ports,
+                                iph->next_proto_id);
+    }
+
+    if (eth_type == ETHER_TYPE_IPv6) {
+        struct ip6_hdr _ip6h;
+        const struct ip6_hdr *ip6h;
+
+        ip6h = mbuf_header_pointer(mbuf, l3_off, sizeof(_ip6h), &_ip6h);
+        if (unlikely(!ip6h))
+            return 0;
+
+        if (ip6h->ip6_nxt == IPPROTO_TCP || ip6h->ip6_nxt == IPPROTO_UDP) {
+            pptr = mbuf_header_pointer(mbuf, l3_off + sizeof(*ip6h),
+                                       sizeof(_ports), &_ports);
+            if (pptr)
+                ports = *pptr;
+        }
+
+        return rte_jhash(&ip6h->ip6_src, 2 * sizeof(struct in6_addr),
+                         ports ^ ip6h->ip6_nxt);
+    }
+
+    return 0;
+}
+
+int vxlan_encap_build(struct netif_port *dev, struct vxlan_encap *encap,
+                      struct netif_port **odev, union inet_addr *onexthop)
+{
+    struct ip_tunnel *tnl = netif_priv(dev);
+    const struct iphdr *tiph = &tnl->params.iph;
+    struct route_entry *rt;
+    struct flow4 fl4 = {};
+
+    assert(is_vxlan_dev(dev) && encap && odev && onexthop);
+
+    /* TODO: NBMA devices, remote VTEP learning */
+    if (!tiph->daddr)
+        return EDPVS_NOTSUPP;
+
+    fl4.fl4_proto           = IPPROTO_UDP;
+    fl4.fl4_daddr.s_addr    = tiph->daddr;
+    fl4.fl4_saddr.s_addr    = tiph->saddr;
+    fl4.fl4_tos             = tiph->tos & ~0x1;
+    fl4.fl4_oif             = tnl->link;
+
+    rt = route4_output(&fl4);
+    if (!rt)
+        return EDPVS_NOROUTE;
+
+    /* the same source as ip_tunnel_xmit() */
+    if (rt->port == dev || rt->src.s_addr == htonl(INADDR_ANY)) {
+        route4_put(rt);
+        return EDPVS_NOTSUPP;
+    }
+
+    memset(encap, 0, sizeof(*encap));
+
+    encap->iph.version_ihl      = 0x45;
+    encap->iph.type_of_service  = tiph->tos;
+    encap->iph.fragment_offset  = tiph->frag_off;
+    encap->iph.time_to_live     = tiph->ttl;
+    encap->iph.next_proto_id    = IPPROTO_UDP;
+    encap->iph.src_addr         = rt->src.s_addr;
+    encap->iph.dst_addr         = tiph->daddr;
+
+    encap->udph.dst_port        = htons(VXLAN_PORT);
+
+    encap->vxh.vx_flags         = VXLAN_HF_VNI;
+    encap->vxh.vx_vni           = vxlan_vni_field(tnl->params.o_key);
+
+    ether_addr_copy(&dev->addr, &encap->eth.s_addr);
+
+    *odev = rt->port;
+    if (rt->gw.s_addr == htonl(INADDR_ANY))
+        onexthop->in.s_addr = tiph->daddr;
+    else
+        onexthop->in = rt->gw;
+
+    route4_put(rt);
+    return EDPVS_OK;
+}
+
+static int vxlan_xmit(struct rte_mbuf *mbuf, struct netif_port *dev)
+{
+    struct ip_tunnel *tnl = netif_priv(dev);
+    struct ether_hdr *eth;
+    struct udp_hdr *udph;
+    struct vxlan_hdr *vxh;
+    uint32_t hash;
+
+    /* no segmentation offload for VXLAN, drop TCP aggregates (LRO/GRO) */
+    if (unlikely(mbuf->ol_flags & PKT_TX_TCP_SEG)) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_NOTSUPP;
+    }
+
+    if (unlikely(mbuf->data_len < sizeof(*eth))) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_INVPKT;
+    }
+
+    /* frames from KNI have no packet_type set by neigh_fill_mac,
+     * ip_tunnel_xmit() looks at the inner IPv4 header by it too. */
+    eth = rte_pktmbuf_mtod(mbuf, struct ether_hdr *);
+    mbuf->packet_type = ntohs(eth->ether_type);
+
+    hash = vxlan_flow_hash(mbuf, mbuf->packet_type, sizeof(struct ether_hdr));
+
+    udph = (struct udp_hdr *)rte_pktmbuf_prepend(mbuf, ETHER_VXLAN_HLEN);
+    if (unlikely(!udph)) {
+        rte_pktmbuf_free(mbuf);
+        return EDPVS_NOROOM;
+    }
+
+    vxh = (struct vxlan_hdr *)(udph + 1);
+    vxh->vx_flags       = VXLAN_HF_VNI;
+    vxh->vx_vni         = vxlan_vni_field(tnl->params.o_key);
+
+    udph->src_port      = vxlan_src_port(hash);
+    udph->dst_port      = htons(VXLAN_PORT);
+    udph->dgram_len     = htons(mbuf->pkt_len);
+    udph->dgram_cksum   = 0;
+
+    return ip_tunnel_xmit(mbuf, dev, &tnl->params.iph, IPPROTO_UDP);
+}
+
+/* VNI is always the key of VXLAN device, VNI 0 if not configured. */
+static int vxlan_set_params(struct ip_tunnel_param *params)
+{
+    if (ntohl(params->i_key) > VXLAN_VNI_MAX ||
+        ntohl(params->o_key) > VXLAN_VNI_MAX) {
+        RTE_LOG(ERR, VXLAN, "%s: invalid VNI\n", __func__);
+        return EDPVS_INVAL;
+    }
+
+    params->i_flags |= TUNNEL_F_KEY;
+    params->o_flags |= TUNNEL_F_KEY;
+
+    return EDPVS_OK;
+}
+
+static int vxlan_dev_init(struct netif_port *dev)
+{
+    struct ip_tunnel *tnl = netif_priv(dev);
+
+    /* inner ethernet header is counted in tunnel header rather than
+     * @dev->hw_header_len, see ip_tunnel_xmit() and tunnel_bind_dev() */
+    tnl->hlen = ETHER_VXLAN_HLEN + sizeof(struct ether_hdr);
+
+    /* VXLAN device is an ethernet device, neighbours are resolved on it */
+    dev->flag &= ~NETIF_PORT_FLAG_NO_ARP;
+    eth_random_addr(dev->addr.addr_bytes);
+
+    return vxlan_set_params(&tnl->params);
+}
+
+static struct netif_ops vxlan_dev_ops = {
+    .op_init        = vxlan_dev_init,
+    .op_xmit        = vxlan_xmit,
+    .op_get_link    = ip_tunnel_get_link,
+    .op_get_stats   = ip_tunnel_get_stats,
+    .op_get_promisc = ip_tunnel_get_promisc,
+};
+
+static void vxlan_setup(struct netif_port *dev)
+{
+    dev->netif_ops = &vxlan_dev_ops;
+}
+
+static int vxlan_change(struct netif_port *dev,
+                        const struct ip_tunnel_param *param)
+{
+    struct ip_tunnel *tnl = netif_priv(dev);
+
+    /* headers prebuilt by vxlan_encap_build() are stale */
+    neigh_generation_bump_all();
+
+    return vxlan_set_params(&tnl->params);
+}
+
+/* UDP handler, only packets to VXLAN port are consumed. */
+static int vxlan_rcv(struct rte_mbuf *mbuf)
+{
+    struct iphdr *iph;
+    struct udp_hdr *udph;
+    struct vxlan_hdr *vxh;
+    struct ip_tunnel *tnl;
+    __be32 key;
+
+    if (unlikely(mbuf_may_pull(mbuf, sizeof(*udph)) != 0))
+        return EDPVS_KNICONTINUE;
+
+    udph = rte_pktmbuf_mtod(mbuf, struct udp_hdr *);
+    if (udph->dst_port != htons(VXLAN_PORT))
+        return EDPVS_KNICONTINUE; /* KNI may like it, don't drop */
+
+    /* not for our tunnels, a kernel VTEP behind KNI may like it */
+    if (unlikely(mbuf_may_pull(mbuf, ETHER_VXLAN_HLEN +
+                               sizeof(struct ether_hdr)) != 0))
+        return EDPVS_KNICONTINUE;
+
+    vxh = rte_pktmbuf_mtod_offset(mbuf, struct vxlan_hdr *, sizeof(*udph));
+    if (unlikely(!(vxh->vx_flags & VXLAN_HF_VNI)))
+        return EDPVS_KNICONTINUE;
+
+    iph = mbuf->userdata; /* see ipv4_local_in_fin */
+    assert(iph->version == 4 && iph->protocol == IPPROTO_UDP);
+
+    key = htonl(ntohl(vxh->vx_vni) >> 8);
+    tnl = ip_tunnel_lookup(&vxlan_tunnel_tab, mbuf->port, TUNNEL_F_KEY,
+                           iph->saddr, iph->daddr, key);
+    if (!tnl)
+        return EDPVS_KNICONTINUE;
+
+    if (ip_tunnel_pull_header(mbuf, ETHER_VXLAN_HLEN,
+                              htons(ETH_P_TEB)) != EDPVS_OK)
+        goto drop;
+
+    /* RX checksum flags are for the outer packet */
+    mbuf->ol_flags &= ~(PKT_RX_IP_CKSUM_MASK | PKT_RX_L4_CKSUM_MASK);
+
+    return netif_rcv_l2(tnl->dev, mbuf);
+
+drop:
+    rte_pktmbuf_free(mbuf);
+    return EDPVS_DROP;
+}
+
+static struct ip_tunnel_ops vxlan_tnl_ops = {
+    .kind       = "vxlan",
+    .priv_size  = sizeof(struct ip_tunnel),
+    .kni        = true,
+    .setup      = vxlan_setup,
+    .change     = vxlan_change,
+};
+
+static struct inet_protocol vxlan_proto = {
+    .handler    = vxlan_rcv,
+};
+
+int vxlan_init(void)
+{
+    int err;
+
+    err = ip_tunnel_init_tab(&vxlan_tunnel_tab, &vxlan_tnl_ops, "vxlan0");
+    if (err != EDPVS_OK)
+        return err;
+
+    err = ipv4_register_protocol(&vxlan_proto, IPPROTO_UDP);
+    if (err != EDPVS_OK) {
+        ip_tunnel_term_tab(&vxlan_tunnel_tab);
+        return err;
+    }
+
+    return err;
+}
+
+int vxlan_term(void)
+{
+    int err;
+
+    err = ipv4_unregister_protocol(&vxlan_proto, IPPROTO_UDP);
+    if (err != EDPVS_OK)
+        return err;
+
+    err = ip_tunnel_term_tab(&vxlan_tunnel_tab);
+    if (err != EDPVS_OK)
+        return err;
+
+    return err;
+}
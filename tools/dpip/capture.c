@@ -0,0 +1,231 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "common.h"
+#include "dpip.h"
+#include "conf/capture.h"
+#include "sockopt.h"
+
+static void capture_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip capture add file FILE [ dev DEVICE ] [ dir { in | out | both } ]\n"
+            "                     [ snaplen LEN ] [ sample N ] [ count N ] [ bpf BPF-FILE ]\n"
+            "    dpip capture del\n"
+            "    dpip capture show\n"
+            "Parameters:\n"
+            "    FILE       pcapng file written by dpvs, readable by tcpdump/wireshark\n"
+            "    sample N   capture one of every N packets\n"
+            "    count N    stop capturing after N packets\n"
+            "    BPF-FILE   filter compiled by `tcpdump -y EN10MB -ddd EXPRESSION`,\n"
+            "               use '-' for stdin\n"
+            "Examples:\n"
+            "    tcpdump -y EN10MB -ddd 'tcp port 80' > /tmp/http.bpf\n"
+            "    dpip capture add file /tmp/http.pcapng dev dpdk0 bpf /tmp/http.bpf count 1000\n"
+            "    dpip capture del\n"
+           );
+}
+
+/* parse `tcpdump -ddd` output: instruction number followed by
+ * "code jt jf k" in decimal for each instruction. */
+static int capture_parse_bpf(const char *path, struct dp_vs_capture_conf *conf)
+{
+    FILE *fp;
+    unsigned int i, n, code, jt, jf, k;
+    int err = -1;
+
+    if (strcmp(path, "-") == 0)
+        fp = stdin;
+    else if ((fp = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "fail to open %s\n", path);
+        return -1;
+    }
+
+    if (fscanf(fp, "%u", &n) != 1 || n == 0 || n > CAPTURE_BPF_MAXINSNS) {
+        fprintf(stderr, "invalid BPF program size (max %d)\n",
+                CAPTURE_BPF_MAXINSNS);
+        goto out;
+    }
+
+    for (i = 0; i < n; i++) {
+        if (fscanf(fp, "%u %u %u %u", &code, &jt, &jf, &k) != 4 ||
+                code > USHRT_MAX || jt > UCHAR_MAX || jf > UCHAR_MAX) {
+            fprintf(stderr, "invalid BPF instruction #%u\n", i);
+            goto out;
+        }
+        conf->bpf[i].code = code;
+        conf->bpf[i].jt = jt;
+        conf->bpf[i].jf = jf;
+        conf->bpf[i].k = k;
+    }
+    conf->bpf_len = n;
+    err = 0;
+
+out:
+    if (fp != stdin)
+        fclose(fp);
+    return err;
+}
+
+static int capture_parse_args(struct dpip_conf *conf,
+                              struct dp_vs_capture_conf *cap)
+{
+    memset(cap, 0, sizeof(*cap));
+    cap->direction = CAPTURE_DIR_BOTH;
+    cap->snaplen = CAPTURE_SNAPLEN_DEF;
+
+    while (conf->argc > 0) {
+        if (strcmp(conf->argv[0], "dev") == 0) {
+            NEXTARG_CHECK(conf, "dev");
+            snprintf(cap->ifname, sizeof(cap->ifname), "%s", conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "file") == 0) {
+            NEXTARG_CHECK(conf, "file");
+            if (conf->argv[0][0] != '/') {
+                fprintf(stderr, "file must be an absolute path\n");
+                return -1;
+            }
+            snprintf(cap->file, sizeof(cap->file), "%s", conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "dir") == 0) {
+            NEXTARG_CHECK(conf, "dir");
+            if (strcmp(conf->argv[0], "in") == 0)
+                cap->direction = CAPTURE_DIR_RX;
+            else if (strcmp(conf->argv[0], "out") == 0)
+                cap->direction = CAPTURE_DIR_TX;
+            else if (strcmp(conf->argv[0], "both") == 0)
+                cap->direction = CAPTURE_DIR_BOTH;
+            else {
+                fprintf(stderr, "invalid direction\n");
+                return -1;
+            }
+        } else if (strcmp(conf->argv[0], "snaplen") == 0) {
+            NEXTARG_CHECK(conf, "snaplen");
+            cap->snaplen = atoi(conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "sample") == 0) {
+            NEXTARG_CHECK(conf, "sample");
+            cap->sample = atoi(conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "count") == 0) {
+            NEXTARG_CHECK(conf, "count");
+            cap->count = atoi(conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "bpf") == 0) {
+            NEXTARG_CHECK(conf, "bpf");
+            if (capture_parse_bpf(conf->argv[0], cap) != 0)
+                return -1;
+        } else {
+            fprintf(stderr, "invalid argument `%s'\n", conf->argv[0]);
+            return -1;
+        }
+
+        NEXTARG(conf);
+    }
+
+    if (conf->cmd == DPIP_CMD_ADD && !strlen(cap->file)) {
+        fprintf(stderr, "missing output file\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void capture_dump(const struct dp_vs_capture_show *show)
+{
+    const struct dp_vs_capture_lcore_stats *st;
+    int i;
+
+    printf("capture: %s", show->running ? "running" : "stopped");
+    if (strlen(show->conf.file)) {
+        printf(" dev %s dir %s snaplen %u sample %u count %u bpf %u insns\n",
+               strlen(show->conf.ifname) ? show->conf.ifname : "all",
+               show->conf.direction == CAPTURE_DIR_RX ? "in" :
+               show->conf.direction == CAPTURE_DIR_TX ? "out" : "both",
+               show->conf.snaplen, show->conf.sample, show->conf.count,
+               show->conf.bpf_len);
+        printf("    file %s written %lu\n", show->conf.file, show->written);
+    } else {
+        printf("\n");
+    }
+    printf("forward2kni: sent %lu dropped %lu\n",
+           show->kni_sent, show->kni_dropped);
+
+    printf("%-8s %-16s %-16s %-16s %-16s %-16s\n", "lcore", "captured",
+           "sampled", "filtered", "ring-full", "no-mem");
+    for (i = 0; i < show->nlcore; i++) {
+        st = &show->lcores[i];
+        printf("%-8u %-16lu %-16lu %-16lu %-16lu %-16lu\n", st->cid,
+               st->captured, st->sampled, st->filtered,
+               st->ring_full, st->nomem);
+    }
+}
+
+static int capture_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                          struct dpip_conf *conf)
+{
+    struct dp_vs_capture_conf cap;
+    struct dp_vs_capture_show *show;
+    size_t size;
+    int err;
+
+    if (capture_parse_args(conf, &cap) != 0)
+        return EDPVS_INVAL;
+
+    switch (conf->cmd) {
+    case DPIP_CMD_ADD:
+        return dpvs_setsockopt(SOCKOPT_SET_CAPTURE_START, &cap, sizeof(cap));
+
+    case DPIP_CMD_DEL:
+        return dpvs_setsockopt(SOCKOPT_SET_CAPTURE_STOP, NULL, 0);
+
+    case DPIP_CMD_SHOW:
+        err = dpvs_getsockopt(SOCKOPT_GET_CAPTURE_SHOW, NULL, 0,
+                              (void **)&show, &size);
+        if (err != 0)
+            return err;
+        if (size < sizeof(*show) ||
+                size != sizeof(*show) + show->nlcore * \
+                sizeof(struct dp_vs_capture_lcore_stats)) {
+            fprintf(stderr, "corrupted response.\n");
+            dpvs_sockopt_msg_free(show);
+            return EDPVS_INVAL;
+        }
+        capture_dump(show);
+        dpvs_sockopt_msg_free(show);
+        return EDPVS_OK;
+
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+struct dpip_obj dpip_capture = {
+    .name = "capture",
+    .help = capture_help,
+    .do_cmd = capture_do_cmd,
+};
+
+static void __init capture_init(void)
+{
+    dpip_register_obj(&dpip_capture);
+}
+
+static void __exit capture_exit(void)
+{
+    dpip_unregister_obj(&dpip_capture);
+}
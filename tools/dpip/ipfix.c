@@ -0,0 +1,176 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "common.h"
+#include "dpip.h"
+#include "conf/ipfix.h"
+#include "sockopt.h"
+
+static void ipfix_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip ipfix add collector IPADDR [ port PORT ] [ domain ID ]\n"
+            "                   [ active-timeout SEC ] [ template-refresh SEC ]\n"
+            "    dpip ipfix del\n"
+            "    dpip ipfix show\n"
+            "Parameters:\n"
+            "    IPADDR             IPv4 address of the UDP collector\n"
+            "    PORT               collector port, default %d\n"
+            "    ID                 observation domain id, default 0\n"
+            "    active-timeout     report long-lived flows every SEC, default %d\n"
+            "    template-refresh   resend templates every SEC, default %d\n"
+            "Examples:\n"
+            "    dpip ipfix add collector 10.0.0.100 domain 1 active-timeout 30\n"
+            "    dpip ipfix del\n",
+            IPFIX_PORT_DEF, IPFIX_ACTIVE_TIMEOUT_DEF, IPFIX_TEMPLATE_REFRESH_DEF
+           );
+}
+
+static int ipfix_parse_args(struct dpip_conf *conf,
+                            struct dp_vs_ipfix_conf *ic)
+{
+    int port;
+
+    memset(ic, 0, sizeof(*ic));
+
+    while (conf->argc > 0) {
+        if (strcmp(conf->argv[0], "collector") == 0) {
+            NEXTARG_CHECK(conf, "collector");
+            if (inet_pton(AF_INET, conf->argv[0], &ic->collector) <= 0) {
+                fprintf(stderr, "invalid collector address\n");
+                return -1;
+            }
+        } else if (strcmp(conf->argv[0], "port") == 0) {
+            NEXTARG_CHECK(conf, "port");
+            port = atoi(conf->argv[0]);
+            if (port <= 0 || port > 65535) {
+                fprintf(stderr, "invalid port\n");
+                return -1;
+            }
+            ic->port = htons(port);
+        } else if (strcmp(conf->argv[0], "domain") == 0) {
+            NEXTARG_CHECK(conf, "domain");
+            ic->domain_id = strtoul(conf->argv[0], NULL, 0);
+        } else if (strcmp(conf->argv[0], "active-timeout") == 0) {
+            NEXTARG_CHECK(conf, "active-timeout");
+            ic->active_timeout = atoi(conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "template-refresh") == 0) {
+            NEXTARG_CHECK(conf, "template-refresh");
+            ic->template_refresh = atoi(conf->argv[0]);
+        } else {
+            fprintf(stderr, "invalid argument `%s'\n", conf->argv[0]);
+            return -1;
+        }
+
+        NEXTARG(conf);
+    }
+
+    if (conf->cmd == DPIP_CMD_ADD && !ic->collector.s_addr) {
+        fprintf(stderr, "missing collector\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void ipfix_dump(const struct dp_vs_ipfix_show *show)
+{
+    const struct dp_vs_ipfix_lcore_stats *st;
+    char addr[INET_ADDRSTRLEN];
+    int i;
+
+    printf("ipfix: %s", show->running ? "running" : "stopped");
+    if (show->conf.collector.s_addr) {
+        inet_ntop(AF_INET, &show->conf.collector, addr, sizeof(addr));
+        printf(" collector %s:%u domain %u active-timeout %u template-refresh %u\n",
+               addr, ntohs(show->conf.port), show->conf.domain_id,
+               show->conf.active_timeout, show->conf.template_refresh);
+        printf("    records %lu messages %lu templates %lu send-errors %lu\n",
+               show->sent_records, show->sent_msgs, show->sent_templates,
+               show->send_errors);
+    } else {
+        printf("\n");
+    }
+
+    printf("%-8s %-16s %-16s %-16s\n", "lcore", "records",
+           "no-buffer", "ring-full");
+    for (i = 0; i < show->nlcore; i++) {
+        st = &show->lcores[i];
+        printf("%-8u %-16lu %-16lu %-16lu\n", st->cid,
+               st->records, st->nobuf, st->ring_full);
+    }
+}
+
+static int ipfix_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                        struct dpip_conf *conf)
+{
+    struct dp_vs_ipfix_conf ic;
+    struct dp_vs_ipfix_show *show;
+    size_t size;
+    int err;
+
+    if (ipfix_parse_args(conf, &ic) != 0)
+        return EDPVS_INVAL;
+
+    switch (conf->cmd) {
+    case DPIP_CMD_ADD:
+        return dpvs_setsockopt(SOCKOPT_SET_IPFIX_START, &ic, sizeof(ic));
+
+    case DPIP_CMD_DEL:
+        return dpvs_setsockopt(SOCKOPT_SET_IPFIX_STOP, NULL, 0);
+
+    case DPIP_CMD_SHOW:
+        err = dpvs_getsockopt(SOCKOPT_GET_IPFIX_SHOW, NULL, 0,
+                              (void **)&show, &size);
+        if (err != 0)
+            return err;
+        if (size < sizeof(*show) ||
+                size != sizeof(*show) + show->nlcore * \
+                sizeof(struct dp_vs_ipfix_lcore_stats)) {
+            fprintf(stderr, "corrupted response.\n");
+            dpvs_sockopt_msg_free(show);
+            return EDPVS_INVAL;
+        }
+        ipfix_dump(show);
+        dpvs_sockopt_msg_free(show);
+        return EDPVS_OK;
+
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+struct dpip_obj dpip_ipfix = {
+    .name = "ipfix",
+    .help = ipfix_help,
+    .do_cmd = ipfix_do_cmd,
+};
+
+static void __init ipfix_init(void)
+{
+    dpip_register_obj(&dpip_ipfix);
+}
+
+static void __exit ipfix_exit(void)
+{
+    dpip_unregister_obj(&dpip_ipfix);
+}
@@ -0,0 +1,96 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "dpip.h"
+#include "conf/estats.h"
+#include "sockopt.h"
+
+static void ipvs_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip ipvs show [ all ]\n"
+            "Parameters:\n"
+            "    all        also show counters of zero\n"
+            "Examples:\n"
+            "    dpip ipvs show\n"
+           );
+}
+
+static int ipvs_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                       struct dpip_conf *conf)
+{
+    struct dp_vs_estats_show *show;
+    bool all = false;
+    size_t size;
+    uint32_t i;
+    int err;
+
+    if (cmd != DPIP_CMD_SHOW)
+        return EDPVS_NOTSUPP;
+
+    while (conf->argc > 0) {
+        if (strcmp(conf->argv[0], "all") == 0) {
+            all = true;
+        } else {
+            fprintf(stderr, "invalid argument `%s'\n", conf->argv[0]);
+            return EDPVS_INVAL;
+        }
+        NEXTARG(conf);
+    }
+
+    err = dpvs_getsockopt(SOCKOPT_GET_ESTATS_SHOW, NULL, 0,
+                          (void **)&show, &size);
+    if (err != 0)
+        return err;
+    if (size < sizeof(*show) ||
+            size != sizeof(*show) + show->nstats * \
+            sizeof(struct dp_vs_estats_entry)) {
+        fprintf(stderr, "corrupted response.\n");
+        dpvs_sockopt_msg_free(show);
+        return EDPVS_INVAL;
+    }
+
+    for (i = 0; i < show->nstats; i++) {
+        if (!all && !show->stats[i].value)
+            continue;
+        printf("%-32s %lu\n", show->stats[i].name, show->stats[i].value);
+    }
+
+    dpvs_sockopt_msg_free(show);
+    return EDPVS_OK;
+}
+
+struct dpip_obj dpip_ipvs = {
+    .name = "ipvs",
+    .help = ipvs_help,
+    .do_cmd = ipvs_do_cmd,
+};
+
+static void __init ipvs_init(void)
+{
+    dpip_register_obj(&dpip_ipvs);
+}
+
+static void __exit ipvs_exit(void)
+{
+    dpip_unregister_obj(&dpip_ipvs);
+}
@@ -0,0 +1,177 @@
+/*
+ * DPVS is a software load balancer (Virtual Server) based on DPDK.
+ *
+ * Copyright (C) 2017 iQIYI (www.iqiyi.com).
+ * All Rights Reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "dpip.h"
+#include "conf/sesslog.h"
+#include "sockopt.h"
+
+static void sesslog_help(void)
+{
+    fprintf(stderr,
+            "Usage:\n"
+            "    dpip sesslog add { file FILE | unix SOCKET } [ sample N ]\n"
+            "                     [ events { create | expire | both } ]\n"
+            "    dpip sesslog del\n"
+            "    dpip sesslog show\n"
+            "Parameters:\n"
+            "    FILE       binary record file appended by dpvs, see conf/sesslog.h\n"
+            "    SOCKET     unix datagram socket bound by the collector,\n"
+            "               each datagram carries a batch of records\n"
+            "    sample N   log one of every N sessions\n"
+            "Examples:\n"
+            "    dpip sesslog add file /var/log/dpvs-sess.bin sample 10\n"
+            "    dpip sesslog add unix /var/run/sesslog.sock events expire\n"
+            "    dpip sesslog del\n"
+           );
+}
+
+static int sesslog_parse_args(struct dpip_conf *conf,
+                              struct dp_vs_sesslog_conf *sl)
+{
+    memset(sl, 0, sizeof(*sl));
+
+    while (conf->argc > 0) {
+        if (strcmp(conf->argv[0], "file") == 0 ||
+                strcmp(conf->argv[0], "unix") == 0) {
+            sl->sink = strcmp(conf->argv[0], "file") == 0 ?
+                       SESSLOG_SINK_FILE : SESSLOG_SINK_UNIX;
+            NEXTARG_CHECK(conf, conf->argv[0]);
+            if (conf->argv[0][0] != '/') {
+                fprintf(stderr, "path must be absolute\n");
+                return -1;
+            }
+            if (strlen(conf->argv[0]) >= sizeof(sl->path)) {
+                fprintf(stderr, "path too long\n");
+                return -1;
+            }
+            snprintf(sl->path, sizeof(sl->path), "%s", conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "sample") == 0) {
+            NEXTARG_CHECK(conf, "sample");
+            sl->sample = atoi(conf->argv[0]);
+        } else if (strcmp(conf->argv[0], "events") == 0) {
+            NEXTARG_CHECK(conf, "events");
+            if (strcmp(conf->argv[0], "create") == 0)
+                sl->events = SESSLOG_REC_CREATE;
+            else if (strcmp(conf->argv[0], "expire") == 0)
+                sl->events = SESSLOG_REC_EXPIRE;
+            else if (strcmp(conf->argv[0], "both") == 0)
+                sl->events = SESSLOG_REC_CREATE | SESSLOG_REC_EXPIRE;
+            else {
+                fprintf(stderr, "invalid events\n");
+                return -1;
+            }
+        } else {
+            fprintf(stderr, "invalid argument `%s'\n", conf->argv[0]);
+            return -1;
+        }
+
+        NEXTARG(conf);
+    }
+
+    if (conf->cmd == DPIP_CMD_ADD && !sl->sink) {
+        fprintf(stderr, "missing output file or socket\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+static void sesslog_dump(const struct dp_vs_sesslog_show *show)
+{
+    const struct dp_vs_sesslog_lcore_stats *st;
+    int i;
+
+    printf("sesslog: %s", show->running ? "running" : "stopped");
+    if (show->conf.sink) {
+        printf(" %s %s sample %u events %s\n",
+               show->conf.sink == SESSLOG_SINK_FILE ? "file" : "unix",
+               show->conf.path, show->conf.sample,
+               show->conf.events == SESSLOG_REC_CREATE ? "create" :
+               show->conf.events == SESSLOG_REC_EXPIRE ? "expire" : "both");
+        printf("    written %lu write-errors %lu\n",
+               show->written, show->write_errors);
+    } else {
+        printf("\n");
+    }
+
+    printf("%-8s %-16s %-16s %-16s %-16s\n", "lcore", "logged",
+           "sampled", "no-buffer", "ring-full");
+    for (i = 0; i < show->nlcore; i++) {
+        st = &show->lcores[i];
+        printf("%-8u %-16lu %-16lu %-16lu %-16lu\n", st->cid,
+               st->logged, st->sampled, st->nobuf, st->ring_full);
+    }
+}
+
+static int sesslog_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                          struct dpip_conf *conf)
+{
+    struct dp_vs_sesslog_conf sl;
+    struct dp_vs_sesslog_show *show;
+    size_t size;
+    int err;
+
+    if (sesslog_parse_args(conf, &sl) != 0)
+        return EDPVS_INVAL;
+
+    switch (conf->cmd) {
+    case DPIP_CMD_ADD:
+        return dpvs_setsockopt(SOCKOPT_SET_SESSLOG_START, &sl, sizeof(sl));
+
+    case DPIP_CMD_DEL:
+        return dpvs_setsockopt(SOCKOPT_SET_SESSLOG_STOP, NULL, 0);
+
+    case DPIP_CMD_SHOW:
+        err = dpvs_getsockopt(SOCKOPT_GET_SESSLOG_SHOW, NULL, 0,
+                              (void **)&show, &size);
+        if (err != 0)
+            return err;
+        if (size < sizeof(*show) ||
+                size != sizeof(*show) + show->nlcore * \
+                sizeof(struct dp_vs_sesslog_lcore_stats)) {
+            fprintf(stderr, "corrupted response.\n");
+            dpvs_sockopt_msg_free(show);
+            return EDPVS_INVAL;
+        }
+        sesslog_dump(show);
+        dpvs_sockopt_msg_free(show);
+        return EDPVS_OK;
+
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+struct dpip_obj dpip_sesslog = {
+    .name = "sesslog",
+    .help = sesslog_help,
+    .do_cmd = sesslog_do_cmd,
+};
+
+static void __init sesslog_init(void)
+{
+    dpip_register_obj(&dpip_sesslog);
+}
+
+static void __exit sesslog_exit(void)
+{
+    dpip_unregister_obj(&dpip_sesslog);
+}
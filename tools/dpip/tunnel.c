@@ -26,6 +26,15 @@
 #include "dpip.h"
 #include "sockopt.h"
 #include "ip_tunnel.h"
+#include "ip6_tunnel.h"
+
+struct tnl_param {
+    int af;
+    union {
+        struct ip_tunnel_param  v4;
+        struct ip6_tunnel_param v6;
+    };
+};
 
 static int addr_atoi(const char *addr, __be32 *ip)
 {
@@ -37,6 +46,16 @@ static int addr_atoi(const char *addr, __be32 *ip)
     return EDPVS_OK;
 }
 
+static int addr6_atoi(const char *addr, struct in6_addr *ip6)
+{
+    if (strcmp(addr, "any") == 0)
+        *ip6 = in6addr_any;
+    else if (inet_pton(AF_INET6, addr, ip6) <= 0)
+        return EDPVS_INVAL;
+
+    return EDPVS_OK;
+}
+
 static int ttl_atoi(const char *ttl)
 {
     if (strcmp(ttl, "inherit") == 0)
@@ -99,12 +118,47 @@ static void tnl_dump_param(const struct ip_tunnel_param *param)
     printf("\n");
 }
 
+static void tnl6_dump_param(const struct ip6_tunnel_param *param)
+{
+    char sip[64], dip[64];
+
+    inet_ntop(AF_INET6, &param->laddr, sip, sizeof(sip));
+    inet_ntop(AF_INET6, &param->raddr, dip, sizeof(dip));
+
+    printf("%s: %4s remote %s local %s ",
+           param->ifname, param->kind, dip, sip);
+
+    if (strlen(param->link))
+        printf("dev %s ", param->link);
+
+    if (param->hop_limit)
+        printf("hoplimit %d ", param->hop_limit);
+    else
+        printf("hoplimit inherit ");
+
+    if (param->flags & IP6_TNL_F_USE_ORIG_TCLASS)
+        printf("tclass inherit ");
+    else if (param->tclass)
+        printf("tclass 0x%x ", param->tclass);
+
+    if (param->i_flags)
+        printf("i_flags 0x%x ", ntohs(param->i_flags));
+    if (param->o_flags)
+        printf("o_flags 0x%x ", ntohs(param->o_flags));
+    if (param->i_key)
+        printf("i_key 0x%x ", ntohl(param->i_key));
+    if (param->o_key)
+        printf("o_key 0x%x ", ntohl(param->o_key));
+
+    printf("\n");
+}
+
 static void tnl_help(void)
 {
     fprintf(stderr,
         "Usage:\n"
         "    dpip tunnel { add | change | del | show } [ NAME ]\n"
-        "         [ mode { ipip | gre } ] [ remote ADDR ] [ local ADDR ]\n"
+        "         [ mode { ipip | gre | vxlan } ] [ remote ADDR ] [ local ADDR ]\n"
         "         [ [i|o]seq ] [ [i|o]key KEY ] [ [i|o]csum ]\n"
         "         [ ttl TTL ] [ tos TOS ] [ dev PHYS_DEV ]\n"
         "Parameters:\n"
@@ -113,13 +167,18 @@ static void tnl_help(void)
         "    TOS     := { 0..255 | inherit }\n"
         "    TTL     := { 1..255 | inherit }\n"
         "    KEY     := { DOTTED_QUAD | NUMBER }\n"
+        "    dpip -6 tunnel { add | change | del | show } [ NAME ]\n"
+        "         [ mode { ip6ip6 | ipip6 | ip6gre } ] [ remote ADDR6 ] [ local ADDR6 ]\n"
+        "         [ [i|o]key KEY ] [ [i|o]csum ]\n"
+        "         [ hoplimit TTL ] [ tclass TOS ] [ dev PHYS_DEV ]\n"
+        "Note:\n"
+        "    KEY is VNI (0..16777215) for vxlan, remote is mandatory.\n"
+        "    ADDR6 is IPv6 address or any, the underlay of -6 tunnels.\n"
         );
 }
 
-static int tnl_parse(struct dpip_obj *obj, struct dpip_conf *cf)
+static int tnl4_parse(struct ip_tunnel_param *param, struct dpip_conf *cf)
 {
-    struct ip_tunnel_param *param = obj->param;
-
     memset(param, 0, sizeof(*param));
 
     while (cf->argc > 0) {
@@ -198,13 +257,108 @@ static int tnl_parse(struct dpip_obj *obj, struct dpip_conf *cf)
     return EDPVS_OK;
 }
 
+static int tnl6_parse(struct ip6_tunnel_param *param, struct dpip_conf *cf)
+{
+    uint8_t tos;
+
+    memset(param, 0, sizeof(*param));
+
+    while (cf->argc > 0) {
+        if (strcmp(CURRARG(cf), "mode") == 0 ||
+            strcmp(CURRARG(cf), "type") == 0 ||
+            strcmp(CURRARG(cf), "kind") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            snprintf(param->kind, sizeof(param->kind), "%s", CURRARG(cf));
+        } else if (strcmp(CURRARG(cf), "remote") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            if (addr6_atoi(CURRARG(cf), &param->raddr) != EDPVS_OK) {
+                fprintf(stderr, "invalid remote address: `%s'\n", CURRARG(cf));
+                return EDPVS_INVAL;
+            }
+        } else if (strcmp(CURRARG(cf), "local") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            if (addr6_atoi(CURRARG(cf), &param->laddr) != EDPVS_OK) {
+                fprintf(stderr, "invalid local address: `%s'\n", CURRARG(cf));
+                return EDPVS_INVAL;
+            }
+        } else if (strcmp(CURRARG(cf), "ikey") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            param->i_flags |= TUNNEL_F_KEY;
+            param->i_key = key_atoi(CURRARG(cf));
+        } else if (strcmp(CURRARG(cf), "okey") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            param->o_flags |= TUNNEL_F_KEY;
+            param->o_key = key_atoi(CURRARG(cf));
+        } else if (strcmp(CURRARG(cf), "key") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            param->i_flags |= TUNNEL_F_KEY;
+            param->o_flags |= TUNNEL_F_KEY;
+            param->i_key = param->o_key = key_atoi(CURRARG(cf));
+        } else if (strcmp(CURRARG(cf), "icsum") == 0) {
+            param->i_flags |= TUNNEL_F_CSUM;
+        } else if (strcmp(CURRARG(cf), "ocsum") == 0) {
+            param->o_flags |= TUNNEL_F_CSUM;
+        } else if (strcmp(CURRARG(cf), "csum") == 0) {
+            param->i_flags |= TUNNEL_F_CSUM;
+            param->o_flags |= TUNNEL_F_CSUM;
+        } else if (strcmp(CURRARG(cf), "hoplimit") == 0 ||
+                   strcmp(CURRARG(cf), "ttl") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            param->hop_limit = ttl_atoi(CURRARG(cf));
+        } else if (strcmp(CURRARG(cf), "tclass") == 0 ||
+                   strcmp(CURRARG(cf), "tos") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            tos = tos_atoi(CURRARG(cf));
+            if (strcmp(CURRARG(cf), "inherit") == 0)
+                param->flags |= IP6_TNL_F_USE_ORIG_TCLASS;
+            else
+                param->tclass = tos;
+        } else if (strcmp(CURRARG(cf), "dev") == 0) {
+            NEXTARG_CHECK(cf, CURRARG(cf));
+            snprintf(param->link, sizeof(param->link), "%s", CURRARG(cf));
+        } else {
+            if (!strlen(param->ifname))
+                snprintf(param->ifname, sizeof(param->ifname), "%s", CURRARG(cf));
+            else { /* cannot be set more than once */
+                fprintf(stderr, "Is `%s' or `%s' garbage ?\n",
+                        CURRARG(cf), param->ifname);
+                return EDPVS_INVAL;
+            }
+
+        }
+
+        NEXTARG(cf);
+    }
+
+    if (cf->argc > 0) {
+        fprintf(stderr, "too many arguments\n");
+        return EDPVS_INVAL;
+    }
+
+    return EDPVS_OK;
+}
+
+static int tnl_parse(struct dpip_obj *obj, struct dpip_conf *cf)
+{
+    struct tnl_param *param = obj->param;
+
+    param->af = cf->af == AF_INET6 ? AF_INET6 : AF_INET;
+
+    if (param->af == AF_INET6)
+        return tnl6_parse(&param->v6, cf);
+    else
+        return tnl4_parse(&param->v4, cf);
+}
+
 static int tnl_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
 {
-    const struct ip_tunnel_param *param = obj->param;
+    const struct tnl_param *tp = obj->param;
+    const char *kind = tp->af == AF_INET6 ? tp->v6.kind : tp->v4.kind;
+    const char *ifname = tp->af == AF_INET6 ? tp->v6.ifname : tp->v4.ifname;
 
     switch (cmd) {
     case DPIP_CMD_ADD:
-        if (!strlen(param->kind)) {
+        if (!strlen(kind)) {
             fprintf(stderr, "missing tunnel type.\n");
             return EDPVS_INVAL;
         }
@@ -212,7 +366,7 @@ static int tnl_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
     case DPIP_CMD_DEL:
     case DPIP_CMD_SET:
     case DPIP_CMD_REPLACE:
-        if (!strlen(param->ifname)) {
+        if (!strlen(ifname)) {
             fprintf(stderr, "missing tunnel dev name.\n");
             return EDPVS_INVAL;
         }
@@ -226,10 +380,8 @@ static int tnl_check(const struct dpip_obj *obj, dpip_cmd_t cmd)
     return EDPVS_OK;
 }
 
-static int tnl_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
-                      struct dpip_conf *conf)
+static int tnl4_do_cmd(struct ip_tunnel_param *param, dpip_cmd_t cmd)
 {
-    struct ip_tunnel_param *param = obj->param;
     struct ip_tunnel_param *par_list;
     size_t par_size;
     int err, i;
@@ -265,7 +417,55 @@ static int tnl_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
     }
 }
 
-static struct ip_tunnel_param tnl_param;
+static int tnl6_do_cmd(struct ip6_tunnel_param *param, dpip_cmd_t cmd)
+{
+    struct ip6_tunnel_param *par_list;
+    size_t par_size;
+    int err, i;
+
+    switch (cmd) {
+    case DPIP_CMD_ADD:
+        return dpvs_setsockopt(SOCKOPT_TUNNEL6_ADD, param, sizeof(*param));
+    case DPIP_CMD_DEL:
+        return dpvs_setsockopt(SOCKOPT_TUNNEL6_DEL, param, sizeof(*param));
+    case DPIP_CMD_SET:
+        return dpvs_setsockopt(SOCKOPT_TUNNEL6_CHANGE, param, sizeof(*param));
+    case DPIP_CMD_REPLACE:
+        return dpvs_setsockopt(SOCKOPT_TUNNEL6_REPLACE, param, sizeof(*param));
+    case DPIP_CMD_SHOW:
+        err = dpvs_getsockopt(SOCKOPT_TUNNEL6_SHOW, param, sizeof(*param),
+                              (void **)&par_list, &par_size);
+        if (err != 0)
+            return EDPVS_INVAL;
+
+        if (par_size < 0 || (par_size % sizeof(*par_list)) != 0) {
+            fprintf(stderr, "corrupted response.\n");
+            dpvs_sockopt_msg_free(par_list);
+            return EDPVS_INVAL;
+        }
+
+        for (i = 0; i < par_size / sizeof(*par_list); i++)
+            tnl6_dump_param(&par_list[i]);
+
+        dpvs_sockopt_msg_free(par_list);
+        return EDPVS_OK;
+    default:
+        return EDPVS_NOTSUPP;
+    }
+}
+
+static int tnl_do_cmd(struct dpip_obj *obj, dpip_cmd_t cmd,
+                      struct dpip_conf *conf)
+{
+    struct tnl_param *param = obj->param;
+
+    if (param->af == AF_INET6)
+        return tnl6_do_cmd(&param->v6, cmd);
+    else
+        return tnl4_do_cmd(&param->v4, cmd);
+}
+
+static struct tnl_param tnl_param;
 
 static struct dpip_obj dpip_tnl = {
     .name   = "tunnel",
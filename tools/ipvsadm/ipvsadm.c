@@ -265,6 +265,7 @@ struct ipvs_command_entry {
 	ipvs_laddr_t		laddr;
 	ipvs_blklst_t		blklst;
 	ipvs_sockpair_t		sockpair;
+	struct ip_vs_conn_filter conn_filter;
 };
 
 /* Use values outside ASCII range so that if an option has
@@ -285,6 +286,8 @@ enum {
 	TAG_NO_SORT,
 	TAG_PERSISTENCE_ENGINE,
 	TAG_SOCKPAIR,
+	TAG_CONN_FILTER,
+	TAG_VXLAN,
 };
 
 /* various parsing helpers & parsing functions */
@@ -303,6 +306,7 @@ static int parse_netmask(char *buf, u_int32_t *addr);
 static int parse_timeout(char *buf, int min, int max);
 static unsigned int parse_fwmark(char *buf);
 static int parse_sockpair(char *buf, ipvs_sockpair_t *sockpair);
+static int parse_conn_filter(char *buf, struct ip_vs_conn_filter *filter);
 static int parse_match_snat(const char *buf, ipvs_service_t *svc);
 
 /* check the options based on the commands_v_options table */
@@ -317,7 +321,8 @@ static void version(FILE *stream);
 static void fail(int err, char *msg, ...);
 
 /* various listing functions */
-static void list_conn(int is_template, unsigned int format);
+static void list_conn(int is_template, const struct ip_vs_conn_filter *filter,
+		unsigned int format);
 static void list_conn_sockpair(int is_template,
 		ipvs_sockpair_t *sockpair, unsigned int format);
 static void list_service(ipvs_service_t *svc, unsigned int format);
@@ -419,6 +424,7 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 		{ "gatewaying", 'g', POPT_ARG_NONE, NULL, 'g', NULL, NULL },
 		{ "fullnat" , 'b' , POPT_ARG_NONE, NULL, 'b', NULL, NULL },
 		{ "snat" , 'J' , POPT_ARG_NONE, NULL, 'J', NULL, NULL },
+		{ "vxlan", '\0', POPT_ARG_NONE, NULL, TAG_VXLAN, NULL, NULL },
 		{ "weight", 'w', POPT_ARG_STRING, &optarg, 'w', NULL, NULL },
 		{ "u-threshold", 'x', POPT_ARG_STRING, &optarg, 'x',
 		  NULL, NULL },
@@ -440,6 +446,8 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 		  TAG_PERSISTENTCONN, NULL, NULL },
 		{ "sockpair", '\0', POPT_ARG_STRING, &optarg,
 		  TAG_SOCKPAIR, NULL, NULL },
+		{ "conn-filter", '\0', POPT_ARG_STRING, &optarg,
+		  TAG_CONN_FILTER, NULL, NULL },
 		{ "nosort", '\0', POPT_ARG_NONE, NULL,
 		   TAG_NO_SORT, NULL, NULL },
 		{ "sort", '\0', POPT_ARG_NONE, NULL, TAG_SORT, NULL, NULL },
@@ -636,6 +644,10 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 			set_option(options, OPT_FORWARD);
 			ce->dest.conn_flags = IP_VS_CONN_F_SNAT;
 			break;
+		case TAG_VXLAN:
+			set_option(options, OPT_FORWARD);
+			ce->dest.conn_flags = IP_VS_CONN_F_VXLAN;
+			break;
 		case 'm':
 			set_option(options, OPT_FORWARD);
 			ce->dest.conn_flags = IP_VS_CONN_F_MASQ;
@@ -704,6 +716,10 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 			if (parse != 1)
 				fail(2, "illegal sockpair<af:sip:sport:tip:tport> specified");
 			break;
+		case TAG_CONN_FILTER:
+			if (parse_conn_filter(optarg, &ce->conn_filter) != 1)
+				fail(2, "illegal connection filter specified");
+			break;
 		case TAG_NO_SORT:
 			set_option(options, OPT_NOSORT);
 			*format |= FMT_NOSORT;
@@ -838,9 +854,53 @@ parse_options(int argc, char **argv, struct ipvs_command_entry *ce,
 
 
 
+/*
+ * restore sends the rules to dpvs as atomic batches over one connection.
+ * a get flushes the pending batch, so commands reading the rules close
+ * the current batch and run outside of it, and a new batch begins with
+ * the next line.
+ */
+static int restore_batch_open;
+static int restore_batch_line;	/* first line of the open batch */
+static int restore_batch_failed;
+
+static int cmd_reads_rules(int cmd)
+{
+	switch (cmd) {
+	case CMD_LIST:
+	case CMD_SAVE:
+	case CMD_EDIT:	/* gets the service to merge the options */
+	case CMD_GETLADDR:
+	case CMD_GETBLKLST:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static int restore_batch_end(void)
+{
+	if (!restore_batch_open)
+		return 0;
+	restore_batch_open = 0;
+
+	if (ipvs_batch_commit()) {
+		if (restore_batch_line > 1)
+			fprintf(stderr, "restore failed, rules from line %d on are "
+				"rolled back, rules before it are kept\n",
+				restore_batch_line);
+		else
+			fprintf(stderr, "restore failed, rules added are rolled back\n");
+		restore_batch_failed = 1;
+		return -1;
+	}
+	return 0;
+}
+
 static int restore_table(int argc, char **argv, int reading_stdin)
 {
 	int result = 0;
+	int line = 0;
 	dynamic_array_t *a;
 
 	/* avoid infinite loop */
@@ -849,12 +909,24 @@ static int restore_table(int argc, char **argv, int reading_stdin)
 
 	while ((a = config_stream_read(stdin, argv[0])) != NULL) {
 		int i;
+		line++;
+		if (!restore_batch_open) {
+			if (ipvs_batch_begin(IPVS_BATCH_ATOMIC))
+				fail(2, "fail to begin batch");
+			restore_batch_open = 1;
+			restore_batch_line = line;
+		}
 		if ((i = (int)dynamic_array_get_count(a)) > 1) {
 			char **strv = dynamic_array_get_vector(a);
 			result = process_options(i, strv, 1);
 		}
 		dynamic_array_destroy(a, DESTROY_STR);
+		if (restore_batch_failed)
+			return -1;
 	}
+
+	if (restore_batch_end())
+		result = -1;
 	return result;
 }
 
@@ -879,6 +951,9 @@ static int process_options(int argc, char **argv, int reading_stdin)
 
 	generic_opt_check(ce.cmd, options);
 
+	if (reading_stdin && cmd_reads_rules(ce.cmd) && restore_batch_end())
+		return -1;
+
 	if (ce.cmd == CMD_ADD || ce.cmd == CMD_EDIT) {
 		/* Make sure that port zero service is persistent */
 		if (!ce.svc.fwmark && !ce.svc.port &&
@@ -909,7 +984,8 @@ static int process_options(int argc, char **argv, int reading_stdin)
 		 */
 		if (!ce.svc.fwmark &&
 		    (ce.dest.conn_flags == IP_VS_CONN_F_TUNNEL
-		     || ce.dest.conn_flags == IP_VS_CONN_F_DROUTE))
+		     || ce.dest.conn_flags == IP_VS_CONN_F_DROUTE
+		     || ce.dest.conn_flags == IP_VS_CONN_F_VXLAN))
 			ce.dest.port = ce.svc.port;
 	}
 
@@ -920,13 +996,16 @@ static int process_options(int argc, char **argv, int reading_stdin)
 		    (options & (OPT_TIMEOUT|OPT_DAEMON) &&
 		     options & OPT_PERSISTENTCONN))
 			fail(2, "options conflicts in the list command");
+		if (ce.conn_filter.flags && !(options & OPT_CONNECTION))
+			fail(2, "--conn-filter can only be used with -c");
 
 		if (options & OPT_CONNECTION)
             if (options & OPT_SOCKPAIR)
                 list_conn_sockpair(options & OPT_PERSISTENTCONN,
 						&ce.sockpair, format);
             else
-                list_conn(options & OPT_PERSISTENTCONN, format);
+                list_conn(options & OPT_PERSISTENTCONN, &ce.conn_filter,
+						format);
 		else if (options & OPT_SERVICE)
 			list_service(&ce.svc, format);
 		else if (options & OPT_TIMEOUT)
@@ -1261,6 +1340,122 @@ parse_sockpair(char *buf, ipvs_sockpair_t *sockpair)
 
     return 1;
 }
+
+/*
+ * Get address of connection filter, return the char following the
+ * address (0 for end of string), or -1 on error.
+ * ADDR := dotted-decimal ip address or square-blacketed ip6 address
+ */
+static int
+parse_conn_filter_addr(char *buf, int *af, union inet_addr *addr, char **rest)
+{
+	char *end;
+	int sep;
+
+	if (*buf == '[') {
+		end = strchr(++buf, ']');
+		if (!end)
+			return -1;
+		*end++ = '\0';
+		*af = AF_INET6;
+	} else {
+		end = buf + strcspn(buf, ":/");
+		*af = AF_INET;
+	}
+
+	sep = *end;
+	*end = '\0';
+	if (inet_pton(*af, buf, addr) != 1)
+		return -1;
+	*rest = sep ? end + 1 : NULL;
+
+	return sep;
+}
+
+/*
+ * Get server side connection filter from the arguments.
+ * filter := ITEM[,ITEM]...
+ * ITEM := proto=tcp|udp|icmp|icmpv6 | vip=ADDR[:PORT] | rs=ADDR[:PORT] |
+ *         client=ADDR[/PLEN] | state=STATE | age=SECONDS
+ * STATE := state name as shown by 'ipvsadm -lnc', e.g. TCP_EST
+ */
+static int
+parse_conn_filter(char *buf, struct ip_vs_conn_filter *filter)
+{
+	char *item, *val, *rest, *saveptr = NULL;
+	union inet_addr addr;
+	int af, sep, num;
+
+	memset(filter, 0, sizeof(*filter));
+
+	for (item = strtok_r(buf, ",", &saveptr); item;
+	     item = strtok_r(NULL, ",", &saveptr)) {
+		val = strchr(item, '=');
+		if (!val)
+			return 0;
+		*val++ = '\0';
+
+		if (!strcmp(item, "proto")) {
+			if (!strcmp(val, "tcp"))
+				filter->proto = IPPROTO_TCP;
+			else if (!strcmp(val, "udp"))
+				filter->proto = IPPROTO_UDP;
+			else if (!strcmp(val, "icmp"))
+				filter->proto = IPPROTO_ICMP;
+			else if (!strcmp(val, "icmpv6"))
+				filter->proto = IPPROTO_ICMPV6;
+			else
+				return 0;
+			filter->flags |= CONN_FILTER_F_PROTO;
+		} else if (!strcmp(item, "vip") || !strcmp(item, "rs")) {
+			sep = parse_conn_filter_addr(val, &af, &addr, &rest);
+			if (sep < 0 || (sep && sep != ':'))
+				return 0;
+			num = 0;
+			if (rest && (num = string_to_number(rest, 0, 65535)) == -1)
+				return 0;
+			if (filter->af && filter->af != af)
+				return 0;
+			filter->af = af;
+			if (item[0] == 'v') {
+				filter->vaddr = addr;
+				filter->vport = htons(num);
+				filter->flags |= CONN_FILTER_F_VADDR;
+			} else {
+				filter->daddr = addr;
+				filter->dport = htons(num);
+				filter->flags |= CONN_FILTER_F_DADDR;
+			}
+		} else if (!strcmp(item, "client")) {
+			sep = parse_conn_filter_addr(val, &af, &addr, &rest);
+			if (sep < 0 || (sep && sep != '/'))
+				return 0;
+			num = (af == AF_INET ? 32 : 128);
+			if (rest && (num = string_to_number(rest, 0, num)) == -1)
+				return 0;
+			if (filter->af && filter->af != af)
+				return 0;
+			filter->af = af;
+			filter->caddr = addr;
+			filter->cplen = num;
+			filter->flags |= CONN_FILTER_F_CADDR;
+		} else if (!strcmp(item, "state")) {
+			if (strlen(val) >= sizeof(filter->state))
+				return 0;
+			snprintf(filter->state, sizeof(filter->state), "%s", val);
+			filter->flags |= CONN_FILTER_F_STATE;
+		} else if (!strcmp(item, "age")) {
+			if ((num = string_to_number(val, 0, 0x7fffffff)) == -1)
+				return 0;
+			filter->min_age = num;
+			filter->flags |= CONN_FILTER_F_AGE;
+		} else {
+			return 0;
+		}
+	}
+
+	return 1;
+}
 /*
  * comma separated parameters list, all fields is used to match packets.
  *
@@ -1467,6 +1662,7 @@ static void usage_exit(const char *program, const int exit_status)
 		"  --ipip         -i                   ipip encapsulation (tunneling)\n"
 		"  --fullnat      -b                   fullnat mode\n"
 		"  --snat         -J                   SNAT mode\n"
+		"  --vxlan                             vxlan encapsulation (DR over VXLAN device)\n"
 		"  --masquerading -m                   masquerading (NAT)\n"
 		"  --weight       -w weight            capacity of real server\n"
 		"  --u-threshold  -x uthreshold        upper threshold of connections\n"
@@ -1481,7 +1677,10 @@ static void usage_exit(const char *program, const int exit_status)
 		"  --exact                             expand numbers (display exact values)\n"
 		"  --thresholds                        output of thresholds information\n"
 		"  --persistent-conn                   output of persistent connection info\n"
-		"  --sockpair                          output connection info of specified socket pair (proto:sip:sport:tip:tport)"
+		"  --sockpair                          output connection info of specified socket pair (proto:sip:sport:tip:tport)\n"
+		"  --conn-filter  FILTER               output connections matching FILTER only, comma separated\n"
+		"                                      proto=PROTO,vip=ADDR[:PORT],rs=ADDR[:PORT],client=ADDR[/PLEN],\n"
+		"                                      state=STATE,age=SECONDS\n"
 		"  --nosort                            disable sorting output of service/server entries\n"
 		"  --sort                              does nothing, for backwards compatibility\n"
 		"  --ops          -o                   one-packet scheduling\n"
@@ -1578,7 +1777,8 @@ exit:
 		free(dname);
 }
 
-static void list_conn(int is_template, unsigned int format)
+static void list_conn(int is_template, const struct ip_vs_conn_filter *filter,
+		unsigned int format)
 {
     struct ip_vs_conn_array *conn_array;
     struct ip_vs_conn_req req;
@@ -1588,11 +1788,16 @@ static void list_conn(int is_template, unsigned int format)
     if (is_template)
         req.flag |= GET_IPVS_CONN_FLAG_TEMPLATE;
     req.flag |= GET_IPVS_CONN_FLAG_ALL;
+    req.filter = *filter;
 
+    /* entries are streamed chunk by chunk, resume from the cursor
+     * returned by last chunk */
     while((conn_array = ip_vs_get_conns(&req)) != NULL) {
 		for (i = 0; i < conn_array->nconns; i++)
 			print_conn_entry(&conn_array->array[i], format);
         req.whence = conn_array->curcid;
+        req.bucket = conn_array->bucket;
+        req.offset = conn_array->offset;
         more = conn_array->resl & GET_IPVS_CONN_FLAG_MORE;
         free(conn_array);
         if (!more)
@@ -1649,6 +1854,9 @@ static inline char *fwd_name(unsigned flags)
 	case IP_VS_CONN_F_SNAT:
 		fwd = "SNAT";
 		break;
+	case IP_VS_CONN_F_VXLAN:
+		fwd = "Vxlan";
+		break;
 	}
 	return fwd;
 }
@@ -1665,6 +1873,8 @@ static inline char *fwd_switch(unsigned flags)
 	case IP_VS_CONN_F_LOCALNODE:
 	case IP_VS_CONN_F_DROUTE:
 		swt = "-g"; break;
+	case IP_VS_CONN_F_VXLAN:
+		swt = "--vxlan"; break;
 	}
 	return swt;
 }
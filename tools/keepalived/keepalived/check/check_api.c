@@ -237,6 +237,7 @@ register_checkers_thread(void)
 	checker_t *checker;
 	element e;
 	long warmup;
+	int idx = 0, n = LIST_SIZE(checkers_queue);
 
 	for (e = LIST_HEAD(checkers_queue); e; ELEMENT_NEXT(e)) {
 		checker = ELEMENT_DATA(e);
@@ -245,13 +246,11 @@ register_checkers_thread(void)
 		CHECKER_ENABLE(checker);
 		if (checker->launch)
 		{
-			/* wait for a random timeout to begin checker thread.
-			   It helps avoiding multiple simultaneous checks to
-			   the same RS.
+			/* spread checker threads evenly over the warmup
+			   period. It helps avoiding multiple simultaneous
+			   checks to the same RS and bursts of checks.
 			*/
-			warmup = checker->warmup;
-			if (warmup)
-				warmup = warmup * rand() / RAND_MAX;
+			warmup = thread_spread_delay(checker->warmup, idx++, n);
 			thread_add_timer(master, checker->launch, checker,
 					 BOOTSTRAP_DELAY + warmup);
 		}
@@ -50,7 +50,8 @@ extern char *checkers_pidfile;
 static void
 stop_check(void)
 {
-	/* Destroy master thread */
+	/* Push pending IPVS updates, then destroy master thread */
+	ipvs_defer_updates(0);
 	signal_handler_destroy();
 	thread_destroy_master(master);
 	free_checkers_queue();
@@ -122,6 +123,9 @@ start_check(void)
 		return;
 	}
 
+	/* Only push the delta to dpvs rules, in batches */
+	ipvs_reconcile_begin();
+
 	/* Processing differential configuration parsing */
 	if (reload) {
 		clear_diff_services();
@@ -141,6 +145,8 @@ start_check(void)
 		return;
 	}
 
+	ipvs_reconcile_end();
+
 	/* Dump configuration */
 	if (debug & 4) {
 		dump_global_data(global_data);
@@ -154,6 +160,9 @@ start_check(void)
 
 	/* Register checkers thread */
 	register_checkers_thread();
+
+	/* Coalesce IPVS updates of checkers */
+	ipvs_defer_updates(1);
 }
 
 /* Reload handler */
@@ -196,7 +205,8 @@ reload_check_thread(thread_t * thread)
 	signal_reset();
 	signal_handler_destroy();
 
-	/* Destroy master thread */
+	/* Push pending IPVS updates, then destroy master thread */
+	ipvs_defer_updates(0);
 	thread_destroy_master(master);
 	master = thread_make_master();
 	free_global_data(global_data);
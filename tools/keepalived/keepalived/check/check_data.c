@@ -375,6 +375,9 @@ dump_vs(void *data)
 	case IP_VS_CONN_F_SNAT:
 		log_message(LOG_INFO, "   lb_kind = SNAT");
 		break;
+	case IP_VS_CONN_F_VXLAN:
+		log_message(LOG_INFO, "   lb_kind = VXLAN");
+		break;
 #endif
 	}
 
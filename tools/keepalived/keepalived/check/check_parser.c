@@ -120,6 +120,8 @@ lbkind_handler(vector_t *strvec)
 		vs->loadbalancing_kind = IP_VS_CONN_F_FULLNAT;
 	else if (!strcmp(str, "SNAT"))
 		vs->loadbalancing_kind = IP_VS_CONN_F_SNAT;
+	else if (!strcmp(str, "VXLAN"))
+		vs->loadbalancing_kind = IP_VS_CONN_F_VXLAN;
 	else
 		log_message(LOG_INFO, "PARSER : unknown [%s] routing method.", str);
 }
@@ -22,6 +22,7 @@
  */
 
 #include "ipvswrapper.h"
+#include "ipwrapper.h"
 #include "check_data.h"
 #include "list.h"
 #include "utils.h"
@@ -33,6 +34,9 @@ static int parse_timeout(char *, unsigned *);
 static int string_to_number(const char *, int, int);
 static int parse_bps(char *, unsigned *);
 static int parse_limit_proportion(char *, unsigned *);
+#if defined(_KRNL_2_6_) && defined(_WITH_SNMP_)
+static void ipvs_stats_release(void);
+#endif
 
 /* fetch virtual server group from group name */
 virtual_server_group_t *
@@ -403,14 +407,506 @@ ipvs_stop(void)
 	FREE(blklst_rule);
 	FREE(tunnel_rule);
 
+	ipvs_reconcile_end();
+#ifdef _WITH_SNMP_
+	ipvs_stats_release();
+#endif
 	ipvs_close();
 }
 
+/*
+ * Reconciliation with dpvs.
+ *
+ * On startup and reload, the rules dpvs already has are loaded from one
+ * snapshot, and only the delta is pushed: adds of identical rules and
+ * dels of absent ones are dropped, adds of changed rules become edits.
+ * Rule updates are sent in batches, updates made by checkers within one
+ * scheduler loop are coalesced into one batch.
+ */
+#define IPVS_STATE_HASH_MIN	256
+
+typedef struct _ipvs_rule_key {
+	u_int16_t		af;
+	u_int16_t		protocol;
+	union nf_inet_addr	addr;
+	u_int32_t		fwmark;
+	u_int32_t		match;		/* hash of srange/drange/ifnames */
+	u_int16_t		port;
+	u_int16_t		dport;		/* dest part, zero for service */
+	u_int16_t		daf;
+	union nf_inet_addr	daddr;
+} ipvs_rule_key_t;
+
+typedef struct _ipvs_rule {
+	struct _ipvs_rule	*next;		/* hash chain */
+	ipvs_rule_key_t		key;
+	int			live;
+	unsigned		gen;		/* svc: bumped on re-add */
+	struct _ipvs_rule	*svc;		/* dest: its service ... */
+	unsigned		svc_gen;	/* ... and service gen */
+
+	/* attributes compared to find edits */
+	char			sched_name[IP_VS_SCHEDNAME_MAXLEN];
+	unsigned		flags;
+	unsigned		timeout;
+	unsigned		conn_timeout;
+	u_int32_t		netmask;
+	unsigned		bps;
+	unsigned		limit_proportion;
+	unsigned		conn_flags;
+	int			weight;
+	u_int32_t		u_threshold;
+	u_int32_t		l_threshold;
+
+	/* set if built from snapshot */
+	ipvs_service_entry_t	*svc_entry;
+	ipvs_dest_entry_t	*dests;		/* svc: its dests in snapshot */
+} ipvs_rule_t;
+
+typedef struct _ipvs_state {
+	ipvs_rule_t		**hash;
+	unsigned int		size;		/* power of 2 */
+} ipvs_state_t;
+
+/* commands in the open batch, to check their results on commit */
+typedef struct _ipvs_batch_cmd {
+	int			cmd;
+	unsigned int		first;		/* index of its first operation */
+	unsigned int		num;		/* operations sent by the command */
+} ipvs_batch_cmd_t;
+
+#define IPVS_RESYNC_DELAY	(5 * TIMER_HZ)
+
+static ipvs_snapshot_t *ipvs_snap;
+static ipvs_state_t *ipvs_state;	/* dpvs rules, while reconciling */
+static int ipvs_batching;		/* a batch is open */
+static int ipvs_deferred;		/* coalesce updates per loop */
+static int ipvs_resync_pending;		/* resync after failed updates */
+static ipvs_batch_cmd_t *ipvs_batch_cmds;
+static unsigned int ipvs_batch_ncmds;
+static unsigned int ipvs_batch_size;
+
+static u_int32_t
+ipvs_hash(const void *buf, size_t len, u_int32_t hash)
+{
+	const unsigned char *p = buf;
+
+	/* FNV-1a */
+	while (len--)
+		hash = (hash ^ *p++) * 16777619;
+	return hash;
+}
+
+static void
+ipvs_rule_key_svc(ipvs_rule_key_t *key, u_int16_t af, u_int16_t protocol,
+		  const union nf_inet_addr *addr, u_int16_t port,
+		  u_int32_t fwmark, const char *srange, const char *drange,
+		  const char *iifname, const char *oifname)
+{
+	memset(key, 0, sizeof(*key));
+	key->af = af;
+	key->protocol = protocol;
+	memcpy(&key->addr, addr, af == AF_INET6 ? sizeof(key->addr.in6)
+						 : sizeof(key->addr.ip));
+	key->port = port;
+	key->fwmark = fwmark;
+	key->match = 2166136261U;
+	key->match = ipvs_hash(srange, strlen(srange) + 1, key->match);
+	key->match = ipvs_hash(drange, strlen(drange) + 1, key->match);
+	key->match = ipvs_hash(iifname, strlen(iifname) + 1, key->match);
+	key->match = ipvs_hash(oifname, strlen(oifname) + 1, key->match);
+}
+
+#define IPVS_RULE_KEY_SVC(K, S)						\
+	ipvs_rule_key_svc((K), (S)->af, (S)->protocol, &(S)->addr,	\
+			  (S)->port, (S)->fwmark, (S)->srange,		\
+			  (S)->drange, (S)->iifname, (S)->oifname)
+
+static void
+ipvs_rule_key_dest(ipvs_rule_key_t *key, u_int16_t af,
+		   const union nf_inet_addr *addr, u_int16_t port)
+{
+	key->daf = af;
+	memcpy(&key->daddr, addr, af == AF_INET6 ? sizeof(key->daddr.in6)
+						  : sizeof(key->daddr.ip));
+	key->dport = port;
+}
+
+static ipvs_rule_t *
+ipvs_state_lookup(ipvs_state_t *state, const ipvs_rule_key_t *key)
+{
+	ipvs_rule_t *rule;
+	u_int32_t hash = ipvs_hash(key, sizeof(*key), 2166136261U);
+
+	for (rule = state->hash[hash & (state->size - 1)]; rule; rule = rule->next)
+		if (!memcmp(&rule->key, key, sizeof(*key)))
+			return rule;
+	return NULL;
+}
+
+static ipvs_rule_t *
+ipvs_state_add(ipvs_state_t *state, const ipvs_rule_key_t *key)
+{
+	ipvs_rule_t *rule;
+	u_int32_t hash = ipvs_hash(key, sizeof(*key), 2166136261U);
+
+	rule = (ipvs_rule_t *) MALLOC(sizeof(ipvs_rule_t));
+	rule->key = *key;
+	rule->next = state->hash[hash & (state->size - 1)];
+	state->hash[hash & (state->size - 1)] = rule;
+	return rule;
+}
+
+static void
+ipvs_state_free(ipvs_state_t *state)
+{
+	ipvs_rule_t *rule;
+	unsigned int i;
+
+	if (!state)
+		return;
+	for (i = 0; i < state->size; i++) {
+		while ((rule = state->hash[i])) {
+			state->hash[i] = rule->next;
+			FREE(rule);
+		}
+	}
+	FREE(state->hash);
+	FREE(state);
+}
+
+/* Index services and dests of a dpvs snapshot */
+static ipvs_state_t *
+ipvs_state_build(ipvs_snapshot_t *snap)
+{
+	ipvs_state_t *state;
+	ipvs_service_entry_t *se;
+	ipvs_dest_entry_t *de;
+	ipvs_rule_key_t key;
+	ipvs_rule_t *svc, *dest;
+	unsigned int i, j, d = 0;
+
+	state = (ipvs_state_t *) MALLOC(sizeof(ipvs_state_t));
+	state->size = IPVS_STATE_HASH_MIN;
+	while (state->size < 2 * (snap->num_services + snap->num_dests))
+		state->size <<= 1;
+	state->hash = (ipvs_rule_t **) MALLOC(state->size * sizeof(ipvs_rule_t *));
+
+	for (i = 0; i < snap->num_services; i++) {
+		se = &snap->services[i];
+		IPVS_RULE_KEY_SVC(&key, se);
+		svc = ipvs_state_add(state, &key);
+		svc->live = 1;
+		strncpy(svc->sched_name, se->sched_name, IP_VS_SCHEDNAME_MAXLEN);
+		svc->flags = se->flags;
+		svc->timeout = se->timeout;
+		svc->conn_timeout = se->conn_timeout;
+		svc->netmask = se->netmask;
+		svc->bps = se->bps;
+		svc->limit_proportion = se->limit_proportion;
+		svc->svc_entry = se;
+		svc->dests = &snap->dests[d];
+
+		for (j = 0; j < se->num_dests; j++, d++) {
+			de = &snap->dests[d];
+			ipvs_rule_key_dest(&key, de->af, &de->addr, de->port);
+			dest = ipvs_state_add(state, &key);
+			dest->live = 1;
+			dest->svc = svc;
+			dest->conn_flags = de->conn_flags;
+			dest->weight = de->weight;
+			dest->u_threshold = de->u_threshold;
+			dest->l_threshold = de->l_threshold;
+		}
+	}
+
+	return state;
+}
+
+/* all service attributes filled by ipvs_set_rule() but the key */
+static int
+ipvs_svc_changed(ipvs_rule_t *svc)
+{
+	return strncmp(svc->sched_name, srule->sched_name, IP_VS_SCHEDNAME_MAXLEN) ||
+	       (svc->flags & ~IP_VS_SVC_F_HASHED) != (srule->flags & ~IP_VS_SVC_F_HASHED) ||
+	       svc->timeout != srule->timeout ||
+	       svc->conn_timeout != srule->conn_timeout ||
+	       svc->netmask != srule->netmask ||
+	       svc->bps != srule->bps ||
+	       svc->limit_proportion != srule->limit_proportion;
+}
+
+static int
+ipvs_dest_changed(ipvs_rule_t *dest)
+{
+	return (dest->conn_flags & IP_VS_CONN_F_FWD_MASK) !=
+			(drule->conn_flags & IP_VS_CONN_F_FWD_MASK) ||
+	       dest->weight != drule->weight ||
+	       dest->u_threshold != drule->u_threshold ||
+	       dest->l_threshold != drule->l_threshold;
+}
+
+/*
+ * Check a service/dest command against dpvs state and the commands
+ * already pushed. Returns 0 if it's a no-op, or the command to send.
+ */
+static int
+ipvs_state_filter(int cmd)
+{
+	ipvs_rule_key_t key;
+	ipvs_rule_t *svc, *dest;
+	int live;
+
+	IPVS_RULE_KEY_SVC(&key, srule);
+	svc = ipvs_state_lookup(ipvs_state, &key);
+
+	switch (cmd) {
+	case IP_VS_SO_SET_DEL:
+		if (!svc || !svc->live)
+			return 0;
+		svc->live = 0;
+		return cmd;
+	case IP_VS_SO_SET_ADD:
+	case IP_VS_SO_SET_EDIT:
+		if (!svc)
+			svc = ipvs_state_add(ipvs_state, &key);
+		else if (svc->live && !ipvs_svc_changed(svc))
+			return 0;
+		if (svc->live) {
+			cmd = IP_VS_SO_SET_EDIT;
+		} else {
+			cmd = IP_VS_SO_SET_ADD;
+			svc->gen++;
+			svc->live = 1;
+		}
+		strncpy(svc->sched_name, srule->sched_name, IP_VS_SCHEDNAME_MAXLEN);
+		svc->flags = srule->flags;
+		svc->timeout = srule->timeout;
+		svc->conn_timeout = srule->conn_timeout;
+		svc->netmask = srule->netmask;
+		svc->bps = srule->bps;
+		svc->limit_proportion = srule->limit_proportion;
+		return cmd;
+	case IP_VS_SO_SET_ADDDEST:
+	case IP_VS_SO_SET_EDITDEST:
+	case IP_VS_SO_SET_DELDEST:
+		break;
+	default:
+		return cmd;
+	}
+
+	/* unknown service, let dpvs tell */
+	if (!svc)
+		return cmd;
+
+	ipvs_rule_key_dest(&key, drule->af, &drule->addr, drule->port);
+	dest = ipvs_state_lookup(ipvs_state, &key);
+	live = dest && dest->live && svc->live && dest->svc_gen == svc->gen;
+
+	if (cmd == IP_VS_SO_SET_DELDEST) {
+		if (!live)
+			return 0;
+		dest->live = 0;
+		return cmd;
+	}
+
+	if (live && !ipvs_dest_changed(dest))
+		return 0;
+	cmd = live ? IP_VS_SO_SET_EDITDEST : IP_VS_SO_SET_ADDDEST;
+
+	if (!dest)
+		dest = ipvs_state_add(ipvs_state, &key);
+	dest->live = 1;
+	dest->svc = svc;
+	dest->svc_gen = svc->gen;
+	dest->conn_flags = drule->conn_flags;
+	dest->weight = drule->weight;
+	dest->u_threshold = drule->u_threshold;
+	dest->l_threshold = drule->l_threshold;
+	return cmd;
+}
+
+static void
+ipvs_batch_record(int cmd, unsigned int first)
+{
+	unsigned int last = ipvs_batch_count();
+
+	if (last == first)
+		return;
+
+	if (ipvs_batch_ncmds == ipvs_batch_size) {
+		ipvs_batch_size = ipvs_batch_size ? ipvs_batch_size * 2 : 64;
+		ipvs_batch_cmds = (ipvs_batch_cmd_t *)
+			REALLOC(ipvs_batch_cmds, ipvs_batch_size * sizeof(ipvs_batch_cmd_t));
+	}
+	ipvs_batch_cmds[ipvs_batch_ncmds].cmd = cmd;
+	ipvs_batch_cmds[ipvs_batch_ncmds].first = first;
+	ipvs_batch_cmds[ipvs_batch_ncmds].num = last - first;
+	ipvs_batch_ncmds++;
+}
+
+/* same as the errors ignored by ipvs_talk() */
+static int
+ipvs_batch_result_ok(int cmd, int result)
+{
+	switch (cmd) {
+	case IP_VS_SO_SET_ADD:
+	case IP_VS_SO_SET_ADDDEST:
+	case IP_VS_SO_SET_ADDLADDR:
+	case IP_VS_SO_SET_ADDBLKLST:
+	case IP_VS_SO_SET_ADDTUNNEL:
+		return !result || result == EDPVS_EXIST;
+	case IP_VS_SO_SET_DEL:
+	case IP_VS_SO_SET_DELDEST:
+	case IP_VS_SO_SET_DELLADDR:
+	case IP_VS_SO_SET_DELBLKLST:
+	case IP_VS_SO_SET_DELTUNNEL:
+		return !result || result == EDPVS_NOTEXIST;
+	default:
+		return !result;
+	}
+}
+
+static int
+ipvs_resync_thread(thread_t * thread)
+{
+	log_message(LOG_INFO, "IPVS: resyncing rules with dpvs");
+
+	ipvs_reconcile_begin();
+	init_tunnel();
+	sync_services();
+	ipvs_reconcile_end();
+	return 0;
+}
+
+/*
+ * Checkers take a command as done once queued, so dpvs is resynced with
+ * the current states if any command of the batch failed.
+ */
+static void
+ipvs_resync_schedule(void)
+{
+	if (ipvs_resync_pending)
+		return;
+
+	ipvs_resync_pending = 1;
+	thread_add_timer(master, ipvs_resync_thread, NULL, IPVS_RESYNC_DELAY);
+}
+
+static void
+ipvs_batch_flush(void)
+{
+	ipvs_batch_cmd_t *bc;
+	unsigned int i, j;
+	int failed = 0, result;
+
+	if (!ipvs_batching)
+		return;
+
+	ipvs_batching = 0;
+	if (ipvs_batch_commit()) {
+		log_message(LOG_INFO, "IPVS: batch of rule updates failed: %s"
+				    , ipvs_strerror(errno));
+		failed = 1;
+	}
+
+	for (i = 0; i < ipvs_batch_ncmds && !failed; i++) {
+		bc = &ipvs_batch_cmds[i];
+		for (j = 0; j < bc->num; j++) {
+			result = ipvs_batch_result(bc->first + j);
+			if (ipvs_batch_result_ok(bc->cmd, result))
+				continue;
+			log_message(LOG_INFO, "IPVS: command %d of batch failed: %d"
+					    , bc->cmd, result);
+			failed = 1;
+			break;
+		}
+	}
+	ipvs_batch_ncmds = 0;
+
+	if (failed)
+		ipvs_resync_schedule();
+}
+
+static int
+ipvs_batch_thread(thread_t * thread)
+{
+	ipvs_batch_flush();
+	return 0;
+}
+
+/* Following rule updates go to the current batch */
+static void
+ipvs_batch_open(void)
+{
+	if (ipvs_batching)
+		return;
+
+	if (ipvs_batch_begin(IPVS_BATCH_CONTINUE | IPVS_BATCH_RESULTS)) {
+		log_message(LOG_INFO, "IPVS: can't begin batch: %s"
+				    , ipvs_strerror(errno));
+		return;
+	}
+	ipvs_batching = 1;
+	ipvs_batch_ncmds = 0;
+
+	/* pushed once threads ready in this loop are done */
+	if (!ipvs_state)
+		thread_add_timer(master, ipvs_batch_thread, NULL, 0);
+}
+
+/* Load dpvs rules, following commands push only the delta */
+void
+ipvs_reconcile_begin(void)
+{
+	/* a reconcile is a resync */
+	ipvs_resync_pending = 0;
+	ipvs_batch_flush();
+
+	ipvs_snap = ipvs_get_snapshot();
+	if (ipvs_snap)
+		ipvs_state = ipvs_state_build(ipvs_snap);
+	else
+		log_message(LOG_INFO, "IPVS: can't get rules snapshot, pushing all: %s"
+				    , ipvs_strerror(errno));
+
+	ipvs_batch_open();
+}
+
+void
+ipvs_reconcile_end(void)
+{
+	ipvs_batch_flush();
+	ipvs_state_free(ipvs_state);
+	ipvs_state = NULL;
+	if (ipvs_snap)
+		ipvs_free_snapshot(ipvs_snap);
+	ipvs_snap = NULL;
+}
+
+/* Coalesce rule updates of one scheduler loop, pending ones are pushed
+ * when disabled. */
+void
+ipvs_defer_updates(int enable)
+{
+	ipvs_deferred = enable;
+	if (!enable)
+		ipvs_batch_flush();
+}
+
 /* Send user rules to IPVS module */
 static int
 ipvs_talk(int cmd)
 {
 	int result = -1;
+	unsigned int first = 0;
+
+	if (ipvs_state && !(cmd = ipvs_state_filter(cmd)))
+		return IPVS_SUCCESS;
+	if (ipvs_state || ipvs_deferred)
+		ipvs_batch_open();
+	if (ipvs_batching)
+		first = ipvs_batch_count();
 
 	switch (cmd) {
 		case IP_VS_SO_SET_STARTDAEMON:
@@ -462,6 +958,10 @@ ipvs_talk(int cmd)
 			break;
 	}
 
+	/* result of queued commands is checked on commit */
+	if (ipvs_batching)
+		ipvs_batch_record(cmd, first);
+
 	if (result) {
 		if (result == EDPVS_EXIST && (cmd == IP_VS_SO_SET_ADD || cmd == IP_VS_SO_SET_ADDDEST))
 			result = 0;
@@ -1347,6 +1847,49 @@ ipvs_group_remove_entry(virtual_server_t *vs, virtual_server_group_entry_t *vsge
 }
 
 #ifdef _WITH_SNMP_
+/* Stats of all services and dests, refreshed by one request at most
+   every STATS_REFRESH seconds */
+static ipvs_snapshot_t *stats_snap;
+static ipvs_state_t *stats_state;
+static time_t stats_lastupdated;
+
+static ipvs_service_entry_t *
+ipvs_stats_get_service(u_int32_t fwmark, u_int16_t af, u_int16_t protocol,
+		       union nf_inet_addr addr, u_int16_t port,
+		       ipvs_dest_entry_t **dests)
+{
+	ipvs_rule_key_t key;
+	ipvs_rule_t *svc;
+
+	if (!stats_state || time(NULL) - stats_lastupdated >= STATS_REFRESH) {
+		ipvs_stats_release();
+		stats_snap = ipvs_get_snapshot();
+		if (stats_snap)
+			stats_state = ipvs_state_build(stats_snap);
+		stats_lastupdated = time(NULL);
+	}
+	if (!stats_state)
+		return NULL;
+
+	ipvs_rule_key_svc(&key, af, protocol, &addr, port, fwmark, "", "", "", "");
+	svc = ipvs_state_lookup(stats_state, &key);
+	if (!svc)
+		return NULL;
+
+	*dests = svc->dests;
+	return svc->svc_entry;
+}
+
+static void
+ipvs_stats_release(void)
+{
+	ipvs_state_free(stats_state);
+	stats_state = NULL;
+	if (stats_snap)
+		ipvs_free_snapshot(stats_snap);
+	stats_snap = NULL;
+}
+
 /* Update statistics for a given virtual server. This includes
    statistics of real servers. The update is only done if we need
    refreshing. */
@@ -1360,7 +1903,7 @@ ipvs_update_stats(virtual_server_t *vs)
 	uint32_t addr_ip = 0;
 	union nf_inet_addr nfaddr;
 	ipvs_service_entry_t * serv = NULL;
-	struct ip_vs_get_dests * dests = NULL;
+	ipvs_dest_entry_t * dests = NULL;
 	int i;
 #define UPDATE_STATS_INIT 1
 #define UPDATE_STATS_VSG_IP 2
@@ -1410,21 +1953,23 @@ ipvs_update_stats(virtual_server_t *vs)
 			state = UPDATE_STATS_END;
 			if (vs->vfwmark) {
 				memset(&nfaddr, 0, sizeof(nfaddr));
-				serv = ipvs_get_service(vs->vfwmark,
+				serv = ipvs_stats_get_service(vs->vfwmark,
 							AF_INET,
 							vs->service_type,
-							nfaddr, 0);
+							nfaddr, 0,
+							&dests);
 				break;
 			}
 			memcpy(&nfaddr, (vs->addr.ss_family == AF_INET6)?
 			       (void*)(&((struct sockaddr_in6 *)&vs->addr)->sin6_addr):
 			       (void*)(&((struct sockaddr_in *)&vs->addr)->sin_addr),
 			       sizeof(nfaddr));
-			serv = ipvs_get_service(0,
+			serv = ipvs_stats_get_service(0,
 						vs->addr.ss_family,
 						vs->service_type,
 						nfaddr,
-						inet_sockaddrport(&vs->addr));
+						inet_sockaddrport(&vs->addr),
+						&dests);
 			break;
 		case UPDATE_STATS_VSG_IP:
 			if (!ge)
@@ -1440,11 +1985,12 @@ ipvs_update_stats(virtual_server_t *vs)
 			       (void*)(&((struct sockaddr_in6 *)&vsg_entry->addr)->sin6_addr):
 			       (void*)(&((struct sockaddr_in *)&vsg_entry->addr)->sin_addr),
 			       sizeof(nfaddr));
-			serv = ipvs_get_service(0,
+			serv = ipvs_stats_get_service(0,
 						vsg_entry->addr.ss_family,
 						vs->service_type,
 						nfaddr,
-						inet_sockaddrport(&vsg_entry->addr));
+						inet_sockaddrport(&vsg_entry->addr),
+						&dests);
 			break;
 		case UPDATE_STATS_VSG_FWMARK:
 			if (!ge)
@@ -1457,10 +2003,11 @@ ipvs_update_stats(virtual_server_t *vs)
 			}
 			vsg_entry = ELEMENT_DATA(ge);
 			memset(&nfaddr, 0, sizeof(nfaddr));
-			serv = ipvs_get_service(vsg_entry->vfwmark,
+			serv = ipvs_stats_get_service(vsg_entry->vfwmark,
 						AF_INET,
 						vs->service_type,
-						nfaddr, 0);
+						nfaddr, 0,
+						&dests);
 			break;
 		case UPDATE_STATS_VSG_RANGE:
 			if (!ge)
@@ -1488,11 +2035,12 @@ ipvs_update_stats(virtual_server_t *vs)
 			} else {
 				nfaddr.in.s_addr = addr_ip;
 			}
-			serv = ipvs_get_service(0,
+			serv = ipvs_stats_get_service(0,
 						vsg_entry->addr.ss_family,
 						vs->service_type,
 						nfaddr,
-						inet_sockaddrport(&vsg_entry->addr));
+						inet_sockaddrport(&vsg_entry->addr),
+						&dests);
 			addr_ip += 0x01000000;
 			break;
 		}
@@ -1513,26 +2061,21 @@ ipvs_update_stats(virtual_server_t *vs)
 		ADD_TO_VSSTATS(outbps);
 
 		/* Get real servers */
-		dests = ipvs_get_dests(serv);
-		if (!dests) {
-			FREE(serv);
-			return;
-		}
-		for (i = 0; i < dests->num_dests; i++) {
+		for (i = 0; i < serv->num_dests; i++) {
 			rs = NULL;
 
 #define VSD_EQUAL(entity) (((entity)->addr.ss_family == AF_INET &&	\
-			    dests->entrytable[i].af == AF_INET &&	\
+			    dests[i].af == AF_INET &&	\
 			    inaddr_equal(AF_INET,			\
-					 &dests->entrytable[i].addr,    \
+					 &dests[i].addr,    \
 					 &((struct sockaddr_in *)&(entity)->addr)->sin_addr) &&	\
-			    dests->entrytable[i].port == ((struct sockaddr_in *)&(entity)->addr)->sin_port) || \
+			    dests[i].port == ((struct sockaddr_in *)&(entity)->addr)->sin_port) || \
 			    ((entity)->addr.ss_family == AF_INET6 &&	\
-			    dests->entrytable[i].af == AF_INET6 &&	\
+			    dests[i].af == AF_INET6 &&	\
 			    inaddr_equal(AF_INET6,			\
-					 &dests->entrytable[i].addr,	\
+					 &dests[i].addr,	\
 					 &((struct sockaddr_in6 *)&(entity)->addr)->sin6_addr) &&	\
-			    dests->entrytable[i].port == ((struct sockaddr_in6 *)&(entity)->addr)->sin6_port))
+			    dests[i].port == ((struct sockaddr_in6 *)&(entity)->addr)->sin6_port))
 			/* Is it the sorry server? */
 			if (vs->s_svr && VSD_EQUAL(vs->s_svr))
 				rs = vs->s_svr;
@@ -1544,7 +2087,7 @@ ipvs_update_stats(virtual_server_t *vs)
 						break;
 				}
 			if (rs) {
-#define ADD_TO_RSSTATS(X) rs->X += dests->entrytable[i].X
+#define ADD_TO_RSSTATS(X) rs->X += dests[i].X
 				ADD_TO_RSSTATS(activeconns);
 				ADD_TO_RSSTATS(inactconns);
 				ADD_TO_RSSTATS(persistconns);
@@ -1560,8 +2103,6 @@ ipvs_update_stats(virtual_server_t *vs)
 				ADD_TO_RSSTATS(stats.outbps);
 			}
 		}
-		FREE(dests);
-		FREE(serv);
 	}
 }
 #endif /* _WITH_SNMP_ */
@@ -241,6 +241,89 @@ init_services(void)
 	return 1;
 }
 
+/* clear alive flags of the group entries, see IPVS_ALIVE */
+static void
+unset_vsg_alive(virtual_server_t * vs)
+{
+	virtual_server_group_t *vsg;
+	element e;
+
+	vsg = ipvs_get_group_by_name(vs->vsgname, check_data->vs_group);
+	if (!vsg)
+		return;
+
+	for (e = LIST_HEAD(vsg->addr_ip); e; ELEMENT_NEXT(e))
+		UNSET_ALIVE((virtual_server_group_entry_t *) ELEMENT_DATA(e));
+	for (e = LIST_HEAD(vsg->vfwmark); e; ELEMENT_NEXT(e))
+		UNSET_ALIVE((virtual_server_group_entry_t *) ELEMENT_DATA(e));
+	for (e = LIST_HEAD(vsg->range); e; ELEMENT_NEXT(e))
+		UNSET_ALIVE((virtual_server_group_entry_t *) ELEMENT_DATA(e));
+}
+
+/* Push a realserver rule as @in_pool, states are unchanged */
+static void
+sync_service_rs(virtual_server_t * vs, real_server_t * rs, int in_pool)
+{
+	int alive = rs->alive;
+
+	/* inhibited server never added */
+	if (!in_pool && rs->inhibit && !rs->set)
+		return;
+
+	/* let group commands pass, see IPVS_ALIVE */
+	rs->alive = !in_pool;
+	ipvs_cmd(in_pool ? LVS_CMD_ADD_DEST : LVS_CMD_DEL_DEST,
+		 check_data->vs_group, vs, rs);
+	rs->alive = alive;
+}
+
+static void
+sync_service_vs(virtual_server_t * vs)
+{
+	int sorry = vs->s_svr && ISALIVE(vs->s_svr);
+	element e;
+
+	if (vs->vsgname)
+		unset_vsg_alive(vs);
+	ipvs_cmd(LVS_CMD_ADD, check_data->vs_group, vs, NULL);
+
+	if (vs->local_addr_gname &&
+	    (vs->loadbalancing_kind == IP_VS_CONN_F_FULLNAT ||
+	     vs->loadbalancing_kind == IP_VS_CONN_F_SNAT))
+		ipvs_cmd(LVS_CMD_ADD_LADDR, check_data->vs_group, vs, NULL);
+	if (vs->blklst_addr_gname)
+		ipvs_cmd(LVS_CMD_ADD_BLKLST, check_data->vs_group, vs, NULL);
+
+	/* alive servers are out of the pool while the sorry server is in */
+	if (!LIST_ISEMPTY(vs->rs)) {
+		for (e = LIST_HEAD(vs->rs); e; ELEMENT_NEXT(e))
+			sync_service_rs(vs, ELEMENT_DATA(e),
+					ISALIVE((real_server_t *) ELEMENT_DATA(e)) && !sorry);
+	}
+	if (vs->s_svr)
+		sync_service_rs(vs, vs->s_svr, sorry);
+}
+
+/*
+ * Push IPVS rules of current states, without changing them. Called
+ * between ipvs_reconcile_begin/end, so only the delta goes to dpvs.
+ */
+void
+sync_services(void)
+{
+	element e;
+	virtual_server_t *vs;
+
+	if (LIST_ISEMPTY(check_data->vs))
+		return;
+
+	for (e = LIST_HEAD(check_data->vs); e; ELEMENT_NEXT(e)) {
+		vs = ELEMENT_DATA(e);
+		if (ISALIVE(vs))
+			sync_service_vs(vs);
+	}
+}
+
 static int init_tunnel_entry(tunnel_entry *entry)
 {
 	return ipvs_tunnel_cmd(LVS_CMD_ADD_TUNNEL, entry);
@@ -25,6 +25,7 @@
 #include "signals.h"
 #include "pidfile.h"
 #include "logger.h"
+#include "sched_bench.h"
 
 /* global var */
 char *conf_file = NULL;		/* Configuration file */
@@ -146,6 +147,7 @@ usage(const char *prog)
 	fprintf(stderr, "  -p, --pid=FILE               Use specified pidfile for parent process\n");
 	fprintf(stderr, "  -r, --vrrp_pid=FILE          Use specified pidfile for VRRP child process\n");
 	fprintf(stderr, "  -c, --checkers_pid=FILE      Use specified pidfile for checkers child process\n");
+	fprintf(stderr, "  -B, --sched-bench=N          Benchmark scheduler with N checks to local servers\n");
 #ifdef _WITH_SNMP_
 	fprintf(stderr, "  -x, --snmp                   Enable SNMP subsystem\n");
 #endif
@@ -174,6 +176,7 @@ parse_cmdline(int argc, char **argv)
 		{"pid",               required_argument, 0, 'p'},
 		{"vrrp_pid",          required_argument, 0, 'r'},
 		{"checkers_pid",      required_argument, 0, 'c'},
+		{"sched-bench",       required_argument, 0, 'B'},
  #ifdef _WITH_SNMP_
 		{"snmp",              no_argument,       0, 'x'},
  #endif
@@ -183,9 +186,9 @@ parse_cmdline(int argc, char **argv)
 	};
 
 #ifdef _WITH_SNMP_
-	while ((c = getopt_long(argc, argv, "vhlndVIDRS:f:PCp:c:r:x", long_options, NULL)) != EOF) {
+	while ((c = getopt_long(argc, argv, "vhlndVIDRS:f:PCp:c:r:B:x", long_options, NULL)) != EOF) {
 #else
-	while ((c = getopt_long(argc, argv, "vhlndVIDRS:f:PCp:c:r:", long_options, NULL)) != EOF) {
+	while ((c = getopt_long(argc, argv, "vhlndVIDRS:f:PCp:c:r:B:", long_options, NULL)) != EOF) {
 #endif
 		switch (c) {
 		case 'v':
@@ -238,6 +241,9 @@ parse_cmdline(int argc, char **argv)
 		case 'r':
 			vrrp_pidfile = optarg;
 			break;
+		case 'B':
+			exit(sched_benchmark(atoi(optarg), SCHED_BENCH_DURATION) ? 1 : 0);
+			break;
 #ifdef _WITH_SNMP_
 		case 'x':
 			snmp = 1;
@@ -102,6 +102,9 @@ extern int ipvs_syncd_cmd(int, char *, int, int);
 extern void ipvs_syncd_master(char *, int);
 extern void ipvs_syncd_backup(char *, int);
 extern int ipvs_tunnel_cmd(int cmd, tunnel_entry *entry);
+extern void ipvs_reconcile_begin(void);
+extern void ipvs_reconcile_end(void);
+extern void ipvs_defer_updates(int);
 
 #ifdef _KRNL_2_6_
 /* Refresh statistics at most every 5 seconds */
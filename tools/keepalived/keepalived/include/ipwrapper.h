@@ -60,6 +60,7 @@ extern void update_svr_wgt(int, virtual_server_t *, real_server_t *);
 extern int svr_checker_up(checker_id_t, real_server_t *);
 extern void update_svr_checker_state(int, checker_id_t, virtual_server_t *, real_server_t *);
 extern int init_services(void);
+extern void sync_services(void);
 extern int clear_services(void);
 extern int clear_diff_services(void);
 extern int copy_srv_states(void);
@@ -8,6 +8,7 @@
 #include "conf/laddr.h"
 #include "conf/blklst.h"
 #include "conf/conn.h"
+#include "conf/sync.h"
 #include "ip_tunnel.h"
 #include "ipvs/service.h"
 #include "ipvs/dest.h"
@@ -30,6 +31,7 @@ enum{
     DPVS_SO_GET_SERVICES,
     DPVS_SO_GET_SERVICE,
     DPVS_SO_GET_DESTS,
+    DPVS_SO_GET_SNAPSHOT,
 };
 
 #endif
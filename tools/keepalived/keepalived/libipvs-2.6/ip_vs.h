@@ -109,6 +109,7 @@
 #define IP_VS_CONN_F_BYPASS	0x0004		/* cache bypass */
 #define IP_VS_CONN_F_FULLNAT	0x0005		/* full nat mode */
 #define IP_VS_CONN_F_SNAT	0x0006		/* SNAT mode */
+#define IP_VS_CONN_F_VXLAN	0x0007		/* VXLAN encapsulation */
 
 #define IP_VS_CONN_F_SYNC	0x0020		/* entry created by sync */
 #define IP_VS_CONN_F_HASHED	0x0040		/* hashed entry */
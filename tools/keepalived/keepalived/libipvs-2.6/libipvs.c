@@ -462,20 +462,34 @@ int ipvs_set_timeout(ipvs_timeout_t *to)
 }
 
 
+static void ipvs_fill_sync_daemon_conf(const ipvs_daemon_t *dm,
+				       struct dp_vs_sync_daemon_conf *conf)
+{
+	memset(conf, 0, sizeof(*conf));
+	conf->state = dm->state;
+	conf->syncid = dm->syncid;
+	strncpy(conf->mcast_ifn, dm->mcast_ifn, sizeof(conf->mcast_ifn) - 1);
+}
+
 int ipvs_start_daemon(ipvs_daemon_t *dm)
 {
+	struct dp_vs_sync_daemon_conf conf;
+
 	ipvs_func = ipvs_start_daemon;
-	return setsockopt(sockfd, IPPROTO_IP, IP_VS_SO_SET_STARTDAEMON,
-			  (char *)dm, sizeof(*dm));
+	ipvs_fill_sync_daemon_conf(dm, &conf);
+
+	return dpvs_setsockopt(SOCKOPT_SET_SYNC_START, &conf, sizeof(conf));
 }
 
 
 int ipvs_stop_daemon(ipvs_daemon_t *dm)
 {
+	struct dp_vs_sync_daemon_conf conf;
+
 	ipvs_func = ipvs_stop_daemon;
+	ipvs_fill_sync_daemon_conf(dm, &conf);
 
-	return setsockopt(sockfd, IPPROTO_IP, IP_VS_SO_SET_STOPDAEMON,
-			  (char *)dm, sizeof(*dm));
+	return dpvs_setsockopt(SOCKOPT_SET_SYNC_STOP, &conf, sizeof(conf));
 }
 
 
@@ -894,27 +908,145 @@ ipvs_timeout_t *ipvs_get_timeout(void)
 ipvs_daemon_t *ipvs_get_daemon(void)
 {
 	ipvs_daemon_t *u;
-	socklen_t len;
+	struct dp_vs_sync_show *show;
+	size_t len;
+	int i;
 
 	/* note that we need to get the info about two possible
 	   daemons, master and backup. */
-	len = sizeof(*u) * 2;
-	if (!(u = malloc(len)))
+	if (!(u = calloc(2, sizeof(*u))))
 		return NULL;
 
 	ipvs_func = ipvs_get_daemon;
-	if (getsockopt(sockfd, IPPROTO_IP, IP_VS_SO_GET_DAEMON, (char *)u, &len)) {
+	if (dpvs_getsockopt(SOCKOPT_GET_SYNC_SHOW, NULL, 0,
+			    (void **)&show, &len)) {
 		free(u);
 		return NULL;
 	}
-	//return u;
-    return NULL;
+	if (len < sizeof(*show)) {
+		dpvs_sockopt_msg_free(show);
+		free(u);
+		return NULL;
+	}
+
+	for (i = 0; i < 2; i++) {
+		u[i].state = show->daemons[i].state;
+		u[i].syncid = show->daemons[i].syncid;
+		strncpy(u[i].mcast_ifn, show->daemons[i].mcast_ifn,
+			sizeof(u[i].mcast_ifn) - 1);
+	}
+	dpvs_sockopt_msg_free(show);
+
+	return u;
 }
 
 
 void ipvs_close(void)
 {
-    //close(sockfd);
+    dpvs_sockopt_close();
+}
+
+
+int ipvs_batch_begin(int flags)
+{
+	uint32_t f = 0;
+
+	if (flags & IPVS_BATCH_ATOMIC)
+		f |= DPVS_SOCK_BATCH_F_ATOMIC;
+	if (flags & IPVS_BATCH_CONTINUE)
+		f |= DPVS_SOCK_BATCH_F_CONTINUE;
+	if (flags & IPVS_BATCH_RESULTS)
+		f |= DPVS_SOCK_BATCH_F_RESULTS;
+	return dpvs_sockopt_batch_begin(f);
+}
+
+
+int ipvs_batch_commit(void)
+{
+	return dpvs_sockopt_batch_commit();
+}
+
+
+unsigned int ipvs_batch_count(void)
+{
+	return dpvs_sockopt_batch_count();
+}
+
+
+int ipvs_batch_result(unsigned int idx)
+{
+	return dpvs_sockopt_batch_result(idx);
+}
+
+
+ipvs_snapshot_t *ipvs_get_snapshot(void)
+{
+	ipvs_snapshot_t *snap;
+	struct dp_vs_get_snapshot *rcv;
+	struct dp_vs_service_entry *dpvs_svc;
+	struct dp_vs_dest_entry *dpvs_dest;
+	ipvs_service_entry_t *svc;
+	ipvs_dest_entry_t *dest;
+	size_t len_rcv = 0, off;
+	unsigned int i, j, d = 0;
+
+	if (dpvs_getsockopt(DPVS_SO_GET_SNAPSHOT, NULL, 0, (void **)&rcv, &len_rcv))
+		return NULL;
+	if (len_rcv < sizeof(*rcv) ||
+	    len_rcv != sizeof(*rcv) + rcv->num_services * sizeof(*dpvs_svc) +
+		       rcv->num_dests * sizeof(*dpvs_dest)) {
+		errno = EINVAL;
+		dpvs_sockopt_msg_free(rcv);
+		return NULL;
+	}
+
+	snap = calloc(1, sizeof(*snap) + rcv->num_services * sizeof(*svc) +
+			 rcv->num_dests * sizeof(*dest));
+	if (!snap) {
+		dpvs_sockopt_msg_free(rcv);
+		return NULL;
+	}
+	snap->num_services = rcv->num_services;
+	snap->num_dests = rcv->num_dests;
+	snap->services = (ipvs_service_entry_t *)(snap + 1);
+	snap->dests = (ipvs_dest_entry_t *)(snap->services + snap->num_services);
+
+	off = sizeof(*rcv);
+	for (i = 0; i < rcv->num_services; i++) {
+		dpvs_svc = (struct dp_vs_service_entry *)((char *)rcv + off);
+		off += sizeof(*dpvs_svc);
+		if (d + dpvs_svc->num_dests > rcv->num_dests) {
+			errno = EINVAL;
+			ipvs_free_snapshot(snap);
+			dpvs_sockopt_msg_free(rcv);
+			return NULL;
+		}
+
+		svc = &snap->services[i];
+		DPVS_2_IPVS(svc, dpvs_svc);
+		if (svc->af == AF_INET) {
+			svc->__addr_v4 = svc->addr.ip;
+			svc->pe_name[0] = '\0';
+		}
+
+		for (j = 0; j < dpvs_svc->num_dests; j++, d++) {
+			dpvs_dest = (struct dp_vs_dest_entry *)((char *)rcv + off);
+			off += sizeof(*dpvs_dest);
+			dest = &snap->dests[d];
+			DPRS_2_IPRS(dest, dpvs_dest);
+			if (dest->af == AF_INET)
+				dest->__addr_v4 = dest->addr.ip;
+		}
+	}
+
+	dpvs_sockopt_msg_free(rcv);
+	return snap;
+}
+
+
+void ipvs_free_snapshot(ipvs_snapshot_t *snap)
+{
+	free(snap);
 }
 
 
@@ -179,6 +179,29 @@ extern ipvs_daemon_t *ipvs_get_daemon(void);
 /* close the socket */
 extern void ipvs_close(void);
 
+/* send the following set operations to dpvs as one batch */
+#define IPVS_BATCH_ATOMIC	0x1	/* roll back applied adds if any fails */
+#define IPVS_BATCH_CONTINUE	0x2	/* apply the rest if any fails */
+#define IPVS_BATCH_RESULTS	0x4	/* keep result of each operation */
+extern int ipvs_batch_begin(int flags);
+extern int ipvs_batch_commit(void);
+/* operations queued since begin, and result of the idx-th after commit */
+extern unsigned int ipvs_batch_count(void);
+extern int ipvs_batch_result(unsigned int idx);
+
+/* all services with their dests and stats, fetched by one request.
+ * dests of services[i] are services[i].num_dests entries of dests,
+ * following those of services[0..i-1]. */
+typedef struct ip_vs_snapshot {
+	unsigned int		num_services;
+	unsigned int		num_dests;
+	ipvs_service_entry_t	*services;
+	ipvs_dest_entry_t	*dests;
+} ipvs_snapshot_t;
+
+extern ipvs_snapshot_t *ipvs_get_snapshot(void);
+extern void ipvs_free_snapshot(ipvs_snapshot_t *snap);
+
 extern const char *ipvs_strerror(int err);
 
 extern int ipvs_send_gratuitous_arp(struct in_addr *in);
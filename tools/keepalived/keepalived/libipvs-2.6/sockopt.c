@@ -107,130 +107,324 @@ static inline int sockopt_msg_recv(int clt_fd, struct dpvs_sock_msg_reply *reply
     return ESOCKOPT_OK;
 }
 
-int dpvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len)
+/*
+ * the connection is kept and reused by the following requests of the
+ * process, a forked child doesn't share it with its parent.
+ */
+static pthread_mutex_t sockopt_lock = PTHREAD_MUTEX_INITIALIZER;
+static int sockopt_fd = -1;
+static pid_t sockopt_pid;
+
+/* pending set messages of current batch */
+static struct {
+    int         active;
+    uint32_t    flags;
+    uint32_t    count;
+    char       *buf;    /* struct dpvs_sock_batch and entries */
+    size_t      len;
+    size_t      size;
+    uint32_t    total;  /* entries since begin */
+    int32_t    *results;/* DPVS_SOCK_BATCH_F_RESULTS, of @total entries */
+    uint32_t    nres;
+    uint32_t    res_size;
+} sockopt_batch;
+
+static void sockopt_disconnect(void)
+{
+    if (sockopt_fd >= 0)
+        close(sockopt_fd);
+    sockopt_fd = -1;
+}
+
+static int sockopt_connect(void)
 {
-    struct dpvs_sock_msg *msg;
-    struct dpvs_sock_msg_reply reply_hdr;
     struct sockaddr_un clt_addr;
     int clt_fd;
-    int res;
-    size_t msg_len;
+
+    if (sockopt_fd >= 0) {
+        if (sockopt_pid == getpid())
+            return sockopt_fd;
+        sockopt_disconnect(); /* inherited from parent */
+    }
 
     memset(&clt_addr, 0, sizeof(struct sockaddr_un));
     clt_addr.sun_family = AF_UNIX;
     strncpy(clt_addr.sun_path, UNIX_DOMAIN, sizeof(clt_addr.sun_path) - 1);
 
-    msg_len = sizeof(struct dpvs_sock_msg);
-    msg = malloc(msg_len);
-    if (NULL == msg) {
-        fprintf(stderr, "[%s] no memory\n", __func__);
-        return -ESOCKOPT_INVAL;
+    clt_fd = socket(PF_UNIX, SOCK_STREAM, 0);
+    if (clt_fd < 0) {
+        fprintf(stderr, "[%s] scoket create error: %s\n",
+                __func__, strerror(errno));
+        return -ESOCKOPT_IO;
     }
 
-    clt_fd = socket(PF_UNIX, SOCK_STREAM, 0);
-    res = connect(clt_fd, (struct sockaddr *)&clt_addr, sizeof(clt_addr));
-    if (-1 == res) {
+    if (-1 == connect(clt_fd, (struct sockaddr *)&clt_addr, sizeof(clt_addr))) {
         fprintf(stderr, "[%s] scoket msg connection error: %s\n",
                 __func__, strerror(errno));
-        free(msg);
+        close(clt_fd);
         return -ESOCKOPT_IO;
     }
 
-    memset(msg, 0, msg_len);
-    msg->version = SOCKOPT_VERSION;
-    msg->id = cmd;
-    msg->type = SOCKOPT_SET;
-    msg->len = in_len;
-    res = sockopt_msg_send(clt_fd, msg, in, in_len);
+    sockopt_fd = clt_fd;
+    sockopt_pid = getpid();
+    return clt_fd;
+}
 
-    free(msg);
-    msg = NULL;
+/* caller holds sockopt_lock */
+static int __sockopt_request(enum sockopt_type type, sockoptid_t cmd,
+        const void *in, size_t in_len, void **out, size_t *out_len)
+{
+    struct dpvs_sock_msg msg;
+    struct dpvs_sock_msg_reply reply_hdr;
+    int clt_fd, res, retry;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.version = SOCKOPT_VERSION;
+    msg.id = cmd;
+    msg.type = type;
+    msg.len = in_len;
+
+    /* a kept connection may be closed by server meanwhile, retry once
+     * with a new connection if nothing was received. */
+    for (retry = 0; retry < 2; retry++) {
+        clt_fd = sockopt_connect();
+        if (clt_fd < 0)
+            return clt_fd;
+
+        res = sockopt_msg_send(clt_fd, &msg, in, in_len);
+        if (res == -ESOCKOPT_IO) {
+            sockopt_disconnect();
+            continue;
+        }
+        if (res)
+            return res;
 
-    if (res) {
-        close(clt_fd);
-        return res;
-    }
+        res = sockopt_msg_recv(clt_fd, &reply_hdr, out, out_len);
+        if (res == -ESOCKOPT_IO || res == -ESOCKOPT_VERSION ||
+                res == -ESOCKOPT_NOMEM)
+            sockopt_disconnect(); /* stream is out of sync */
+        if (res)
+            return res;
 
-    res = sockopt_msg_recv(clt_fd, &reply_hdr, NULL, NULL);
-    if (res) {
-        close(clt_fd);
-        return res;
+        return ESOCKOPT_OK;
     }
 
-    if (reply_hdr.errcode) {
-        fprintf(stderr, "[%s] Server error: %s\n", __func__, reply_hdr.errstr);
-        close(clt_fd);
-        return reply_hdr.errcode;
+    return -ESOCKOPT_IO;
+}
+
+/* save results of the chunk sent, or @err for all its entries */
+static void sockopt_batch_save_results(const int32_t *results, int err)
+{
+    uint32_t i, count = sockopt_batch.count;
+    int32_t *buf;
+
+    if (sockopt_batch.nres + count > sockopt_batch.res_size) {
+        buf = realloc(sockopt_batch.results,
+                      (sockopt_batch.nres + count) * 2 * sizeof(int32_t));
+        if (!buf) {
+            fprintf(stderr, "[%s] no memory\n", __func__);
+            return; /* taken as failed, see dpvs_sockopt_batch_result */
+        }
+        sockopt_batch.results = buf;
+        sockopt_batch.res_size = (sockopt_batch.nres + count) * 2;
     }
 
-    close(clt_fd);
-    return ESOCKOPT_OK;
+    for (i = 0; i < count; i++)
+        sockopt_batch.results[sockopt_batch.nres++] = results ? results[i] : err;
 }
 
-int dpvs_getsockopt(sockoptid_t cmd, const void *in, size_t in_len,
-        void **out, size_t *out_len)
+static int sockopt_batch_flush(void)
 {
-    struct dpvs_sock_msg *msg;
-    struct dpvs_sock_msg_reply reply_hdr;
-    struct sockaddr_un clt_addr;
-    int clt_fd;
+    struct dpvs_sock_batch *batch;
+    void *out = NULL;
+    size_t out_len = 0;
     int res;
-    size_t msg_len;
 
-    if (NULL == out || NULL == out_len) {
-        fprintf(stderr, "[%s] no pointer for info return\n", __func__);
-        return -1;
+    if (!sockopt_batch.count)
+        return ESOCKOPT_OK;
+
+    batch = (struct dpvs_sock_batch *)sockopt_batch.buf;
+    batch->flags = sockopt_batch.flags;
+    batch->count = sockopt_batch.count;
+
+    if (sockopt_batch.flags & DPVS_SOCK_BATCH_F_RESULTS) {
+        res = __sockopt_request(SOCKOPT_SET, SOCKOPT_SET_BATCH,
+                                sockopt_batch.buf, sockopt_batch.len,
+                                &out, &out_len);
+        if (!res && out_len != sockopt_batch.count * sizeof(int32_t))
+            res = -ESOCKOPT_INVAL;
+        sockopt_batch_save_results(res ? NULL : out, res);
+        free(out);
+    } else {
+        res = __sockopt_request(SOCKOPT_SET, SOCKOPT_SET_BATCH,
+                                sockopt_batch.buf, sockopt_batch.len, NULL, NULL);
     }
-    *out = NULL;
-    *out_len = 0;
 
-    memset(&clt_addr, 0, sizeof(struct sockaddr_un));
-    clt_addr.sun_family = AF_UNIX;
-    strncpy(clt_addr.sun_path, UNIX_DOMAIN, sizeof(clt_addr.sun_path) - 1);
+    sockopt_batch.count = 0;
+    sockopt_batch.len = sizeof(struct dpvs_sock_batch);
+    return res;
+}
 
-    msg_len = sizeof(struct dpvs_sock_msg);
-    msg = malloc(msg_len);
-    if (NULL == msg) {
-        fprintf(stderr, "[%s] no memory\n", __func__);
-        return -ESOCKOPT_NOMEM;
+static int sockopt_batch_append(sockoptid_t cmd, const void *in, size_t in_len)
+{
+    struct dpvs_sock_batch_entry *ent;
+    size_t len = DPVS_SOCK_BATCH_ALIGN(sizeof(*ent) + in_len);
+    size_t size;
+    char *buf;
+    int res;
+
+    /* non-atomic batch is sent by chunks to bound server memory */
+    if (!(sockopt_batch.flags & DPVS_SOCK_BATCH_F_ATOMIC) &&
+            sockopt_batch.len + len > DPVS_SOCK_BATCH_CHUNK) {
+        res = sockopt_batch_flush();
+        if (res)
+            return res;
     }
 
-    clt_fd = socket(PF_UNIX, SOCK_STREAM, 0);
-    res = connect(clt_fd, (struct sockaddr*)&clt_addr, sizeof(clt_addr));
-    if (-1 == res) {
-        fprintf(stderr, "[%s] scoket msg connection error: %s\n",
-                __func__, strerror(errno));
-        free(msg);
-        return -ESOCKOPT_IO;
+    if (sockopt_batch.len + len > sockopt_batch.size) {
+        size = sockopt_batch.size ? sockopt_batch.size : SOCKOPT_MSG_BUFFER_SIZE;
+        while (size < sockopt_batch.len + len)
+            size <<= 1;
+        buf = realloc(sockopt_batch.buf, size);
+        if (!buf) {
+            fprintf(stderr, "[%s] no memory\n", __func__);
+            return -ESOCKOPT_NOMEM;
+        }
+        sockopt_batch.buf = buf;
+        sockopt_batch.size = size;
     }
 
-    memset(msg, 0, msg_len);
-    msg->version = SOCKOPT_VERSION;
-    msg->id = cmd;
-    msg->type = SOCKOPT_GET;
-    msg->len = in_len;
-    res = sockopt_msg_send(clt_fd, msg, in, in_len);
+    ent = (struct dpvs_sock_batch_entry *)(sockopt_batch.buf + sockopt_batch.len);
+    memset(ent, 0, len);
+    ent->id = cmd;
+    ent->len = in_len;
+    if (in && in_len)
+        memcpy(ent->data, in, in_len);
 
-    free(msg);
-    msg = NULL;
+    sockopt_batch.len += len;
+    sockopt_batch.count++;
+    sockopt_batch.total++;
+    return ESOCKOPT_OK;
+}
 
-    if (res) {
-        close(clt_fd);
-        return res;
+int dpvs_sockopt_batch_begin(uint32_t flags)
+{
+    pthread_mutex_lock(&sockopt_lock);
+    if (sockopt_batch.active) {
+        pthread_mutex_unlock(&sockopt_lock);
+        fprintf(stderr, "[%s] batch already begun\n", __func__);
+        return -ESOCKOPT_INVAL;
     }
 
-    res = sockopt_msg_recv(clt_fd, &reply_hdr, out, out_len);
-    if (res) {
-        close(clt_fd);
-        return res;
+    sockopt_batch.active = 1;
+    sockopt_batch.flags = flags;
+    sockopt_batch.count = 0;
+    sockopt_batch.total = 0;
+    sockopt_batch.nres = 0;
+    sockopt_batch.len = sizeof(struct dpvs_sock_batch);
+    pthread_mutex_unlock(&sockopt_lock);
+
+    return ESOCKOPT_OK;
+}
+
+int dpvs_sockopt_batch_commit(void)
+{
+    int res;
+
+    pthread_mutex_lock(&sockopt_lock);
+    if (!sockopt_batch.active) {
+        pthread_mutex_unlock(&sockopt_lock);
+        return -ESOCKOPT_INVAL;
     }
 
-    if (reply_hdr.errcode) {
-        fprintf(stderr, "[%s] Server error: %s\n", __func__, reply_hdr.errstr);
-        close(clt_fd);
-        return reply_hdr.errcode;
+    res = sockopt_batch_flush();
+    sockopt_batch.active = 0;
+    pthread_mutex_unlock(&sockopt_lock);
+
+    return res;
+}
+
+void dpvs_sockopt_batch_abort(void)
+{
+    pthread_mutex_lock(&sockopt_lock);
+    sockopt_batch.active = 0;
+    sockopt_batch.count = 0;
+    pthread_mutex_unlock(&sockopt_lock);
+}
+
+uint32_t dpvs_sockopt_batch_count(void)
+{
+    uint32_t total;
+
+    pthread_mutex_lock(&sockopt_lock);
+    total = sockopt_batch.total;
+    pthread_mutex_unlock(&sockopt_lock);
+
+    return total;
+}
+
+int dpvs_sockopt_batch_result(uint32_t idx)
+{
+    int res = -ESOCKOPT_INVAL;
+
+    pthread_mutex_lock(&sockopt_lock);
+    if (idx < sockopt_batch.nres)
+        res = sockopt_batch.results[idx];
+    pthread_mutex_unlock(&sockopt_lock);
+
+    return res;
+}
+
+void dpvs_sockopt_close(void)
+{
+    pthread_mutex_lock(&sockopt_lock);
+    sockopt_disconnect();
+    free(sockopt_batch.buf);
+    free(sockopt_batch.results);
+    memset(&sockopt_batch, 0, sizeof(sockopt_batch));
+    pthread_mutex_unlock(&sockopt_lock);
+}
+
+/* set messages are deferred and the result is returned by
+ * dpvs_sockopt_batch_commit() if a batch is begun. */
+int dpvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len)
+{
+    int res;
+
+    pthread_mutex_lock(&sockopt_lock);
+    if (sockopt_batch.active)
+        res = sockopt_batch_append(cmd, in, in_len);
+    else
+        res = __sockopt_request(SOCKOPT_SET, cmd, in, in_len, NULL, NULL);
+    pthread_mutex_unlock(&sockopt_lock);
+
+    return res;
+}
+
+/* pending set messages of a batch are sent first to keep the order. */
+int dpvs_getsockopt(sockoptid_t cmd, const void *in, size_t in_len,
+        void **out, size_t *out_len)
+{
+    int res;
+
+    if (NULL == out || NULL == out_len) {
+        fprintf(stderr, "[%s] no pointer for info return\n", __func__);
+        return -1;
     }
+    *out = NULL;
+    *out_len = 0;
 
-    close(clt_fd);
-    return ESOCKOPT_OK;
+    pthread_mutex_lock(&sockopt_lock);
+    if (sockopt_batch.active) {
+        res = sockopt_batch_flush();
+        if (res) {
+            pthread_mutex_unlock(&sockopt_lock);
+            return res;
+        }
+    }
+
+    res = __sockopt_request(SOCKOPT_GET, cmd, in, in_len, out, out_len);
+    pthread_mutex_unlock(&sockopt_lock);
+
+    return res;
 }
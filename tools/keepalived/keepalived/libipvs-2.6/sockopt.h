@@ -47,9 +47,53 @@ struct dpvs_sock_msg_reply {
     char data[0];
 };
 
+/*
+ * batch of set messages, applied in order within one request.
+ * must be consistent with dpvs include/ctrl.h.
+ */
+#define SOCKOPT_SET_BATCH               1300
+
+#define DPVS_SOCK_BATCH_F_ATOMIC        0x1 /* roll back all on failure */
+#define DPVS_SOCK_BATCH_F_CONTINUE      0x2 /* apply the rest on failure */
+#define DPVS_SOCK_BATCH_F_RESULTS       0x4 /* reply result of each entry */
+#define DPVS_SOCK_BATCH_ALIGN(len)      (((len) + 7) & ~((size_t)7))
+#define DPVS_SOCK_BATCH_CHUNK           (1UL << 20)
+
+struct dpvs_sock_batch {
+    uint32_t flags;
+    uint32_t count;
+    char data[0];
+};
+
+struct dpvs_sock_batch_entry {
+    sockoptid_t id;
+    uint32_t len;
+    char data[0];
+};
+
+/* the connection to dpvs is kept until dpvs_sockopt_close(). */
 int dpvs_setsockopt(sockoptid_t cmd, const void *in, size_t in_len);
 int dpvs_getsockopt(sockoptid_t cmd, const void *in, size_t in_len,
         void **out, size_t *out_len);
+void dpvs_sockopt_close(void);
+
+/*
+ * dpvs_setsockopt() between begin and commit are sent as one batch.
+ * with DPVS_SOCK_BATCH_F_ATOMIC, applied adds are rolled back if any
+ * entry fails; otherwise the batch may be sent by chunks, and with
+ * DPVS_SOCK_BATCH_F_CONTINUE entries after a failed one are still applied.
+ */
+int dpvs_sockopt_batch_begin(uint32_t flags);
+int dpvs_sockopt_batch_commit(void);
+void dpvs_sockopt_batch_abort(void);
+
+/*
+ * with DPVS_SOCK_BATCH_F_RESULTS, the result of each entry, indexed by
+ * order of dpvs_setsockopt() since begin, is kept after commit until the
+ * next begin. entries of a chunk failed as a whole get its error.
+ */
+uint32_t dpvs_sockopt_batch_count(void);
+int dpvs_sockopt_batch_result(uint32_t idx);
 
 static inline void dpvs_sockopt_msg_free(void *msg)
 {
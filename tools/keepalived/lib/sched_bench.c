@@ -0,0 +1,252 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        Scheduler self benchmark. Runs N periodic TCP connect
+ *              checks against local dummy servers through the I/O
+ *              multiplexer and reports how late the checks fire and
+ *              how long they take.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "scheduler.h"
+#include "sched_bench.h"
+#include "memory.h"
+#include "logger.h"
+
+typedef struct _bench_check {
+	struct sockaddr_in addr;
+	timeval_t due;			/* scheduled start time */
+	timeval_t start;		/* connect() time */
+} bench_check_t;
+
+typedef struct _bench_samples {
+	long *val;			/* usec */
+	int count;
+	int size;
+} bench_samples_t;
+
+static bench_samples_t lateness;
+static bench_samples_t latency;
+static int bench_failed;
+static timeval_t bench_end;
+
+static void
+bench_sample_add(bench_samples_t * s, long val)
+{
+	if (s->count < s->size)
+		s->val[s->count++] = val;
+}
+
+static int
+bench_sample_cmp(const void *a, const void *b)
+{
+	long x = *(const long *) a, y = *(const long *) b;
+
+	return (x > y) - (x < y);
+}
+
+static void
+bench_sample_dump(const char *name, bench_samples_t * s)
+{
+	if (!s->count) {
+		printf("%-10s no sample\n", name);
+		return;
+	}
+
+	qsort(s->val, s->count, sizeof(long), bench_sample_cmp);
+	printf("%-10s p50 %ldus p99 %ldus max %ldus\n", name
+	       , s->val[s->count / 2]
+	       , s->val[(long) s->count * 99 / 100]
+	       , s->val[s->count - 1]);
+}
+
+/* Dummy server: accept and close right away */
+static int
+bench_accept_thread(thread_t * thread)
+{
+	int fd;
+
+	if (thread->type == THREAD_READY_FD) {
+		fd = accept(thread->u.fd, NULL, NULL);
+		if (fd >= 0)
+			close(fd);
+	}
+
+	thread_add_read(thread->master, bench_accept_thread, NULL
+			, thread->u.fd, TIMER_MAX_SEC * TIMER_HZ);
+	return 0;
+}
+
+static int bench_check_thread(thread_t *);
+
+/* Schedule next run at a fixed rate, regardless of check duration */
+static void
+bench_check_next(thread_master_t * m, bench_check_t * chk)
+{
+	long delay;
+
+	chk->due = timer_add_long(chk->due, SCHED_BENCH_INTERVAL);
+	if (timer_cmp(chk->due, bench_end) >= 0)
+		return;
+
+	delay = timer_long(timer_sub(chk->due, time_now));
+	thread_add_timer(m, bench_check_thread, chk, delay > 0 ? delay : 0);
+}
+
+static int
+bench_check_done_thread(thread_t * thread)
+{
+	bench_check_t *chk = THREAD_ARG(thread);
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (thread->type == THREAD_WRITE_TIMEOUT ||
+	    getsockopt(thread->u.fd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err)
+		bench_failed++;
+	else
+		bench_sample_add(&latency, timer_long(timer_sub(time_now, chk->start)));
+	close(thread->u.fd);
+
+	bench_check_next(thread->master, chk);
+	return 0;
+}
+
+static int
+bench_check_thread(thread_t * thread)
+{
+	bench_check_t *chk = THREAD_ARG(thread);
+	int fd;
+
+	set_time_now();
+	bench_sample_add(&lateness, timer_long(timer_sub(time_now, chk->due)));
+	chk->start = time_now;
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0 ||
+	    (connect(fd, (struct sockaddr *) &chk->addr, sizeof(chk->addr)) < 0 &&
+	     errno != EINPROGRESS)) {
+		if (fd >= 0)
+			close(fd);
+		bench_failed++;
+		bench_check_next(thread->master, chk);
+		return 0;
+	}
+
+	thread_add_write(thread->master, bench_check_done_thread, chk
+			 , fd, SCHED_BENCH_INTERVAL);
+	return 0;
+}
+
+static int
+bench_stop_thread(thread_t * thread)
+{
+	thread_add_terminate_event(thread->master);
+	return 0;
+}
+
+/* Open a listening socket on 127.0.0.1, any port */
+static int
+bench_server(struct sockaddr_in *addr)
+{
+	socklen_t len = sizeof(*addr);
+	int fd;
+
+	fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (fd < 0)
+		return -1;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sin_family = AF_INET;
+	addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(fd, (struct sockaddr *) addr, len) < 0 ||
+	    listen(fd, 1024) < 0 ||
+	    getsockname(fd, (struct sockaddr *) addr, &len) < 0) {
+		close(fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+int
+sched_benchmark(int nchecks, int secs)
+{
+	struct sockaddr_in servers[SCHED_BENCH_SERVERS];
+	bench_check_t *checks;
+	thread_t thread;
+	long delay;
+	int i, nserv;
+
+	if (nchecks <= 0)
+		return -1;
+	if (secs <= 0)
+		secs = SCHED_BENCH_DURATION;
+
+	master = thread_make_master();
+
+	nserv = nchecks < SCHED_BENCH_SERVERS ? nchecks : SCHED_BENCH_SERVERS;
+	for (i = 0; i < nserv; i++) {
+		thread.master = master;
+		thread.type = THREAD_READ;
+		thread.u.fd = bench_server(&servers[i]);
+		if (thread.u.fd < 0) {
+			fprintf(stderr, "sched bench: can't open dummy server (%s)\n"
+				      , strerror(errno));
+			thread_destroy_master(master);
+			master = NULL;
+			return -1;
+		}
+		bench_accept_thread(&thread);
+	}
+
+	checks = (bench_check_t *) MALLOC(nchecks * sizeof(bench_check_t));
+	lateness.size = latency.size = nchecks * (secs + 1);
+	lateness.val = (long *) MALLOC(lateness.size * sizeof(long));
+	latency.val = (long *) MALLOC(latency.size * sizeof(long));
+	lateness.count = latency.count = bench_failed = 0;
+
+	set_time_now();
+	bench_end = timer_add_long(time_now, (long) secs * TIMER_HZ);
+	for (i = 0; i < nchecks; i++) {
+		checks[i].addr = servers[i % nserv];
+		delay = thread_spread_delay(SCHED_BENCH_INTERVAL, i, nchecks);
+		checks[i].due = timer_add_long(time_now, delay);
+		thread_add_timer(master, bench_check_thread, &checks[i], delay);
+	}
+	thread_add_timer(master, bench_stop_thread, NULL
+			 , (long) (secs + 1) * TIMER_HZ);
+
+	while (thread_fetch(master, &thread))
+		thread_call(&thread);
+
+	printf("checks %d servers %d duration %ds interval %ldus\n"
+	       , nchecks, nserv, secs, (long) SCHED_BENCH_INTERVAL);
+	printf("%-10s %d failed %d\n", "runs", lateness.count, bench_failed);
+	bench_sample_dump("lateness", &lateness);
+	bench_sample_dump("latency", &latency);
+
+	thread_destroy_master(master);
+	master = NULL;
+	FREE(checks);
+	FREE(lateness.val);
+	FREE(latency.val);
+	return 0;
+}
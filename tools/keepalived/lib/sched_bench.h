@@ -0,0 +1,30 @@
+/*
+ * Soft:        Keepalived is a failover program for the LVS project
+ *              <www.linuxvirtualserver.org>. It monitor & manipulate
+ *              a loadbalanced server pool using multi-layer checks.
+ *
+ * Part:        sched_bench.c include file.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *              See the GNU General Public License for more details.
+ *
+ *              This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU General Public License
+ *              as published by the Free Software Foundation; either version
+ *              2 of the License, or (at your option) any later version.
+ */
+
+#ifndef _SCHED_BENCH_H
+#define _SCHED_BENCH_H
+
+/* Defines */
+#define SCHED_BENCH_SERVERS	64		/* max local dummy servers */
+#define SCHED_BENCH_INTERVAL	TIMER_HZ	/* check interval */
+#define SCHED_BENCH_DURATION	10		/* default run time in sec */
+
+/* prototypes */
+extern int sched_benchmark(int, int);
+
+#endif
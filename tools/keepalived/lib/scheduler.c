@@ -33,7 +33,8 @@
 
 #include <signal.h>
 #include <sys/wait.h>
-#include <sys/select.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
 #include "scheduler.h"
 #include "memory.h"
@@ -41,6 +42,11 @@
 #include "signals.h"
 #include "logger.h"
 
+/* initial size of fd table and epoll event buffer, both grow on demand */
+#define THREAD_FDS_MIN		1024
+#define THREAD_HEAP_MIN		1024
+#define THREAD_EVENTS_MIN	64
+
 /* global vars */
 thread_master_t *master = NULL;
 
@@ -49,8 +55,30 @@ thread_master_t *
 thread_make_master(void)
 {
 	thread_master_t *new;
+	struct epoll_event ev;
 
 	new = (thread_master_t *) MALLOC(sizeof (thread_master_t));
+	new->signal_fd = -1;
+
+	new->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (new->epoll_fd < 0) {
+		log_message(LOG_ERR, "scheduler: epoll_create failed (%s)", strerror(errno));
+		assert(0);
+	}
+
+	new->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (new->timer_fd < 0) {
+		log_message(LOG_ERR, "scheduler: timerfd_create failed (%s)", strerror(errno));
+		assert(0);
+	}
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = new->timer_fd;
+	epoll_ctl(new->epoll_fd, EPOLL_CTL_ADD, new->timer_fd, &ev);
+
+	new->events_size = THREAD_EVENTS_MIN;
+	new->events = (struct epoll_event *) MALLOC(new->events_size * sizeof(struct epoll_event));
+
 	return new;
 }
 
@@ -68,37 +96,6 @@ thread_list_add(thread_list_t * list, thread_t * thread)
 	list->count++;
 }
 
-/* Add a new thread to the list. */
-void
-thread_list_add_before(thread_list_t * list, thread_t * point, thread_t * thread)
-{
-	thread->next = point;
-	thread->prev = point->prev;
-	if (point->prev)
-		point->prev->next = thread;
-	else
-		list->head = thread;
-	point->prev = thread;
-	list->count++;
-}
-
-/* Add a thread in the list sorted by timeval */
-void
-thread_list_add_timeval(thread_list_t * list, thread_t * thread)
-{
-	thread_t *tt;
-
-	for (tt = list->head; tt; tt = tt->next) {
-		if (timer_cmp(thread->sands, tt->sands) <= 0)
-			break;
-	}
-
-	if (tt)
-		thread_list_add_before(list, tt, thread);
-	else
-		thread_list_add(list, thread);
-}
-
 /* Delete a thread from the list. */
 thread_t *
 thread_list_delete(thread_list_t * list, thread_t * thread)
@@ -116,6 +113,160 @@ thread_list_delete(thread_list_t * list, thread_t * thread)
 	return thread;
 }
 
+/*
+ * Timer heap. All threads waiting for a timeout (read, write, timer and
+ * child) are kept in a binary min-heap ordered by sands, so the nearest
+ * timeout is found in O(1) and insert/delete are O(log n).
+ */
+static inline void
+thread_heap_set(thread_master_t * m, int i, thread_t * thread)
+{
+	m->heap[i] = thread;
+	thread->heap_idx = i + 1;
+}
+
+static void
+thread_heap_up(thread_master_t * m, int i)
+{
+	thread_t *thread = m->heap[i];
+	int parent;
+
+	while (i > 0) {
+		parent = (i - 1) / 2;
+		if (timer_cmp(m->heap[parent]->sands, thread->sands) <= 0)
+			break;
+		thread_heap_set(m, i, m->heap[parent]);
+		i = parent;
+	}
+	thread_heap_set(m, i, thread);
+}
+
+static void
+thread_heap_down(thread_master_t * m, int i)
+{
+	thread_t *thread = m->heap[i];
+	int child;
+
+	while ((child = 2 * i + 1) < m->heap_count) {
+		if (child + 1 < m->heap_count &&
+		    timer_cmp(m->heap[child + 1]->sands, m->heap[child]->sands) < 0)
+			child++;
+		if (timer_cmp(thread->sands, m->heap[child]->sands) <= 0)
+			break;
+		thread_heap_set(m, i, m->heap[child]);
+		i = child;
+	}
+	thread_heap_set(m, i, thread);
+}
+
+static void
+thread_heap_add(thread_master_t * m, thread_t * thread)
+{
+	if (m->heap_count == m->heap_size) {
+		m->heap_size = m->heap_size ? m->heap_size * 2 : THREAD_HEAP_MIN;
+		m->heap = (thread_t **) REALLOC(m->heap, m->heap_size * sizeof(thread_t *));
+		assert(m->heap != NULL);
+	}
+
+	m->heap[m->heap_count++] = thread;
+	thread_heap_up(m, m->heap_count - 1);
+}
+
+static void
+thread_heap_delete(thread_master_t * m, thread_t * thread)
+{
+	int i = thread->heap_idx - 1;
+
+	if (!thread->heap_idx)
+		return;
+	assert(m->heap[i] == thread);
+
+	thread->heap_idx = 0;
+	if (i == --m->heap_count)
+		return;
+
+	thread_heap_set(m, i, m->heap[m->heap_count]);
+	thread_heap_up(m, i);
+	thread_heap_down(m, m->heap[i]->heap_idx - 1);
+}
+
+static inline thread_t *
+thread_heap_top(thread_master_t * m)
+{
+	return m->heap_count ? m->heap[0] : NULL;
+}
+
+/* Get the fd slot, growing the table if needed. */
+static thread_fd_t *
+thread_fd_get(thread_master_t * m, int fd)
+{
+	int size;
+
+	if (fd < 0)
+		return NULL;
+
+	if (fd >= m->fds_size) {
+		size = m->fds_size ? m->fds_size : THREAD_FDS_MIN;
+		while (size <= fd)
+			size *= 2;
+		m->fds = (thread_fd_t *) REALLOC(m->fds, size * sizeof(thread_fd_t));
+		assert(m->fds != NULL);
+		memset(&m->fds[m->fds_size], 0, (size - m->fds_size) * sizeof(thread_fd_t));
+		m->fds_size = size;
+	}
+
+	return &m->fds[fd];
+}
+
+/* Sync epoll registration of fd with its waiting read/write threads. */
+static void
+thread_fd_update(thread_master_t * m, int fd)
+{
+	thread_fd_t *tfd = &m->fds[fd];
+	struct epoll_event ev;
+	uint32_t events = 0;
+	int op, ret;
+
+	if (tfd->read)
+		events |= EPOLLIN;
+	if (tfd->write)
+		events |= EPOLLOUT;
+	if (events == tfd->events)
+		return;
+
+	if (!events)
+		op = EPOLL_CTL_DEL;
+	else if (!tfd->events)
+		op = EPOLL_CTL_ADD;
+	else
+		op = EPOLL_CTL_MOD;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = fd;
+	ret = epoll_ctl(m->epoll_fd, op, fd, &ev);
+	if (ret < 0 && op == EPOLL_CTL_ADD && errno == EEXIST)
+		ret = epoll_ctl(m->epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+	/* fd closed by its owner is removed from epoll by kernel */
+	if (ret < 0 && op != EPOLL_CTL_DEL)
+		log_message(LOG_WARNING, "scheduler: epoll_ctl(%d) fd %d failed (%s)"
+				       , op, fd, strerror(errno));
+	tfd->events = events;
+}
+
+/* Detach a read/write thread from its fd. */
+static void
+thread_fd_delete(thread_master_t * m, thread_t * thread)
+{
+	thread_fd_t *tfd = &m->fds[thread->u.fd];
+
+	if (tfd->read == thread)
+		tfd->read = NULL;
+	else if (tfd->write == thread)
+		tfd->write = NULL;
+	thread_fd_update(m, thread->u.fd);
+}
+
 /* Free all unused thread. */
 static void
 thread_clean_unuse(thread_master_t * m)
@@ -170,6 +321,7 @@ thread_destroy_list(thread_master_t * m, thread_list_t thread_list)
 			close (t->u.fd);
 
 		thread_list_delete(&thread_list, t);
+		t->heap_idx = 0;
 		t->type = THREAD_UNUSED;
 		thread_add_unuse(m, t);
 	}
@@ -186,10 +338,17 @@ thread_cleanup_master(thread_master_t * m)
 	thread_destroy_list(m, m->event);
 	thread_destroy_list(m, m->ready);
 
-	/* Clear all FDs */
-	FD_ZERO(&m->readfd);
-	FD_ZERO(&m->writefd);
-	FD_ZERO(&m->exceptfd);
+	/*
+	 * Forget fds and timers without touching epoll: master is also
+	 * destroyed by forked children, which share the epoll instance with
+	 * their parent until closing it.
+	 */
+	FREE_PTR(m->fds);
+	m->fds = NULL;
+	m->fds_size = 0;
+	FREE_PTR(m->heap);
+	m->heap = NULL;
+	m->heap_count = m->heap_size = 0;
 
 	/* Clean garbage */
 	thread_clean_unuse(m);
@@ -202,6 +361,9 @@ thread_destroy_master(thread_master_t * m)
 	if (!m)
 		return;
 	thread_cleanup_master(m);
+	close(m->timer_fd);
+	close(m->epoll_fd);
+	FREE(m->events);
 	FREE(m);
 }
 
@@ -238,10 +400,16 @@ thread_add_read(thread_master_t * m, int (*func) (thread_t *)
 		, void *arg, int fd, long timer)
 {
 	thread_t *thread;
+	thread_fd_t *tfd;
 
 	assert(m != NULL);
 
-	if (FD_ISSET(fd, &m->readfd)) {
+	tfd = thread_fd_get(m, fd);
+	if (!tfd) {
+		log_message(LOG_WARNING, "Invalid read fd [%d]", fd);
+		return NULL;
+	}
+	if (tfd->read) {
 		log_message(LOG_WARNING, "There is already read fd [%d]", fd);
 		return NULL;
 	}
@@ -252,15 +420,16 @@ thread_add_read(thread_master_t * m, int (*func) (thread_t *)
 	thread->master = m;
 	thread->func = func;
 	thread->arg = arg;
-	FD_SET(fd, &m->readfd);
 	thread->u.fd = fd;
+	tfd->read = thread;
+	thread_fd_update(m, fd);
 
 	/* Compute read timeout value */
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort the thread. */
-	thread_list_add_timeval(&m->read, thread);
+	thread_list_add(&m->read, thread);
+	thread_heap_add(m, thread);
 
 	return thread;
 }
@@ -271,10 +440,16 @@ thread_add_write(thread_master_t * m, int (*func) (thread_t *)
 		 , void *arg, int fd, long timer)
 {
 	thread_t *thread;
+	thread_fd_t *tfd;
 
 	assert(m != NULL);
 
-	if (FD_ISSET(fd, &m->writefd)) {
+	tfd = thread_fd_get(m, fd);
+	if (!tfd) {
+		log_message(LOG_WARNING, "Invalid write fd [%d]", fd);
+		return NULL;
+	}
+	if (tfd->write) {
 		log_message(LOG_WARNING, "There is already write fd [%d]", fd);
 		return NULL;
 	}
@@ -285,15 +460,16 @@ thread_add_write(thread_master_t * m, int (*func) (thread_t *)
 	thread->master = m;
 	thread->func = func;
 	thread->arg = arg;
-	FD_SET(fd, &m->writefd);
 	thread->u.fd = fd;
+	tfd->write = thread;
+	thread_fd_update(m, fd);
 
 	/* Compute write timeout value */
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort the thread. */
-	thread_list_add_timeval(&m->write, thread);
+	thread_list_add(&m->write, thread);
+	thread_heap_add(m, thread);
 
 	return thread;
 }
@@ -318,12 +494,25 @@ thread_add_timer(thread_master_t * m, int (*func) (thread_t *)
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort by timeval. */
-	thread_list_add_timeval(&m->timer, thread);
+	thread_list_add(&m->timer, thread);
+	thread_heap_add(m, thread);
 
 	return thread;
 }
 
+/*
+ * Start offset of the idx-th of n periodic jobs sharing the same
+ * interval, so that they fire evenly spread over the interval
+ * instead of all at once.
+ */
+long
+thread_spread_delay(long interval, int idx, int n)
+{
+	if (n <= 1 || interval <= 0)
+		return 0;
+	return (long) ((long long) interval * (idx % n) / n);
+}
+
 /* Add a child thread. */
 thread_t *
 thread_add_child(thread_master_t * m, int (*func) (thread_t *)
@@ -346,8 +535,8 @@ thread_add_child(thread_master_t * m, int (*func) (thread_t *)
 	set_time_now();
 	thread->sands = timer_add_long(time_now, timer);
 
-	/* Sort by timeval. */
-	thread_list_add_timeval(&m->child, thread);
+	thread_list_add(&m->child, thread);
+	thread_heap_add(m, thread);
 
 	return thread;
 }
@@ -397,43 +586,50 @@ thread_add_terminate_event(thread_master_t * m)
 int
 thread_cancel(thread_t * thread)
 {
+	thread_master_t *m;
+
 	if (!thread)
 		return -1;
+	m = thread->master;
 
 	switch (thread->type) {
 	case THREAD_READ:
-		assert(FD_ISSET(thread->u.fd, &thread->master->readfd));
-		FD_CLR(thread->u.fd, &thread->master->readfd);
-		thread_list_delete(&thread->master->read, thread);
+		assert(m->fds[thread->u.fd].read == thread);
+		thread_fd_delete(m, thread);
+		thread_heap_delete(m, thread);
+		thread_list_delete(&m->read, thread);
 		break;
 	case THREAD_WRITE:
-		assert(FD_ISSET(thread->u.fd, &thread->master->writefd));
-		FD_CLR(thread->u.fd, &thread->master->writefd);
-		thread_list_delete(&thread->master->write, thread);
+		assert(m->fds[thread->u.fd].write == thread);
+		thread_fd_delete(m, thread);
+		thread_heap_delete(m, thread);
+		thread_list_delete(&m->write, thread);
 		break;
 	case THREAD_TIMER:
-		thread_list_delete(&thread->master->timer, thread);
+		thread_heap_delete(m, thread);
+		thread_list_delete(&m->timer, thread);
 		break;
 	case THREAD_CHILD:
 		/* Does this need to kill the child, or is that the
 		 * caller's job?
 		 * This function is currently unused, so leave it for now.
 		 */
-		thread_list_delete(&thread->master->child, thread);
+		thread_heap_delete(m, thread);
+		thread_list_delete(&m->child, thread);
 		break;
 	case THREAD_EVENT:
-		thread_list_delete(&thread->master->event, thread);
+		thread_list_delete(&m->event, thread);
 		break;
 	case THREAD_READY:
 	case THREAD_READY_FD:
-		thread_list_delete(&thread->master->ready, thread);
+		thread_list_delete(&m->ready, thread);
 		break;
 	default:
 		break;
 	}
 
 	thread->type = THREAD_UNUSED;
-	thread_add_unuse(thread->master, thread);
+	thread_add_unuse(m, thread);
 	return 0;
 }
 
@@ -458,67 +654,134 @@ thread_cancel_event(thread_master_t * m, void *arg)
 	}
 }
 
-/* Update timer value */
+/* Move a waiting thread to the ready list as type. */
 static void
-thread_update_timer(thread_list_t *list, timeval_t *timer_min)
+thread_move_ready(thread_master_t * m, thread_t * thread, unsigned char type)
 {
-	if (list->head) {
-		if (!timer_isnull(*timer_min)) {
-			if (timer_cmp(list->head->sands, *timer_min) <= 0) {
-				*timer_min = list->head->sands;
-			}
-		} else {
-			*timer_min = list->head->sands;
-		}
+	switch (thread->type) {
+	case THREAD_READ:
+		thread_fd_delete(m, thread);
+		thread_list_delete(&m->read, thread);
+		break;
+	case THREAD_WRITE:
+		thread_fd_delete(m, thread);
+		thread_list_delete(&m->write, thread);
+		break;
+	case THREAD_TIMER:
+		thread_list_delete(&m->timer, thread);
+		break;
+	case THREAD_CHILD:
+		thread_list_delete(&m->child, thread);
+		break;
+	default:
+		assert(0);
 	}
+
+	thread_heap_delete(m, thread);
+	thread_list_add(&m->ready, thread);
+	thread->type = type;
 }
 
-/* Compute the wait timer. Take care of timeouted fd */
+/*
+ * Arm the timerfd to the nearest sands, at most 1s ahead as the
+ * select loop used to, so that signals and SNMP are never starved.
+ */
 static void
 thread_compute_timer(thread_master_t * m, timeval_t * timer_wait)
 {
+	thread_t *top = thread_heap_top(m);
+	struct itimerspec its;
 	timeval_t timer_min;
 
-	/* Prepare timer */
-	timer_reset(timer_min);
-	thread_update_timer(&m->timer, &timer_min);
-	thread_update_timer(&m->write, &timer_min);
-	thread_update_timer(&m->read, &timer_min);
-	thread_update_timer(&m->child, &timer_min);
-
-	/* Take care about monothonic clock */
-	if (!timer_isnull(timer_min)) {
-		timer_min = timer_sub(timer_min, time_now);
+	if (top) {
+		timer_min = timer_sub(top->sands, time_now);
 		if (timer_min.tv_sec < 0) {
 			timer_min.tv_sec = timer_min.tv_usec = 0;
 		} else if (timer_min.tv_sec >= 1) {
 			timer_min.tv_sec = 1;
 			timer_min.tv_usec = 0;
 		}
-
-		timer_wait->tv_sec = timer_min.tv_sec;
-		timer_wait->tv_usec = timer_min.tv_usec;
 	} else {
-		timer_wait->tv_sec = 1;
-		timer_wait->tv_usec = 0;
+		timer_min.tv_sec = 1;
+		timer_min.tv_usec = 0;
+	}
+	*timer_wait = timer_min;
+
+	/* zero it_value disarms the timer, fire as soon as possible instead */
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = timer_min.tv_sec;
+	its.it_value.tv_nsec = timer_min.tv_usec * 1000;
+	if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+		its.it_value.tv_nsec = 1;
+	timerfd_settime(m->timer_fd, 0, &its, NULL);
+}
+
+/* Keep signal pipe registered, it is recreated by child processes. */
+static void
+thread_update_signal_fd(thread_master_t * m)
+{
+	struct epoll_event ev;
+	int fd = signal_rfd();
+
+	if (fd == m->signal_fd)
+		return;
+
+	if (m->signal_fd >= 0)
+		epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, m->signal_fd, NULL);
+	m->signal_fd = fd;
+	if (fd < 0)
+		return;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = fd;
+	if (epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0 && errno != EEXIST)
+		log_message(LOG_WARNING, "scheduler: fail to watch signal fd (%s)"
+				       , strerror(errno));
+}
+
+#ifdef _WITH_SNMP_
+/* Register snmp fds reported by snmp_select_info() to epoll. */
+static void
+thread_update_snmp_fds(thread_master_t * m, fd_set * fds, int maxfd)
+{
+	struct epoll_event ev;
+	int fd, nfds = maxfd > m->snmp_maxfd ? maxfd : m->snmp_maxfd;
+
+	for (fd = 0; fd < nfds; fd++) {
+		if (!!FD_ISSET(fd, fds) == !!FD_ISSET(fd, &m->snmp_fds))
+			continue;
+
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.fd = fd;
+		if (FD_ISSET(fd, fds)) {
+			epoll_ctl(m->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+			FD_SET(fd, &m->snmp_fds);
+		} else {
+			epoll_ctl(m->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+			FD_CLR(fd, &m->snmp_fds);
+		}
 	}
+	m->snmp_maxfd = maxfd;
 }
+#endif
 
 /* Fetch next ready thread. */
 thread_t *
 thread_fetch(thread_master_t * m, thread_t * fetch)
 {
-	int ret, old_errno;
+	int ret, old_errno, i, fd, signaled;
+	uint32_t events;
+	uint64_t expirations;
 	thread_t *thread;
-	fd_set readfd;
-	fd_set writefd;
-	fd_set exceptfd;
+	thread_fd_t *tfd;
 	timeval_t timer_wait;
-	int signal_fd;
 #ifdef _WITH_SNMP_
 	timeval_t snmp_timer_wait;
 	int snmpblock = 0;
 	int fdsetsize;
+	fd_set snmp_fds, snmp_readfd;
 #endif
 
 	assert(m != NULL);
@@ -553,50 +816,53 @@ retry:	/* When thread can't fetch try to find next thread again. */
 
 	/*
 	 * Re-read the current time to get the maximum accuracy.
-	 * Calculate select wait timer. Take care of timeouted fd.
+	 * Calculate wait timer. Take care of timeouted fd.
 	 */
 	set_time_now();
-	thread_compute_timer(m, &timer_wait);
-
-	/* Call select function. */
-	readfd = m->readfd;
-	writefd = m->writefd;
-	exceptfd = m->exceptfd;
-
-	signal_fd = signal_rfd();
-	FD_SET(signal_fd, &readfd);
+	thread_update_signal_fd(m);
 
 #ifdef _WITH_SNMP_
-	/* When SNMP is enabled, we may have to select() on additional
-	 * FD. snmp_select_info() will add them to `readfd'. The trick
+	/* When SNMP is enabled, we may have to wait on additional
+	 * FD. snmp_select_info() will add them to `snmp_fds'. The trick
 	 * with this function is its last argument. We need to set it
 	 * to 0 and we need to use the provided new timer only if it
 	 * is still set to 0. */
-	fdsetsize = FD_SETSIZE;
+	thread_compute_timer(m, &timer_wait);
+	FD_ZERO(&snmp_fds);
+	fdsetsize = 0;
 	snmpblock = 0;
 	memcpy(&snmp_timer_wait, &timer_wait, sizeof(timeval_t));
-	snmp_select_info(&fdsetsize, &readfd, &snmp_timer_wait, &snmpblock);
-	if (snmpblock == 0)
-		memcpy(&timer_wait, &snmp_timer_wait, sizeof(timeval_t));
+	snmp_select_info(&fdsetsize, &snmp_fds, &snmp_timer_wait, &snmpblock);
+	thread_update_snmp_fds(m, &snmp_fds, fdsetsize);
+	if (snmpblock == 0 && timer_cmp(snmp_timer_wait, timer_wait) < 0) {
+		struct itimerspec its;
+
+		memset(&its, 0, sizeof(its));
+		its.it_value.tv_sec = snmp_timer_wait.tv_sec;
+		its.it_value.tv_nsec = snmp_timer_wait.tv_usec * 1000;
+		if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+			its.it_value.tv_nsec = 1;
+		timerfd_settime(m->timer_fd, 0, &its, NULL);
+	}
+	FD_ZERO(&snmp_readfd);
+#else
+	thread_compute_timer(m, &timer_wait);
 #endif
 
-	ret = select(FD_SETSIZE, &readfd, &writefd, &exceptfd, &timer_wait);
+	/* the event buffer should hold all fds ready at once */
+	if (m->events_size < m->read.count + m->write.count + 2 &&
+	    m->events_size < m->fds_size) {
+		m->events_size *= 2;
+		m->events = (struct epoll_event *) REALLOC(m->events,
+				m->events_size * sizeof(struct epoll_event));
+		assert(m->events != NULL);
+	}
+
+	ret = epoll_wait(m->epoll_fd, m->events, m->events_size, -1);
 
 	/* we have to save errno here because the next syscalls will set it */
 	old_errno = errno;
 
-       /* Handle SNMP stuff */
-#ifdef _WITH_SNMP_
-	if (ret > 0)
-		snmp_read(&readfd);
-	else if (ret == 0)
-		snmp_timeout();
-#endif
-
-	/* handle signals synchronously, including child reaping */
-	if (FD_ISSET(signal_fd, &readfd))
-		signal_run_callback();
-
 	/* Update current time */
 	set_time_now();
 
@@ -604,87 +870,72 @@ retry:	/* When thread can't fetch try to find next thread again. */
 		if (old_errno == EINTR)
 			goto retry;
 		/* Real error. */
-		DBG("select error: %s", strerror(old_errno));
+		DBG("epoll_wait error: %s", strerror(old_errno));
 		assert(0);
 	}
 
-	/* Timeout children */
-	thread = m->child.head;
-	while (thread) {
-		thread_t *t;
-
-		t = thread;
-		thread = t->next;
+	/* Ready fds, an fd ready wins over its timeout as select loop did */
+	signaled = 0;
+	for (i = 0; i < ret; i++) {
+		fd = m->events[i].data.fd;
+		events = m->events[i].events;
 
-		if (timer_cmp(time_now, t->sands) >= 0) {
-			thread_list_delete(&m->child, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_CHILD_TIMEOUT;
+		if (fd == m->timer_fd) {
+			while (read(fd, &expirations, sizeof(expirations)) > 0)
+				;
+			continue;
 		}
-	}
-
-	/* Read thead. */
-	thread = m->read.head;
-	while (thread) {
-		thread_t *t;
-
-		t = thread;
-		thread = t->next;
-
-		if (FD_ISSET(t->u.fd, &readfd)) {
-			assert(FD_ISSET(t->u.fd, &m->readfd));
-			FD_CLR(t->u.fd, &m->readfd);
-			thread_list_delete(&m->read, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_READY_FD;
-		} else {
-			if (timer_cmp(time_now, t->sands) >= 0) {
-				FD_CLR(t->u.fd, &m->readfd);
-				thread_list_delete(&m->read, t);
-				thread_list_add(&m->ready, t);
-				t->type = THREAD_READ_TIMEOUT;
-			}
+		if (fd == m->signal_fd) {
+			signaled = 1;
+			continue;
 		}
-	}
-
-	/* Write thead. */
-	thread = m->write.head;
-	while (thread) {
-		thread_t *t;
-
-		t = thread;
-		thread = t->next;
-
-		if (FD_ISSET(t->u.fd, &writefd)) {
-			assert(FD_ISSET(t->u.fd, &writefd));
-			FD_CLR(t->u.fd, &m->writefd);
-			thread_list_delete(&m->write, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_READY_FD;
-		} else {
-			if (timer_cmp(time_now, t->sands) >= 0) {
-				FD_CLR(t->u.fd, &m->writefd);
-				thread_list_delete(&m->write, t);
-				thread_list_add(&m->ready, t);
-				t->type = THREAD_WRITE_TIMEOUT;
-			}
+#ifdef _WITH_SNMP_
+		if (fd < FD_SETSIZE && FD_ISSET(fd, &m->snmp_fds)) {
+			FD_SET(fd, &snmp_readfd);
+			continue;
 		}
+#endif
+		if (fd >= m->fds_size)
+			continue;
+		tfd = &m->fds[fd];
+
+		if ((events & (EPOLLIN | EPOLLERR | EPOLLHUP)) && tfd->read)
+			thread_move_ready(m, tfd->read, THREAD_READY_FD);
+		if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && tfd->write)
+			thread_move_ready(m, tfd->write, THREAD_READY_FD);
 	}
-	/* Exception thead. */
-	/*... */
 
-	/* Timer update. */
-	thread = m->timer.head;
-	while (thread) {
-		thread_t *t;
+       /* Handle SNMP stuff */
+#ifdef _WITH_SNMP_
+	for (fd = 0; fd < fdsetsize; fd++)
+		if (FD_ISSET(fd, &snmp_readfd))
+			break;
+	if (fd < fdsetsize)
+		snmp_read(&snmp_readfd);
+	else
+		snmp_timeout();
+#endif
 
-		t = thread;
-		thread = t->next;
+	/* handle signals synchronously, including child reaping */
+	if (signaled)
+		signal_run_callback();
 
-		if (timer_cmp(time_now, t->sands) >= 0) {
-			thread_list_delete(&m->timer, t);
-			thread_list_add(&m->ready, t);
-			t->type = THREAD_READY;
+	/* Timeout read/write/children and timers, nearest first */
+	while ((thread = thread_heap_top(m)) &&
+	       timer_cmp(time_now, thread->sands) >= 0) {
+		switch (thread->type) {
+		case THREAD_READ:
+			thread_move_ready(m, thread, THREAD_READ_TIMEOUT);
+			break;
+		case THREAD_WRITE:
+			thread_move_ready(m, thread, THREAD_WRITE_TIMEOUT);
+			break;
+		case THREAD_CHILD:
+			thread_move_ready(m, thread, THREAD_CHILD_TIMEOUT);
+			break;
+		default:
+			thread_move_ready(m, thread, THREAD_READY);
+			break;
 		}
 	}
 
@@ -733,10 +984,8 @@ thread_child_handler(void * v, int sig)
 				t = thread;
 				thread = t->next;
 				if (pid == t->u.c.pid) {
-					thread_list_delete(&m->child, t);
-					thread_list_add(&m->ready, t);
+					thread_move_ready(m, t, THREAD_READY);
 					t->u.c.status = status;
-					t->type = THREAD_READY;
 					break;
 				}
 			}
@@ -31,6 +31,9 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <syslog.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/select.h>
 #include "timer.h"
 
 /* Thread itself. */
@@ -43,6 +46,7 @@ typedef struct _thread {
 	int (*func) (struct _thread *);	/* event function */
 	void *arg;			/* event argument */
 	timeval_t sands;		/* rest of time sands value. */
+	int heap_idx;			/* 1-based index in timer heap, 0 if not queued */
 	union {
 		int val;		/* second argument of the event. */
 		int fd;			/* file descriptor in case of read/write. */
@@ -60,6 +64,13 @@ typedef struct _thread_list {
 	int count;
 } thread_list_t;
 
+/* Read and write threads waiting on one fd. */
+typedef struct _thread_fd {
+	thread_t *read;
+	thread_t *write;
+	uint32_t events;		/* events registered to epoll */
+} thread_fd_t;
+
 /* Master of the theads. */
 typedef struct _thread_master {
 	thread_list_t read;
@@ -69,9 +80,20 @@ typedef struct _thread_master {
 	thread_list_t event;
 	thread_list_t ready;
 	thread_list_t unuse;
-	fd_set readfd;
-	fd_set writefd;
-	fd_set exceptfd;
+	thread_fd_t *fds;		/* indexed by fd */
+	int fds_size;
+	thread_t **heap;		/* min-heap of timed threads by sands */
+	int heap_count;
+	int heap_size;
+	int epoll_fd;
+	int timer_fd;			/* timerfd armed to the nearest sands */
+	int signal_fd;			/* signal pipe registered to epoll */
+	struct epoll_event *events;
+	int events_size;
+#ifdef _WITH_SNMP_
+	fd_set snmp_fds;		/* snmp fds registered to epoll */
+	int snmp_maxfd;
+#endif
 	unsigned long alloc;
 } thread_master_t;
 
@@ -110,6 +132,7 @@ extern void thread_destroy_master(thread_master_t *);
 extern thread_t *thread_add_read(thread_master_t *, int (*func) (thread_t *), void *, int, long);
 extern thread_t *thread_add_write(thread_master_t *, int (*func) (thread_t *), void *, int, long);
 extern thread_t *thread_add_timer(thread_master_t *, int (*func) (thread_t *), void *, long);
+extern long thread_spread_delay(long, int, int);
 extern thread_t *thread_add_child(thread_master_t *, int (*func) (thread_t *), void *, pid_t, long);
 extern thread_t *thread_add_event(thread_master_t *, int (*func) (thread_t *), void *, int);
 extern int thread_cancel(thread_t *);